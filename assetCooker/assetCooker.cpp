@@ -0,0 +1,304 @@
+#include "assetCooker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#include "core/hash.h"
+#include "core/threadPool.h"
+#include "renderer/model.h"
+#include "renderer/textureFile.h"
+#include "renderer/texture/ktxFile.h"
+
+#include "cookManifest.h"
+
+
+namespace cooker {
+
+// bump this when the cooker itself changes what it writes
+constexpr uint64_t g_CookerVersion = 1;
+
+// the application loads the models with the default options
+static ModelLoadOptions GetModelLoadOptions(uint32_t threadCount, AssetCache* cache)
+{
+	ModelLoadOptions options{};
+	options.cache = cache;
+	options.threadCount = threadCount;
+	return options;
+}
+
+static uint64_t GetMeshKey()
+{
+	const ModelLoadOptions options = GetModelLoadOptions(0, nullptr);
+
+	uint64_t key = hash::Combine(g_CookerVersion, MESH_FILE_VERSION);
+	key = hash::Combine(key, static_cast<uint64_t>(options.vertexLayout));
+	key = hash::Combine(key, options.optimizeMesh);
+	key = hash::Combine(key, options.buildMeshlets);
+	key = hash::Combine(key, options.buildLods);
+	key = hash::Combine(key, options.splitSubmeshes);
+	return hash::Combine(key, options.compressCookedMesh);
+}
+
+static uint64_t GetShaderKey(const AssetCookerOptions& options)
+{
+	const uint64_t key = hash::Combine(g_CookerVersion, 0);
+	return hash::HashBytes(options.glslcPath.data(), options.glslcPath.size(), key);
+}
+
+static std::string ToLower(std::string text)
+{
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+	return text;
+}
+
+static std::vector<CookJob> FindJobs(const AssetCookerOptions& options)
+{
+	std::vector<CookJob> jobs;
+
+	std::error_code errorCode;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator{ options.assetDirectory, errorCode })
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		const std::string source = entry.path().generic_string();
+		const std::string extension = ToLower(entry.path().extension().string());
+
+		CookJob job{};
+		job.source = source;
+		job.inputs.push_back(source);
+		if (extension == ".obj")
+		{
+			job.type = CookJobType::MESH;
+			job.output = Model::GetCookedPath(source);
+			job.key = GetMeshKey();
+		}
+		else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga"
+				 || extension == ".bmp")
+		{
+			job.type = CookJobType::TEXTURE;
+			job.output = TextureFile::GetCookedPath(source);
+			job.key = hash::Combine(hash::Combine(g_CookerVersion, TEXTURE_FILE_VERSION),
+				static_cast<uint64_t>(options.mipFilter));
+
+			// the device picks one of them when the texture is loaded
+			CookJob compressedJob = job;
+			compressedJob.type = CookJobType::COMPRESSED_TEXTURE;
+			compressedJob.output = KtxFile::GetCookedPath(source);
+			compressedJob.key = hash::Combine(hash::Combine(g_CookerVersion, KTX_FILE_VERSION),
+				static_cast<uint64_t>(options.mipFilter));
+			jobs.push_back(std::move(compressedJob));
+		}
+		else if (extension == ".vert" || extension == ".frag" || extension == ".comp")
+		{
+			job.type = CookJobType::SHADER;
+			job.output = source + ".spv";
+			job.key = GetShaderKey(options);
+		}
+		else
+		{
+			continue;
+		}
+
+		jobs.push_back(std::move(job));
+	}
+
+	if (errorCode)
+		throw std::runtime_error("Failed to list the assets in: " + options.assetDirectory);
+
+	// the same order on every run, so that the output is comparable
+	std::sort(jobs.begin(), jobs.end(), [](const CookJob& lhs, const CookJob& rhs) { return lhs.output < rhs.output; });
+	return jobs;
+}
+
+// hashes the inputs of the job; the material libraries of an unchanged OBJ
+// are the ones recorded, so it is not scanned again
+static std::vector<CookInput> HashInputs(CookJob& job, const CookRecord* previous)
+{
+	std::vector<CookInput> inputs{ CookManifest::HashInput(job.source, previous) };
+	if (job.type != CookJobType::MESH || inputs[0].hash == 0)
+		return inputs;
+
+	if (previous && !previous->inputs.empty() && previous->inputs[0].path == job.source
+		&& previous->inputs[0].hash == inputs[0].hash)
+	{
+		for (size_t i = 1; i < previous->inputs.size(); ++i)
+			job.inputs.push_back(previous->inputs[i].path);
+	}
+	else
+	{
+		const std::vector<std::string> libraries = mesh::FindMaterialLibraries(job.source);
+		job.inputs.insert(job.inputs.end(), libraries.begin(), libraries.end());
+	}
+
+	for (size_t i = 1; i < job.inputs.size(); ++i)
+		inputs.push_back(CookManifest::HashInput(job.inputs[i], previous));
+
+	return inputs;
+}
+
+static void CompileShader(const CookJob& job, const AssetCookerOptions& options, AssetCache* cache)
+{
+	const uint64_t cacheKey = cache ? AssetCache::MakeKey("spirv", 1, hash::HashFile(job.source), job.key) : 0;
+	if (cache && cache->Extract(cacheKey, job.output))
+		return;
+
+	const std::string tempPath = job.output + ".tmp";
+	std::string command = "\"" + options.glslcPath + "\" \"" + job.source + "\" -o \"" + tempPath + "\"";
+#ifdef _WIN32
+	// cmd strips the outer quotes of a command that starts with one
+	command = "\"" + command + "\"";
+#endif
+
+	if (std::system(command.c_str()) != 0)
+		throw std::runtime_error("glslc failed on " + job.source);
+
+	std::filesystem::rename(tempPath, job.output);
+	if (cache)
+		cache->StoreFile(cacheKey, job.output);
+}
+
+// throws if the output could not be cooked
+static void RunJob(const CookJob& job, const AssetCookerOptions& options, uint32_t threadCount, AssetCache* cache)
+{
+	switch (job.type)
+	{
+	case CookJobType::MESH:
+	{
+		// the model only compares the file times and the options, so a stale
+		// mesh could be taken as up to date; without one it parses the OBJ
+		// and cooks it
+		std::error_code errorCode;
+		std::filesystem::remove(job.output, errorCode);
+		Model{ job.source.c_str(), GetModelLoadOptions(threadCount, cache) };
+		if (!std::filesystem::is_regular_file(job.output, errorCode))
+			throw std::runtime_error("Failed to write " + job.output);
+		break;
+	}
+	case CookJobType::TEXTURE:
+	{
+		ThreadPool threadPool{ threadCount };
+		if (!TextureFile::Cook(job.source, job.output, threadPool, cache, options.mipFilter))
+			throw std::runtime_error("Failed to write " + job.output);
+		break;
+	}
+	case CookJobType::COMPRESSED_TEXTURE:
+	{
+		ThreadPool threadPool{ threadCount };
+		if (!KtxFile::Cook(job.source, job.output, threadPool, cache, options.mipFilter))
+			throw std::runtime_error("Failed to write " + job.output);
+		break;
+	}
+	case CookJobType::SHADER:
+		CompileShader(job, options, cache);
+		break;
+	}
+}
+
+AssetCookStats CookAssets(const AssetCookerOptions& options)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const std::string manifestPath = options.manifestPath.empty()
+		? (std::filesystem::path{ options.assetDirectory } / "cookManifest.txt").generic_string()
+		: options.manifestPath;
+	CookManifest manifest{ manifestPath };
+
+	std::vector<CookJob> jobs = FindJobs(options);
+
+	std::unique_ptr<AssetCache> cache;
+	if (!options.cacheDirectory.empty())
+		cache = std::make_unique<AssetCache>(options.cacheDirectory, options.maxCacheSize);
+
+	AssetCookStats stats{};
+	std::vector<CookJob*> staleJobs;
+	std::vector<std::vector<CookInput>> staleInputs;
+	std::vector<CookRecord> records;
+	for (CookJob& job : jobs)
+	{
+		const CookRecord* previous = manifest.Find(job.output);
+		std::vector<CookInput> inputs = HashInputs(job, previous);
+		if (!options.force && manifest.IsUpToDate(job.output, job.key, inputs))
+		{
+			++stats.upToDate;
+			records.push_back(*previous);
+			continue;
+		}
+
+		staleJobs.push_back(&job);
+		staleInputs.push_back(std::move(inputs));
+	}
+
+	// the biggest jobs first, so that a large model does not start last
+	// while the other threads are idle
+	std::vector<size_t> order(staleJobs.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&staleInputs](size_t lhs, size_t rhs) {
+		return staleInputs[lhs][0].size > staleInputs[rhs][0].size;
+	});
+
+	// every job gets its share of the threads for its own parallel work,
+	// so a single large model still uses every core
+	ThreadPool threadPool{ options.threadCount };
+	const uint32_t jobThreads = std::max<uint32_t>(
+		1, threadPool.GetThreadCount() / std::max<uint32_t>(1, static_cast<uint32_t>(staleJobs.size())));
+
+	std::mutex mutex;
+	std::vector<std::future<void>> futures;
+	for (size_t i : order)
+	{
+		futures.push_back(threadPool.Submit([&, i]() {
+			const CookJob& job = *staleJobs[i];
+			const auto jobStart = std::chrono::high_resolution_clock::now();
+			try
+			{
+				RunJob(job, options, jobThreads, cache.get());
+			} catch (const std::exception& e)
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				std::cout << "Failed to cook " << job.output << ": " << e.what() << '\n';
+				++stats.failed;
+				return;
+			}
+			const auto jobEnd = std::chrono::high_resolution_clock::now();
+
+			std::error_code errorCode;
+			CookRecord record{};
+			record.output = job.output;
+			record.key = job.key;
+			record.outputSize = std::filesystem::file_size(job.output, errorCode);
+			record.inputs = std::move(staleInputs[i]);
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			std::cout << "Cooked " << job.output << " in "
+					  << std::chrono::duration<double, std::milli>(jobEnd - jobStart).count() << " ms\n";
+			records.push_back(std::move(record));
+			++stats.cooked;
+		}));
+	}
+	for (std::future<void>& future : futures)
+		future.get();
+
+	// rebuilt from the current jobs only, so the records of deleted assets
+	// are dropped, and so are the ones of failed jobs to cook them again
+	manifest.Clear();
+	for (CookRecord& record : records)
+		manifest.Set(std::move(record));
+	if (!manifest.Write())
+		std::cout << "Failed to write the cook manifest: " << manifestPath << '\n';
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return stats;
+}
+
+} // namespace cooker
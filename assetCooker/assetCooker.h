@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/assetCache.h"
+#include "renderer/texture/mipChain.h"
+
+
+enum class CookJobType
+{
+	MESH, // OBJ -> .mesh (`MeshFile`)
+	TEXTURE, // png, jpg, tga, bmp -> .tex (`TextureFile`), for devices without BC texture compression
+	COMPRESSED_TEXTURE, // png, jpg, tga, bmp -> .ktx2 (`KtxFile`), BC1, BC5 or BC7 with the mip chain
+	SHADER // GLSL -> SPIR-V (.spv next to the source), compiled with glslc
+};
+
+// converts one source asset into its cooked form
+struct CookJob
+{
+	CookJobType type;
+	std::string source;
+	std::string output;
+	// every file the output depends on, the source first
+	std::vector<std::string> inputs;
+	// the cooker version and options the output is cooked with
+	uint64_t key;
+};
+
+struct AssetCookerOptions
+{
+	// paths in the cooked meshes are relative to the working directory, so
+	// the cooker runs from the root of the repo like the application
+	std::string assetDirectory = "assets";
+	// defaults to cookManifest.txt in the asset directory
+	std::string manifestPath;
+	std::string glslcPath = "glslc";
+	// content addressed cache of cooked assets, shared with the application;
+	// an asset whose inputs were cooked before (eg: on another branch) is
+	// copied from it instead of being cooked again; empty to disable it
+	std::string cacheDirectory = "cache";
+	uint64_t maxCacheSize = DEFAULT_ASSET_CACHE_SIZE;
+	// filter of the mip chains of the cooked textures; the application cooks
+	// the textures it loads with KAISER
+	texture::MipFilter mipFilter = texture::MipFilter::KAISER;
+	// jobs run at once; 0 uses one per hardware thread
+	uint32_t threadCount = 0;
+	// cook every asset, even the unchanged ones
+	bool force = false;
+};
+
+struct AssetCookStats
+{
+	// including the ones copied from the cache
+	uint32_t cooked;
+	uint32_t upToDate;
+	uint32_t failed;
+	double milliseconds;
+};
+
+
+namespace cooker {
+
+// cooks the assets whose inputs changed since the last run, on multiple
+// threads, and updates the manifest; failed jobs are cooked again on the
+// next run
+AssetCookStats CookAssets(const AssetCookerOptions& options);
+
+} // namespace cooker
@@ -0,0 +1,163 @@
+#include "cookManifest.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "core/hash.h"
+
+
+// bump this when the records change
+constexpr const char* g_ManifestHeader = "assetCooker manifest 1";
+
+CookManifest::CookManifest(const std::string& path)
+	: m_Path{ path }
+{
+	Read();
+}
+
+void CookManifest::Read()
+{
+	std::ifstream file{ m_Path };
+	std::string line;
+	if (!file.is_open() || !std::getline(file, line) || line != g_ManifestHeader)
+		return;
+
+	CookRecord* record = nullptr;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream{ line };
+		std::string type;
+		stream >> type;
+
+		// the path is the rest of the line, it may contain spaces
+		auto readPath = [&stream]() {
+			std::string path;
+			stream >> std::ws;
+			std::getline(stream, path);
+			return path;
+		};
+
+		if (type == "output")
+		{
+			CookRecord newRecord{};
+			stream >> std::hex >> newRecord.key >> std::dec >> newRecord.outputSize;
+			newRecord.output = readPath();
+			if (!stream && !stream.eof())
+			{
+				// a corrupt manifest only means cooking everything again
+				m_Records.clear();
+				return;
+			}
+
+			record = &(m_Records[newRecord.output] = std::move(newRecord));
+		}
+		else if (type == "input" && record)
+		{
+			CookInput input{};
+			stream >> std::hex >> input.hash >> std::dec >> input.size >> input.writeTime;
+			input.path = readPath();
+			record->inputs.push_back(std::move(input));
+		}
+	}
+}
+
+bool CookManifest::Write() const
+{
+	const std::string tempPath = m_Path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::trunc };
+		if (!file.is_open())
+			return false;
+
+		file << g_ManifestHeader << '\n';
+		for (const auto& [output, record] : m_Records)
+		{
+			file << "output " << std::hex << record.key << std::dec << ' ' << record.outputSize << ' ' << output
+				 << '\n';
+			for (const CookInput& input : record.inputs)
+			{
+				file << "input " << std::hex << input.hash << std::dec << ' ' << input.size << ' '
+					 << input.writeTime << ' ' << input.path << '\n';
+			}
+		}
+
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, m_Path, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return true;
+}
+
+CookInput CookManifest::HashInput(const std::string& path, const CookRecord* previous)
+{
+	CookInput input{ path, 0, 0, 0 };
+
+	std::error_code errorCode;
+	if (!std::filesystem::is_regular_file(path, errorCode))
+		return input;
+
+	input.size = std::filesystem::file_size(path, errorCode);
+	input.writeTime =
+		static_cast<int64_t>(std::filesystem::last_write_time(path, errorCode).time_since_epoch().count());
+	if (errorCode)
+		return input;
+
+	if (previous)
+	{
+		for (const CookInput& previousInput : previous->inputs)
+		{
+			if (previousInput.path == path && previousInput.size == input.size
+				&& previousInput.writeTime == input.writeTime && previousInput.hash != 0)
+			{
+				input.hash = previousInput.hash;
+				return input;
+			}
+		}
+	}
+
+	// 0 is kept for missing files
+	input.hash = std::max<uint64_t>(hash::HashFile(path), 1);
+	return input;
+}
+
+bool CookManifest::IsUpToDate(const std::string& output, uint64_t key, const std::vector<CookInput>& inputs) const
+{
+	const CookRecord* record = Find(output);
+	if (!record || record->key != key || record->inputs.size() != inputs.size())
+		return false;
+
+	std::error_code errorCode;
+	const uint64_t outputSize = std::filesystem::file_size(output, errorCode);
+	if (errorCode || outputSize != record->outputSize)
+		return false;
+
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		if (inputs[i].path != record->inputs[i].path || inputs[i].hash != record->inputs[i].hash)
+			return false;
+	}
+
+	return true;
+}
+
+const CookRecord* CookManifest::Find(const std::string& output) const
+{
+	const auto it = m_Records.find(output);
+	return it != m_Records.end() ? &it->second : nullptr;
+}
+
+void CookManifest::Set(CookRecord record)
+{
+	std::string output = record.output;
+	m_Records[std::move(output)] = std::move(record);
+}
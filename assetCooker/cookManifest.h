@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <vector>
+
+
+// a file a cooked asset was built from, eg: the OBJ and its material
+// libraries; missing files are recorded too (with a hash of 0), so that
+// creating them cooks the asset again
+struct CookInput
+{
+	std::string path;
+	uint64_t hash;
+	// only used to skip hashing files that were not touched since the last
+	// cook; a changed time with the same contents still counts as unchanged
+	uint64_t size;
+	int64_t writeTime;
+};
+
+// how an output was last cooked
+struct CookRecord
+{
+	std::string output;
+	// the cooker version and options of the job, any change cooks it again
+	uint64_t key;
+	// an output that was deleted or replaced since is cooked again
+	uint64_t outputSize;
+	std::vector<CookInput> inputs;
+};
+
+// the dependency manifest of the assetCooker: for every output, the content
+// hash of every input it was cooked from
+// stored as text next to the assets, one record per output:
+//     output <key> <output size> <path>
+//     input <hash> <size> <write time> <path>
+class CookManifest
+{
+public:
+	// a missing or unreadable manifest is empty, so everything is cooked
+	CookManifest(const std::string& path);
+
+	// hashes `path`, reusing the hash of the record when the size and write
+	// time of the file did not change since
+	static CookInput HashInput(const std::string& path, const CookRecord* previous);
+
+	// whether `output` has to be cooked from `inputs` (hashed with `HashInput`)
+	bool IsUpToDate(const std::string& output, uint64_t key, const std::vector<CookInput>& inputs) const;
+
+	const CookRecord* Find(const std::string& output) const;
+	void Set(CookRecord record);
+	inline void Clear() { m_Records.clear(); }
+
+	// written to a temporary file and renamed, like the cooked assets
+	bool Write() const;
+
+	inline size_t GetRecordCount() const { return m_Records.size(); }
+
+private:
+	void Read();
+
+private:
+	std::string m_Path;
+	// sorted, so that the manifest only changes where the assets did
+	std::map<std::string, CookRecord> m_Records;
+};
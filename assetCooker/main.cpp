@@ -0,0 +1,75 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// stb_image is only compiled into the application through texture.cpp
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+#include "assetCooker.h"
+
+
+static void PrintUsage()
+{
+	std::cout << "Usage: assetCooker [asset directory] [--threads count] [--glslc path] [--manifest path]\n"
+				 "                   [--cache directory] [--cache-size MB] [--mip-filter box|kaiser] [--force]\n"
+				 "    Cooks the meshes, textures and shaders of the asset directory (assets by default) that\n"
+				 "    changed since the last run. Run it from the root directory of the repo.\n"
+				 "    The cooked assets are also kept in the cache directory (cache by default, empty to disable\n"
+				 "    it), so that assets cooked before are copied instead of cooked again.\n"
+				 "    The mip chains of the textures are filtered with a Kaiser window by default, box is\n"
+				 "    faster but blurrier.\n";
+}
+
+int main(int argc, char** argv)
+{
+	AssetCookerOptions options{};
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.threadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (strcmp(argv[i], "--glslc") == 0 && hasValue)
+			options.glslcPath = argv[++i];
+		else if (strcmp(argv[i], "--manifest") == 0 && hasValue)
+			options.manifestPath = argv[++i];
+		else if (strcmp(argv[i], "--cache") == 0 && hasValue)
+			options.cacheDirectory = argv[++i];
+		else if (strcmp(argv[i], "--cache-size") == 0 && hasValue)
+			options.maxCacheSize = std::stoull(argv[++i]) * 1024 * 1024;
+		else if (strcmp(argv[i], "--mip-filter") == 0 && hasValue && strcmp(argv[i + 1], "box") == 0)
+		{
+			options.mipFilter = texture::MipFilter::BOX;
+			++i;
+		}
+		else if (strcmp(argv[i], "--mip-filter") == 0 && hasValue && strcmp(argv[i + 1], "kaiser") == 0)
+		{
+			options.mipFilter = texture::MipFilter::KAISER;
+			++i;
+		}
+		else if (strcmp(argv[i], "--force") == 0)
+			options.force = true;
+		else if (argv[i][0] != '-')
+			options.assetDirectory = argv[i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	try
+	{
+		const AssetCookStats stats = cooker::CookAssets(options);
+		std::cout << "Cooked " << stats.cooked << " assets, " << stats.upToDate << " up to date, " << stats.failed
+				  << " failed in " << stats.milliseconds << " ms\n";
+
+		return stats.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	} catch (const std::exception& e)
+	{
+		std::cout << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+}
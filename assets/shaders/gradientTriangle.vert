@@ -1,24 +1,24 @@
 #version 450
 
+// the position and texture coordinates may be quantized, see `VertexLayout`
+// the vertex input converts them to floats and the uniforms below decode them
 layout (location = 0) in vec3 inPosition;
-layout (location = 1) in vec3 inColor;
-layout (location = 2) in vec2 inTexCoord;
+layout (location = 1) in vec2 inTexCoord;
 
-layout (location = 0) out vec3 fragColor;
-layout (location = 1) out vec2 fragTexCoord;
+layout (location = 0) out vec2 fragTexCoord;
 
 // uniforms
-layout (binding = 0) uniform UniformBufferObjects
+layout (set = 0, binding = 0) uniform UniformBufferObjects
 {
-	mat4 model;
+	mat4 model; // also decodes the quantized positions
 	mat4 view;
 	mat4 proj;
+	vec4 texCoordTransform; // xy is the scale and zw the offset
 } ubo;
 
 
 void main()
 {
 	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-	fragColor = inColor;
-	fragTexCoord = inTexCoord;
+	fragTexCoord = inTexCoord * ubo.texCoordTransform.xy + ubo.texCoordTransform.zw;
 }
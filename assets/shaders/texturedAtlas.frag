@@ -0,0 +1,31 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// texturedBindless.frag for a texture packed in a page of an atlas (see
+// `texture::PackAtlas`): the texture coordinates repeat within its rect, and
+// the gutter around it keeps the samples from reading its neighbours
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in  vec2 fragTexCoord; // from the vertex shader
+
+// partially bound, only the slots textures were registered into are valid
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+// `AtlasConstants`, a texture with an image of its own has the whole page
+layout (push_constant) uniform AtlasInfo
+{
+	uint index; // of the page
+	uint firstLevel;
+	vec2 scale; // of the rect of the texture, in the coordinates of the page
+	vec2 offset;
+} atlasInfo;
+
+void main()
+{
+	// the level is picked from the derivatives of the unwrapped coordinates,
+	// which do not jump where the texture repeats
+	vec2 texCoord = fract(fragTexCoord) * atlasInfo.scale + atlasInfo.offset;
+	outColor = textureGrad(textures[atlasInfo.index],
+		texCoord,
+		dFdx(fragTexCoord) * atlasInfo.scale,
+		dFdy(fragTexCoord) * atlasInfo.scale);
+}
@@ -0,0 +1,22 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// gradientTriangle.frag with every texture of the frame in one array, that
+// the draws index with a push constant instead of binding a descriptor set
+// per texture
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in  vec2 fragTexCoord; // from the vertex shader
+
+// partially bound, only the slots textures were registered into are valid
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+// the same push constants as texturedFeedback.frag, without the first level
+layout (push_constant) uniform TextureInfo
+{
+	uint index;
+} textureInfo;
+
+void main()
+{
+	outColor = texture(textures[textureInfo.index], fragTexCoord);
+}
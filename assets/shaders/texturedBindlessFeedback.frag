@@ -0,0 +1,38 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// texturedFeedback.frag with every texture of the frame in one array, that
+// the draws index with a push constant instead of binding a descriptor set
+// per texture
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in  vec2 fragTexCoord; // from the vertex shader
+
+// partially bound, only the slots textures were registered into are valid
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+// the finest level of the whole chain per texture, reset to ~0 every frame
+layout (set = 0, binding = 1) buffer SamplingFeedback
+{
+	uint finestLevel[];
+} feedback;
+
+// the slot of the texture, which is also its slot in the feedback
+layout (push_constant) uniform TextureInfo
+{
+	uint index;
+	uint firstLevel; // of the chain, the first one resident in the image
+} textureInfo;
+
+void main()
+{
+	outColor = texture(textures[textureInfo.index], fragTexCoord);
+
+	// relative to the first resident level, negative when a finer one is
+	// wanted; the lower of the two levels a trilinear sample reads
+	float lod = textureQueryLod(textures[textureInfo.index], fragTexCoord).y;
+	uint level = uint(max(int(floor(lod)) + int(textureInfo.firstLevel), 0));
+
+	// most fragments sample no finer than the others did, and skip the atomic
+	if (level < feedback.finestLevel[textureInfo.index])
+		atomicMin(feedback.finestLevel[textureInfo.index], level);
+}
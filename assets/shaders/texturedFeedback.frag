@@ -0,0 +1,34 @@
+#version 450
+
+// gradientTriangle.frag, that also records the finest mip level every texture
+// is sampled at for `MipStreamer`
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in  vec2 fragTexCoord; // from the vertex shader
+
+layout (set = 1, binding = 0) uniform sampler2D texSampler;
+
+// the finest level of the whole chain per texture, reset to ~0 every frame
+layout (set = 0, binding = 1) buffer SamplingFeedback
+{
+	uint finestLevel[];
+} feedback;
+
+layout (push_constant) uniform TextureInfo
+{
+	uint index;
+	uint firstLevel; // of the chain, the first one resident in the image
+} textureInfo;
+
+void main()
+{
+	outColor = texture(texSampler, fragTexCoord);
+
+	// relative to the first resident level, negative when a finer one is
+	// wanted; the lower of the two levels a trilinear sample reads
+	float lod = textureQueryLod(texSampler, fragTexCoord).y;
+	uint level = uint(max(int(floor(lod)) + int(textureInfo.firstLevel), 0));
+
+	// most fragments sample no finer than the others did, and skip the atomic
+	if (level < feedback.finestLevel[textureInfo.index])
+		atomicMin(feedback.finestLevel[textureInfo.index], level);
+}
@@ -0,0 +1,83 @@
+#version 450
+
+// gradientTriangle.frag for a virtual texture: finds the tiles of the texels
+// in the tile cache through the page table, and records the pages it
+// samples for `VirtualTexture`
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in  vec2 fragTexCoord; // from the vertex shader
+
+// the slots of the tiles, each with a border around it
+layout (set = 1, binding = 0) uniform sampler2D tileCache;
+
+// not 0 for every page sampled by the frame, reset to 0 every frame
+layout (set = 0, binding = 1) buffer TileFeedback
+{
+	uint sampled[];
+} feedback;
+
+// a texel per page of every level: the slot of the page or of its finest
+// resident ancestor, the level of that tile, and 0 in alpha when nothing is
+// resident
+layout (set = 1, binding = 1) uniform usampler2D pageTable;
+
+layout (push_constant) uniform VirtualTextureInfo
+{
+	uvec2 size; // of level 0
+	uint tileSize;
+	uint tileBorder;
+	uint levelCount;
+	uint cacheSize; // slots on a side
+} info;
+
+// the pages of the levels follow each other, the finest first
+uint GetPageIndex(int level, ivec2 page)
+{
+	uint firstPage = 0;
+	for (int i = 0; i < level; ++i)
+	{
+		ivec2 pages = textureSize(pageTable, i);
+		firstPage += uint(pages.x * pages.y);
+	}
+	return firstPage + uint(page.y * textureSize(pageTable, level).x + page.x);
+}
+
+ivec2 GetPage(vec2 uv, int level)
+{
+	ivec2 pages = textureSize(pageTable, level);
+	return clamp(ivec2(uv * vec2(pages)), ivec2(0), pages - 1);
+}
+
+// bilinear within the tile the page falls back to, at the level of that tile
+vec4 SampleLevel(vec2 uv, int level)
+{
+	uvec4 entry = texelFetch(pageTable, GetPage(uv, level), level);
+	if (entry.a == 0u)
+		return vec4(0.0);
+
+	vec2 texel = uv * vec2(max(info.size >> entry.b, uvec2(1)));
+	vec2 inTile = texel - floor(texel / float(info.tileSize)) * float(info.tileSize);
+
+	float slotSize = float(info.tileSize + 2u * info.tileBorder);
+	vec2 cacheTexel = vec2(entry.rg) * slotSize + float(info.tileBorder) + inTile;
+	return textureLod(tileCache, cacheTexel / (slotSize * float(info.cacheSize)), 0.0);
+}
+
+void main()
+{
+	// repeats like the samplers of the other textures
+	vec2 uv = fract(fragTexCoord);
+
+	// the derivatives of the unwrapped coordinates, which do not jump at the
+	// seams
+	vec2 texelCoord = fragTexCoord * vec2(info.size);
+	vec2 dx = dFdx(texelCoord);
+	vec2 dy = dFdy(texelCoord);
+	float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, float(info.levelCount - 1u));
+
+	int level = int(lod);
+	int coarserLevel = min(level + 1, int(info.levelCount) - 1);
+	outColor = mix(SampleLevel(uv, level), SampleLevel(uv, coarserLevel), fract(lod));
+
+	// the finer of the two levels, the coarser one is kept with it
+	feedback.sampled[GetPageIndex(level, GetPage(uv, level))] = 1u;
+}
@@ -0,0 +1,55 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "benchmark.h"
+
+
+// replaces the global operator new and delete of the benchmarks executable
+// so that every allocation is counted
+// kept in its own file so that the compiler can not inline them into the
+// benchmarks and see the size stored in front of every allocation
+static std::atomic<uint64_t> g_AllocationCount{ 0 };
+static std::atomic<int64_t> g_AllocatedBytes{ 0 };
+
+// the size of every allocation is stored in front of it, keeping the
+// alignment malloc guarantees
+constexpr size_t g_AllocationHeaderSize = alignof(std::max_align_t);
+
+void* operator new(size_t size)
+{
+	void* allocation = std::malloc(size + g_AllocationHeaderSize);
+	if (allocation == nullptr)
+		throw std::bad_alloc{};
+
+	g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	g_AllocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+	*static_cast<size_t*>(allocation) = size;
+	return static_cast<uint8_t*>(allocation) + g_AllocationHeaderSize;
+}
+
+void operator delete(void* pointer) noexcept
+{
+	if (pointer == nullptr)
+		return;
+
+	void* allocation = static_cast<uint8_t*>(pointer) - g_AllocationHeaderSize;
+	g_AllocatedBytes.fetch_sub(static_cast<int64_t>(*static_cast<size_t*>(allocation)), std::memory_order_relaxed);
+	std::free(allocation);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+uint64_t GetAllocationCount()
+{
+	return g_AllocationCount.load(std::memory_order_relaxed);
+}
+
+int64_t GetAllocatedBytes()
+{
+	return g_AllocatedBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "assetCooker.h"
+
+
+static void PrintCook(const std::string& name, const AssetCookStats& stats)
+{
+	std::cout << "    " << name << stats.milliseconds << " ms (" << stats.cooked << " cooked, " << stats.upToDate
+			  << " up to date, " << stats.failed << " failed)\n";
+}
+
+// cooks a copy of the assets from scratch on one and on every thread, then
+// measures the incremental runs that find nothing or a single asset to cook,
+// and a full cook that finds every asset in the asset cache
+static void RunAssetCookBenchmark(const BenchmarkArgs& args)
+{
+	const std::string assetDirectory = GetArg(args, 0, "assets");
+	const std::string glslcPath = GetArg(args, 1, "glslc");
+	const uint32_t maxThreads = GetThreadCountArg(args, 2);
+
+	// a copy, so that the cooked assets and the manifest of the repo are left
+	// alone; the cooked ones are removed to cook everything
+	const std::filesystem::path copyDirectory = std::filesystem::temp_directory_path() / "assetCookBenchmark";
+	std::filesystem::remove_all(copyDirectory);
+	std::filesystem::copy(assetDirectory, copyDirectory, std::filesystem::copy_options::recursive);
+
+	AssetCookerOptions options{};
+	options.assetDirectory = copyDirectory.generic_string();
+	options.glslcPath = glslcPath;
+	options.cacheDirectory.clear();
+	options.force = true;
+
+	options.threadCount = 1;
+	const AssetCookStats single = cooker::CookAssets(options);
+	options.threadCount = maxThreads;
+	const AssetCookStats parallel = cooker::CookAssets(options);
+
+	// nothing changed, only the file times and sizes are checked
+	options.force = false;
+	const AssetCookStats unchanged = cooker::CookAssets(options);
+
+	// the same contents with a new time are hashed again, but not cooked
+	std::filesystem::path touched;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator{ copyDirectory })
+	{
+		if (entry.path().extension() == ".obj")
+			touched = entry.path();
+	}
+	if (!touched.empty())
+		std::filesystem::last_write_time(touched, std::filesystem::file_time_type::clock::now());
+	const AssetCookStats rehashed = cooker::CookAssets(options);
+
+	// filled by the first cook, every asset is copied by the second one
+	const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "assetCookBenchmarkCache";
+	std::filesystem::remove_all(cacheDirectory);
+	options.cacheDirectory = cacheDirectory.generic_string();
+	options.force = true;
+	cooker::CookAssets(options);
+	const AssetCookStats cached = cooker::CookAssets(options);
+
+	std::cout << '\n';
+	PrintCook("1 thread:   ", single);
+	PrintCook(std::to_string(maxThreads) + " thread(s): ", parallel);
+	PrintCook("unchanged:  ", unchanged);
+	PrintCook("touched:    ", rehashed);
+	PrintCook("from cache: ", cached);
+
+	std::filesystem::remove_all(copyDirectory);
+	std::filesystem::remove_all(cacheDirectory);
+}
+
+static const BenchmarkRegistration g_Registration{ "assetCook",
+	"[asset directory] [glslc path] [max threads]: full cook on 1 vs every thread and incremental cooks",
+	RunAssetCookBenchmark };
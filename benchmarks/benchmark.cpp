@@ -0,0 +1,140 @@
+#include "benchmark.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "renderer/mesh/objParser.h"
+
+
+std::vector<Benchmark>& GetBenchmarks()
+{
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name,
+	const char* description,
+	std::function<void(const BenchmarkArgs&)> run)
+{
+	GetBenchmarks().push_back(Benchmark{ name, description, std::move(run) });
+}
+
+static uint32_t g_FailedCheckCount = 0;
+
+bool Check(bool passed, const std::string& message)
+{
+	if (!passed)
+	{
+		std::cout << "    CHECK FAILED: " << message << '\n';
+		++g_FailedCheckCount;
+	}
+
+	return passed;
+}
+
+uint32_t GetFailedCheckCount()
+{
+	return g_FailedCheckCount;
+}
+
+// the libraries of a `mtllib` line, next to the copy of the model; the
+// reference parser only finds them relative to the model
+static void CopyMaterialLibraries(const std::string& line,
+	const std::string& modelPath,
+	const std::string& repeatedPath)
+{
+	const std::filesystem::path sourceDirectory = std::filesystem::path{ modelPath }.parent_path();
+	const std::filesystem::path destinationDirectory = std::filesystem::path{ repeatedPath }.parent_path();
+
+	std::istringstream libraries{ line.substr(7) };
+	for (std::string library; libraries >> library;)
+	{
+		std::error_code errorCode;
+		const std::filesystem::path destination = destinationDirectory / library;
+		if (std::filesystem::equivalent(sourceDirectory / library, destination, errorCode))
+			continue;
+
+		std::filesystem::create_directories(destination.parent_path(), errorCode);
+		std::filesystem::copy_file(sourceDirectory / library,
+			destination,
+			std::filesystem::copy_options::overwrite_existing,
+			errorCode);
+	}
+}
+
+// relative face indices keep every copy pointing at its own vertices
+static void WriteRepeatedObj(const std::string& modelPath, uint32_t repeatCount, const std::string& repeatedPath)
+{
+	std::ifstream source{ modelPath };
+	if (!source.is_open())
+		throw std::runtime_error("Failed to open model: " + modelPath);
+
+	std::stringstream buffer;
+	buffer << source.rdbuf();
+	const std::string contents = buffer.str();
+
+	const ObjData objData = mesh::ParseObjReference(modelPath);
+	std::stringstream relative;
+	size_t positionCount = 0;
+	size_t texCoordCount = 0;
+	std::istringstream lines{ contents };
+	std::string line;
+	size_t faceIndex = 0;
+	while (std::getline(lines, line))
+	{
+		if (line.rfind("v ", 0) == 0)
+			++positionCount;
+		if (line.rfind("vt ", 0) == 0)
+			++texCoordCount;
+		if (line.rfind("mtllib ", 0) == 0)
+			CopyMaterialLibraries(line, modelPath, repeatedPath);
+		if (line.rfind("f ", 0) != 0)
+		{
+			relative << line << '\n';
+			continue;
+		}
+
+		// the reference parser only emits triangles for this benchmark's models
+		relative << 'f';
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const ObjIndex& index = objData.indices[faceIndex * 3 + corner];
+			relative << ' ' << static_cast<int64_t>(index.vertexIndex) - static_cast<int64_t>(positionCount) << '/'
+					 << static_cast<int64_t>(index.texCoordIndex) - static_cast<int64_t>(texCoordCount);
+		}
+		relative << '\n';
+		++faceIndex;
+	}
+
+	std::ofstream output{ repeatedPath, std::ios::binary | std::ios::trunc };
+	const std::string relativeContents = relative.str();
+	for (uint32_t i = 0; i < repeatCount; ++i)
+		output << relativeContents;
+
+	if (!output.good())
+		throw std::runtime_error("Failed to write repeated model: " + repeatedPath);
+}
+
+RepeatedObj::RepeatedObj(const std::string& modelPath, uint32_t repeatCount, const std::string& name)
+	: m_Path{ modelPath },
+	  m_Written{ repeatCount > 1 }
+{
+	if (!m_Written)
+		return;
+
+	m_Path = (std::filesystem::temp_directory_path() / (name + ".obj")).string();
+	WriteRepeatedObj(modelPath, repeatCount, m_Path);
+}
+
+RepeatedObj::~RepeatedObj()
+{
+	if (m_Written)
+	{
+		std::error_code errorCode;
+		std::filesystem::remove(m_Path, errorCode);
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// arguments passed after the benchmark name on the command line
+using BenchmarkArgs = std::vector<std::string>;
+
+// what most benchmarks load by default
+constexpr const char* DEFAULT_MODEL_PATH = "assets/models/viking_room.obj";
+constexpr const char* DEFAULT_TEXTURE_PATH = "assets/textures/viking_room.png";
+
+// see `BenchmarkRegistration`
+struct Benchmark
+{
+	const char* name;
+	const char* description;
+	std::function<void(const BenchmarkArgs&)> run;
+};
+
+// runs `func` `iterations` times and returns the fastest run in milliseconds
+// the fastest run is the least disturbed by the OS, so it is the most
+// repeatable number to compare between runs
+template<typename Func>
+double MeasureMilliseconds(uint32_t iterations, Func&& func)
+{
+	double best = 0.0;
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		func();
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		const double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+		if (i == 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	return best;
+}
+
+inline std::string GetArg(const BenchmarkArgs& args, size_t index, const std::string& defaultValue)
+{
+	return index < args.size() ? args[index] : defaultValue;
+}
+
+// the argument at `index` as a number, times `unit` (eg: 1024 * 1024 for an
+// argument in MB); `defaultValue` is in units too
+inline uint64_t GetSizeArg(const BenchmarkArgs& args, size_t index, uint64_t defaultValue, uint64_t unit = 1)
+{
+	return (index < args.size() ? std::stoull(args[index]) : defaultValue) * unit;
+}
+
+inline uint32_t GetUintArg(const BenchmarkArgs& args, size_t index, uint32_t defaultValue)
+{
+	return index < args.size() ? static_cast<uint32_t>(std::stoul(args[index])) : defaultValue;
+}
+
+inline float GetFloatArg(const BenchmarkArgs& args, size_t index, float defaultValue)
+{
+	return index < args.size() ? std::stof(args[index]) : defaultValue;
+}
+
+// a thread count, one per hardware thread if it is not given or 0
+inline uint32_t GetThreadCountArg(const BenchmarkArgs& args, size_t index)
+{
+	const uint32_t threadCount = GetUintArg(args, index, 0);
+	return threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// a result the benchmark relies on, eg: that a faster path builds the same
+// output as the reference one; a failed check prints `message`, what went
+// wrong, and the benchmarks exit with a failure once they are done, so that
+// they can gate a build
+// returns `passed`
+bool Check(bool passed, const std::string& message);
+uint32_t GetFailedCheckCount();
+
+// the global operator new of the benchmarks executable counts every
+// allocation and the bytes that are still allocated
+uint64_t GetAllocationCount();
+int64_t GetAllocatedBytes();
+
+// the OBJ a benchmark loads: the model itself, or `repeatCount` copies of it
+// written into a single OBJ of the temporary directory (`name`.obj, removed
+// again with it), so that the scaling can be measured on files the size of
+// photogrammetry scans; the material libraries are copied next to it
+class RepeatedObj
+{
+public:
+	RepeatedObj(const std::string& modelPath, uint32_t repeatCount, const std::string& name);
+	~RepeatedObj();
+
+	RepeatedObj(const RepeatedObj&) = delete;
+	RepeatedObj& operator=(const RepeatedObj&) = delete;
+
+	inline const std::string& GetPath() const { return m_Path; }
+
+private:
+	std::string m_Path;
+	bool m_Written;
+};
+
+// adds a benchmark to the ones `main` runs, from a static of the file that
+// defines it:
+//     static const BenchmarkRegistration g_Registration{ "name", "[arguments]: what it measures", Run };
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, const char* description, std::function<void(const BenchmarkArgs&)> run);
+};
+
+// every registered benchmark, in the order they registered in
+std::vector<Benchmark>& GetBenchmarks();
@@ -0,0 +1,105 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+#include "benchmark.h"
+#include "core/codec.h"
+#include "renderer/model.h"
+
+
+// encodes `data` with every encoding in `encodings` and reports the size and
+// the decode throughput of each, on one thread and on `threadCount`
+static void MeasureStream(const char* name,
+	Span<const uint8_t> data,
+	uint32_t elementSize,
+	std::initializer_list<StreamEncoding> encodings,
+	uint32_t iterations,
+	uint32_t threadCount)
+{
+	static const char* const encodingNames[] = { "raw", "lz", "delta", "index" };
+
+	ThreadPool singleThread{ 1 };
+	ThreadPool threadPool{ threadCount };
+	std::vector<uint8_t> decoded(data.size());
+
+	std::cout << "    " << name << ": " << data.size() << " bytes\n";
+	for (StreamEncoding encoding : encodings)
+	{
+		std::vector<uint8_t> encoded;
+		const double encodeTime = MeasureMilliseconds(1, [&]() {
+			encoded = codec::Encode(data, encoding, elementSize, threadPool);
+		});
+		const EncodedStream stream{ encoded, data.size(), encoding, elementSize };
+
+		// GB/s of decoded bytes, the rate the staging buffers are filled at
+		auto measureDecode = [&](ThreadPool& pool) {
+			const double milliseconds =
+				MeasureMilliseconds(iterations, [&]() { codec::Decode(stream, decoded.data(), pool); });
+			return static_cast<double>(data.size()) / (milliseconds * 1e6);
+		};
+		const double singleThreadRate = measureDecode(singleThread);
+		const double rate = measureDecode(threadPool);
+
+		Check(memcmp(decoded.data(), data.data(), data.size()) == 0,
+			std::string{ "the decoded stream does not match the source: " } + name);
+
+		std::cout << "        " << encodingNames[static_cast<uint32_t>(encoding)] << ": " << encoded.size()
+				  << " bytes (" << 100.0 * static_cast<double>(encoded.size()) / static_cast<double>(data.size())
+				  << "%), encode " << encodeTime << " ms, decode " << singleThreadRate << " GB/s on 1 thread, "
+				  << rate << " GB/s on " << threadPool.GetThreadCount() << " threads\n";
+	}
+}
+
+// size and decode throughput of the cooked asset codec on the vertices and
+// indices of a model and the texels of a texture
+static void RunCodecBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const std::string texturePath = GetArg(args, 1, DEFAULT_TEXTURE_PATH);
+	const uint32_t iterations = GetUintArg(args, 2, 10);
+	const uint32_t threadCount = GetThreadCountArg(args, 3);
+
+	{
+		ModelLoadOptions options{};
+		options.useCookedMesh = false;
+		const Model model{ modelPath.c_str(), options };
+
+		const EncodedStream vertexData = model.GetVertexData();
+		const EncodedStream indexData = model.GetIndexData();
+		MeasureStream("vertices",
+			vertexData.data,
+			model.GetVertexStride(),
+			{ StreamEncoding::RAW, StreamEncoding::LZ, StreamEncoding::DELTA },
+			iterations,
+			threadCount);
+		MeasureStream("indices",
+			indexData.data,
+			model.GetIndexSize(),
+			{ StreamEncoding::RAW, StreamEncoding::LZ, StreamEncoding::INDEX },
+			iterations,
+			threadCount);
+	}
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	stbi_uc* texels = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!texels)
+		throw std::runtime_error("Failed to load texture image: " + texturePath);
+
+	MeasureStream("texels",
+		Span<const uint8_t>{ texels, static_cast<size_t>(width) * height * 4 },
+		4,
+		{ StreamEncoding::RAW, StreamEncoding::LZ, StreamEncoding::DELTA },
+		iterations,
+		threadCount);
+	stbi_image_free(texels);
+}
+
+static const BenchmarkRegistration g_Registration{ "codec",
+	"[model path] [texture path] [iterations] [max threads]: cooked asset size and decode GB/s",
+	RunCodecBenchmark };
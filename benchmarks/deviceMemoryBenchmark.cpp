@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/memory/tlsfAllocator.h"
+
+
+constexpr uint64_t g_MegaByte = 1024 * 1024;
+// the block of a resource with memory of its own
+constexpr uint32_t g_DedicatedBlock = ~0u;
+
+// a resource sub-allocated from a block, or with memory of its own
+struct SimulatedAllocation
+{
+	uint32_t block;
+	uint32_t handle;
+	uint64_t offset;
+	uint64_t size;
+};
+
+// the blocks of a memory type of `DeviceAllocator`, with an interval map per
+// block that checks every allocation against its neighbours
+class SimulatedPool
+{
+public:
+	SimulatedPool(uint64_t blockSize, uint64_t dedicatedThreshold)
+		: m_BlockSize{ blockSize },
+		  m_DedicatedThreshold{ dedicatedThreshold },
+		  m_DedicatedCount{ 0 },
+		  m_PeakMemoryObjects{ 0 },
+		  m_Errors{ 0 }
+	{
+	}
+
+	SimulatedAllocation Allocate(uint64_t size, uint64_t alignment)
+	{
+		SimulatedAllocation allocation{ g_DedicatedBlock, NO_TLSF_BLOCK, 0, size };
+		if (size > m_DedicatedThreshold)
+			return AllocateDedicated(allocation);
+
+		for (uint32_t i = 0; i < m_Blocks.size() && allocation.handle == NO_TLSF_BLOCK; ++i)
+		{
+			if (m_Blocks[i] == nullptr)
+				continue;
+			allocation.handle = m_Blocks[i]->Allocate(size, alignment, allocation.offset);
+			allocation.block = i;
+		}
+		if (allocation.handle == NO_TLSF_BLOCK)
+		{
+			// like `DeviceAllocator`, a request that does not fit an empty
+			// block goes dedicated
+			auto allocator = std::make_unique<TlsfAllocator>(m_BlockSize);
+			allocation.handle = allocator->Allocate(size, alignment, allocation.offset);
+			if (allocation.handle == NO_TLSF_BLOCK)
+				return AllocateDedicated(SimulatedAllocation{ g_DedicatedBlock, NO_TLSF_BLOCK, 0, size });
+
+			auto slot = std::find(m_Blocks.begin(), m_Blocks.end(), nullptr);
+			if (slot == m_Blocks.end())
+			{
+				m_Blocks.emplace_back();
+				m_Ranges.emplace_back();
+				slot = m_Blocks.end() - 1;
+			}
+			*slot = std::move(allocator);
+			allocation.block = static_cast<uint32_t>(slot - m_Blocks.begin());
+		}
+
+		CheckAllocation(allocation, alignment);
+		UpdatePeak();
+		return allocation;
+	}
+
+	void Free(const SimulatedAllocation& allocation)
+	{
+		if (allocation.block == g_DedicatedBlock)
+		{
+			--m_DedicatedCount;
+			return;
+		}
+
+		m_Ranges[allocation.block].erase(allocation.offset);
+		std::unique_ptr<TlsfAllocator>& block = m_Blocks[allocation.block];
+		block->Free(allocation.handle);
+
+		// like `DeviceAllocator`, the last block of the pool is kept
+		const auto usedBlocks = std::count_if(m_Blocks.begin(), m_Blocks.end(), [](const auto& other) {
+			return other != nullptr;
+		});
+		if (block->IsEmpty() && usedBlocks > 1)
+		{
+			CheckEmpty(*block);
+			block.reset();
+		}
+	}
+
+	// the free ranges of the blocks and how fragmented they are
+	void Report(const char* label) const
+	{
+		uint32_t blockCount = 0, freeRanges = 0;
+		uint64_t usedBytes = 0, freeBytes = 0, fragmentedBytes = 0;
+		for (const auto& block : m_Blocks)
+		{
+			if (block == nullptr)
+				continue;
+
+			const TlsfStats stats = block->GetStats();
+			++blockCount;
+			freeRanges += stats.freeBlockCount;
+			usedBytes += stats.usedBytes;
+			freeBytes += stats.freeBytes;
+			fragmentedBytes += stats.freeBytes - stats.largestFreeBlock;
+		}
+
+		const double fragmentation =
+			freeBytes > 0 ? 100.0 * static_cast<double>(fragmentedBytes) / static_cast<double>(freeBytes) : 0.0;
+		std::cout << "    " << label << ": " << blockCount << " blocks + " << m_DedicatedCount << " dedicated, "
+				  << usedBytes / g_MegaByte << " MB used, " << freeBytes / g_MegaByte << " MB free in " << freeRanges
+				  << " ranges, " << fragmentation << "% of it outside the largest range of its block\n";
+	}
+
+	void CheckAllFreed()
+	{
+		for (const auto& block : m_Blocks)
+		{
+			if (block != nullptr)
+				CheckEmpty(*block);
+		}
+	}
+
+	inline uint32_t GetPeakMemoryObjects() const { return m_PeakMemoryObjects; }
+	inline uint32_t GetErrors() const { return m_Errors; }
+
+private:
+	SimulatedAllocation AllocateDedicated(const SimulatedAllocation& allocation)
+	{
+		++m_DedicatedCount;
+		UpdatePeak();
+		return allocation;
+	}
+
+	void CheckAllocation(const SimulatedAllocation& allocation, uint64_t alignment)
+	{
+		std::map<uint64_t, uint64_t>& ranges = m_Ranges[allocation.block];
+		const uint64_t end = allocation.offset + allocation.size;
+		bool valid = allocation.handle != NO_TLSF_BLOCK && allocation.offset % alignment == 0 && end <= m_BlockSize;
+
+		// the ranges either side of it end before it and start after it
+		const auto next = ranges.lower_bound(allocation.offset);
+		if (next != ranges.end() && next->first < end)
+			valid = false;
+		if (next != ranges.begin() && std::prev(next)->second > allocation.offset)
+			valid = false;
+
+		if (!valid && m_Errors++ == 0)
+		{
+			std::cout << "    ERROR: " << allocation.size << " bytes aligned to " << alignment << " at "
+					  << allocation.offset << " of block " << allocation.block << " overlap or are misaligned\n";
+		}
+		ranges[allocation.offset] = end;
+	}
+
+	void CheckEmpty(const TlsfAllocator& block)
+	{
+		const TlsfStats stats = block.GetStats();
+		if ((stats.freeBlockCount != 1 || stats.largestFreeBlock != stats.size) && m_Errors++ == 0)
+		{
+			std::cout << "    ERROR: an empty block has " << stats.freeBlockCount << " free ranges, the largest of "
+					  << stats.largestFreeBlock << " bytes\n";
+		}
+	}
+
+	void UpdatePeak()
+	{
+		const auto blockCount = std::count_if(m_Blocks.begin(), m_Blocks.end(), [](const auto& block) {
+			return block != nullptr;
+		});
+		m_PeakMemoryObjects = std::max(m_PeakMemoryObjects, static_cast<uint32_t>(blockCount) + m_DedicatedCount);
+	}
+
+private:
+	uint64_t m_BlockSize;
+	uint64_t m_DedicatedThreshold;
+	std::vector<std::unique_ptr<TlsfAllocator>> m_Blocks;
+	std::vector<std::map<uint64_t, uint64_t>> m_Ranges;
+	uint32_t m_DedicatedCount;
+	uint32_t m_PeakMemoryObjects;
+	uint32_t m_Errors;
+};
+
+// sizes spread evenly over the powers of two from 256 bytes to 64 MB, like
+// the mix of uniform, staging and vertex buffers and of textures a scene
+// allocates, and an alignment of 256 bytes to 64 KB
+static void RandomResource(std::mt19937& random, uint64_t& size, uint64_t& alignment)
+{
+	std::uniform_real_distribution<double> logSize{ 8.0, 26.0 };
+	std::uniform_int_distribution<uint32_t> logAlignment{ 8, 16 };
+	size = static_cast<uint64_t>(std::exp2(logSize(random)));
+	alignment = 1ull << logAlignment(random);
+}
+
+// sub-allocates resources from blocks of device memory the way
+// `DeviceAllocator` does, with the memory replaced by the offsets of its
+// `TlsfAllocator`: a scene's worth of resources is allocated, then churned by
+// freeing random ones and allocating others in their place; every allocation
+// is checked for alignment and overlap, every emptied block for a single free
+// range, and the memory objects are compared to one per resource
+static void RunDeviceMemoryBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t resourceCount = GetUintArg(args, 0, 2000);
+	const uint32_t operationCount = GetUintArg(args, 1, 200000);
+	const uint64_t blockSize = GetSizeArg(args, 2, 64, g_MegaByte);
+
+	std::mt19937 random{ 1234 };
+	SimulatedPool pool{ blockSize, blockSize / 2 };
+	std::vector<SimulatedAllocation> allocations;
+	allocations.reserve(resourceCount);
+	for (uint32_t i = 0; i < resourceCount; ++i)
+	{
+		uint64_t size, alignment;
+		RandomResource(random, size, alignment);
+		allocations.push_back(pool.Allocate(size, alignment));
+	}
+	pool.Report("loaded");
+
+	std::uniform_int_distribution<uint32_t> pick{ 0, resourceCount - 1 };
+	for (uint32_t i = 0; i < operationCount; ++i)
+	{
+		SimulatedAllocation& allocation = allocations[pick(random)];
+		pool.Free(allocation);
+
+		uint64_t size, alignment;
+		RandomResource(random, size, alignment);
+		allocation = pool.Allocate(size, alignment);
+	}
+	pool.Report("churned");
+
+	for (const SimulatedAllocation& allocation : allocations)
+		pool.Free(allocation);
+	pool.CheckAllFreed();
+
+	// a block between two free lists (eg: an eighth of an odd sized heap)
+	// and a request that fits it, but rounds up to a list past it
+	SimulatedPool oddPool{ blockSize + 1, blockSize + 1 };
+	oddPool.Free(oddPool.Allocate(blockSize + 1, 256));
+
+	std::cout << "    " << pool.GetPeakMemoryObjects() << " memory objects at most vs " << resourceCount
+			  << " with an allocation per resource\n";
+	Check(pool.GetErrors() + oddPool.GetErrors() == 0,
+		std::to_string(pool.GetErrors() + oddPool.GetErrors())
+			+ " allocations overlap or are misaligned, or emptied blocks are not a single free range");
+
+	// the time of an allocation and a free within a single block that is
+	// kept about half full, without the checks
+	const uint32_t timedCount = std::min<uint32_t>(resourceCount, 1024);
+	std::vector<uint64_t> sizes(operationCount), alignments(operationCount);
+	for (uint32_t i = 0; i < operationCount; ++i)
+	{
+		RandomResource(random, sizes[i], alignments[i]);
+		sizes[i] = std::max<uint64_t>(sizes[i] >> 8, 1);
+	}
+	TlsfAllocator allocator{ blockSize };
+	std::vector<uint32_t> handles(timedCount, NO_TLSF_BLOCK);
+	uint32_t failed = 0;
+	const double milliseconds = MeasureMilliseconds(1, [&]() {
+		for (uint32_t i = 0; i < operationCount; ++i)
+		{
+			uint32_t& handle = handles[i % timedCount];
+			if (handle != NO_TLSF_BLOCK)
+				allocator.Free(handle);
+
+			uint64_t offset;
+			handle = allocator.Allocate(sizes[i], alignments[i], offset);
+			failed += handle == NO_TLSF_BLOCK ? 1 : 0;
+		}
+	});
+	std::cout << "    " << operationCount << " allocations and frees in " << milliseconds << " ms, "
+			  << milliseconds * 1e6 / operationCount << " ns per pair, " << failed << " failed\n";
+}
+
+static const BenchmarkRegistration g_Registration{ "deviceMemory",
+	"[resource count] [operation count] [block MB]: memory objects and fragmentation of blocks",
+	RunDeviceMemoryBenchmark };
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+
+#include "benchmark.h"
+#include "renderer/drawSort.h"
+
+
+// draws of submeshes whose materials interleave, like the shapes of an OBJ
+// exported object by object; compares the binds in submission order
+// against the binds once sorted by state, and against a bindless pipeline
+// that pushes the material instead of binding a descriptor set per texture
+static void RunDrawSortBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t drawCount = GetUintArg(args, 0, 10000);
+	const uint32_t materialCount = GetUintArg(args, 1, 64);
+	const uint32_t iterations = GetUintArg(args, 2, 10);
+
+	std::mt19937 random{ 42 };
+	std::uniform_int_distribution<uint32_t> material{ 0, materialCount - 1 };
+	std::uniform_int_distribution<uint32_t> pipeline{ 0, 3 };
+
+	std::vector<DrawItem> sourceItems(drawCount);
+	std::unordered_set<uint64_t> distinctStates;
+	for (uint32_t i = 0; i < drawCount; ++i)
+	{
+		sourceItems[i] = DrawItem{ DrawState{ pipeline(random), material(random), 0, 0 }, i };
+		distinctStates.insert(static_cast<uint64_t>(sourceItems[i].state.pipeline) << 32
+							  | sourceItems[i].state.descriptorSet);
+	}
+
+	std::vector<DrawItem> items;
+	const double milliseconds = MeasureMilliseconds(iterations, [&]() {
+		items = sourceItems;
+		draw::SortDrawItems(items);
+	});
+
+	const DrawBindStats unsorted = draw::CountBinds(sourceItems);
+	const DrawBindStats sorted = draw::CountBinds(items);
+
+	// the same draws with every texture in the set of the frame
+	std::vector<DrawItem> bindlessItems = sourceItems;
+	for (DrawItem& item : bindlessItems)
+		item.state = DrawState{ item.state.pipeline, 0, 0, item.state.descriptorSet };
+	const DrawBindStats bindlessUnsorted = draw::CountBinds(bindlessItems);
+	draw::SortDrawItems(bindlessItems);
+	const DrawBindStats bindless = draw::CountBinds(bindlessItems);
+
+	std::cout << "    " << drawCount << " draws, " << materialCount << " materials, 4 pipelines, sorted in "
+			  << milliseconds << " ms\n"
+			  << "    unsorted: " << unsorted.pipelineBinds << " pipeline, " << unsorted.descriptorSetBinds
+			  << " descriptor set binds\n"
+			  << "    sorted:   " << sorted.pipelineBinds << " pipeline, " << sorted.descriptorSetBinds
+			  << " descriptor set binds\n"
+			  << "    bindless: " << bindless.pipelineBinds << " pipeline, " << bindless.descriptorSetBinds
+			  << " descriptor set binds, " << bindless.materialPushes << " texture index pushes ("
+			  << bindlessUnsorted.pipelineBinds << " pipeline, " << bindlessUnsorted.descriptorSetBinds
+			  << " descriptor set binds, " << bindlessUnsorted.materialPushes << " pushes unsorted)\n";
+
+	// every state must be bound exactly once after sorting
+	Check(sorted.descriptorSetBinds == distinctStates.size(),
+		std::to_string(sorted.descriptorSetBinds) + " descriptor set binds for " + std::to_string(distinctStates.size())
+			+ " distinct states");
+	// and a bindless pipeline binds a descriptor set per pipeline
+	Check(bindless.descriptorSetBinds == bindless.pipelineBinds && bindless.materialPushes == distinctStates.size(),
+		std::to_string(bindless.descriptorSetBinds) + " descriptor set binds and "
+			+ std::to_string(bindless.materialPushes) + " pushes with bindless textures");
+}
+
+static const BenchmarkRegistration g_Registration{ "drawSort",
+	"[draw count] [material count] [iterations]: state binds of unsorted, sorted and bindless draws",
+	RunDrawSortBenchmark };
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+
+// run from the root directory of the repo, like the application
+// usage: benchmarks [benchmark name] [benchmark arguments...]
+// all benchmarks are run with their default arguments if no name is given;
+// exits with a failure if a benchmark throws or one of their checks fails
+int main(int argc, char** argv)
+{
+	const std::string name = argc > 1 ? argv[1] : "";
+	const BenchmarkArgs args{ argc > 2 ? argv + 2 : argv + argc, argv + argc };
+
+	std::vector<Benchmark>& benchmarks = GetBenchmarks();
+	std::sort(benchmarks.begin(), benchmarks.end(), [](const Benchmark& a, const Benchmark& b) {
+		return std::strcmp(a.name, b.name) < 0;
+	});
+
+	try
+	{
+		bool found = false;
+		for (const Benchmark& benchmark : benchmarks)
+		{
+			if (!name.empty() && name != benchmark.name)
+				continue;
+
+			std::cout << "[" << benchmark.name << "]\n";
+			benchmark.run(args);
+			std::cout << '\n';
+			found = true;
+		}
+
+		if (!found)
+		{
+			std::cout << "Unknown benchmark: " << name << "\nAvailable benchmarks:\n";
+			for (const Benchmark& benchmark : benchmarks)
+				std::cout << "    " << benchmark.name << ' ' << benchmark.description << '\n';
+			return EXIT_FAILURE;
+		}
+	} catch (const std::exception& e)
+	{
+		std::cout << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	if (GetFailedCheckCount() > 0)
+	{
+		std::cout << GetFailedCheckCount() << " checks failed\n";
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,52 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "renderer/model.h"
+
+
+// triangles and error of every level of the lod chain, and the distance from
+// which each level is drawn by a 1080p viewport with a 45 degree fov
+static void RunMeshLodBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const float maxPixelError = GetFloatArg(args, 2, 1.0f);
+
+	ModelLoadOptions options{};
+	options.useCookedMesh = false;
+	options.splitSubmeshes = false;
+	options.buildLods = false;
+	const Model model{ modelPath.c_str(), options };
+
+	const std::vector<Vertex>& vertices = model.GetVertices();
+	const std::vector<uint32_t>& sourceIndices = model.GetIndices();
+
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	const double milliseconds = MeasureMilliseconds(iterations, [&]() {
+		indices = sourceIndices;
+		lods = mesh::BuildLodChain(vertices, indices);
+	});
+
+	std::cout << "    " << lods.size() << " levels built in " << milliseconds << " ms, index buffer grew from "
+			  << sourceIndices.size() << " to " << indices.size() << " indices\n";
+
+	const float fovY = 3.14159265f / 4.0f;
+	const float viewportHeight = 1080.0f;
+	const float radius = glm::length(model.GetBoundsMax() - model.GetBoundsMin()) * 0.5f;
+	for (size_t i = 0; i < lods.size(); ++i)
+	{
+		// the distance at which the error of the level projects to `maxPixelError` pixels
+		const float distance = lods[i].error * viewportHeight / (2.0f * std::tan(fovY * 0.5f) * maxPixelError);
+
+		std::cout << "    lod " << i << ": " << lods[i].indexCount / 3 << " triangles, error " << lods[i].error
+				  << " (" << 100.0f * lods[i].error / radius << "% of the radius), drawn from " << distance
+				  << " units away\n";
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "meshLod",
+	"[model path] [iterations] [max pixel error]: LOD chain triangles, error and draw distance",
+	RunMeshLodBenchmark };
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "renderer/model.h"
+
+
+static void PrintStats(const char* pass, const VertexCacheStats& stats, double milliseconds)
+{
+	std::cout << "    " << pass << "ACMR " << stats.acmr << ", ATVR " << stats.atvr;
+	if (milliseconds > 0.0)
+		std::cout << " (" << milliseconds << " ms)";
+	std::cout << '\n';
+}
+
+// vertex cache efficiency after each pass of the mesh optimizer
+static void RunMeshOptimizeBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const uint32_t cacheSize = GetUintArg(args, 2, 16);
+
+	ModelLoadOptions options{};
+	options.useCookedMesh = false;
+	options.splitSubmeshes = false;
+	options.optimizeMesh = false;
+	options.buildMeshlets = false;
+	options.buildLods = false;
+	const Model model{ modelPath.c_str(), options };
+
+	const std::vector<Vertex>& sourceVertices = model.GetVertices();
+	const std::vector<uint32_t>& sourceIndices = model.GetIndices();
+
+	PrintStats("unoptimized:  ", mesh::AnalyzeVertexCache(sourceIndices, sourceVertices.size(), cacheSize), 0.0);
+
+	std::vector<uint32_t> indices;
+	const double cacheTime = MeasureMilliseconds(iterations, [&]() {
+		indices = sourceIndices;
+		mesh::OptimizeVertexCache(indices, sourceVertices.size(), cacheSize);
+	});
+	PrintStats("vertex cache: ", mesh::AnalyzeVertexCache(indices, sourceVertices.size(), cacheSize), cacheTime);
+
+	const std::vector<uint32_t> cacheIndices = indices;
+	const double overdrawTime = MeasureMilliseconds(iterations, [&]() {
+		indices = cacheIndices;
+		mesh::OptimizeOverdraw(indices, sourceVertices, cacheSize, MeshOptimizeOptions{}.overdrawThreshold);
+	});
+	PrintStats("overdraw:     ", mesh::AnalyzeVertexCache(indices, sourceVertices.size(), cacheSize), overdrawTime);
+
+	const std::vector<uint32_t> overdrawIndices = indices;
+	std::vector<Vertex> vertices;
+	const double fetchTime = MeasureMilliseconds(iterations, [&]() {
+		vertices = sourceVertices;
+		indices = overdrawIndices;
+		mesh::OptimizeVertexFetch(vertices, indices);
+	});
+	PrintStats("vertex fetch: ", mesh::AnalyzeVertexCache(indices, vertices.size(), cacheSize), fetchTime);
+}
+
+static const BenchmarkRegistration g_Registration{ "meshOptimize",
+	"[model path] [iterations] [cache size]: ACMR and ATVR after each mesh optimizer pass",
+	RunMeshOptimizeBenchmark };
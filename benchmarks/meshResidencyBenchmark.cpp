@@ -0,0 +1,121 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "benchmark.h"
+#include "core/memoryStats.h"
+#include "renderer/model.h"
+
+
+template<typename T>
+static double ToMegabytes(T bytes)
+{
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+// uploads the geometry of `model` the way the application does (decoded
+// into a staging buffer), releases it and reports the resident memory around it
+static void MeasureUpload(const char* name, Model& model, ThreadPool& threadPool)
+{
+	const EncodedStream vertexData = model.GetVertexData();
+	const EncodedStream indexData = model.GetIndexData();
+	const uint64_t uploadedBytes = vertexData.decodedSize + indexData.decodedSize;
+	{
+		std::vector<uint8_t> staging(uploadedBytes);
+		codec::Decode(vertexData, staging.data(), threadPool);
+		codec::Decode(indexData, staging.data() + vertexData.decodedSize, threadPool);
+	}
+
+	const size_t loadedBytes = memory::GetCurrentResidentBytes();
+	const int64_t loadedHeapBytes = GetAllocatedBytes();
+
+	model.OnUploaded();
+	const size_t releasedBytes = memory::GetCurrentResidentBytes();
+	const int64_t releasedHeapBytes = GetAllocatedBytes();
+
+	std::cout << "    " << name << ": " << ToMegabytes(uploadedBytes) << " MB uploaded"
+			  << (model.IsGeometryResident() ? " (geometry kept)" : "") << '\n'
+			  << "        heap:     " << ToMegabytes(loadedHeapBytes) << " MB -> " << ToMegabytes(releasedHeapBytes)
+			  << " MB\n"
+			  << "        resident: " << ToMegabytes(loadedBytes) << " MB -> " << ToMegabytes(releasedBytes) << " MB\n";
+}
+
+// measures how much cpu memory the geometry of a model takes before and
+// after it is uploaded, and counts the allocations of the per frame lod
+// selection and meshlet culling
+static void RunMeshResidencyBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t frameCount = GetUintArg(args, 1, 1000);
+
+	ThreadPool threadPool;
+	std::cout << "    start:          resident " << ToMegabytes(memory::GetCurrentResidentBytes()) << " MB\n";
+	{
+		ModelLoadOptions options{};
+		options.useCookedMesh = false;
+		Model model{ modelPath.c_str(), options };
+		MeasureUpload("parsed model", model, threadPool);
+	}
+
+	// writes the cooked mesh if it is missing or out of date
+	Model{ modelPath.c_str() };
+	Model model{ modelPath.c_str() };
+	if (!model.IsCooked())
+		throw std::runtime_error("Cooked mesh was not used: " + Model::GetCookedPath(modelPath));
+	MeasureUpload("cooked model", model, threadPool);
+
+	// the same work as Application::RecordCommandBuffer, from cameras
+	// orbiting the model at different distances
+	const glm::vec3 center = (model.GetBoundsMin() + model.GetBoundsMax()) * 0.5f;
+	const float radius = glm::length(model.GetBoundsMax() - model.GetBoundsMin()) * 0.5f;
+	const float fovY = glm::radians(45.0f);
+	const glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	std::vector<MeshletDraw> draws;
+	draws.reserve(model.GetMeshlets().size());
+	uint64_t trianglesDrawn = 0;
+
+	const uint64_t allocationsBefore = GetAllocationCount();
+	const double time = MeasureMilliseconds(1, [&]() {
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			const float t = static_cast<float>(frame) / static_cast<float>(frameCount);
+			const float angle = glm::radians(360.0f) * t;
+			const float distance = radius * (1.0f + 20.0f * t);
+			const glm::vec3 eye = center + distance * glm::vec3{ std::cos(angle), std::sin(angle), 0.5f };
+			const glm::mat4 view = glm::lookAt(eye, center, glm::vec3{ 0.0f, 0.0f, 1.0f });
+			const MeshletCullParams params = mesh::GetMeshletCullParams(projection * view, view);
+			const float lodDistance = glm::max(glm::length(eye - center) - radius, 1e-3f);
+
+			for (const Submesh& submesh : model.GetSubmeshes())
+			{
+				const uint32_t lodIndex = mesh::SelectLod(
+					model.GetLods().data() + submesh.firstLod, submesh.lodCount, lodDistance, fovY, 1080.0f, 1.0f);
+				if (lodIndex == 0 && submesh.meshletCount > 0)
+				{
+					draws.clear();
+					trianglesDrawn += mesh::CullMeshlets(
+						model.GetMeshlets().data() + submesh.firstMeshlet, submesh.meshletCount, params, draws)
+										  .triangles;
+				}
+				else
+				{
+					trianglesDrawn += model.GetLods()[submesh.firstLod + lodIndex].indexCount / 3;
+				}
+			}
+		}
+	});
+	const uint64_t frameAllocations = GetAllocationCount() - allocationsBefore;
+
+	std::cout << "    frames:         " << frameCount << " in " << time << " ms, "
+			  << static_cast<double>(trianglesDrawn) / frameCount << " triangles per frame\n"
+			  << "    allocations:    " << static_cast<double>(frameAllocations) / frameCount << " per frame\n"
+			  << "    peak resident:  " << ToMegabytes(memory::GetPeakResidentBytes()) << " MB\n";
+}
+
+static const BenchmarkRegistration g_Registration{ "meshResidency",
+	"[model path] [frame count]: memory released after upload and allocations per frame",
+	RunMeshResidencyBenchmark };
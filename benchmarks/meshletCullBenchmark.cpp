@@ -0,0 +1,117 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "benchmark.h"
+#include "renderer/model.h"
+
+
+// checks that every triangle of a culled meshlet could not have been seen:
+// either outside one of the frustum planes or facing away from the camera
+static bool IsTriangleInvisible(const Vertex* vertices, const uint32_t* triangle, const MeshletCullParams& params, bool frustumCulled)
+{
+	const glm::vec3& p0 = vertices[triangle[0]].pos;
+	const glm::vec3& p1 = vertices[triangle[1]].pos;
+	const glm::vec3& p2 = vertices[triangle[2]].pos;
+
+	if (frustumCulled)
+	{
+		for (const glm::vec4& plane : params.frustumPlanes)
+		{
+			const glm::vec3 normal{ plane };
+			if (glm::dot(normal, p0) + plane.w < 0.0f && glm::dot(normal, p1) + plane.w < 0.0f
+				&& glm::dot(normal, p2) + plane.w < 0.0f)
+				return true;
+		}
+
+		return false;
+	}
+
+	return glm::dot(glm::cross(p1 - p0, p2 - p0), p0 - params.cameraPosition) >= 0.0f;
+}
+
+// culls the meshlets of a model from cameras orbiting around it and checks
+// that no visible triangle was culled
+static void RunMeshletCullBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const uint32_t viewCount = GetUintArg(args, 2, 64);
+
+	ModelLoadOptions options{};
+	options.useCookedMesh = false;
+	options.splitSubmeshes = false;
+	options.buildLods = false;
+	const Model model{ modelPath.c_str(), options };
+
+	const glm::vec3 center = (model.GetBoundsMin() + model.GetBoundsMax()) * 0.5f;
+	const float radius = glm::length(model.GetBoundsMax() - model.GetBoundsMin()) * 0.5f;
+
+	// close enough that part of the model is outside the frustum
+	std::vector<MeshletCullParams> views(viewCount);
+	for (uint32_t i = 0; i < viewCount; ++i)
+	{
+		const float angle = glm::radians(360.0f) * static_cast<float>(i) / static_cast<float>(viewCount);
+		const glm::vec3 eye = center + radius * glm::vec3{ std::cos(angle), std::sin(angle), 0.5f };
+		const glm::mat4 view = glm::lookAt(eye, center, glm::vec3{ 0.0f, 0.0f, 1.0f });
+		const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 50.0f);
+
+		views[i] = mesh::GetMeshletCullParams(projection * view, view);
+	}
+
+	std::vector<MeshletDraw> draws;
+	MeshletCullStats totals{};
+	const double time = MeasureMilliseconds(iterations, [&]() {
+		totals = MeshletCullStats{};
+		for (const MeshletCullParams& params : views)
+		{
+			draws.clear();
+			const MeshletCullStats stats = mesh::CullMeshlets(model.GetMeshlets().data(), model.GetMeshlets().size(), params, draws);
+			totals.totalMeshlets += stats.totalMeshlets;
+			totals.frustumCulled += stats.frustumCulled;
+			totals.backfaceCulled += stats.backfaceCulled;
+			totals.drawCalls += stats.drawCalls;
+			totals.triangles += stats.triangles;
+		}
+	});
+
+	// culling must be conservative, check every triangle of every culled
+	// meshlet from every view
+	size_t errors = 0;
+	for (const MeshletCullParams& params : views)
+	{
+		for (size_t i = 0; i < model.GetMeshlets().size(); ++i)
+		{
+			const Meshlet& meshlet = model.GetMeshlets()[i];
+
+			MeshletCullParams frustumOnly = params;
+			frustumOnly.backfaceCulling = false;
+			std::vector<MeshletDraw> meshletDraws;
+			const bool frustumCulled = mesh::CullMeshlets(&meshlet, 1, frustumOnly, meshletDraws).frustumCulled > 0;
+			const bool culled = mesh::CullMeshlets(&meshlet, 1, params, meshletDraws).drawCalls == 0;
+			if (!culled)
+				continue;
+
+			for (uint32_t index = meshlet.firstIndex; index < meshlet.firstIndex + meshlet.indexCount; index += 3)
+			{
+				if (!IsTriangleInvisible(model.GetVertices().data(), model.GetIndices().data() + index, params, frustumCulled))
+					++errors;
+			}
+		}
+	}
+
+	const double total = static_cast<double>(totals.totalMeshlets);
+	std::cout << "    meshlets:        " << model.GetMeshlets().size() << ", " << viewCount << " views\n"
+			  << "    frustum culled:  " << 100.0 * totals.frustumCulled / total << "%\n"
+			  << "    backface culled: " << 100.0 * totals.backfaceCulled / total << "%\n"
+			  << "    triangles drawn: " << totals.triangles / viewCount << " of " << model.GetIndexCount() / 3
+			  << " per view in " << totals.drawCalls / viewCount << " draws\n"
+			  << "    cull time:       " << time * 1000.0 / viewCount << " us per view\n";
+	Check(errors == 0, std::to_string(errors) + " visible triangles culled");
+}
+
+static const BenchmarkRegistration g_Registration{ "meshletCull",
+	"[model path] [iterations] [view count]: meshlet frustum and backface culling",
+	RunMeshletCullBenchmark };
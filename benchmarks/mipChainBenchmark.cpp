@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "stb_image/stb_image.h"
+
+#include "benchmark.h"
+#include "renderer/texture/mipChain.h"
+
+
+// mean linear luminance of RGBA8 sRGB texels
+static double GetMeanLuminance(const uint8_t* texels, size_t texelCount)
+{
+	const auto toLinear = [](uint8_t value) {
+		const double normalized = value / 255.0;
+		return normalized <= 0.04045 ? normalized / 12.92 : std::pow((normalized + 0.055) / 1.055, 2.4);
+	};
+
+	double sum = 0.0;
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		const uint8_t* texel = texels + i * 4;
+		sum += 0.2126 * toLinear(texel[0]) + 0.7152 * toLinear(texel[1]) + 0.0722 * toLinear(texel[2]);
+	}
+
+	return sum / static_cast<double>(texelCount);
+}
+
+// 2x2 box filter that averages the sRGB values as they are, like a
+// downsampler that ignores gamma
+static std::vector<texture::MipLevel> BuildNaiveMipChain(const uint8_t* texels, uint32_t width, uint32_t height)
+{
+	std::vector<texture::MipLevel> levels;
+	const uint8_t* previous = texels;
+	uint32_t previousWidth = width;
+	uint32_t previousHeight = height;
+	for (uint32_t level = 1; level < texture::GetMipLevelCount(width, height); ++level)
+	{
+		texture::MipLevel mipLevel{ std::max(1u, previousWidth / 2), std::max(1u, previousHeight / 2), {} };
+		mipLevel.texels.resize(static_cast<size_t>(mipLevel.width) * mipLevel.height * 4);
+		for (uint32_t y = 0; y < mipLevel.height; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, previousHeight - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, previousHeight - 1);
+			for (uint32_t x = 0; x < mipLevel.width; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, previousWidth - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, previousWidth - 1);
+				for (uint32_t channel = 0; channel < 4; ++channel)
+				{
+					const uint32_t sum = previous[(y0 * previousWidth + x0) * 4 + channel]
+						+ previous[(y0 * previousWidth + x1) * 4 + channel]
+						+ previous[(y1 * previousWidth + x0) * 4 + channel]
+						+ previous[(y1 * previousWidth + x1) * 4 + channel];
+					mipLevel.texels[(static_cast<size_t>(y) * mipLevel.width + x) * 4 + channel] =
+						static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+
+		levels.push_back(std::move(mipLevel));
+		previous = levels.back().texels.data();
+		previousWidth = levels.back().width;
+		previousHeight = levels.back().height;
+	}
+
+	return levels;
+}
+
+// largest change of the mean linear luminance of a level from the image, in
+// percent; a correct filter keeps it close to 0 on every level
+static double GetLuminanceDrift(const std::vector<texture::MipLevel>& levels, double imageLuminance)
+{
+	double drift = 0.0;
+	for (const texture::MipLevel& level : levels)
+	{
+		const double luminance = GetMeanLuminance(level.texels.data(), level.texels.size() / 4);
+		drift = std::max(drift, std::abs(luminance - imageLuminance) / imageLuminance * 100.0);
+	}
+
+	return drift;
+}
+
+// time to build the mip chain with every filter on one and on every thread,
+// how far the levels drift in brightness from the image, and the commands
+// that upload the texture with its mips
+static void RunMipChainBenchmark(const BenchmarkArgs& args)
+{
+	const std::string texturePath = GetArg(args, 0, DEFAULT_TEXTURE_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 5);
+	const uint32_t threadCount = GetThreadCountArg(args, 2);
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	stbi_uc* texels = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!texels)
+		throw std::runtime_error("Failed to load texture image: " + texturePath);
+
+	const uint32_t textureWidth = static_cast<uint32_t>(width);
+	const uint32_t textureHeight = static_cast<uint32_t>(height);
+	const uint32_t levelCount = texture::GetMipLevelCount(textureWidth, textureHeight);
+	const double imageLuminance = GetMeanLuminance(texels, static_cast<size_t>(textureWidth) * textureHeight);
+
+	ThreadPool singleThread{ 1 };
+	ThreadPool threadPool{ threadCount };
+
+	std::cout << "    " << texturePath << ": " << width << "x" << height << ", " << levelCount << " levels\n";
+
+	std::vector<texture::MipLevel> levels;
+	const double naiveTime =
+		MeasureMilliseconds(iterations, [&]() { levels = BuildNaiveMipChain(texels, textureWidth, textureHeight); });
+	std::cout << "        sRGB unaware 2x2 box: " << naiveTime << " ms on 1 thread, luminance drift up to "
+			  << GetLuminanceDrift(levels, imageLuminance) << "%\n";
+
+	for (texture::MipFilter filter : { texture::MipFilter::BOX, texture::MipFilter::KAISER })
+	{
+		const auto build = [&](ThreadPool& pool) {
+			return MeasureMilliseconds(iterations, [&]() {
+				levels = texture::BuildMipChain(texels, textureWidth, textureHeight, filter, true, pool);
+			});
+		};
+		const double singleThreadTime = build(singleThread);
+		const double time = build(threadPool);
+
+		std::cout << "        " << texture::GetMipFilterName(filter) << ": " << singleThreadTime << " ms on 1 thread, "
+				  << time << " ms on " << threadPool.GetThreadCount() << " threads, luminance drift up to "
+				  << GetLuminanceDrift(levels, imageLuminance) << "%\n";
+	}
+	stbi_image_free(texels);
+
+	// blitting each level from the one above takes a blit and two barriers
+	// per level after the copy of the image
+	std::cout << "    upload: 1 copy with " << levelCount << " regions and 2 barriers vs 1 copy, " << levelCount - 1
+			  << " blits and " << 2 * levelCount << " barriers when the GPU generates the mips\n";
+}
+
+static const BenchmarkRegistration g_Registration{ "mipChain",
+	"[texture path] [iterations] [max threads]: box vs Kaiser mip chain time and brightness drift",
+	RunMipChainBenchmark };
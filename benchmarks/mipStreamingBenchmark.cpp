@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/texture/mipResidency.h"
+#include "renderer/texture/textureUpload.h"
+
+
+// the mip tail the textures start with, like `MipStreamer`
+constexpr uint32_t g_TailSize = 64;
+// frames from starting to read a raise to sampling its levels
+constexpr uint32_t g_RaiseLatencyFrames = 4;
+// texels of a texture per unit of distance at level 0
+constexpr float g_TexelsPerUnit = 256.0f;
+// units the camera moves per frame, 6 per second at 60 fps
+constexpr float g_CameraSpeed = 0.1f;
+
+struct StreamResult
+{
+	MipResidencyStats stats;
+	uint64_t peakResidentBytes;
+	uint64_t uploadedBytes;
+	uint64_t maxFrameUploadBytes;
+	// textures sampled in a frame, and the ones of them blurrier than wanted
+	uint64_t sampledCount;
+	uint64_t blurryCount;
+	double milliseconds;
+};
+
+// the level a texture `distance` away is sampled at: a level per doubling of
+// the distance, like the lod the fragment shader computes for a fixed
+// screen size
+static uint32_t GetSampledLevel(float distance, uint32_t width, uint32_t levelCount)
+{
+	const float texelsPerPixel = static_cast<float>(width) / g_TexelsPerUnit * std::max(distance, 1e-3f);
+	const float lod = std::log2(std::max(texelsPerPixel, 1.0f));
+	return std::min(static_cast<uint32_t>(lod), levelCount - 1);
+}
+
+// walks the camera along a corridor of textures and back for `frameCount`
+// frames, feeding what it samples to a `MipResidency`; the raises are read
+// and uploaded `g_RaiseLatencyFrames` later, like `MipStreamer` minus the GPU
+static StreamResult StreamCorridor(const std::vector<float>& positions,
+	const std::vector<uint32_t>& widths,
+	uint32_t frameCount,
+	float viewDistance,
+	uint64_t budget,
+	uint64_t maxUploadSize)
+{
+	const float length = positions.back();
+	MipResidency residency{ budget };
+	for (uint32_t width : widths)
+	{
+		const uint32_t levelCount = static_cast<uint32_t>(std::log2(width)) + 1;
+		std::vector<uint64_t> levelSizes(levelCount);
+		for (uint32_t level = 0; level < levelCount; ++level)
+			levelSizes[level] = texture::GetLevelSize(VK_FORMAT_BC7_SRGB_BLOCK, width, width, level);
+
+		residency.AddTexture(levelSizes, texture::GetFirstLevelWithin(width, width, levelCount, g_TailSize));
+	}
+
+	struct PendingRaise
+	{
+		MipChange change;
+		uint32_t readyFrame;
+	};
+	std::deque<PendingRaise> pending;
+	std::vector<uint32_t> feedback(positions.size());
+
+	StreamResult result{};
+	const auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		// there and back
+		const float travelled = std::fmod(static_cast<float>(frame) * g_CameraSpeed, length * 2.0f);
+		const float camera = travelled < length ? travelled : length * 2.0f - travelled;
+
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			const float distance = std::abs(positions[i] - camera);
+			const uint32_t levelCount = static_cast<uint32_t>(std::log2(widths[i])) + 1;
+			feedback[i] = distance < viewDistance ? GetSampledLevel(distance, widths[i], levelCount) : NOT_SAMPLED;
+
+			if (feedback[i] != NOT_SAMPLED)
+			{
+				++result.sampledCount;
+				if (residency.GetResidentLevel(static_cast<uint32_t>(i)) > feedback[i])
+					++result.blurryCount;
+			}
+		}
+		residency.AddFeedback(feedback.data());
+
+		uint64_t frameUploadBytes = 0;
+		while (!pending.empty() && pending.front().readyFrame <= frame)
+		{
+			const MipChange& change = pending.front().change;
+			residency.SetResident(change.texture, change.firstLevel);
+			frameUploadBytes += residency.GetSize(change.texture, change.firstLevel);
+			pending.pop_front();
+		}
+		result.uploadedBytes += frameUploadBytes;
+		result.maxFrameUploadBytes = std::max(result.maxFrameUploadBytes, frameUploadBytes);
+
+		for (const MipChange& change : residency.Plan(maxUploadSize))
+		{
+			if (change.firstLevel < residency.GetResidentLevel(change.texture))
+				pending.push_back(PendingRaise{ change, frame + g_RaiseLatencyFrames });
+		}
+
+		result.peakResidentBytes = std::max(result.peakResidentBytes, residency.GetStats().residentBytes);
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	result.stats = residency.GetStats();
+	result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return result;
+}
+
+// BC7 textures with their mip chain along a corridor the camera walks
+// through; compares the memory of keeping every level resident vs streaming
+// the levels the frames sample within a budget, and how often a texture is
+// drawn blurrier than it is sampled
+static void RunMipStreamingBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t textureCount = GetUintArg(args, 0, 1024);
+	const uint32_t frameCount = GetUintArg(args, 1, 10000);
+	const uint64_t budget = GetSizeArg(args, 2, 256, 1024 * 1024);
+
+	std::mt19937 random{ 42 };
+	std::uniform_int_distribution<uint32_t> sizeLog{ 10, 12 };
+	std::vector<float> positions(textureCount);
+	std::vector<uint32_t> widths(textureCount);
+	uint64_t fullBytes = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		positions[i] = static_cast<float>(i) * 0.5f;
+		widths[i] = 1u << sizeLog(random);
+		for (uint32_t level = 0; (widths[i] >> level) > 0; ++level)
+			fullBytes += texture::GetLevelSize(VK_FORMAT_BC7_SRGB_BLOCK, widths[i], widths[i], level);
+	}
+
+	const float viewDistance = 40.0f;
+	std::cout << "    " << textureCount << " textures (" << fullBytes / (1024 * 1024) << " MB with every level), "
+			  << frameCount << " frames walking " << g_CameraSpeed << " units per frame, sampled within "
+			  << viewDistance << " units, raises resident " << g_RaiseLatencyFrames << " frames after they start\n";
+
+	const struct
+	{
+		const char* name;
+		uint64_t budget;
+		uint64_t maxUploadSize;
+	} configs[] = {
+		{ "unlimited", std::numeric_limits<uint64_t>::max(), std::numeric_limits<uint64_t>::max() },
+		{ "unlimited, 16 MB per frame", std::numeric_limits<uint64_t>::max(), 16ull * 1024 * 1024 },
+		{ "budget, 16 MB per frame", budget, 16ull * 1024 * 1024 },
+		{ "budget, 4 MB per frame", budget, 4ull * 1024 * 1024 },
+	};
+	for (const auto& config : configs)
+	{
+		const StreamResult result =
+			StreamCorridor(positions, widths, frameCount, viewDistance, config.budget, config.maxUploadSize);
+
+		std::cout << "        " << config.name;
+		if (config.budget != std::numeric_limits<uint64_t>::max())
+			std::cout << " (" << config.budget / (1024 * 1024) << " MB)";
+		std::cout << ": peak " << result.peakResidentBytes / (1024 * 1024) << " MB resident, "
+				  << result.uploadedBytes / (1024 * 1024) << " MB uploaded (at most "
+				  << result.maxFrameUploadBytes / 1024 << " KB in a frame), " << result.stats.raises << " raises, "
+				  << result.stats.drops << " drops, "
+				  << 100.0 * static_cast<double>(result.blurryCount)
+						 / static_cast<double>(std::max<uint64_t>(1, result.sampledCount))
+				  << "% of sampled textures blurrier than wanted, "
+				  << result.milliseconds * 1000.0 / static_cast<double>(frameCount) << " us per frame\n";
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "mipStreaming",
+	"[texture count] [frame count] [budget MB]: resident and uploaded mips of streamed textures",
+	RunMipStreamingBenchmark };
@@ -0,0 +1,58 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/model.h"
+
+
+// compares the startup cost of parsing the source OBJ against mapping the
+// cooked mesh of the same model
+static void RunModelLoadBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 5);
+
+	// make sure the cooked mesh exists and is up to date before timing it
+	Model{ modelPath.c_str() };
+
+	ModelLoadOptions objOptions{};
+	objOptions.useCookedMesh = false;
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	const double objTime = MeasureMilliseconds(iterations, [&]() {
+		Model model{ modelPath.c_str(), objOptions };
+		vertexCount = model.GetVertexCount();
+		indexCount = model.GetIndexCount();
+	});
+
+	// decode into a staging copy like the upload would, otherwise only the
+	// header pages of the mapped file are read
+	ThreadPool threadPool;
+	std::vector<uint8_t> staging;
+	const double cookedTime = MeasureMilliseconds(iterations, [&]() {
+		Model model{ modelPath.c_str() };
+		if (!model.IsCooked())
+			throw std::runtime_error("Cooked mesh was not used: " + Model::GetCookedPath(modelPath));
+
+		const EncodedStream vertexData = model.GetVertexData();
+		const EncodedStream indexData = model.GetIndexData();
+		staging.resize(vertexData.decodedSize + indexData.decodedSize);
+		codec::Decode(vertexData, staging.data(), threadPool);
+		codec::Decode(indexData, staging.data() + vertexData.decodedSize, threadPool);
+	});
+
+	std::cout << "    model:        " << modelPath << " (" << vertexCount << " vertices, " << indexCount
+			  << " indices)\n"
+			  << "    cooked size:  " << std::filesystem::file_size(Model::GetCookedPath(modelPath)) << " bytes\n"
+			  << "    OBJ parse:    " << objTime << " ms\n"
+			  << "    cooked load:  " << cookedTime << " ms\n"
+			  << "    speedup:      " << objTime / cookedTime << "x\n";
+}
+
+static const BenchmarkRegistration g_Registration{ "modelLoad",
+	"[model path] [iterations]: OBJ parse vs cooked mesh load",
+	RunModelLoadBenchmark };
@@ -0,0 +1,69 @@
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "renderer/mesh/objParser.h"
+
+
+static bool IsSameObjData(const ObjData& lhs, const ObjData& rhs)
+{
+	auto sameFloats = [](const std::vector<float>& a, const std::vector<float>& b) {
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+	};
+
+	if (!sameFloats(lhs.positions, rhs.positions) || !sameFloats(lhs.texCoords, rhs.texCoords)
+		|| !sameFloats(lhs.normals, rhs.normals) || lhs.indices.size() != rhs.indices.size())
+		return false;
+
+	for (size_t i = 0; i < lhs.indices.size(); ++i)
+	{
+		if (lhs.indices[i].vertexIndex != rhs.indices[i].vertexIndex
+			|| lhs.indices[i].texCoordIndex != rhs.indices[i].texCoordIndex
+			|| lhs.indices[i].normalIndex != rhs.indices[i].normalIndex)
+			return false;
+	}
+
+	return true;
+}
+
+// compares tinyobjloader against the chunked parser at increasing thread
+// counts, and checks that every run produces the same geometry
+static void RunObjParseBenchmark(const BenchmarkArgs& args)
+{
+	const RepeatedObj model{ GetArg(args, 0, DEFAULT_MODEL_PATH), GetUintArg(args, 2, 1), "objParseBenchmark" };
+	const std::string& modelPath = model.GetPath();
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const uint32_t maxThreads = GetThreadCountArg(args, 3);
+
+	std::cout << "    model:        " << modelPath << " (" << std::filesystem::file_size(modelPath) << " bytes)\n";
+
+	ObjData reference{};
+	const double referenceTime =
+		MeasureMilliseconds(iterations, [&]() { reference = mesh::ParseObjReference(modelPath); });
+	std::cout << "    tinyobj:      " << referenceTime << " ms\n";
+
+	double singleThreadTime = 0.0;
+	for (uint32_t threadCount = 1;; threadCount = std::min(threadCount * 2, maxThreads))
+	{
+		ThreadPool threadPool{ threadCount };
+
+		ObjData parsed{};
+		const double time = MeasureMilliseconds(iterations, [&]() { parsed = mesh::ParseObj(modelPath, threadPool); });
+		if (threadCount == 1)
+			singleThreadTime = time;
+
+		std::cout << "    " << threadCount << " thread(s):  " << time << " ms, " << singleThreadTime / time
+				  << "x vs 1 thread, " << referenceTime / time << "x vs tinyobj\n";
+		Check(IsSameObjData(reference, parsed),
+			"the geometry parsed on " + std::to_string(threadCount) + " threads differs from tinyobj");
+
+		if (threadCount == maxThreads)
+			break;
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "objParse",
+	"[model path] [iterations] [repeat count] [max threads]: tinyobj vs chunked parser",
+	RunObjParseBenchmark };
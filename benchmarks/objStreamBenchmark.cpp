@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "core/memoryStats.h"
+#include "renderer/model.h"
+
+
+template<typename T>
+static double ToMegabytes(T bytes)
+{
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+// decodes `data` piece by piece into a staging buffer of at most
+// `maxStagingSize` bytes, the way `staging::UploadBuffer` does
+static void UploadThroughStaging(const EncodedStream& data, uint64_t maxStagingSize, ThreadPool& threadPool)
+{
+	if (data.decodedSize == 0)
+		return;
+
+	const uint64_t granularity = codec::GetDecodeGranularity(data);
+	const uint64_t pieceSize =
+		std::min<uint64_t>(data.decodedSize, std::max<uint64_t>(maxStagingSize / granularity, 1) * granularity);
+	std::vector<uint8_t> staging(pieceSize);
+	for (uint64_t offset = 0; offset < data.decodedSize; offset += pieceSize)
+	{
+		const uint64_t size = std::min<uint64_t>(pieceSize, data.decodedSize - offset);
+		codec::Decode(data, offset, size, staging.data(), threadPool);
+	}
+}
+
+struct StreamRun
+{
+	double time;
+	size_t startBytes;
+	size_t peakBytes;
+	uint64_t vertexCount;
+	uint64_t indexCount;
+	size_t submeshCount;
+	// the most bytes uploaded at once
+	uint64_t maxWriteBytes;
+};
+
+// loads and uploads the model from a fresh peak, so that every run reports
+// its own peak resident memory; a streamed model is uploaded by its stream
+// target as it loads
+static StreamRun MeasureLoad(const std::string& modelPath,
+	ModelLoadOptions options,
+	uint64_t maxStagingSize,
+	ThreadPool& threadPool)
+{
+	if (!memory::ResetPeakResidentBytes())
+		std::cout << "    (peak resident memory cannot be reset, it includes the previous runs)\n";
+
+	StreamRun run{};
+	auto write = [&](size_t, const EncodedStream& data) {
+		UploadThroughStaging(data, maxStagingSize, threadPool);
+		run.maxWriteBytes = std::max<uint64_t>(run.maxWriteBytes, data.decodedSize);
+	};
+	options.streamTarget.reserve = [](size_t, size_t, uint32_t) {};
+	options.streamTarget.writeVertices = write;
+	options.streamTarget.writeIndices = write;
+
+	run.startBytes = memory::GetCurrentResidentBytes();
+	run.time = MeasureMilliseconds(1, [&]() {
+		Model model{ modelPath.c_str(), options };
+		if (model.IsGeometryResident())
+		{
+			write(0, model.GetVertexData());
+			write(0, model.GetIndexData());
+		}
+		model.OnUploaded();
+
+		run.vertexCount = model.GetVertexCount();
+		run.indexCount = model.GetIndexCount();
+		run.submeshCount = model.GetSubmeshes().size();
+	});
+	run.peakBytes = memory::GetPeakResidentBytes();
+
+	return run;
+}
+
+// compares the peak resident memory of parsing the whole OBJ against
+// streaming it in fixed size windows, uploading both through a bounded
+// staging buffer, and checks that they build the same submeshes
+static void RunObjStreamBenchmark(const BenchmarkArgs& args)
+{
+	const RepeatedObj model{ GetArg(args, 0, DEFAULT_MODEL_PATH), GetUintArg(args, 1, 64), "objStreamBenchmark" };
+	const std::string& modelPath = model.GetPath();
+	const size_t windowSize = GetSizeArg(args, 2, 4096, 1024);
+	const uint64_t maxStagingSize = GetSizeArg(args, 3, 16, 1024 * 1024);
+
+	std::cout << "    model:     " << modelPath << " (" << ToMegabytes(std::filesystem::file_size(modelPath))
+			  << " MB)\n"
+			  << "    start:     resident " << ToMegabytes(memory::GetCurrentResidentBytes()) << " MB\n";
+
+	ThreadPool threadPool;
+
+	// streamed first, the heap the parsed load leaves behind would count
+	// towards the streamed peak otherwise; streamed models have no lods, so
+	// neither has the parsed one, or the index counts would differ
+	ModelLoadOptions options{};
+	options.useCookedMesh = false;
+	options.buildLods = false;
+	options.streamObj = true;
+	options.streamOptions.windowSize = windowSize;
+	options.maxStreamPendingBytes = maxStagingSize;
+	const StreamRun streamed = MeasureLoad(modelPath, options, maxStagingSize, threadPool);
+
+	options.streamObj = false;
+	const StreamRun parsed = MeasureLoad(modelPath, options, maxStagingSize, threadPool);
+
+	auto print = [](const char* name, const StreamRun& run) {
+		std::cout << "    " << name << run.time << " ms, peak resident " << ToMegabytes(run.peakBytes) << " MB (+"
+				  << ToMegabytes(run.peakBytes - std::min(run.peakBytes, run.startBytes)) << " MB), "
+				  << run.vertexCount << " vertices, " << run.indexCount << " indices, " << run.submeshCount
+				  << " submeshes, largest upload " << ToMegabytes(run.maxWriteBytes) << " MB\n";
+	};
+	print("streamed:  ", streamed);
+	print("parsed:    ", parsed);
+	std::cout << "    window:    " << windowSize / 1024 << " KB, staging " << ToMegabytes(maxStagingSize) << " MB\n"
+			  << "    peak:      " << ToMegabytes(parsed.peakBytes) / ToMegabytes(streamed.peakBytes)
+			  << "x lower when streamed\n";
+
+	Check(streamed.vertexCount == parsed.vertexCount && streamed.indexCount == parsed.indexCount
+			  && streamed.submeshCount == parsed.submeshCount,
+		"the streamed and parsed models do not match");
+}
+
+static const BenchmarkRegistration g_Registration{ "objStream",
+	"[model path] [repeat count] [window KB] [staging MB]: peak resident of parsed vs streamed load",
+	RunObjStreamBenchmark };
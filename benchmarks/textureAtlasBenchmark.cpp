@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "core/threadPool.h"
+#include "renderer/texture/textureAtlas.h"
+
+
+// bytes of an RGBA8 image with `levelCount` levels of its mip chain
+static uint64_t GetChainBytes(uint32_t width, uint32_t height, uint32_t levelCount)
+{
+	uint64_t bytes = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+		bytes += static_cast<uint64_t>(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4;
+	return bytes;
+}
+
+// every texel of the rect of the texture and of its gutter, in every level,
+// must be the colour the texture is filled with; a neighbour or a filter
+// that bled into it would change some
+static uint32_t CountBleedingTexels(const std::vector<texture::MipLevel>& images,
+	const AtlasLayout& layout,
+	const std::vector<AtlasPage>& pages)
+{
+	uint32_t bleeding = 0;
+	for (uint32_t i = 0; i < images.size(); ++i)
+	{
+		const AtlasRect& rect = layout.rects[i];
+		if (rect.page == NO_ATLAS_PAGE)
+			continue;
+
+		for (uint32_t level = 0; level < layout.levelCount; ++level)
+		{
+			const texture::MipLevel& pageLevel = pages[rect.page].levels[level];
+			const uint32_t gutter = layout.padding >> level;
+			const uint32_t x = (rect.x >> level) - gutter;
+			const uint32_t y = (rect.y >> level) - gutter;
+			const uint32_t width = std::max(1u, rect.width >> level) + 2 * gutter;
+			const uint32_t height = std::max(1u, rect.height >> level) + 2 * gutter;
+			for (uint32_t row = y; row < y + height; ++row)
+			{
+				for (uint32_t column = x; column < x + width; ++column)
+				{
+					const uint8_t* texel =
+						pageLevel.texels.data() + (static_cast<size_t>(row) * pageLevel.width + column) * 4;
+					bleeding += memcmp(texel, images[i].texels.data(), 4) != 0 ? 1 : 0;
+				}
+			}
+		}
+	}
+
+	return bleeding;
+}
+
+// small textures of random sizes, like the props and decals of a scene,
+// each filled with a colour of its own; compares the images and memory of
+// one texture per image with the pages of atlases of two level counts, the
+// time to pack and build them, and checks that no texture bleeds into its
+// gutter in any level
+static void RunTextureAtlasBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t textureCount = GetUintArg(args, 0, 500);
+	const uint32_t maxTextureSize = GetUintArg(args, 1, 256);
+	const uint32_t pageSize = GetUintArg(args, 2, 2048);
+
+	uint32_t maxSizeShift = 3;
+	while ((2u << maxSizeShift) <= maxTextureSize)
+		++maxSizeShift;
+
+	std::mt19937 random{ 42 };
+	std::uniform_int_distribution<uint32_t> sizeShift{ 3, maxSizeShift };
+	std::uniform_int_distribution<uint32_t> channel{ 0, 255 };
+
+	// power of two sides from 8 texels, and an odd one now and then
+	std::vector<texture::MipLevel> images(textureCount);
+	uint64_t separateBytes = 0;
+	for (texture::MipLevel& image : images)
+	{
+		const auto getSide = [&]() {
+			const uint32_t side = 1u << sizeShift(random);
+			return random() % 8 == 0 ? side * 3 / 4 : side;
+		};
+		image.width = getSide();
+		image.height = getSide();
+
+		const uint8_t colour[4] = { static_cast<uint8_t>(channel(random)),
+			static_cast<uint8_t>(channel(random)),
+			static_cast<uint8_t>(channel(random)),
+			255 };
+		image.texels.resize(static_cast<size_t>(image.width) * image.height * 4);
+		for (size_t texel = 0; texel < image.texels.size(); texel += 4)
+			memcpy(image.texels.data() + texel, colour, 4);
+
+		const uint32_t levelCount = texture::GetMipLevelCount(image.width, image.height);
+		separateBytes += GetChainBytes(image.width, image.height, levelCount);
+	}
+
+	std::cout << "    " << textureCount << " textures of 8 to " << maxTextureSize << " texels, "
+			  << separateBytes / 1024 << " KB in RGBA8 with their mip chains\n";
+
+	// the default levels, and fewer of them with narrower gutters
+	ThreadPool threadPool;
+	for (uint32_t levelCount : { AtlasOptions{}.levelCount, 4u })
+	{
+		AtlasOptions options{};
+		options.pageSize = pageSize;
+		options.maxTextureSize = maxTextureSize;
+		options.levelCount = levelCount;
+
+		AtlasLayout layout;
+		const double packMilliseconds =
+			MeasureMilliseconds(10, [&]() { layout = texture::PackAtlas(images, options); });
+		std::vector<AtlasPage> pages;
+		const double buildMilliseconds =
+			MeasureMilliseconds(3, [&]() { pages = texture::BuildAtlasPages(images, layout, options, threadPool); });
+
+		uint32_t packedCount = 0;
+		for (const AtlasRect& rect : layout.rects)
+			packedCount += rect.page != NO_ATLAS_PAGE ? 1 : 0;
+		const uint64_t pageTexels = static_cast<uint64_t>(layout.pageCount) * pageSize * pageSize;
+
+		std::cout << "        " << packedCount << " packed in " << layout.pageCount << " pages of " << pageSize << "x"
+				  << pageSize << " with " << layout.levelCount << " levels and a gutter of " << layout.padding
+				  << " texels: " << layout.pageCount * GetChainBytes(pageSize, pageSize, layout.levelCount) / 1024
+				  << " KB, "
+				  << 100.0 * static_cast<double>(layout.packedTexels)
+						 / static_cast<double>(std::max<uint64_t>(1, pageTexels))
+				  << "% of the texels used, " << textureCount << " images and descriptors vs "
+				  << layout.pageCount + textureCount - packedCount << ", packed in " << packMilliseconds
+				  << " ms, pages built in " << buildMilliseconds << " ms\n";
+
+		const uint32_t bleeding = CountBleedingTexels(images, layout, pages);
+		Check(bleeding == 0, std::to_string(bleeding) + " texels of the textures or their gutters bled");
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "textureAtlas",
+	"[texture count] [max texture size] [page size]: pages, memory and bleeding of packed textures",
+	RunTextureAtlasBenchmark };
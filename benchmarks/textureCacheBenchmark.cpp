@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/texture/textureResidency.h"
+
+
+struct WalkResult
+{
+	TextureCacheStats stats;
+	uint64_t loadedBytes;
+	uint64_t acquireCount;
+};
+
+// walks `laps` times through the rooms and back, acquiring the textures of a
+// room before releasing the ones of the previous room, like a level that
+// streams its rooms in; what `TextureCache` does minus the GPU
+static WalkResult WalkRooms(const std::vector<std::vector<uint32_t>>& rooms,
+	const std::vector<std::string>& keys,
+	const std::vector<uint64_t>& sizes,
+	uint32_t laps,
+	uint64_t budget)
+{
+	TextureResidency residency{ budget };
+	WalkResult result{};
+
+	std::vector<uint32_t> previous;
+	std::vector<uint32_t> current;
+	const auto visit = [&](const std::vector<uint32_t>& room) {
+		current.clear();
+		for (uint32_t texture : room)
+		{
+			bool resident = false;
+			const uint32_t entry = residency.Acquire(keys[texture], resident);
+			if (!resident)
+			{
+				residency.OnLoaded(entry, sizes[texture]);
+				result.loadedBytes += sizes[texture];
+			}
+			current.push_back(entry);
+		}
+		residency.Evict();
+		result.acquireCount += room.size();
+
+		for (uint32_t entry : previous)
+			residency.Release(entry);
+		residency.Evict();
+		std::swap(previous, current);
+	};
+
+	for (uint32_t lap = 0; lap < laps; ++lap)
+	{
+		for (size_t i = 0; i < rooms.size(); ++i)
+			visit(rooms[i]);
+		for (size_t i = rooms.size(); i-- > 0;)
+			visit(rooms[i]);
+	}
+	for (uint32_t entry : previous)
+		residency.Release(entry);
+
+	result.stats = residency.GetStats();
+	return result;
+}
+
+// textures of BC7 sizes with their mip chain, shared by overlapping rooms;
+// compares the uploads of evicting a texture as soon as it is released vs
+// keeping the released ones resident within a budget
+static void RunTextureCacheBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t textureCount = GetUintArg(args, 0, 512);
+	const uint32_t texturesPerRoom = GetUintArg(args, 1, 32);
+	const uint32_t laps = GetUintArg(args, 2, 8);
+
+	std::mt19937 random{ 42 };
+	std::uniform_int_distribution<uint32_t> sizeLog{ 9, 11 };
+	std::vector<std::string> keys(textureCount);
+	std::vector<uint64_t> sizes(textureCount);
+	uint64_t totalBytes = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		const uint64_t width = 1ull << sizeLog(random);
+		keys[i] = "assets/textures/texture" + std::to_string(i) + ".png";
+		sizes[i] = width * width * 4 / 3;
+		totalBytes += sizes[i];
+	}
+
+	// every room shares half of its textures with the next one
+	const uint32_t roomStep = std::max(1u, texturesPerRoom / 2);
+	std::vector<std::vector<uint32_t>> rooms;
+	for (uint32_t first = 0; first + texturesPerRoom <= textureCount; first += roomStep)
+	{
+		rooms.emplace_back();
+		for (uint32_t i = 0; i < texturesPerRoom; ++i)
+			rooms.back().push_back(first + i);
+	}
+	if (rooms.empty())
+		throw std::runtime_error("Fewer textures than textures per room");
+
+	const uint64_t roomBytes = totalBytes / textureCount * texturesPerRoom;
+	std::cout << "    " << textureCount << " textures (" << totalBytes / (1024 * 1024) << " MB), " << rooms.size()
+			  << " rooms of " << texturesPerRoom << " (~" << roomBytes / (1024 * 1024) << " MB), " << laps
+			  << " laps there and back\n";
+
+	const struct
+	{
+		const char* name;
+		uint64_t budget;
+	} budgets[] = {
+		{ "no budget (evicted once released)", 0 },
+		{ "budget of 2 rooms", roomBytes * 2 },
+		{ "budget of 8 rooms", roomBytes * 8 },
+		{ "unlimited", std::numeric_limits<uint64_t>::max() },
+	};
+	for (const auto& budget : budgets)
+	{
+		WalkResult result{};
+		const double milliseconds = MeasureMilliseconds(
+			5, [&]() { result = WalkRooms(rooms, keys, sizes, laps, budget.budget); });
+
+		const TextureCacheStats& stats = result.stats;
+		std::cout << "        " << budget.name << ": " << stats.hits << " hits, " << stats.misses << " misses ("
+				  << stats.reloads << " reloads), " << stats.evictions << " evictions, "
+				  << result.loadedBytes / (1024 * 1024) << " MB uploaded, peak "
+				  << stats.peakResidentBytes / (1024 * 1024) << " MB resident, " << milliseconds * 1000000.0 / static_cast<double>(result.acquireCount)
+				  << " ns per acquire\n";
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "textureCache",
+	"[texture count] [textures per room] [laps]: uploads and evictions of the texture cache per budget",
+	RunTextureCacheBenchmark };
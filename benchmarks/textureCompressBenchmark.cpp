@@ -0,0 +1,104 @@
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "stb_image/stb_image.h"
+
+#include "benchmark.h"
+#include "renderer/texture/bcCodec.h"
+#include "renderer/texture/ktxFile.h"
+
+
+// peak signal to noise ratio in dB of the first `channelCount` channels of
+// the decoded texels; higher is better, above ~40 dB the difference is hard
+// to see
+static double GetPsnr(const uint8_t* source, const std::vector<uint8_t>& decoded, uint32_t channelCount)
+{
+	double squaredError = 0.0;
+	for (size_t texel = 0; texel < decoded.size() / 4; ++texel)
+	{
+		for (uint32_t channel = 0; channel < channelCount; ++channel)
+		{
+			const double difference =
+				static_cast<double>(source[texel * 4 + channel]) - static_cast<double>(decoded[texel * 4 + channel]);
+			squaredError += difference * difference;
+		}
+	}
+
+	const double meanSquaredError = squaredError / static_cast<double>(decoded.size() / 4 * channelCount);
+	return meanSquaredError == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+// encode speed, size and quality of every block format on a texture, and
+// the size of its cooked KTX2 with the whole mip chain
+static void RunTextureCompressBenchmark(const BenchmarkArgs& args)
+{
+	const std::string texturePath = GetArg(args, 0, DEFAULT_TEXTURE_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const uint32_t threadCount = GetThreadCountArg(args, 2);
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	stbi_uc* texels = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!texels)
+		throw std::runtime_error("Failed to load texture image: " + texturePath);
+
+	const uint32_t textureWidth = static_cast<uint32_t>(width);
+	const uint32_t textureHeight = static_cast<uint32_t>(height);
+	const double rgbaSize = static_cast<double>(textureWidth) * textureHeight * 4;
+	const double megaTexels = static_cast<double>(textureWidth) * textureHeight / 1e6;
+
+	ThreadPool singleThread{ 1 };
+	ThreadPool threadPool{ threadCount };
+
+	std::cout << "    " << texturePath << ": " << width << "x" << height << ", " << rgbaSize << " bytes as RGBA8\n";
+	for (texture::BlockFormat format :
+		{ texture::BlockFormat::BC1, texture::BlockFormat::BC5, texture::BlockFormat::BC7 })
+	{
+		std::vector<uint8_t> blocks(texture::GetEncodedSize(format, textureWidth, textureHeight));
+		std::vector<uint8_t> decoded(static_cast<size_t>(rgbaSize));
+
+		const auto encode = [&](ThreadPool& pool) {
+			return MeasureMilliseconds(iterations, [&]() {
+				texture::Encode(format, texels, textureWidth, textureHeight, blocks.data(), pool);
+			});
+		};
+		const double singleThreadTime = encode(singleThread);
+		const double time = encode(threadPool);
+		const double decodeTime = MeasureMilliseconds(iterations, [&]() {
+			texture::Decode(format, blocks.data(), textureWidth, textureHeight, decoded.data(), threadPool);
+		});
+
+		// BC5 only keeps red and green; alpha is left out so that BC1 and BC7
+		// compare on the same channels
+		const uint32_t channelCount = format == texture::BlockFormat::BC5 ? 2 : 3;
+
+		std::cout << "        " << texture::GetBlockFormatName(format) << ": " << blocks.size() << " bytes ("
+				  << rgbaSize / static_cast<double>(blocks.size()) << "x smaller), PSNR "
+				  << GetPsnr(texels, decoded, channelCount) << " dB over " << channelCount << " channels, encode "
+				  << megaTexels / (singleThreadTime / 1000.0) << " Mtexels/s on 1 thread, "
+				  << megaTexels / (time / 1000.0) << " Mtexels/s on " << threadPool.GetThreadCount()
+				  << " threads, decode " << decodeTime << " ms\n";
+	}
+	stbi_image_free(texels);
+
+	// the cooked texture that is uploaded as is, with every mip level
+	const std::string cookedPath =
+		(std::filesystem::temp_directory_path() / "textureCompressBenchmark.ktx2").generic_string();
+	const double cookTime =
+		MeasureMilliseconds(1, [&]() { KtxFile::Cook(texturePath, cookedPath, threadPool); });
+	{
+		const KtxFile ktxFile{ cookedPath };
+		std::cout << "    cooked " << texture::GetBlockFormatName(ktxFile.GetBlockFormat()) << " KTX2 in " << cookTime
+				  << " ms: " << ktxFile.GetLevelCount() << " levels, " << ktxFile.GetDataSize()
+				  << " bytes of VRAM vs " << rgbaSize * 4.0 / 3.0 << " as RGBA8 with mips\n";
+	}
+	std::filesystem::remove(cookedPath);
+}
+
+static const BenchmarkRegistration g_Registration{ "textureCompress",
+	"[texture path] [iterations] [max threads]: BC1, BC5 and BC7 size, PSNR and encode speed",
+	RunTextureCompressBenchmark };
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/texture/textureUpload.h"
+
+
+// bytes written into `staging`, two halves used in turn like the batches of
+// `TextureLoader`
+static uint64_t StageTexture(const PreparedTexture& texture,
+	std::vector<uint8_t>& staging,
+	size_t& offset,
+	ThreadPool& threadPool)
+{
+	const size_t half = staging.size() / 2;
+	const size_t size = static_cast<size_t>(texture.stagingSize);
+	if (offset % half + size > half)
+		offset = (offset / half + 1) % 2 * half;
+
+	texture::WriteStaging(texture, staging.data() + offset, threadPool);
+	offset += (size + TEXTURE_STAGING_ALIGNMENT - 1) / TEXTURE_STAGING_ALIGNMENT * TEXTURE_STAGING_ALIGNMENT;
+	return size;
+}
+
+// the CPU side of loading `textureCount` copies of a cooked texture: opening
+// and reading every file, then writing it into staging memory; one texture
+// after the other like `Texture` used to, vs read on the thread pool several
+// textures ahead like `TextureLoader`
+static void RunTextureIngestBenchmark(const BenchmarkArgs& args)
+{
+	const std::string texturePath = GetArg(args, 0, DEFAULT_TEXTURE_PATH);
+	const uint32_t textureCount = GetUintArg(args, 1, 64);
+	const uint32_t threadCount = GetThreadCountArg(args, 2);
+
+	ThreadPool threadPool{ threadCount };
+	const std::filesystem::path copyDirectory = std::filesystem::temp_directory_path() / "textureIngestBenchmark";
+	std::filesystem::remove_all(copyDirectory);
+	std::filesystem::create_directories(copyDirectory);
+
+	const std::string ktxPath = (copyDirectory / "cooked.ktx2").generic_string();
+	const std::string texPath = (copyDirectory / "cooked.tex").generic_string();
+	if (!KtxFile::Cook(texturePath, ktxPath, threadPool) || !TextureFile::Cook(texturePath, texPath, threadPool))
+		throw std::runtime_error("Failed to cook texture: " + texturePath);
+
+	// the images do not exist, only their cooked textures are loaded
+	std::vector<std::string> paths;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		const std::filesystem::path path = copyDirectory / ("texture" + std::to_string(i) + ".png");
+		std::filesystem::copy_file(ktxPath, KtxFile::GetCookedPath(path.generic_string()));
+		std::filesystem::copy_file(texPath, TextureFile::GetCookedPath(path.generic_string()));
+		paths.push_back(path.generic_string());
+	}
+
+	std::vector<uint8_t> staging(static_cast<size_t>(DEFAULT_MAX_TEXTURE_STAGING_SIZE));
+	const uint32_t maxInFlight = threadPool.GetThreadCount() * 2;
+
+	std::cout << "    " << textureCount << " copies of " << texturePath << ", " << threadPool.GetThreadCount()
+			  << " threads\n";
+	for (bool compressed : { true, false })
+	{
+		uint64_t stagedBytes = 0;
+		const double serialTime = MeasureMilliseconds(1, [&]() {
+			size_t offset = 0;
+			stagedBytes = 0;
+			for (const std::string& path : paths)
+			{
+				const PreparedTexture texture = texture::PrepareTexture(path, compressed, true, nullptr, 1);
+				stagedBytes += StageTexture(texture, staging, offset, threadPool);
+			}
+		});
+
+		const double pipelinedTime = MeasureMilliseconds(1, [&]() {
+			std::vector<PreparedTexture> prepared(paths.size());
+			std::vector<std::future<void>> futures(paths.size());
+			size_t submitted = 0;
+			const auto prepareNext = [&]() {
+				if (submitted == paths.size())
+					return;
+				const size_t i = submitted++;
+				futures[i] = threadPool.Submit(
+					[&, i]() { prepared[i] = texture::PrepareTexture(paths[i], compressed, true, nullptr, 1); });
+			};
+			while (submitted < std::min<size_t>(paths.size(), maxInFlight))
+				prepareNext();
+
+			size_t offset = 0;
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				futures[i].get();
+				prepareNext();
+				StageTexture(prepared[i], staging, offset, threadPool);
+				prepared[i] = PreparedTexture{};
+			}
+		});
+
+		// a texture used to take 3 queue submits and waits (2 transitions and
+		// the copy); a batch is a single submit for every texture it holds
+		const uint64_t batchSize = DEFAULT_MAX_TEXTURE_STAGING_SIZE / 2;
+		std::cout << "        " << (compressed ? "KTX2" : "RGBA8") << ": " << stagedBytes / (1024 * 1024)
+				  << " MB staged, " << serialTime << " ms one by one vs " << pipelinedTime << " ms pipelined ("
+				  << static_cast<double>(stagedBytes) / (1024.0 * 1024.0) / (pipelinedTime / 1000.0) << " MB/s), "
+				  << textureCount * 3 << " queue waits vs " << (stagedBytes + batchSize - 1) / batchSize
+				  << " batches\n";
+	}
+
+	std::filesystem::remove_all(copyDirectory);
+}
+
+static const BenchmarkRegistration g_Registration{ "textureIngest",
+	"[texture path] [texture count] [max threads]: one by one vs pipelined texture reads and staging",
+	RunTextureIngestBenchmark };
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/memory/frameRingAllocator.h"
+
+
+// the size of `UniformBufferObject`: three matrices and a vector
+constexpr uint64_t g_UniformBlockSize = 3 * 64 + 16;
+constexpr uint32_t g_FramesInFlight = 2;
+
+// a draw's uniform block, tagged with the frame that pushed it so that a
+// block overwritten while its frame is in flight is caught
+struct SimulatedBlock
+{
+	uint32_t frame;
+	uint32_t draw;
+	uint8_t padding[g_UniformBlockSize - 2 * sizeof(uint32_t)];
+};
+
+// pushes the uniform block of every draw of `frameCount` frames into a ring
+// with a region per frame in flight, like `UniformBuffer::Push`, and checks
+// that the blocks are aligned, that those of a frame in flight are still
+// intact when its fence signals and its region starts over, and how many
+// did not fit
+static void RunFrames(FrameRingAllocator& ring,
+	std::vector<uint8_t>& buffer,
+	uint32_t frameCount,
+	uint32_t drawCount,
+	uint32_t& errors)
+{
+	std::vector<std::vector<uint64_t>> frameOffsets(g_FramesInFlight);
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		// the fence of the previous submission of the frame signaled: what
+		// it pushed must have survived the frames in flight since
+		const uint32_t frameIdx = frame % g_FramesInFlight;
+		for (uint64_t offset : frameOffsets[frameIdx])
+		{
+			SimulatedBlock block;
+			memcpy(&block, buffer.data() + offset, sizeof(block));
+			if (block.frame != frame - g_FramesInFlight && errors++ == 0)
+				std::cout << "    ERROR: a block of frame " << block.frame << " is at " << offset << "\n";
+		}
+		frameOffsets[frameIdx].clear();
+
+		ring.BeginFrame(frameIdx);
+		for (uint32_t draw = 0; draw < drawCount; ++draw)
+		{
+			const uint64_t offset = ring.Allocate(sizeof(SimulatedBlock));
+			if (offset == NO_RING_OFFSET)
+				continue;
+			if (offset % ring.GetAlignment() != 0 && errors++ == 0)
+				std::cout << "    ERROR: a block at " << offset << " is not aligned to " << ring.GetAlignment() << "\n";
+
+			const SimulatedBlock block{ frame, draw, {} };
+			memcpy(buffer.data() + offset, &block, sizeof(block));
+			frameOffsets[frameIdx].push_back(offset);
+		}
+	}
+}
+
+// what the uniform blocks of thousands of draws cost with a buffer and a
+// descriptor set per block, like `UniformBuffer` had for its single block,
+// vs a ring with a region per frame in flight bound with dynamic offsets; the
+// ring is run with the alignments devices report for
+// `minUniformBufferOffsetAlignment`, which round the blocks up
+static void RunUniformRingBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t drawCount = GetUintArg(args, 0, 4000);
+	const uint32_t frameCount = GetUintArg(args, 1, 1000);
+	const uint64_t frameSize = GetSizeArg(args, 2, 1024, 1024);
+
+	std::cout << "    a buffer per block: " << drawCount * g_FramesInFlight << " buffers and memory allocations, "
+			  << drawCount * g_FramesInFlight << " descriptor sets, " << drawCount << " binds per frame\n";
+
+	for (uint64_t alignment : { 16ull, 64ull, 256ull })
+	{
+		FrameRingAllocator ring{ g_FramesInFlight, frameSize, alignment };
+		std::vector<uint8_t> buffer(ring.GetSize(), 0);
+
+		uint32_t errors = 0;
+		const double milliseconds =
+			MeasureMilliseconds(1, [&]() { RunFrames(ring, buffer, frameCount, drawCount, errors); });
+
+		const FrameRingStats stats = ring.GetStats();
+		const double blocks = static_cast<double>(frameCount) * drawCount;
+		std::cout << "    ring aligned to " << alignment << ": 1 buffer of " << ring.GetSize() / 1024 << " KB, "
+				  << g_FramesInFlight << " descriptor sets, " << stats.peakBytes / 1024 << " KB of a frame used, "
+				  << stats.failedCount << " blocks did not fit, " << milliseconds * 1e6 / blocks
+				  << " ns per block\n";
+		Check(errors == 0,
+			std::to_string(errors) + " blocks overwritten in flight or misaligned to " + std::to_string(alignment));
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "uniformRing",
+	"[draw count] [frame count] [frame KB]: buffers, sets and time of per-draw uniforms in a ring",
+	RunUniformRingBenchmark };
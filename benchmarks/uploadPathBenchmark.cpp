@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/model.h"
+#include "renderer/buffer/uploadPath.h"
+
+
+constexpr VkDeviceSize g_GigaByte = 1024ull * 1024 * 1024;
+
+struct MemoryHeapDesc
+{
+	VkDeviceSize size;
+	bool deviceLocal;
+};
+
+struct MemoryTypeDesc
+{
+	VkMemoryPropertyFlags properties;
+	uint32_t heapIndex;
+};
+
+// the memory heaps and types of a kind of device, like the drivers report them
+struct DeviceMemoryDesc
+{
+	const char* name;
+	std::vector<MemoryHeapDesc> heaps;
+	std::vector<MemoryTypeDesc> types;
+};
+
+static VkPhysicalDeviceMemoryProperties GetMemoryProperties(const DeviceMemoryDesc& desc)
+{
+	VkPhysicalDeviceMemoryProperties properties{};
+	properties.memoryHeapCount = static_cast<uint32_t>(desc.heaps.size());
+	for (uint32_t i = 0; i < properties.memoryHeapCount; ++i)
+	{
+		properties.memoryHeaps[i].size = desc.heaps[i].size;
+		properties.memoryHeaps[i].flags = desc.heaps[i].deviceLocal ? VK_MEMORY_HEAP_DEVICE_LOCAL_BIT : 0;
+	}
+	properties.memoryTypeCount = static_cast<uint32_t>(desc.types.size());
+	for (uint32_t i = 0; i < properties.memoryTypeCount; ++i)
+	{
+		properties.memoryTypes[i].propertyFlags = desc.types[i].properties;
+		properties.memoryTypes[i].heapIndex = desc.types[i].heapIndex;
+	}
+
+	return properties;
+}
+
+// decodes `data` piece by piece into a staging buffer of at most
+// `maxStagingSize` bytes and copies every piece into `destination`, like the
+// GPU copies of `staging::UploadBuffer`
+static BufferUploadStats UploadStaged(const EncodedStream& data,
+	uint64_t maxStagingSize,
+	uint8_t* destination,
+	ThreadPool& threadPool)
+{
+	BufferUploadStats stats{};
+	stats.path = UploadPath::STAGED;
+
+	const uint64_t granularity = codec::GetDecodeGranularity(data);
+	const uint64_t pieceSize =
+		std::min<uint64_t>(data.decodedSize, std::max<uint64_t>(maxStagingSize / granularity, 1) * granularity);
+	std::vector<uint8_t> staging(pieceSize);
+	for (uint64_t offset = 0; offset < data.decodedSize; offset += pieceSize)
+	{
+		const uint64_t size = std::min<uint64_t>(pieceSize, data.decodedSize - offset);
+		codec::Decode(data, offset, size, staging.data(), threadPool);
+		memcpy(destination + offset, staging.data(), static_cast<size_t>(size));
+		++stats.submitCount;
+	}
+
+	stats.writtenBytes = data.decodedSize;
+	stats.copiedBytes = data.decodedSize;
+	stats.stagingBytes = pieceSize;
+	return stats;
+}
+
+// decodes `data` straight into `destination`, like `staging::CreateDeviceBuffer`
+// on devices with direct uploads
+static BufferUploadStats UploadDirect(const EncodedStream& data, uint8_t* destination, ThreadPool& threadPool)
+{
+	BufferUploadStats stats{};
+	stats.path = UploadPath::DIRECT;
+	codec::Decode(data, destination, threadPool);
+	stats.writtenBytes = data.decodedSize;
+	return stats;
+}
+
+static BufferUploadStats AddStats(const BufferUploadStats& a, const BufferUploadStats& b)
+{
+	BufferUploadStats stats = a;
+	stats.writtenBytes += b.writtenBytes;
+	stats.copiedBytes += b.copiedBytes;
+	stats.stagingBytes = std::max(a.stagingBytes, b.stagingBytes);
+	stats.submitCount += b.submitCount;
+	return stats;
+}
+
+// which path the buffers of typical devices are uploaded through, and the
+// bytes moved, staging memory and time of uploading the vertices and indices
+// of the cooked model through each; the GPU copy is a memcpy here, so the
+// staged time leaves out the submits and waits it also takes
+static void RunUploadPathBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 20);
+	const uint64_t maxStagingSize = GetSizeArg(args, 2, 16, 1024 * 1024);
+
+	const VkMemoryPropertyFlags deviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	const VkMemoryPropertyFlags hostCoherent =
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const VkMemoryPropertyFlags hostCached = hostCoherent | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	const DeviceMemoryDesc devices[] = {
+		{ "discrete GPU", { { 8 * g_GigaByte, true }, { 16 * g_GigaByte, false }, { 256 * 1024 * 1024, true } },
+			{ { deviceLocal, 0 }, { hostCoherent, 1 }, { hostCached, 1 }, { deviceLocal | hostCoherent, 2 } } },
+		{ "discrete GPU with resizable BAR", { { 8 * g_GigaByte, true }, { 16 * g_GigaByte, false } },
+			{ { deviceLocal, 0 }, { hostCoherent, 1 }, { hostCached, 1 }, { deviceLocal | hostCoherent, 0 } } },
+		{ "integrated GPU", { { 8 * g_GigaByte, true } },
+			{ { deviceLocal, 0 }, { deviceLocal | hostCoherent, 0 }, { deviceLocal | hostCached, 0 } } },
+		{ "lavapipe", { { 16 * g_GigaByte, true } }, { { deviceLocal | hostCached, 0 } } },
+	};
+	for (const DeviceMemoryDesc& device : devices)
+	{
+		const std::optional<uint32_t> type = staging::FindDirectWriteMemoryType(GetMemoryProperties(device));
+		std::cout << "    " << device.name << ": ";
+		if (type)
+			std::cout << "direct, memory type " << *type << "\n";
+		else
+			std::cout << "staged\n";
+	}
+
+	const Model model{ modelPath.c_str() };
+	const EncodedStream vertexData = model.GetVertexData();
+	const EncodedStream indexData = model.GetIndexData();
+
+	// stands in for the buffers, touched once so that page faults are not
+	// measured
+	std::vector<uint8_t> vertexBuffer(vertexData.decodedSize, 0);
+	std::vector<uint8_t> indexBuffer(indexData.decodedSize, 0);
+
+	ThreadPool threadPool;
+	BufferUploadStats staged{};
+	const double stagedMilliseconds = MeasureMilliseconds(iterations, [&]() {
+		staged = AddStats(UploadStaged(vertexData, maxStagingSize, vertexBuffer.data(), threadPool),
+			UploadStaged(indexData, maxStagingSize, indexBuffer.data(), threadPool));
+	});
+	BufferUploadStats direct{};
+	const double directMilliseconds = MeasureMilliseconds(iterations, [&]() {
+		direct = AddStats(UploadDirect(vertexData, vertexBuffer.data(), threadPool),
+			UploadDirect(indexData, indexBuffer.data(), threadPool));
+	});
+
+	const struct
+	{
+		const char* name;
+		const BufferUploadStats& stats;
+		double milliseconds;
+	} runs[] = { { "staged", staged, stagedMilliseconds }, { "direct", direct, directMilliseconds } };
+	for (const auto& run : runs)
+	{
+		std::cout << "    " << run.name << ": " << run.stats.writtenBytes / 1024 << " KB written, "
+				  << run.stats.copiedBytes / 1024 << " KB copied through " << run.stats.stagingBytes / 1024
+				  << " KB of staging in " << run.stats.submitCount << " submits, " << run.milliseconds << " ms\n";
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "uploadPath",
+	"[model path] [iterations] [staging MB]: bytes moved and time of staged vs direct buffer uploads",
+	RunUploadPathBenchmark };
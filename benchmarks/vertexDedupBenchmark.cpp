@@ -0,0 +1,101 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "benchmark.h"
+#include "renderer/mesh/objParser.h"
+#include "renderer/mesh/vertexDedup.h"
+
+
+// the hash `Model` used with `std::unordered_map` before the flat table
+// (minus the constant color `Vertex` no longer has)
+struct XorShiftVertexHash
+{
+	size_t operator()(const Vertex& vertex) const
+	{
+		return (std::hash<glm::vec3>()(vertex.pos) >> 1) ^ (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+	}
+};
+
+static std::vector<Vertex> BuildVertexStream(const ObjData& objData, uint32_t repeatCount)
+{
+	std::vector<Vertex> vertices;
+	vertices.reserve(objData.indices.size() * repeatCount);
+
+	for (uint32_t copy = 0; copy < repeatCount; ++copy)
+	{
+		for (const ObjIndex& index : objData.indices)
+		{
+			Vertex vertex{};
+			// offset every copy so that copies do not collapse into each other
+			vertex.pos = glm::vec3{ objData.positions[3 * index.vertexIndex + 0] + static_cast<float>(copy),
+				objData.positions[3 * index.vertexIndex + 1],
+				objData.positions[3 * index.vertexIndex + 2] };
+			if (index.texCoordIndex >= 0)
+				vertex.texCoord = glm::vec2{ objData.texCoords[2 * index.texCoordIndex + 0],
+					1.0f - objData.texCoords[2 * index.texCoordIndex + 1] };
+			vertices.push_back(vertex);
+		}
+	}
+
+	return vertices;
+}
+
+// compares `std::unordered_map` with the old hash against the flat table,
+// serial and partitioned across threads
+static void RunVertexDedupBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 3);
+	const uint32_t repeatCount = GetUintArg(args, 2, 1);
+	const uint32_t maxThreads = GetThreadCountArg(args, 3);
+
+	const std::vector<Vertex> vertices = BuildVertexStream(mesh::ParseObjReference(modelPath), repeatCount);
+
+	size_t mapUniqueCount = 0;
+	size_t mapBucketCollisions = 0;
+	const double mapTime = MeasureMilliseconds(iterations, [&]() {
+		std::unordered_map<Vertex, uint32_t, XorShiftVertexHash> uniqueVertices{};
+		for (const Vertex& vertex : vertices)
+			uniqueVertices.emplace(vertex, static_cast<uint32_t>(uniqueVertices.size()));
+
+		mapUniqueCount = uniqueVertices.size();
+		mapBucketCollisions = 0;
+		for (size_t bucket = 0; bucket < uniqueVertices.bucket_count(); ++bucket)
+			mapBucketCollisions += uniqueVertices.bucket_size(bucket) > 1 ? uniqueVertices.bucket_size(bucket) - 1 : 0;
+	});
+
+	std::cout << "    vertices:        " << vertices.size() << " total, " << mapUniqueCount << " unique\n"
+			  << "    unordered_map:   " << mapTime << " ms (" << mapBucketCollisions << " bucket collisions)\n";
+
+	std::vector<Vertex> referenceVertices;
+	std::vector<uint32_t> referenceIndices;
+	const double serialTime = MeasureMilliseconds(
+		iterations, [&]() { mesh::DeduplicateVertices(vertices, referenceVertices, referenceIndices); });
+	std::cout << "    flat table:      " << serialTime << " ms, " << mapTime / serialTime << "x vs unordered_map\n";
+
+	for (uint32_t threadCount = 2; threadCount <= maxThreads; threadCount *= 2)
+	{
+		ThreadPool threadPool{ threadCount };
+
+		std::vector<Vertex> uniqueVertices;
+		std::vector<uint32_t> indices;
+		const double time = MeasureMilliseconds(
+			iterations, [&]() { mesh::DeduplicateVertices(vertices, uniqueVertices, indices, &threadPool); });
+
+		const bool matches = indices == referenceIndices && uniqueVertices.size() == referenceVertices.size()
+							 && memcmp(uniqueVertices.data(), referenceVertices.data(), sizeof(Vertex) * uniqueVertices.size())
+									== 0;
+		std::cout << "    " << threadCount << " partitions:    " << time << " ms, " << serialTime / time
+				  << "x vs flat table\n";
+		Check(matches, "the vertices deduplicated in " + std::to_string(threadCount) + " partitions differ");
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "vertexDedup",
+	"[model path] [iterations] [repeat count] [max threads]: unordered_map vs flat hash table",
+	RunVertexDedupBenchmark };
@@ -0,0 +1,49 @@
+#include <iostream>
+#include <string>
+
+#include "benchmark.h"
+#include "renderer/model.h"
+
+
+// size, conversion time and precision of every vertex layout
+static void RunVertexLayoutBenchmark(const BenchmarkArgs& args)
+{
+	const std::string modelPath = GetArg(args, 0, DEFAULT_MODEL_PATH);
+	const uint32_t iterations = GetUintArg(args, 1, 5);
+
+	ModelLoadOptions options{};
+	options.useCookedMesh = false;
+	const Model model{ modelPath.c_str(), options };
+
+	const std::vector<Vertex>& vertices = model.GetVertices();
+	const float diagonal = glm::length(model.GetBoundsMax() - model.GetBoundsMin());
+
+	for (VertexLayout layout : { VertexLayout::FLOAT32, VertexLayout::FLOAT16, VertexLayout::SNORM16 })
+	{
+		VertexQuantization quantization{};
+		std::vector<uint8_t> vertexData;
+		const double milliseconds = MeasureMilliseconds(iterations, [&]() {
+			quantization = mesh::GetVertexQuantization(vertices, layout);
+			vertexData = mesh::QuantizeVertices(vertices, layout, quantization);
+		});
+
+		// largest distance between a decoded vertex and the original one
+		const uint32_t stride = Vertex::GetStride(layout);
+		float positionError = 0.0f;
+		float texCoordError = 0.0f;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const Vertex decoded = mesh::DequantizeVertex(vertexData.data() + i * stride, layout, quantization);
+			positionError = glm::max(positionError, glm::length(decoded.pos - vertices[i].pos));
+			texCoordError = glm::max(texCoordError, glm::length(decoded.texCoord - vertices[i].texCoord));
+		}
+
+		std::cout << "    " << mesh::GetVertexLayoutName(layout) << ": " << stride << " bytes per vertex, "
+				  << vertexData.size() << " bytes in " << milliseconds << " ms, position error "
+				  << positionError / diagonal << " of the bounds, uv error " << texCoordError << '\n';
+	}
+}
+
+static const BenchmarkRegistration g_Registration{ "vertexLayout",
+	"[model path] [iterations]: size, conversion time and precision of every vertex layout",
+	RunVertexLayoutBenchmark };
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "renderer/texture/ktxFile.h"
+#include "renderer/texture/tileCache.h"
+
+
+// frames from drawing a frame to reading its feedback, the frames in flight
+constexpr uint32_t g_FeedbackLatencyFrames = 2;
+// frames from starting to read a tile to uploading it
+constexpr uint32_t g_ReadLatencyFrames = 2;
+// distance from the camera, in texture coordinates, up to which level 0 is
+// sampled; every level further is sampled twice as far
+constexpr float g_FullDetailDistance = 0.02f;
+// distance from the camera up to which the texture is drawn
+constexpr float g_ViewDistance = 0.5f;
+// texture coordinates the camera moves per frame
+constexpr float g_CameraSpeed = 0.002f;
+
+struct TileStreamResult
+{
+	TileCacheStats stats;
+	uint64_t uploadedTiles;
+	uint32_t maxFrameUploads;
+	uint64_t pageTableUploads;
+	// pages sampled in a frame, and the ones of them drawn from a coarser tile
+	uint64_t sampledCount;
+	uint64_t missingCount;
+	double milliseconds;
+};
+
+// the pages the fragment shader samples with the camera at (x, y): a page of
+// a level when part of it is within the distances that level is sampled at
+static void GetSampledPages(const VirtualTextureLayout& layout, float x, float y, std::vector<uint32_t>& pages)
+{
+	pages.clear();
+	for (uint32_t level = 0; level < layout.levelCount; ++level)
+	{
+		// the coarsest level is sampled all the way to the view distance
+		const float minDistance = level == 0 ? 0.0f : g_FullDetailDistance * std::exp2(static_cast<float>(level));
+		float maxDistance = g_FullDetailDistance * std::exp2(static_cast<float>(level + 1));
+		if (level + 1 == layout.levelCount || maxDistance > g_ViewDistance)
+			maxDistance = g_ViewDistance;
+		if (minDistance >= maxDistance)
+			continue;
+
+		const float pagesX = static_cast<float>(layout.pagesX[level]);
+		const float pagesY = static_cast<float>(layout.pagesY[level]);
+		const uint32_t beginX = static_cast<uint32_t>(std::max(0.0f, (x - maxDistance) * pagesX));
+		const uint32_t endX = static_cast<uint32_t>(std::clamp((x + maxDistance) * pagesX + 1.0f, 0.0f, pagesX));
+		const uint32_t beginY = static_cast<uint32_t>(std::max(0.0f, (y - maxDistance) * pagesY));
+		const uint32_t endY = static_cast<uint32_t>(std::clamp((y + maxDistance) * pagesY + 1.0f, 0.0f, pagesY));
+		for (uint32_t pageY = beginY; pageY < endY; ++pageY)
+		{
+			for (uint32_t pageX = beginX; pageX < endX; ++pageX)
+			{
+				const float left = static_cast<float>(pageX) / pagesX;
+				const float top = static_cast<float>(pageY) / pagesY;
+				const float right = left + 1.0f / pagesX;
+				const float bottom = top + 1.0f / pagesY;
+
+				// the closest and the farthest point of the page
+				const float nearX = std::clamp(x, left, right) - x;
+				const float nearY = std::clamp(y, top, bottom) - y;
+				const float farX = std::max(std::abs(left - x), std::abs(right - x));
+				const float farY = std::max(std::abs(top - y), std::abs(bottom - y));
+				if (std::hypot(nearX, nearY) < maxDistance && std::hypot(farX, farY) >= minDistance)
+					pages.push_back(layout.GetPage(level, pageX, pageY));
+			}
+		}
+	}
+}
+
+// flies the camera in a circle over the texture for `frameCount` frames,
+// feeding the pages it samples to a `TileCache` once the frame would be
+// done; the tiles are read and uploaded later, like `VirtualTexture` minus
+// the GPU
+static TileStreamResult StreamTiles(const VirtualTextureLayout& layout,
+	uint32_t frameCount,
+	uint32_t cacheSize,
+	uint32_t maxUploadTiles)
+{
+	TileCache cache{ layout, cacheSize };
+
+	struct PendingTile
+	{
+		uint32_t page;
+		uint32_t readyFrame;
+	};
+	std::deque<PendingTile> pending;
+	std::deque<std::vector<uint32_t>> feedback;
+	std::vector<uint32_t> pageTable;
+
+	TileStreamResult result{};
+	std::chrono::duration<double, std::milli> elapsed{ 0 };
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		const float angle = static_cast<float>(frame) * g_CameraSpeed / 0.3f;
+		const float x = 0.5f + 0.3f * std::cos(angle);
+		const float y = 0.5f + 0.3f * std::sin(angle);
+
+		// the pages are drawn from what is resident before this frame's
+		// update, like the page table the frame samples
+		std::vector<uint32_t> pages;
+		GetSampledPages(layout, x, y, pages);
+		result.sampledCount += pages.size();
+		for (uint32_t page : pages)
+			result.missingCount += cache.IsResident(page) ? 0 : 1;
+		feedback.push_back(std::move(pages));
+
+		const auto start = std::chrono::high_resolution_clock::now();
+		if (feedback.size() > g_FeedbackLatencyFrames)
+		{
+			cache.AddFeedback(feedback.front());
+			feedback.pop_front();
+		}
+
+		uint32_t uploads = 0;
+		while (!pending.empty() && pending.front().readyFrame <= frame && uploads < maxUploadTiles)
+		{
+			cache.SetResident(pending.front().page);
+			pending.pop_front();
+			++uploads;
+		}
+
+		const uint32_t maxPending = maxUploadTiles * 2;
+		if (pending.size() < maxPending)
+		{
+			for (const TileLoad& load : cache.Plan(maxPending - static_cast<uint32_t>(pending.size())))
+				pending.push_back(PendingTile{ load.page, frame + g_ReadLatencyFrames });
+		}
+
+		if (cache.IsPageTableDirty())
+		{
+			cache.BuildPageTable(pageTable);
+			++result.pageTableUploads;
+		}
+		elapsed += std::chrono::high_resolution_clock::now() - start;
+
+		result.uploadedTiles += uploads;
+		result.maxFrameUploads = std::max(result.maxFrameUploads, uploads);
+	}
+
+	result.stats = cache.GetStats();
+	result.milliseconds = elapsed.count();
+	return result;
+}
+
+// a BC1 texture the size of a terrain, with random blocks, the camera flies
+// over; compares the memory of the whole texture vs tile caches of a few
+// sizes, how often a page is drawn from a coarser tile, and the time to read
+// a tile from the cooked texture with and without decoding it to RGBA8
+static void RunVirtualTextureBenchmark(const BenchmarkArgs& args)
+{
+	const uint32_t size = GetUintArg(args, 0, 8192);
+	const uint32_t frameCount = GetUintArg(args, 1, 2000);
+	const uint32_t maxUploadTiles = GetUintArg(args, 2, 128);
+
+	// random blocks decode like any other, and are as slow to read
+	const std::string path = (std::filesystem::temp_directory_path() / "virtualTextureBenchmark.ktx2").generic_string();
+	{
+		std::mt19937 random{ 42 };
+		std::vector<std::vector<uint8_t>> levels;
+		for (uint32_t level = 0; (size >> level) > 0; ++level)
+		{
+			const uint32_t levelSize = size >> level;
+			std::vector<uint8_t> blocks(texture::GetEncodedSize(texture::BlockFormat::BC1, levelSize, levelSize));
+			for (uint8_t& byte : blocks)
+				byte = static_cast<uint8_t>(random());
+			levels.push_back(std::move(blocks));
+		}
+		if (!KtxFile::Write(path, texture::BlockFormat::BC1, true, size, size, levels))
+		{
+			std::cout << "    failed to write " << path << "\n";
+			return;
+		}
+	}
+
+	{
+		const KtxFile file{ path };
+		const VirtualTextureLayout layout = texture::GetVirtualTextureLayout(size, size, DEFAULT_VIRTUAL_TILE_SIZE);
+		const uint32_t slotSize = layout.tileSize + 2 * VIRTUAL_TILE_BORDER;
+		const uint64_t tileBytes = texture::GetEncodedSize(texture::BlockFormat::BC1, slotSize, slotSize);
+
+		std::cout << "    " << size << "x" << size << " BC1 texture (" << file.GetDataSize() / (1024 * 1024)
+				  << " MB with every level, " << file.GetDataSize() * 8 / (1024 * 1024)
+				  << " MB in RGBA8), " << layout.pageCount << " pages of " << layout.tileSize << " texels in "
+				  << layout.levelCount << " levels\n";
+
+		// every page once, the order the tile cache asks for them
+		std::vector<uint8_t> blocks(tileBytes);
+		std::vector<uint8_t> texels(static_cast<size_t>(slotSize) * slotSize * 4);
+		const uint32_t tileCount = std::min(layout.pageCount, 1024u);
+		const double copyMilliseconds = MeasureMilliseconds(3, [&]() {
+			for (uint32_t page = 0; page < tileCount; ++page)
+				texture::CopyTile(file, layout, page, blocks.data());
+		});
+		const double decodeMilliseconds = MeasureMilliseconds(3, [&]() {
+			for (uint32_t page = 0; page < tileCount; ++page)
+			{
+				texture::CopyTile(file, layout, page, blocks.data());
+				texture::Decode(texture::BlockFormat::BC1, blocks.data(), slotSize, slotSize, texels.data());
+			}
+		});
+		std::cout << "        read a tile: " << copyMilliseconds * 1000.0 / tileCount << " us, "
+				  << decodeMilliseconds * 1000.0 / tileCount << " us decoded to RGBA8, on one thread\n";
+
+		const struct
+		{
+			uint32_t cacheSize;
+			uint32_t maxUploadTiles;
+		} configs[] = {
+			{ 8, maxUploadTiles },
+			{ 16, std::max(1u, maxUploadTiles / 8) },
+			{ 16, maxUploadTiles },
+			{ 32, maxUploadTiles },
+		};
+		for (const auto& config : configs)
+		{
+			const TileStreamResult result = StreamTiles(layout, frameCount, config.cacheSize, config.maxUploadTiles);
+
+			std::cout << "        " << config.cacheSize << "x" << config.cacheSize << " cache ("
+					  << result.stats.slotCount * tileBytes / 1024 << " KB), " << config.maxUploadTiles
+					  << " tiles per frame: " << result.stats.loads << " loads, " << result.stats.evictions
+					  << " evictions, " << result.uploadedTiles * tileBytes / (1024 * 1024) << " MB uploaded (at most "
+					  << result.maxFrameUploads << " tiles in a frame), " << result.pageTableUploads
+					  << " page table uploads, "
+					  << 100.0 * static_cast<double>(result.missingCount)
+							 / static_cast<double>(std::max<uint64_t>(1, result.sampledCount))
+					  << "% of sampled pages drawn coarser, "
+					  << result.milliseconds * 1000.0 / static_cast<double>(frameCount) << " us per frame\n";
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+static const BenchmarkRegistration g_Registration{ "virtualTexture",
+	"[texture size] [frame count] [tiles per frame]: tile cache loads and misses per cache size",
+	RunVirtualTextureBenchmark };
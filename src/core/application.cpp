@@ -8,6 +8,9 @@
 #include <limits>
 #include <set>
 #include <stdexcept>
+#include <unordered_map>
+
+#include "core/memoryStats.h"
 
 const VulkanConfig config{
 #ifdef NDEBUG // Release mode
@@ -20,6 +23,77 @@ const VulkanConfig config{
 	{ VK_KHR_SWAPCHAIN_EXTENSION_NAME }
 };
 
+// how far a coarser level of detail may move the surface on screen, in pixels
+constexpr float g_MaxLodPixelError = 1.0f;
+// drawn on the materials without a diffuse texture
+constexpr const char* g_DefaultTexturePath = "assets/textures/viking_room.png";
+// the cookAssets target runs the assetCooker before the application is
+// built, so only the cooked assets are loaded and the sources never parsed
+constexpr bool g_RequireCookedAssets = true;
+// when the source model is parsed, it is read in windows and written into the
+// vertex and index buffers piece by piece, instead of parsed whole and then
+// uploaded; for scans too large to parse at once
+constexpr bool g_StreamSourceModel = false;
+// shared with the assetCooker, relative to the root of the repo
+constexpr const char* g_AssetCacheDirectory = "cache";
+// only the mip tails are loaded up front, and the finer levels follow what
+// the frames sample; needs the sampling feedback, see `MipStreamer`
+constexpr bool g_StreamTextures = true;
+// every texture in one array that the draws index with a push constant,
+// instead of a descriptor set bind per texture; needs descriptor indexing
+constexpr bool g_BindlessTextures = true;
+// the textures of the materials no larger than `AtlasOptions::maxTextureSize`
+// are packed into the pages of an atlas, which take a slot of the texture
+// array each instead of a slot per texture; needs the texture array, and
+// the textures not to be streamed
+constexpr bool g_AtlasTextures = true;
+// every material is drawn with a virtual texture of this image instead of
+// its own texture, with the tiles streamed as they are sampled; needs the
+// sampling feedback, see `VirtualTexture`
+constexpr bool g_VirtualTexture = false;
+constexpr const char* g_VirtualTexturePath = "assets/textures/viking_room.png";
+
+static bool DrawsVirtualTexture(const Device* device)
+{
+	return g_VirtualTexture && device->SupportsSamplingFeedback();
+}
+
+static bool StreamsTextures(const Device* device)
+{
+	return g_StreamTextures && device->SupportsSamplingFeedback() && !DrawsVirtualTexture(device);
+}
+
+static uint32_t GetBindlessTextureCount(const Device* device)
+{
+	return g_BindlessTextures && !DrawsVirtualTexture(device) ? device->GetMaxBindlessTextures() : 0;
+}
+
+static bool DrawsAtlasTextures(const Device* device)
+{
+	return g_AtlasTextures && GetBindlessTextureCount(device) > 0 && !StreamsTextures(device);
+}
+
+static TextureCacheOptions GetTextureCacheOptions()
+{
+	TextureCacheOptions options{};
+	options.loadOptions.requireCooked = g_RequireCookedAssets;
+	return options;
+}
+
+static MipStreamerOptions GetMipStreamerOptions()
+{
+	MipStreamerOptions options{};
+	options.loadOptions.requireCooked = g_RequireCookedAssets;
+	return options;
+}
+
+static void PrintUploadStats(const char* name, const BufferUploadStats& stats)
+{
+	std::cout << "Uploaded " << name << " buffer " << (stats.path == UploadPath::DIRECT ? "directly" : "staged") << ": "
+			  << stats.writtenBytes / 1024 << " KB written, " << stats.copiedBytes / 1024 << " KB copied through "
+			  << stats.stagingBytes / 1024 << " KB of staging in " << stats.submitCount << " submits\n";
+}
+
 Application::Application(const char* title, int32_t width, int32_t height)
 	: m_Config{ &config },
 	  m_Window{ std::make_unique<Window>(title, width, height) },
@@ -30,22 +104,74 @@ Application::Application(const char* title, int32_t width, int32_t height)
 		  m_Device.get(),
 		  m_WindowSurface->GetSurface(),
 		  m_Device->GetMSAASamplesCount()) },
-	  m_GraphicsPipeline{ std::make_unique<Pipeline>(m_Device->GetDevice(),
-		  m_Swapchain->GetRenderPass(),
-		  m_Device->GetMSAASamplesCount()) },
-	  m_Model{ std::make_unique<Model>("assets/models/viking_room.obj") },
+	  m_ThreadPool{ std::make_unique<ThreadPool>() },
+	  m_AssetCache{ std::make_unique<AssetCache>(g_AssetCacheDirectory) },
 	  m_CommandBuffers{
 		  std::make_unique<CommandBuffer>(config.MAX_FRAMES_IN_FLIGHT, m_WindowSurface->GetSurface(), m_Device.get())
 	  },
-	  m_VertexBuffer{ std::make_unique<VertexBuffer>(m_Device.get(), m_CommandBuffers.get(), m_Model->GetVertices()) },
-	  m_IndexBuffer{ std::make_unique<IndexBuffer>(m_Device.get(), m_CommandBuffers.get(), m_Model->GetIndices()) },
-	  m_Texture{ std::make_unique<Texture>(m_Device.get(), m_CommandBuffers.get()) },
+	  m_Model{ LoadModel() },
+	  m_GraphicsPipeline{ std::make_unique<Pipeline>(m_Device->GetDevice(),
+		  m_Swapchain->GetRenderPass(),
+		  m_Device->GetMSAASamplesCount(),
+		  m_Model->GetVertexLayout(),
+		  m_AssetCache.get(),
+		  StreamsTextures(m_Device.get()),
+		  GetBindlessTextureCount(m_Device.get()),
+		  DrawsVirtualTexture(m_Device.get()),
+		  DrawsAtlasTextures(m_Device.get())) },
+	  m_TextureCache{ std::make_unique<TextureCache>(
+		  m_Device.get(), m_CommandBuffers.get(), *m_ThreadPool, GetTextureCacheOptions()) },
+	  m_MipStreamer{ StreamsTextures(m_Device.get()) ? std::make_unique<MipStreamer>(m_Device.get(),
+														   m_CommandBuffers.get(),
+														   *m_ThreadPool,
+														   config.MAX_FRAMES_IN_FLIGHT,
+														   GetMipStreamerOptions())
+													 : nullptr },
+	  m_VirtualTexture{ CreateVirtualTexture() },
+	  m_Textures{ CreateTextures() },
 	  m_UniformBuffers{ std::make_unique<UniformBuffer>(config.MAX_FRAMES_IN_FLIGHT,
 		  m_Device.get(),
 		  m_GraphicsPipeline.get(),
-		  m_Texture.get()) },
+		  m_GraphicsPipeline->IsBindless() ? std::vector<const Texture*>{} : GetTextures(),
+		  m_Model->GetVertexQuantization(),
+		  GetFeedbackBuffers()) },
 	  m_Camera{ std::make_unique<Camera>(static_cast<float>(width) / static_cast<float>(height)) }
 {
+	if (m_VirtualTexture)
+		m_UniformBuffers->WriteVirtualTexture(*m_VirtualTexture);
+	// a bindless pipeline starts with an empty texture array, the textures of
+	// the model are registered into it like the ones loaded later would be;
+	// in order, so that the slot of a texture is its index in the sampling
+	// feedback and in `m_MaterialTextures`
+	if (m_GraphicsPipeline->IsBindless())
+	{
+		const std::vector<const Texture*> textures = GetTextures();
+		for (uint32_t textureIdx = 0; textureIdx < textures.size(); ++textureIdx)
+		{
+			if (m_UniformBuffers->RegisterTexture(textures[textureIdx]) != textureIdx)
+				throw std::runtime_error("The texture array already had textures registered!");
+		}
+	}
+
+	PrintUploadStats("vertex", m_VertexBuffer->GetUploadStats());
+	PrintUploadStats("index", m_IndexBuffer->GetUploadStats());
+
+	// the vertex and index buffers are uploaded synchronously, so the cpu
+	// copy of the geometry is not needed anymore
+	const size_t residentBytes = memory::GetCurrentResidentBytes();
+	m_Model->OnUploaded();
+	const size_t releasedBytes = residentBytes - std::min(residentBytes, memory::GetCurrentResidentBytes());
+	std::cout << "Released model geometry: " << releasedBytes / 1024 << " KB resident (peak resident "
+			  << memory::GetPeakResidentBytes() / (1024 * 1024) << " MB)\n";
+
+	const DeviceAllocatorStats memoryStats = m_Device->GetAllocator().GetStats();
+	std::cout << "Device memory: " << memoryStats.allocationCount << " resources in " << memoryStats.blockCount
+			  << " blocks (" << memoryStats.usedBytes / (1024 * 1024) << " of "
+			  << memoryStats.blockBytes / (1024 * 1024) << " MB used), " << memoryStats.dedicatedCount
+			  << " dedicated (" << memoryStats.dedicatedBytes / (1024 * 1024) << " MB)\n";
+
+	BuildDrawItems();
+
 	RegisterEvents();
 	InitVulkan();
 }
@@ -65,7 +191,17 @@ void Application::Run()
 		m_DeltaTime = currentFrameTime - m_LastFrameTime;
 		m_LastFrameTime = currentFrameTime;
 
-		printf("\r%8d fps", static_cast<uint32_t>(1 / m_DeltaTime));
+		printf("\r%8d fps | lod %u, %8llu triangles | %6u of %6u meshlets drawn (%6u frustum culled, %6u "
+			   "backface culled) in %5u draws, %4u descriptor set binds",
+			static_cast<uint32_t>(1 / m_DeltaTime),
+			m_CurrentLod,
+			static_cast<unsigned long long>(m_TrianglesDrawn),
+			m_MeshletCullStats.totalMeshlets - m_MeshletCullStats.frustumCulled - m_MeshletCullStats.backfaceCulled,
+			m_MeshletCullStats.totalMeshlets,
+			m_MeshletCullStats.frustumCulled,
+			m_MeshletCullStats.backfaceCulled,
+			m_MeshletCullStats.drawCalls,
+			m_BindStats.descriptorSetBinds);
 
 		m_Camera->OnUpdate(
 			m_Window->GetWindowContext(), m_DeltaTime, m_Swapchain->GetWidth(), m_Swapchain->GetHeight());
@@ -101,6 +237,264 @@ void Application::Cleanup()
 	}
 }
 
+// creates the vertex and index buffers too: a streamed model writes into
+// them as it loads, any other model is uploaded once loaded
+std::unique_ptr<Model> Application::LoadModel()
+{
+	ModelLoadOptions options{};
+	options.requireCookedMesh = g_RequireCookedAssets;
+	options.streamObj = g_StreamSourceModel;
+	options.streamTarget.reserve = [this](size_t vertexBytes, size_t indexBytes, uint32_t indexSize) {
+		m_VertexBuffer = std::make_unique<VertexBuffer>(m_Device.get(), m_CommandBuffers.get(), vertexBytes);
+		m_IndexBuffer = std::make_unique<IndexBuffer>(m_Device.get(),
+			m_CommandBuffers.get(),
+			indexBytes,
+			indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+	};
+	options.streamTarget.writeVertices = [this](size_t offset, const EncodedStream& data) {
+		m_VertexBuffer->Write(offset, data, *m_ThreadPool);
+	};
+	options.streamTarget.writeIndices = [this](size_t offset, const EncodedStream& data) {
+		m_IndexBuffer->Write(offset, data, *m_ThreadPool);
+	};
+
+	auto model = std::make_unique<Model>("assets/models/viking_room.obj", options);
+	if (model->IsGeometryResident())
+	{
+		m_VertexBuffer = std::make_unique<VertexBuffer>(
+			m_Device.get(), m_CommandBuffers.get(), model->GetVertexData(), *m_ThreadPool);
+		m_IndexBuffer = std::make_unique<IndexBuffer>(m_Device.get(),
+			m_CommandBuffers.get(),
+			model->GetIndexData(),
+			*m_ThreadPool,
+			model->GetIndexType());
+	}
+
+	return model;
+}
+
+// no tile is resident yet, they are read as the first frames sample them
+std::unique_ptr<VirtualTexture> Application::CreateVirtualTexture()
+{
+	if (!DrawsVirtualTexture(m_Device.get()))
+		return nullptr;
+
+	VirtualTextureOptions options{};
+	options.requireCooked = g_RequireCookedAssets;
+	options.cache = m_AssetCache.get();
+	auto texture = std::make_unique<VirtualTexture>(
+		m_Device.get(), *m_ThreadPool, static_cast<uint32_t>(m_Config->MAX_FRAMES_IN_FLIGHT), options);
+	texture->Load(g_VirtualTexturePath);
+
+	const VirtualTextureLayout& layout = texture->GetLayout();
+	std::cout << "Virtual texture: " << layout.width << "x" << layout.height << ", " << layout.pageCount
+			  << " pages of " << layout.tileSize << " texels in " << layout.levelCount << " levels, "
+			  << options.cacheSize * options.cacheSize << " cache slots\n";
+	return texture;
+}
+
+// loads every distinct texture of the materials once and fills
+// m_MaterialTextures, which is declared before m_Textures
+std::vector<TextureHandle> Application::CreateTextures()
+{
+	std::vector<std::string> paths;
+	std::unordered_map<std::string, uint32_t> textureIndices;
+
+	m_MaterialTextures.clear();
+	// every material samples the virtual texture
+	if (m_VirtualTexture)
+	{
+		m_MaterialTextures.assign(m_Model->GetMaterials().size(), 0);
+		return {};
+	}
+
+	for (const MeshMaterial& material : m_Model->GetMaterials())
+	{
+		const std::string path = material.diffuseTexture[0] != '\0' ? material.diffuseTexture : g_DefaultTexturePath;
+
+		const auto [it, inserted] = textureIndices.try_emplace(path, static_cast<uint32_t>(paths.size()));
+		if (inserted)
+			paths.push_back(path);
+
+		m_MaterialTextures.push_back(it->second);
+	}
+
+	// the mip tails are uploaded at once, the finer levels once they are
+	// sampled
+	if (m_MipStreamer)
+	{
+		m_MipStreamer->Load(paths);
+
+		const MipStreamerStats stats = m_MipStreamer->GetStats();
+		std::cout << "Streaming " << stats.residency.textureCount << " textures: "
+				  << stats.residency.residentBytes / 1024 << " KB of mip tails resident of "
+				  << stats.residency.fullBytes / (1024 * 1024) << " MB, budget "
+				  << GetMipStreamerOptions().budget / (1024 * 1024) << " MB\n";
+		return {};
+	}
+
+	// the small textures are packed into the pages of an atlas, only the
+	// others are loaded on their own
+	if (m_GraphicsPipeline->HasAtlasTextures())
+		paths = PackAtlasTextures(paths);
+
+	// every texture that is not resident yet is read and uploaded at once, in
+	// batches
+	std::vector<TextureHandle> textures = m_TextureCache->Acquire(paths);
+
+	const TextureLoadStats& stats = m_TextureCache->GetLoadStats();
+	const TextureCacheStats& cacheStats = m_TextureCache->GetStats();
+	std::cout << "Loaded " << stats.textureCount << " textures in " << stats.milliseconds << " ms: "
+			  << stats.stagedBytes / 1024 << " KB staged in " << stats.batchCount << " batches, waited "
+			  << stats.prepareWaitMilliseconds << " ms for reads and " << stats.uploadWaitMilliseconds
+			  << " ms for uploads\n";
+	std::cout << "Texture cache: " << cacheStats.residentCount << " resident, "
+			  << cacheStats.residentBytes / (1024 * 1024) << " of " << m_TextureCache->GetBudget() / (1024 * 1024)
+			  << " MB, " << cacheStats.hits << " hits, " << cacheStats.misses << " misses, " << cacheStats.evictions
+			  << " evictions\n";
+	return textures;
+}
+
+// fills m_AtlasPages and m_AtlasConstants, and returns the paths of the
+// textures too large to be packed, which keep an image of their own and the
+// first slots of the texture array; the pages take the ones after them
+// m_MaterialTextures is renumbered into m_AtlasConstants, sorted by page, so
+// that sorting the draws by texture groups the ones that sample a page
+std::vector<std::string> Application::PackAtlasTextures(const std::vector<std::string>& paths)
+{
+	TextureLoader loader{ m_Device.get(), m_CommandBuffers.get(), *m_ThreadPool, GetTextureCacheOptions().loadOptions };
+	AtlasTextures atlas = loader.LoadAtlas(paths);
+	m_AtlasPages = std::move(atlas.pages);
+
+	std::vector<std::string> unpackedPaths;
+	for (uint32_t i = 0; i < paths.size(); ++i)
+	{
+		if (atlas.layout.rects[i].page == NO_ATLAS_PAGE)
+			unpackedPaths.push_back(paths[i]);
+	}
+
+	// a texture with an image of its own is sampled whole
+	std::vector<AtlasConstants> constants;
+	uint32_t unpackedCount = 0;
+	for (uint32_t i = 0; i < paths.size(); ++i)
+	{
+		if (atlas.layout.rects[i].page == NO_ATLAS_PAGE)
+		{
+			constants.push_back(AtlasConstants{ unpackedCount++, 0, { 1.0f, 1.0f }, { 0.0f, 0.0f } });
+			continue;
+		}
+
+		const AtlasTransform transform = texture::GetAtlasTransform(atlas.layout, i);
+		constants.push_back(AtlasConstants{ static_cast<uint32_t>(unpackedPaths.size()) + transform.page,
+			0,
+			{ transform.scale[0], transform.scale[1] },
+			{ transform.offset[0], transform.offset[1] } });
+	}
+
+	std::vector<uint32_t> order(constants.size());
+	for (uint32_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&constants](uint32_t a, uint32_t b) {
+		return constants[a].textureIndex < constants[b].textureIndex;
+	});
+
+	std::vector<uint32_t> remap(order.size());
+	m_AtlasConstants.clear();
+	for (uint32_t i = 0; i < order.size(); ++i)
+	{
+		remap[order[i]] = i;
+		m_AtlasConstants.push_back(constants[order[i]]);
+	}
+	for (uint32_t& texture : m_MaterialTextures)
+		texture = remap[texture];
+
+	const TextureLoadStats& stats = loader.GetStats();
+	std::cout << "Atlas: " << paths.size() - unpackedPaths.size() << " of " << paths.size() << " textures packed into "
+			  << atlas.layout.pageCount << " pages of " << atlas.layout.pageSize << "x" << atlas.layout.pageSize
+			  << " in " << stats.milliseconds << " ms, " << stats.stagedBytes / 1024 << " KB staged\n";
+	return unpackedPaths;
+}
+
+std::vector<const Texture*> Application::GetTextures() const
+{
+	if (m_MipStreamer)
+		return m_MipStreamer->GetTextures();
+
+	std::vector<const Texture*> textures;
+	textures.reserve(m_Textures.size());
+	for (const TextureHandle& texture : m_Textures)
+		textures.push_back(texture.Get());
+	// after them, see `PackAtlasTextures`
+	for (const std::unique_ptr<Texture>& page : m_AtlasPages)
+		textures.push_back(page.get());
+
+	return textures;
+}
+
+std::vector<VkBuffer> Application::GetFeedbackBuffers() const
+{
+	std::vector<VkBuffer> buffers;
+	if (m_MipStreamer)
+	{
+		for (int i = 0; i < m_Config->MAX_FRAMES_IN_FLIGHT; ++i)
+			buffers.push_back(m_MipStreamer->GetFeedbackBuffer(static_cast<uint32_t>(i)));
+	}
+	if (m_VirtualTexture)
+	{
+		for (int i = 0; i < m_Config->MAX_FRAMES_IN_FLIGHT; ++i)
+			buffers.push_back(m_VirtualTexture->GetFeedbackBuffer(static_cast<uint32_t>(i)));
+	}
+
+	return buffers;
+}
+
+// the submeshes never change, so their draws are sorted once; only the lods
+// and meshlets drawn for each of them change per frame
+void Application::BuildDrawItems()
+{
+	const Span<const Submesh> submeshes = m_Model->GetSubmeshes();
+
+	m_DrawItems.clear();
+	m_DrawItems.reserve(submeshes.size());
+	for (size_t i = 0; i < submeshes.size(); ++i)
+	{
+		// a single pipeline and vertex buffer for now; the bindless pipeline
+		// has a single descriptor set per frame, and takes the texture as a
+		// push constant (the index of its `AtlasConstants` with an atlas)
+		const uint32_t texture = m_MaterialTextures[submeshes[i].material];
+		const DrawState state = m_GraphicsPipeline->IsBindless() ? DrawState{ 0, 0, 0, texture }
+																 : DrawState{ 0, texture, 0, 0 };
+		m_DrawItems.push_back(DrawItem{ state, static_cast<uint32_t>(i) });
+	}
+
+	const DrawBindStats unsorted = draw::CountBinds(m_DrawItems);
+	draw::SortDrawItems(m_DrawItems);
+	m_BindStats = draw::CountBinds(m_DrawItems);
+
+	std::cout << "Draws: " << m_BindStats.draws << " submeshes, " << GetTextures().size() << " textures, "
+			  << m_BindStats.descriptorSetBinds << " descriptor set binds per frame (" << unsorted.descriptorSetBinds
+			  << " unsorted)";
+	if (m_GraphicsPipeline->IsBindless())
+	{
+		std::cout << ", bindless: " << m_BindStats.materialPushes << " texture index pushes of "
+				  << m_GraphicsPipeline->GetBindlessTextureCount() << " slots";
+	}
+	// the draws of the textures of a page follow each other, and only push
+	// the rect of theirs
+	if (m_GraphicsPipeline->HasAtlasTextures())
+	{
+		uint32_t imageChanges = 0;
+		for (size_t i = 0; i < m_DrawItems.size(); ++i)
+		{
+			const uint32_t image = m_AtlasConstants[m_DrawItems[i].state.material].textureIndex;
+			if (i == 0 || image != m_AtlasConstants[m_DrawItems[i - 1].state.material].textureIndex)
+				++imageChanges;
+		}
+		std::cout << ", " << imageChanges << " of them to another image (" << m_AtlasPages.size() << " atlas pages)";
+	}
+	std::cout << "\n";
+}
+
 // TODO: move this to renderer class
 void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
@@ -112,6 +506,17 @@ void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
 		throw std::runtime_error("Failed to begin recording command buffer!");
 
+	// the levels that changed are copied before the render pass, and the
+	// descriptor sets of this frame sample the new images
+	if (m_MipStreamer)
+	{
+		m_MipStreamer->Update(m_CurrentFrameIdx, commandBuffer);
+		m_UniformBuffers->UpdateTextures(m_CurrentFrameIdx, m_MipStreamer->GetTextures());
+	}
+	// the tiles and the page table too, the set never changes
+	if (m_VirtualTexture)
+		m_VirtualTexture->Update(m_CurrentFrameIdx, commandBuffer);
+
 	VkRenderPassBeginInfo renderPassBeginInfo{};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassBeginInfo.renderPass = m_Swapchain->GetRenderPass();
@@ -132,7 +537,8 @@ void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	// second command buffers start render pass
 	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline->GetPipeline());
+	// the viewport and scissor are dynamic states, which a pipeline bind does
+	// not reset
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -153,35 +559,199 @@ void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	// TODO: maybe create something similar to a vertex array where you can
 	// define the vertex buffers and index buffers and bind them when needed
 
-	// bind the vertex buffer
-	VkBuffer vertexBuffers[] = { m_VertexBuffer->GetVertexBuffer() };
-	VkDeviceSize offsets[] = { 0 };
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-	// descriptor sets are not unique to graphics or compute pipeline so we need
-	// to specify it
-	vkCmdBindDescriptorSets(commandBuffer,
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_GraphicsPipeline->GetLayout(),
-		0,
-		1,
-		&m_UniformBuffers->GetDescriptorSetAtIndex(m_CurrentFrameIdx),
-		0,
-		nullptr);
-
 	// vkCmdDraw(commandBuffer, static_cast<uint32_t>(vertices.size()), 1, 0,
 	// 0);
 	//  the draw command changes if index buffers are used
-	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_Model->GetIndices().size()), 1, 0, 0, 0);
+	// every submesh is drawn with its own vertex offset and picks its own
+	// level of detail; the index buffer holds every level one after the
+	// other, and the meshlets only cover the full detail level
+	// the draws are sorted by state, so every pipeline, descriptor set and
+	// vertex buffer is bound once per group of draws that use it
+	const float lodDistance = GetLodDistance();
+	const MeshletCullParams cullParams = GetMeshletCullParams();
+
+	m_CurrentLod = 0;
+	m_TrianglesDrawn = 0;
+	m_MeshletCullStats = MeshletCullStats{};
+	for (size_t i = 0; i < m_DrawItems.size(); ++i)
+	{
+		const DrawState& state = m_DrawItems[i].state;
+		const DrawState* previous = i > 0 ? &m_DrawItems[i - 1].state : nullptr;
+
+		// a different pipeline may have a different layout, which disturbs
+		// the bound descriptor sets
+		const bool pipelineChanged = !previous || state.pipeline != previous->pipeline;
+		if (pipelineChanged)
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline->GetPipeline());
+
+		// every draw pushes its own uniform block and binds the frame set at
+		// its offset in the uniform ring; the submeshes of the model share its
+		// model matrix for now
+		// descriptor sets are not unique to graphics or compute pipeline so
+		// we need to specify it
+		const VkDescriptorSet frameSet = m_UniformBuffers->GetFrameSet(m_CurrentFrameIdx);
+		const uint32_t uniformOffset = m_UniformBuffers->PushDraw(m_UniformBuffers->GetModelMatrix());
+		vkCmdBindDescriptorSets(commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_GraphicsPipeline->GetLayout(),
+			FRAME_DESCRIPTOR_SET,
+			1,
+			&frameSet,
+			1,
+			&uniformOffset);
+
+		if (pipelineChanged || state.descriptorSet != previous->descriptorSet)
+		{
+			const VkDescriptorSet textureSet = m_UniformBuffers->GetTextureSet(m_CurrentFrameIdx, state.descriptorSet);
+			vkCmdBindDescriptorSets(commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				m_GraphicsPipeline->GetLayout(),
+				TEXTURE_DESCRIPTOR_SET,
+				1,
+				&textureSet,
+				0,
+				nullptr);
+		}
+
+		// the texture array of a bindless pipeline is indexed by the
+		// material, and the feedback of the texture goes to its own slot,
+		// relative to the levels resident in its image
+		const bool textureChanged = m_GraphicsPipeline->IsBindless()
+										? pipelineChanged || state.material != previous->material
+										: pipelineChanged || state.descriptorSet != previous->descriptorSet;
+		// a virtual texture only pushes its size and tiles, once per pipeline
+		if (m_VirtualTexture)
+		{
+			if (pipelineChanged)
+			{
+				const VirtualTextureConstants constants = m_VirtualTexture->GetConstants();
+				vkCmdPushConstants(commandBuffer,
+					m_GraphicsPipeline->GetLayout(),
+					VK_SHADER_STAGE_FRAGMENT_BIT,
+					0,
+					sizeof(constants),
+					&constants);
+			}
+		}
+		// the page of the texture and its rect in it
+		else if (m_GraphicsPipeline->HasAtlasTextures())
+		{
+			if (textureChanged)
+			{
+				const AtlasConstants& constants = m_AtlasConstants[state.material];
+				vkCmdPushConstants(commandBuffer,
+					m_GraphicsPipeline->GetLayout(),
+					VK_SHADER_STAGE_FRAGMENT_BIT,
+					0,
+					sizeof(constants),
+					&constants);
+			}
+		}
+		else if (m_GraphicsPipeline->HasPushConstants() && textureChanged)
+		{
+			const uint32_t textureIdx = m_GraphicsPipeline->IsBindless() ? state.material : state.descriptorSet;
+			const SamplingFeedbackConstants constants{ textureIdx,
+				m_MipStreamer ? m_MipStreamer->GetTextures()[textureIdx]->GetFirstLevel() : 0 };
+			vkCmdPushConstants(commandBuffer,
+				m_GraphicsPipeline->GetLayout(),
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				0,
+				sizeof(constants),
+				&constants);
+		}
+
+		if (!previous || state.vertexBuffer != previous->vertexBuffer)
+		{
+			// bind the vertex buffer
+			VkBuffer vertexBuffers[] = { m_VertexBuffer->GetVertexBuffer() };
+			VkDeviceSize offsets[] = { 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->GetIndexBuffer(), 0, m_IndexBuffer->GetIndexType());
+		}
+
+		const Submesh& submesh = m_Model->GetSubmeshes()[m_DrawItems[i].item];
+		const int32_t vertexOffset = static_cast<int32_t>(submesh.firstVertex);
+
+		const uint32_t lodIndex = mesh::SelectLod(m_Model->GetLods().data() + submesh.firstLod,
+			submesh.lodCount,
+			lodDistance,
+			m_Camera->GetFOVy(),
+			static_cast<float>(m_Swapchain->GetHeight()),
+			g_MaxLodPixelError);
+		m_CurrentLod = std::max(m_CurrentLod, lodIndex);
+
+		if (lodIndex == 0 && submesh.meshletCount > 0)
+		{
+			CullMeshlets(submesh, cullParams);
+			for (const MeshletDraw& draw : m_MeshletDraws)
+				vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, vertexOffset, 0);
+		}
+		else
+		{
+			const MeshLod& lod = m_Model->GetLods()[submesh.firstLod + lodIndex];
+			vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, vertexOffset, 0);
+			m_TrianglesDrawn += lod.indexCount / 3;
+		}
+	}
 
 	// end render pass
 	vkCmdEndRenderPass(commandBuffer);
 
+	if (m_MipStreamer)
+		m_MipStreamer->EndFrame(m_CurrentFrameIdx, commandBuffer);
+	if (m_VirtualTexture)
+		m_VirtualTexture->EndFrame(m_CurrentFrameIdx, commandBuffer);
+
 	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
 		throw std::runtime_error("Failed to record command buffer!");
 }
 
+// the same matrices are written to the uniform buffer for this frame
+MeshletCullParams Application::GetMeshletCullParams() const
+{
+	const glm::mat4 modelView = m_Camera->GetViewMatrix() * m_UniformBuffers->GetModelMatrix();
+
+	MeshletCullParams params = mesh::GetMeshletCullParams(m_Camera->GetProjectionMatrix() * modelView, modelView);
+	params.backfaceCulling = (m_GraphicsPipeline->GetCullMode() & VK_CULL_MODE_BACK_BIT) != 0;
+	return params;
+}
+
+// culled on the cpu so that it works on any device
+// fills m_MeshletDraws with the visible meshlets of the submesh and adds
+// them to the stats of the frame
+void Application::CullMeshlets(const Submesh& submesh, const MeshletCullParams& params)
+{
+	m_MeshletDraws.clear();
+	const MeshletCullStats stats = mesh::CullMeshlets(
+		m_Model->GetMeshlets().data() + submesh.firstMeshlet, submesh.meshletCount, params, m_MeshletDraws);
+
+	m_MeshletCullStats.totalMeshlets += stats.totalMeshlets;
+	m_MeshletCullStats.frustumCulled += stats.frustumCulled;
+	m_MeshletCullStats.backfaceCulled += stats.backfaceCulled;
+	m_MeshletCullStats.drawCalls += stats.drawCalls;
+	m_MeshletCullStats.triangles += stats.triangles;
+	m_TrianglesDrawn += stats.triangles;
+}
+
+// distance from the camera to the bounding sphere of the model, which the
+// lods are selected by so that the error stays under a pixel on screen
+// the model matrix only rotates and translates, so the distance is measured
+// in model space, the same space as the error of the levels
+float Application::GetLodDistance() const
+{
+	const glm::vec3 boundsMin = m_Model->GetBoundsMin();
+	const glm::vec3 boundsMax = m_Model->GetBoundsMax();
+	const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	const float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+	const glm::vec3 cameraPosition =
+		glm::vec3{ glm::inverse(m_UniformBuffers->GetModelMatrix()) * glm::vec4{ m_Camera->GetPosition(), 1.0f } };
+
+	// the closest point of the bounding sphere; inside the sphere every
+	// level but the full detail one would be too coarse anyway
+	return glm::max(glm::length(cameraPosition - center) - radius, 1e-3f);
+}
+
 // TODO: make a SyncObjects class
 void Application::CreateSyncObjects()
 {
@@ -248,12 +818,14 @@ void Application::DrawFrame()
 	// avoid a deadlock reset the fence to unsignaled state
 	vkResetFences(m_Device->GetDevice(), 1, &m_InFlightFences[m_CurrentFrameIdx]);
 
+	// the frame starts over in the uniform ring first, the draws push their
+	// blocks while they are recorded
+	m_UniformBuffers->Update(m_CurrentFrameIdx, m_Camera.get());
+
 	// record the command buffer
 	m_CommandBuffers->ResetCommandBuffer(m_CurrentFrameIdx);
 	RecordCommandBuffer(m_CommandBuffers->GetCommandBufferAtIndex(m_CurrentFrameIdx), nextImageIndex);
 
-	m_UniformBuffers->Update(m_CurrentFrameIdx, m_Camera.get());
-
 	// TODO: abstract queue submit (prolly in Device or Queue class)
 	// submit the command buffer
 	VkSubmitInfo submitInfo{};
@@ -3,6 +3,7 @@
 #include <vector>
 #include <array>
 #include <optional>
+#include <string>
 #include <chrono>
 #include <memory>
 
@@ -14,6 +15,7 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "core/window.h"
+#include "core/assetCache.h"
 #include "core/vulkanConfig.h"
 
 #include "renderer/vulkanContext.h"
@@ -22,6 +24,10 @@
 #include "renderer/swapchain.h"
 #include "renderer/pipeline.h"
 #include "renderer/texture.h"
+#include "renderer/texture/mipStreamer.h"
+#include "renderer/texture/textureAtlas.h"
+#include "renderer/texture/textureCache.h"
+#include "renderer/texture/virtualTexture.h"
 
 #include "renderer/model.h"
 
@@ -31,6 +37,7 @@
 #include "renderer/buffer/uniformBuffer.h"
 
 #include "renderer/camera.h"
+#include "renderer/drawSort.h"
 
 
 class Application
@@ -49,7 +56,18 @@ private:
 	void RegisterEvents();
 	void Cleanup();
 
+	std::unique_ptr<Model> LoadModel();
+	std::unique_ptr<VirtualTexture> CreateVirtualTexture();
+	std::vector<TextureHandle> CreateTextures();
+	std::vector<std::string> PackAtlasTextures(const std::vector<std::string>& paths);
+	std::vector<const Texture*> GetTextures() const;
+	std::vector<VkBuffer> GetFeedbackBuffers() const;
+	void BuildDrawItems();
+
 	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	MeshletCullParams GetMeshletCullParams() const;
+	void CullMeshlets(const Submesh& submesh, const MeshletCullParams& params);
+	float GetLodDistance() const;
 
 	void CreateSyncObjects();
 	void DrawFrame();
@@ -68,19 +86,54 @@ private:
 
 	std::unique_ptr<Device> m_Device;
 	std::unique_ptr<Swapchain> m_Swapchain;
-	std::unique_ptr<Pipeline> m_GraphicsPipeline;
-
-	std::unique_ptr<Model> m_Model;
-
+	// decodes the cooked assets while uploading them
+	std::unique_ptr<ThreadPool> m_ThreadPool;
+	// keeps the pipeline cache of the driver between runs
+	std::unique_ptr<AssetCache> m_AssetCache;
+	// before the model, a streamed model is written into its buffers while
+	// it loads
 	std::unique_ptr<CommandBuffer> m_CommandBuffers;
 	std::unique_ptr<VertexBuffer> m_VertexBuffer;
 	std::unique_ptr<IndexBuffer> m_IndexBuffer;
+	// before the pipeline, which follows the vertex layout of the model
+	std::unique_ptr<Model> m_Model;
+	std::unique_ptr<Pipeline> m_GraphicsPipeline;
 
-	std::unique_ptr<Texture> m_Texture;
+	// outlives the handles of m_Textures
+	std::unique_ptr<TextureCache> m_TextureCache;
+	// holds the textures instead of the cache when they are streamed, on
+	// devices that support the sampling feedback
+	std::unique_ptr<MipStreamer> m_MipStreamer;
+	// sampled by every material instead of their textures, see
+	// `g_VirtualTexture`
+	std::unique_ptr<VirtualTexture> m_VirtualTexture;
+	// texture of every material of the model, an index into m_Textures and
+	// the descriptor sets of a frame, or into m_AtlasConstants with an atlas;
+	// filled by `CreateTextures`
+	std::vector<uint32_t> m_MaterialTextures;
+	// the small textures of the materials, packed into pages that follow
+	// m_Textures in the texture array, see `g_AtlasTextures`
+	std::vector<std::unique_ptr<Texture>> m_AtlasPages;
+	// of every texture with an atlas, the slot of its page (or its own
+	// image) and its rect in it, sorted by slot
+	std::vector<AtlasConstants> m_AtlasConstants;
+	// one per distinct texture of the materials, empty when they are streamed
+	std::vector<TextureHandle> m_Textures;
 	std::unique_ptr<UniformBuffer> m_UniformBuffers;
 
 	std::unique_ptr<Camera> m_Camera;
 
+	// a draw per submesh, sorted by the state they bind
+	std::vector<DrawItem> m_DrawItems;
+	DrawBindStats m_BindStats{};
+
+	// meshlets of the submesh being drawn that passed culling
+	std::vector<MeshletDraw> m_MeshletDraws;
+	MeshletCullStats m_MeshletCullStats{};
+	// coarsest level of detail drawn in the current frame
+	uint32_t m_CurrentLod = 0;
+	uint64_t m_TrianglesDrawn = 0;
+
 	// synchronization objects
 	// semaphores to sync gpu operations and fence to sync cpu operation with
 	// the gpu operation
@@ -0,0 +1,251 @@
+#include "assetCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "core/hash.h"
+
+
+// entries are named after their key, 16 hex digits
+constexpr size_t g_EntryNameLength = 16;
+
+static int64_t GetFileTimeNow()
+{
+	return static_cast<int64_t>(std::filesystem::file_time_type::clock::now().time_since_epoch().count());
+}
+
+AssetCache::AssetCache(const std::string& directory, uint64_t maxSize)
+	: m_Directory{ directory },
+	  m_MaxSize{ maxSize },
+	  m_Size{ 0 },
+	  m_TempCounter{ 0 }
+{
+	std::error_code errorCode;
+	std::filesystem::create_directories(m_Directory, errorCode);
+	ScanEntries();
+}
+
+uint64_t AssetCache::MakeKey(const char* processor, uint32_t version, uint64_t sourceHash, uint64_t parametersHash)
+{
+	uint64_t key = hash::HashBytes(processor, std::char_traits<char>::length(processor));
+	key = hash::Combine(key, version);
+	key = hash::Combine(key, sourceHash);
+	return hash::Combine(key, parametersHash);
+}
+
+std::string AssetCache::GetEntryPath(uint64_t key) const
+{
+	char name[g_EntryNameLength + 1];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return (std::filesystem::path{ m_Directory } / name).string();
+}
+
+std::string AssetCache::GetTempPath(uint64_t key)
+{
+	// unique across the threads and the processes sharing the cache
+	uint64_t counter;
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		counter = m_TempCounter++;
+	}
+	const uint64_t now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+	return GetEntryPath(key) + "." + std::to_string(hash::Combine(now, counter)) + ".tmp";
+}
+
+void AssetCache::ScanEntries()
+{
+	std::error_code errorCode;
+	for (const auto& entry : std::filesystem::directory_iterator{ m_Directory, errorCode })
+	{
+		// temporary files of writes in progress (or of a crash) are skipped
+		const std::string name = entry.path().filename().string();
+		if (name.size() != g_EntryNameLength || !entry.is_regular_file(errorCode))
+			continue;
+
+		char* nameEnd = nullptr;
+		const uint64_t key = std::strtoull(name.c_str(), &nameEnd, 16);
+		if (nameEnd != name.c_str() + name.size())
+			continue;
+
+		Entry cacheEntry{};
+		cacheEntry.size = entry.file_size(errorCode);
+		cacheEntry.lastUse = static_cast<int64_t>(entry.last_write_time(errorCode).time_since_epoch().count());
+		if (errorCode)
+			continue;
+
+		m_Entries[key] = cacheEntry;
+		m_Size += cacheEntry.size;
+	}
+}
+
+bool AssetCache::Touch(uint64_t key)
+{
+	std::error_code errorCode;
+	std::filesystem::last_write_time(GetEntryPath(key), std::filesystem::file_time_type::clock::now(), errorCode);
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	const auto it = m_Entries.find(key);
+	if (errorCode)
+	{
+		if (it != m_Entries.end())
+		{
+			m_Size -= it->second.size;
+			m_Entries.erase(it);
+		}
+		return false;
+	}
+
+	// written by another process since the directory was scanned
+	if (it == m_Entries.end())
+	{
+		const uint64_t size = std::filesystem::file_size(GetEntryPath(key), errorCode);
+		m_Entries[key] = Entry{ errorCode ? 0 : size, GetFileTimeNow() };
+		m_Size += errorCode ? 0 : size;
+		return true;
+	}
+
+	it->second.lastUse = GetFileTimeNow();
+	return true;
+}
+
+bool AssetCache::Extract(uint64_t key, const std::string& path)
+{
+	const std::string entryPath = GetEntryPath(key);
+	const std::string tempPath = path + ".tmp";
+
+	std::error_code errorCode;
+	if (!std::filesystem::copy_file(
+			entryPath, tempPath, std::filesystem::copy_options::overwrite_existing, errorCode))
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		// forgets the entry if it was evicted
+		Touch(key);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, path, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return Touch(key);
+}
+
+bool AssetCache::Load(uint64_t key, std::vector<uint8_t>& data)
+{
+	std::ifstream file{ GetEntryPath(key), std::ios::binary | std::ios::ate };
+	if (!file.is_open())
+	{
+		Touch(key);
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+	{
+		data.clear();
+		return false;
+	}
+
+	return Touch(key);
+}
+
+bool AssetCache::StoreFile(uint64_t key, const std::string& path)
+{
+	const std::string tempPath = GetTempPath(key);
+
+	std::error_code errorCode;
+	if (!std::filesystem::copy_file(path, tempPath, std::filesystem::copy_options::overwrite_existing, errorCode))
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	const uint64_t size = std::filesystem::file_size(tempPath, errorCode);
+	return !errorCode && Commit(key, tempPath, size);
+}
+
+bool AssetCache::Store(uint64_t key, Span<const uint8_t> data)
+{
+	const std::string tempPath = GetTempPath(key);
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		if (!file.good())
+		{
+			file.close();
+			std::error_code errorCode;
+			std::filesystem::remove(tempPath, errorCode);
+			return false;
+		}
+	}
+
+	return Commit(key, tempPath, data.size());
+}
+
+bool AssetCache::Commit(uint64_t key, const std::string& tempPath, uint64_t size)
+{
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, GetEntryPath(key), errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	Entry& entry = m_Entries[key];
+	m_Size = m_Size - entry.size + size;
+	entry = Entry{ size, GetFileTimeNow() };
+
+	Evict(key);
+	return true;
+}
+
+void AssetCache::Evict(uint64_t keep)
+{
+	if (m_Size <= m_MaxSize)
+		return;
+
+	std::vector<std::pair<int64_t, uint64_t>> byLastUse;
+	byLastUse.reserve(m_Entries.size());
+	for (const auto& [key, entry] : m_Entries)
+	{
+		if (key != keep)
+			byLastUse.emplace_back(entry.lastUse, key);
+	}
+	std::sort(byLastUse.begin(), byLastUse.end());
+
+	// a process that still uses an evicted entry keeps its copy or mapping
+	for (const auto& [lastUse, key] : byLastUse)
+	{
+		if (m_Size <= m_MaxSize)
+			break;
+
+		std::error_code errorCode;
+		std::filesystem::remove(GetEntryPath(key), errorCode);
+		m_Size -= m_Entries[key].size;
+		m_Entries.erase(key);
+	}
+}
+
+uint64_t AssetCache::GetSize()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_Size;
+}
+
+size_t AssetCache::GetEntryCount()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_Entries.size();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/span.h"
+
+
+// cache entries are evicted, least recently used first, once they take more
+// than this
+constexpr uint64_t DEFAULT_ASSET_CACHE_SIZE = 1024ull * 1024 * 1024;
+
+// content addressed cache of derived asset data (cooked meshes and textures,
+// SPIR-V, pipeline cache blobs) shared by every run and tool
+// an entry is a file named after its key, the hash of everything that went
+// into it, so an entry never goes stale: changed inputs make a new key
+// writes go to a temporary file that is renamed, so that a crash or another
+// process never sees a half written entry; safe to use from several threads
+class AssetCache
+{
+public:
+	// the directory is created if it does not exist
+	AssetCache(const std::string& directory, uint64_t maxSize = DEFAULT_ASSET_CACHE_SIZE);
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	// `processor` names what derives the data (eg: "mesh"), `version` must be
+	// bumped whenever its output changes; `sourceHash` covers the bytes of the
+	// source files and `parametersHash` the options they are processed with
+	static uint64_t MakeKey(const char* processor, uint32_t version, uint64_t sourceHash, uint64_t parametersHash);
+
+	// copies the entry to `path` (atomically, like the cooked assets are
+	// written); returns false if there is no such entry
+	bool Extract(uint64_t key, const std::string& path);
+	// reads the entry into `data`; returns false if there is no such entry
+	bool Load(uint64_t key, std::vector<uint8_t>& data);
+
+	// store a copy of the file or the bytes under `key`, replacing the entry
+	// if there is one, and evict the least recently used entries over the
+	// size limit; a cache that cannot be written is not an error, so these
+	// only return false
+	bool StoreFile(uint64_t key, const std::string& path);
+	bool Store(uint64_t key, Span<const uint8_t> data);
+
+	inline const std::string& GetDirectory() const { return m_Directory; }
+	inline uint64_t GetMaxSize() const { return m_MaxSize; }
+	uint64_t GetSize();
+	size_t GetEntryCount();
+
+private:
+	struct Entry
+	{
+		uint64_t size;
+		// the last write time of the entry, which is touched on every hit so
+		// that the order carries over to the next run
+		int64_t lastUse;
+	};
+
+	std::string GetEntryPath(uint64_t key) const;
+	std::string GetTempPath(uint64_t key);
+	void ScanEntries();
+	// marks the entry as used, or forgets it if it was evicted by another
+	// process; returns false in the latter case
+	bool Touch(uint64_t key);
+	bool Commit(uint64_t key, const std::string& tempPath, uint64_t size);
+	void Evict(uint64_t keep);
+
+private:
+	std::string m_Directory;
+	uint64_t m_MaxSize;
+
+	std::mutex m_Mutex;
+	std::unordered_map<uint64_t, Entry> m_Entries;
+	uint64_t m_Size;
+	uint64_t m_TempCounter;
+};
@@ -0,0 +1,594 @@
+#include "codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CODEC_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define CODEC_SSE2 0
+#endif
+
+
+// shortest match worth a sequence, a token and an offset cost 3 bytes
+constexpr size_t g_MinMatch = 4;
+constexpr size_t g_MaxOffset = 65535;
+constexpr uint32_t g_HashBits = 14;
+// the byte planes of the elements are transposed 16 elements at a time
+constexpr uint32_t g_MaxSimdElementSize = 64;
+
+static void ThrowCorrupt()
+{
+	throw std::runtime_error("Encoded stream is corrupt");
+}
+
+static inline uint32_t Read32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Hash(uint32_t value)
+{
+	return (value * 2654435761u) >> (32 - g_HashBits);
+}
+
+static inline void Copy16(uint8_t* destination, const uint8_t* source)
+{
+#if CODEC_SSE2
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), bytes);
+#else
+	memcpy(destination, source, 16);
+#endif
+}
+
+// LZ block format, close to LZ4: a sequence of
+//     token (literal length in the high 4 bits, match length - 4 in the low 4)
+//     literal length - 15 in 255 steps, if the token holds 15
+//     literals
+//     offset (2 bytes, little endian)
+//     match length - 19 in 255 steps, if the token holds 15
+// the last sequence ends after its literals
+
+static uint8_t* WriteLength(uint8_t* out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*out++ = 255;
+	*out++ = static_cast<uint8_t>(length);
+	return out;
+}
+
+static uint8_t* WriteSequence(uint8_t* out,
+	const uint8_t* literals,
+	size_t literalLength,
+	size_t offset,
+	size_t matchLength)
+{
+	const size_t matchCode = matchLength >= g_MinMatch ? matchLength - g_MinMatch : 0;
+	*out++ = static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+	if (literalLength >= 15)
+		out = WriteLength(out, literalLength - 15);
+
+	memcpy(out, literals, literalLength);
+	out += literalLength;
+
+	if (matchLength == 0)
+		return out;
+
+	*out++ = static_cast<uint8_t>(offset & 0xff);
+	*out++ = static_cast<uint8_t>(offset >> 8);
+	if (matchCode >= 15)
+		out = WriteLength(out, matchCode - 15);
+	return out;
+}
+
+static size_t GetLzBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+// greedy matcher over a hash of the next 4 bytes; returns the compressed size
+// `out` must hold `GetLzBound(size)` bytes
+static size_t CompressLz(const uint8_t* in, size_t size, uint8_t* out)
+{
+	thread_local std::vector<uint32_t> table;
+	table.assign(size_t{ 1 } << g_HashBits, UINT32_MAX);
+
+	uint8_t* const outBegin = out;
+	size_t anchor = 0;
+	size_t position = 0;
+	while (position + g_MinMatch <= size)
+	{
+		const uint32_t value = Read32(in + position);
+		uint32_t& entry = table[Hash(value)];
+		const size_t reference = entry;
+		entry = static_cast<uint32_t>(position);
+
+		if (reference == UINT32_MAX || position - reference > g_MaxOffset || Read32(in + reference) != value)
+		{
+			// skip faster through data that does not compress
+			position += 1 + ((position - anchor) >> 6);
+			continue;
+		}
+
+		size_t length = g_MinMatch;
+		while (position + length < size && in[reference + length] == in[position + length])
+			++length;
+
+		out = WriteSequence(out, in + anchor, position - anchor, position - reference, length);
+		position += length;
+		anchor = position;
+
+		// so that the next match can start right after this one
+		if (position >= 2 && position + 2 <= size)
+			table[Hash(Read32(in + position - 2))] = static_cast<uint32_t>(position - 2);
+	}
+
+	out = WriteSequence(out, in + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - outBegin);
+}
+
+static size_t ReadLength(const uint8_t*& in, const uint8_t* inEnd)
+{
+	size_t length = 0;
+	uint8_t byte;
+	do
+	{
+		if (in >= inEnd)
+			ThrowCorrupt();
+		byte = *in++;
+		length += byte;
+	} while (byte == 255);
+
+	return length;
+}
+
+// every read and write is bounds checked, the copies go 16 bytes at a time
+// when they have room to
+static void DecompressLz(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize)
+{
+	const uint8_t* const inEnd = in + inSize;
+	uint8_t* const outBegin = out;
+	uint8_t* const outEnd = out + outSize;
+
+	while (in < inEnd)
+	{
+		const uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15)
+			literalLength += ReadLength(in, inEnd);
+		if (literalLength > static_cast<size_t>(inEnd - in) || literalLength > static_cast<size_t>(outEnd - out))
+			ThrowCorrupt();
+
+		const size_t inRoom = static_cast<size_t>(inEnd - in);
+		if (inRoom >= literalLength + 16 && static_cast<size_t>(outEnd - out) >= literalLength + 16)
+		{
+			for (size_t i = 0; i < literalLength; i += 16)
+				Copy16(out + i, in + i);
+		}
+		else
+		{
+			memcpy(out, in, literalLength);
+		}
+		in += literalLength;
+		out += literalLength;
+
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			ThrowCorrupt();
+		const size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+		in += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15)
+			matchLength += ReadLength(in, inEnd);
+		matchLength += g_MinMatch;
+
+		if (offset == 0 || offset > static_cast<size_t>(out - outBegin)
+			|| matchLength > static_cast<size_t>(outEnd - out))
+			ThrowCorrupt();
+
+		const uint8_t* match = out - offset;
+		uint8_t* const matchEnd = out + matchLength;
+		if (offset >= 16 && outEnd - matchEnd >= 16)
+		{
+			// may write up to 15 bytes past the match, which the next
+			// sequence overwrites
+			for (; out < matchEnd; out += 16, match += 16)
+				Copy16(out, match);
+			out = matchEnd;
+		}
+		else
+		{
+			// overlapping matches repeat the last `offset` bytes; every copy
+			// doubles the bytes that can be copied without overlapping
+			while (out < matchEnd)
+			{
+				const size_t size = std::min(static_cast<size_t>(out - match), static_cast<size_t>(matchEnd - out));
+				memcpy(out, match, size);
+				out += size;
+			}
+		}
+	}
+
+	if (out != outEnd)
+		ThrowCorrupt();
+}
+
+// DELTA filter: plane k holds byte k of every element minus byte k of the
+// previous element
+static void FilterDelta(const uint8_t* in, size_t elementCount, uint32_t elementSize, uint8_t* out)
+{
+	for (uint32_t k = 0; k < elementSize; ++k)
+	{
+		uint8_t* plane = out + k * elementCount;
+		uint8_t previous = 0;
+		for (size_t i = 0; i < elementCount; ++i)
+		{
+			const uint8_t value = in[i * elementSize + k];
+			plane[i] = static_cast<uint8_t>(value - previous);
+			previous = value;
+		}
+	}
+}
+
+static void UnfilterDeltaScalar(const uint8_t* in,
+	size_t elementCount,
+	uint32_t elementSize,
+	size_t begin,
+	const uint8_t* previous,
+	uint8_t* out)
+{
+	for (uint32_t k = 0; k < elementSize; ++k)
+	{
+		const uint8_t* plane = in + k * elementCount;
+		uint8_t value = previous[k];
+		for (size_t i = begin; i < elementCount; ++i)
+		{
+			value = static_cast<uint8_t>(value + plane[i]);
+			out[i * elementSize + k] = value;
+		}
+	}
+}
+
+#if CODEC_SSE2
+// inclusive prefix sum of the 16 bytes, plus `carry` in every byte
+static inline __m128i PrefixSum(__m128i value, __m128i carry)
+{
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+	value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+	return _mm_add_epi8(value, carry);
+}
+
+static inline __m128i BroadcastLastByte(__m128i value)
+{
+	return _mm_set1_epi8(static_cast<char>(_mm_extract_epi16(value, 7) >> 8));
+}
+
+static inline void Store4(uint8_t* out, __m128i value)
+{
+	const int32_t bytes = _mm_cvtsi128_si32(value);
+	memcpy(out, &bytes, sizeof(bytes));
+}
+#endif
+
+// 16 elements at a time: prefix sums the next 16 bytes of 4 planes at once,
+// transposes them into 16 groups of 4 bytes and writes every element in
+// order, so the output is written front to back
+static void UnfilterDelta(const uint8_t* in, size_t elementCount, uint32_t elementSize, uint8_t* out)
+{
+	size_t begin = 0;
+	uint8_t previous[g_MaxSimdElementSize]{};
+
+#if CODEC_SSE2
+	if (elementSize % 4 == 0 && elementSize <= g_MaxSimdElementSize)
+	{
+		__m128i carries[g_MaxSimdElementSize];
+		for (uint32_t k = 0; k < elementSize; ++k)
+			carries[k] = _mm_setzero_si128();
+
+		for (; begin + 16 <= elementCount; begin += 16)
+		{
+			uint8_t* elements = out + begin * elementSize;
+			for (uint32_t k = 0; k < elementSize; k += 4)
+			{
+				__m128i planes[4];
+				for (uint32_t j = 0; j < 4; ++j)
+				{
+					const __m128i deltas =
+						_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + (k + j) * elementCount + begin));
+					planes[j] = PrefixSum(deltas, carries[k + j]);
+					carries[k + j] = BroadcastLastByte(planes[j]);
+				}
+
+				const __m128i bytes01Low = _mm_unpacklo_epi8(planes[0], planes[1]);
+				const __m128i bytes01High = _mm_unpackhi_epi8(planes[0], planes[1]);
+				const __m128i bytes23Low = _mm_unpacklo_epi8(planes[2], planes[3]);
+				const __m128i bytes23High = _mm_unpackhi_epi8(planes[2], planes[3]);
+				const __m128i groups[4] = {
+					_mm_unpacklo_epi16(bytes01Low, bytes23Low),
+					_mm_unpackhi_epi16(bytes01Low, bytes23Low),
+					_mm_unpacklo_epi16(bytes01High, bytes23High),
+					_mm_unpackhi_epi16(bytes01High, bytes23High),
+				};
+
+				for (uint32_t group = 0; group < 4; ++group)
+				{
+					uint8_t* element = elements + group * 4 * elementSize + k;
+					Store4(element, groups[group]);
+					Store4(element + elementSize, _mm_srli_si128(groups[group], 4));
+					Store4(element + 2 * elementSize, _mm_srli_si128(groups[group], 8));
+					Store4(element + 3 * elementSize, _mm_srli_si128(groups[group], 12));
+				}
+			}
+		}
+
+		for (uint32_t k = 0; k < elementSize; ++k)
+			previous[k] = static_cast<uint8_t>(_mm_cvtsi128_si32(carries[k]));
+	}
+#endif
+
+	if (elementSize > g_MaxSimdElementSize)
+	{
+		// no room for the carries, only for unusually large elements
+		UnfilterDeltaScalar(in, elementCount, elementSize, 0, std::vector<uint8_t>(elementSize).data(), out);
+		return;
+	}
+
+	UnfilterDeltaScalar(in, elementCount, elementSize, begin, previous, out);
+}
+
+// INDEX filter: zigzag coded difference to the highest index so far plus
+// one, split into byte planes; the arithmetic wraps at the index size
+template<typename T>
+static void FilterIndices(const uint8_t* in, size_t indexCount, uint8_t* out)
+{
+	using Signed = std::make_signed_t<T>;
+
+	T next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		T index;
+		memcpy(&index, in + i * sizeof(T), sizeof(T));
+
+		const Signed difference = static_cast<Signed>(static_cast<T>(next - index));
+		const T sign = static_cast<T>(difference >> (sizeof(T) * 8 - 1));
+		const T code = static_cast<T>(static_cast<T>(static_cast<T>(difference) << 1) ^ sign);
+		for (size_t k = 0; k < sizeof(T); ++k)
+			out[k * indexCount + i] = static_cast<uint8_t>(code >> (k * 8));
+
+		if (static_cast<T>(index + 1) > next)
+			next = static_cast<T>(index + 1);
+	}
+}
+
+template<typename T>
+static void UnfilterIndices(const uint8_t* in, size_t indexCount, uint8_t* out)
+{
+	T next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		T code = 0;
+		for (size_t k = 0; k < sizeof(T); ++k)
+			code = static_cast<T>(code | static_cast<T>(in[k * indexCount + i]) << (k * 8));
+
+		const T difference = static_cast<T>((code >> 1) ^ static_cast<T>(0 - (code & 1)));
+		const T index = static_cast<T>(next - difference);
+		memcpy(out + i * sizeof(T), &index, sizeof(T));
+
+		if (static_cast<T>(index + 1) > next)
+			next = static_cast<T>(index + 1);
+	}
+}
+
+static void Filter(const uint8_t* in,
+	size_t elementCount,
+	StreamEncoding encoding,
+	uint32_t elementSize,
+	uint8_t* out)
+{
+	if (encoding == StreamEncoding::DELTA)
+		FilterDelta(in, elementCount, elementSize, out);
+	else if (encoding == StreamEncoding::INDEX && elementSize == sizeof(uint16_t))
+		FilterIndices<uint16_t>(in, elementCount, out);
+	else if (encoding == StreamEncoding::INDEX)
+		FilterIndices<uint32_t>(in, elementCount, out);
+	else
+		memcpy(out, in, elementCount * elementSize);
+}
+
+static void Unfilter(const uint8_t* in,
+	size_t elementCount,
+	StreamEncoding encoding,
+	uint32_t elementSize,
+	uint8_t* out)
+{
+	if (encoding == StreamEncoding::DELTA)
+		UnfilterDelta(in, elementCount, elementSize, out);
+	else if (encoding == StreamEncoding::INDEX && elementSize == sizeof(uint16_t))
+		UnfilterIndices<uint16_t>(in, elementCount, out);
+	else if (encoding == StreamEncoding::INDEX)
+		UnfilterIndices<uint32_t>(in, elementCount, out);
+	else
+		memcpy(out, in, elementCount * elementSize);
+}
+
+
+namespace codec {
+
+std::vector<uint8_t> Encode(Span<const uint8_t> data,
+	StreamEncoding encoding,
+	uint32_t elementSize,
+	ThreadPool& threadPool)
+{
+	if (encoding == StreamEncoding::RAW)
+		return std::vector<uint8_t>(data.begin(), data.end());
+
+	if (elementSize == 0 || data.size() % elementSize != 0)
+		throw std::invalid_argument("Encoded data is not a whole number of elements");
+	if (encoding == StreamEncoding::INDEX && elementSize != sizeof(uint16_t) && elementSize != sizeof(uint32_t))
+		throw std::invalid_argument("Encoded indices must be 16 or 32 bit");
+
+	const size_t elementCount = data.size() / elementSize;
+	const size_t chunkElements = std::max<size_t>(1, ENCODED_CHUNK_SIZE / elementSize);
+	const size_t chunkCount = (elementCount + chunkElements - 1) / chunkElements;
+
+	// every chunk is encoded on its own, then they are concatenated
+	std::vector<std::vector<uint8_t>> chunks(chunkCount);
+	std::vector<EncodedChunk> table(chunkCount);
+	threadPool.ParallelFor(chunkCount, [&](size_t i) {
+		const size_t first = i * chunkElements;
+		const size_t count = std::min(chunkElements, elementCount - first);
+		const size_t size = count * elementSize;
+
+		std::vector<uint8_t> filtered(size);
+		Filter(data.data() + first * elementSize, count, encoding, elementSize, filtered.data());
+
+		chunks[i].resize(GetLzBound(size));
+		const size_t compressedSize = CompressLz(filtered.data(), size, chunks[i].data());
+		if (compressedSize < size)
+		{
+			chunks[i].resize(compressedSize);
+			table[i].compressed = 1;
+		}
+		else
+		{
+			chunks[i] = std::move(filtered);
+			table[i].compressed = 0;
+		}
+		table[i].size = static_cast<uint32_t>(chunks[i].size());
+	});
+
+	const EncodedStreamHeader header{ static_cast<uint32_t>(chunkCount), static_cast<uint32_t>(chunkElements) };
+	uint64_t offset = sizeof(EncodedStreamHeader) + chunkCount * sizeof(EncodedChunk);
+	for (EncodedChunk& chunk : table)
+	{
+		chunk.offset = offset;
+		offset += chunk.size;
+	}
+
+	std::vector<uint8_t> result(offset);
+	memcpy(result.data(), &header, sizeof(header));
+	if (chunkCount > 0)
+		memcpy(result.data() + sizeof(header), table.data(), chunkCount * sizeof(EncodedChunk));
+	for (size_t i = 0; i < chunkCount; ++i)
+		std::copy(chunks[i].begin(), chunks[i].end(), result.begin() + static_cast<ptrdiff_t>(table[i].offset));
+
+	return result;
+}
+
+// validates the header of an encoded stream against its decoded size
+static EncodedStreamHeader ReadHeader(const EncodedStream& stream)
+{
+	if (stream.encoding != StreamEncoding::LZ && stream.encoding != StreamEncoding::DELTA
+		&& stream.encoding != StreamEncoding::INDEX)
+		throw std::runtime_error("Unsupported stream encoding");
+
+	const uint32_t elementSize = stream.elementSize;
+	if (elementSize == 0 || stream.decodedSize % elementSize != 0
+		|| (stream.encoding == StreamEncoding::INDEX && elementSize != sizeof(uint16_t)
+			&& elementSize != sizeof(uint32_t)))
+		ThrowCorrupt();
+
+	if (stream.data.size() < sizeof(EncodedStreamHeader))
+		ThrowCorrupt();
+	EncodedStreamHeader header;
+	memcpy(&header, stream.data.data(), sizeof(header));
+
+	const uint64_t elementCount = stream.decodedSize / elementSize;
+	if (header.chunkElements == 0
+		|| header.chunkCount != (elementCount + header.chunkElements - 1) / header.chunkElements
+		|| stream.data.size() < sizeof(EncodedStreamHeader) + header.chunkCount * sizeof(EncodedChunk))
+		ThrowCorrupt();
+
+	return header;
+}
+
+uint64_t GetDecodeGranularity(const EncodedStream& stream)
+{
+	if (stream.encoding == StreamEncoding::RAW)
+		return 1;
+
+	return static_cast<uint64_t>(ReadHeader(stream).chunkElements) * stream.elementSize;
+}
+
+void Decode(const EncodedStream& stream, uint8_t* destination, ThreadPool& threadPool)
+{
+	Decode(stream, 0, stream.decodedSize, destination, threadPool);
+}
+
+void Decode(const EncodedStream& stream,
+	uint64_t offset,
+	uint64_t size,
+	uint8_t* destination,
+	ThreadPool& threadPool)
+{
+	if (offset > stream.decodedSize || size > stream.decodedSize - offset)
+		throw std::invalid_argument("Decoded range is outside of the stream");
+
+	if (stream.encoding == StreamEncoding::RAW)
+	{
+		if (stream.data.size() != stream.decodedSize)
+			ThrowCorrupt();
+
+		// large copies saturate a single core long before the memory bus
+		const uint8_t* source = stream.data.data() + offset;
+		threadPool.ParallelForRange(static_cast<size_t>(size), 1024 * 1024, [&](size_t begin, size_t end) {
+			memcpy(destination + begin, source + begin, end - begin);
+		});
+		return;
+	}
+
+	const EncodedStreamHeader header = ReadHeader(stream);
+	const uint32_t elementSize = stream.elementSize;
+	const uint64_t elementCount = stream.decodedSize / elementSize;
+	const uint64_t chunkSize = static_cast<uint64_t>(header.chunkElements) * elementSize;
+	if (offset % chunkSize != 0 || (size % chunkSize != 0 && offset + size != stream.decodedSize))
+		throw std::invalid_argument("Decoded range is not aligned to the chunks of the stream");
+
+	const uint64_t firstChunk = offset / chunkSize;
+	const uint64_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+	const uint8_t* tableData = stream.data.data() + sizeof(EncodedStreamHeader);
+	threadPool.ParallelFor(static_cast<size_t>(chunkCount), [&](size_t i) {
+		EncodedChunk chunk;
+		memcpy(&chunk, tableData + (firstChunk + i) * sizeof(EncodedChunk), sizeof(chunk));
+		if (chunk.offset > stream.data.size() || chunk.size > stream.data.size() - chunk.offset)
+			ThrowCorrupt();
+
+		const uint64_t first = (firstChunk + i) * header.chunkElements;
+		const size_t count = static_cast<size_t>(std::min<uint64_t>(header.chunkElements, elementCount - first));
+		const size_t decodedSize = count * elementSize;
+		const uint8_t* in = stream.data.data() + chunk.offset;
+		uint8_t* out = destination + i * chunkSize;
+
+		// decompressed into a scratch buffer that stays in the cache, the
+		// matches read back what was already decompressed
+		thread_local std::vector<uint8_t> scratch;
+		const uint8_t* filtered = in;
+		if (chunk.compressed)
+		{
+			scratch.resize(decodedSize);
+			DecompressLz(in, chunk.size, scratch.data(), decodedSize);
+			filtered = scratch.data();
+		}
+		else if (chunk.size != decodedSize)
+		{
+			ThrowCorrupt();
+		}
+
+		Unfilter(filtered, count, stream.encoding, elementSize, out);
+	});
+}
+
+} // namespace codec
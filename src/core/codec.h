@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/span.h"
+#include "core/threadPool.h"
+
+
+// how a stream of a cooked asset is stored
+enum class StreamEncoding : uint32_t
+{
+	RAW = 0, // stored as is
+	LZ = 1, // LZ compressed, eg: texels
+	// the elements are split into byte planes, each byte is delta coded
+	// against the same byte of the previous element and the planes are LZ
+	// compressed; eg: vertices, where neighbours have close attributes
+	DELTA = 2,
+	// 16 or 32 bit indices coded relative to the highest index so far (0 for
+	// a vertex that was never referenced before), zigzag coded, split into
+	// byte planes and LZ compressed; works best after `mesh::OptimizeMesh`
+	INDEX = 3,
+};
+
+// every encoding but RAW starts with this header and a table of
+// `chunkCount` `EncodedChunk`s; the chunks decode independently of each
+// other, so they are decoded on multiple threads
+struct EncodedStreamHeader
+{
+	uint32_t chunkCount;
+	uint32_t chunkElements; // elements decoded from every chunk but the last
+};
+
+struct EncodedChunk
+{
+	uint64_t offset; // from the start of the stream
+	uint32_t size;
+	// 0 if the filtered bytes are stored uncompressed because LZ did not
+	// make them smaller
+	uint32_t compressed;
+};
+
+static_assert(sizeof(EncodedStreamHeader) == 8, "EncodedStreamHeader layout must not depend on the compiler");
+static_assert(sizeof(EncodedChunk) == 16, "EncodedChunk layout must not depend on the compiler");
+
+// decoded bytes per chunk, small enough to stay in the cache of the thread
+// decoding it and to keep LZ offsets in 16 bits
+constexpr uint32_t ENCODED_CHUNK_SIZE = 64 * 1024;
+
+// a stream as stored in a cooked asset; `data` is not owned and usually
+// points into a mapped file
+struct EncodedStream
+{
+	Span<const uint8_t> data;
+	uint64_t decodedSize = 0;
+	StreamEncoding encoding = StreamEncoding::RAW;
+	uint32_t elementSize = 1; // vertex stride, index size or texel size in bytes
+};
+
+
+namespace codec {
+
+inline EncodedStream MakeRawStream(Span<const uint8_t> data)
+{
+	return EncodedStream{ data, data.size(), StreamEncoding::RAW, 1 };
+}
+
+// `data` holds `data.size() / elementSize` elements; INDEX only supports
+// 2 and 4 byte elements
+std::vector<uint8_t> Encode(Span<const uint8_t> data,
+	StreamEncoding encoding,
+	uint32_t elementSize,
+	ThreadPool& threadPool);
+
+// decodes the chunks of `stream` on the thread pool, straight into
+// `destination` (`stream.decodedSize` bytes); the destination is only
+// written, in order, never read back, so it can be write-combined staging
+// memory; throws if the stream is corrupt
+void Decode(const EncodedStream& stream, uint8_t* destination, ThreadPool& threadPool);
+
+// decodes the `size` bytes at `offset` of the decoded stream into
+// `destination`, eg: to upload a large stream through a small staging
+// buffer; `offset` must be a multiple of `GetDecodeGranularity`, and so must
+// `size` unless the range ends at the end of the stream
+void Decode(const EncodedStream& stream,
+	uint64_t offset,
+	uint64_t size,
+	uint8_t* destination,
+	ThreadPool& threadPool);
+
+// the decoded bytes of a chunk, 1 for RAW streams; throws if the stream is
+// corrupt
+uint64_t GetDecodeGranularity(const EncodedStream& stream);
+
+} // namespace codec
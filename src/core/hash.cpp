@@ -0,0 +1,107 @@
+#include "hash.h"
+
+#include <cstring>
+
+#include "core/mappedFile.h"
+
+
+namespace hash {
+
+constexpr uint64_t g_Prime1 = 0x9e3779b185ebca87ull;
+constexpr uint64_t g_Prime2 = 0xc2b2ae3d27d4eb4full;
+constexpr uint64_t g_Prime3 = 0x165667b19e3779f9ull;
+constexpr uint64_t g_Prime4 = 0x85ebca77c2b2ae63ull;
+constexpr uint64_t g_Prime5 = 0x27d4eb2f165667c5ull;
+
+static inline uint64_t RotateLeft(uint64_t value, uint32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Read64(const uint8_t* bytes)
+{
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Read32(const uint8_t* bytes)
+{
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static inline uint64_t Round(uint64_t lane, uint64_t input)
+{
+	lane += input * g_Prime2;
+	return RotateLeft(lane, 31) * g_Prime1;
+}
+
+static inline uint64_t MergeLane(uint64_t hash, uint64_t lane)
+{
+	hash ^= Round(0, lane);
+	return hash * g_Prime1 + g_Prime4;
+}
+
+// same construction as xxHash64: the lanes do not depend on each other, so
+// the cpu works on all four at once
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+
+	uint64_t hash;
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = { seed + g_Prime1 + g_Prime2, seed + g_Prime2, seed, seed - g_Prime1 };
+		for (; bytes + 32 <= end; bytes += 32)
+		{
+			lanes[0] = Round(lanes[0], Read64(bytes));
+			lanes[1] = Round(lanes[1], Read64(bytes + 8));
+			lanes[2] = Round(lanes[2], Read64(bytes + 16));
+			lanes[3] = Round(lanes[3], Read64(bytes + 24));
+		}
+
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (uint64_t lane : lanes)
+			hash = MergeLane(hash, lane);
+	}
+	else
+	{
+		hash = seed + g_Prime5;
+	}
+
+	hash += static_cast<uint64_t>(size);
+
+	for (; bytes + 8 <= end; bytes += 8)
+		hash = RotateLeft(hash ^ Round(0, Read64(bytes)), 27) * g_Prime1 + g_Prime4;
+	if (bytes + 4 <= end)
+	{
+		hash = RotateLeft(hash ^ (Read32(bytes) * g_Prime1), 23) * g_Prime2 + g_Prime3;
+		bytes += 4;
+	}
+	for (; bytes < end; ++bytes)
+		hash = RotateLeft(hash ^ (*bytes * g_Prime5), 11) * g_Prime1;
+
+	// avalanche, so that similar inputs do not give similar hashes
+	hash ^= hash >> 33;
+	hash *= g_Prime2;
+	hash ^= hash >> 29;
+	hash *= g_Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t HashFile(const std::string& path)
+{
+	const MappedFile file{ path };
+	return HashBytes(file.GetData(), file.GetSize());
+}
+
+uint64_t Combine(uint64_t hash, uint64_t value)
+{
+	return HashBytes(&value, sizeof(value), hash);
+}
+
+} // namespace hash
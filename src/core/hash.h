@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace hash {
+
+// 64 bit hash of the contents of a file or buffer, used to tell whether an
+// asset changed; not cryptographic, but every input bit affects every output
+// bit and it runs at memory speed (4 independent lanes of 8 bytes)
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// hashes the whole file through a mapping; throws if it cannot be opened
+uint64_t HashFile(const std::string& path);
+
+// order dependent, eg: to fold the options of a cook job into a single key
+uint64_t Combine(uint64_t hash, uint64_t value);
+
+} // namespace hash
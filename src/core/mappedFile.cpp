@@ -0,0 +1,148 @@
+#include "mappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile(const std::string& path)
+	: m_Path{ path },
+	  m_Data{ nullptr },
+	  m_Size{ 0 },
+#ifdef _WIN32
+	  m_FileHandle{ INVALID_HANDLE_VALUE },
+	  m_MappingHandle{ nullptr }
+#else
+	  m_FileDescriptor{ -1 }
+#endif
+{
+	Map();
+}
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+#ifdef _WIN32
+
+void MappedFile::Map()
+{
+	m_FileHandle = CreateFileA(m_Path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Failed to open file for mapping: " + m_Path);
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(m_FileHandle, &fileSize))
+	{
+		Unmap();
+		throw std::runtime_error("Failed to query file size: " + m_Path);
+	}
+
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+	// an empty file cannot be mapped, there is nothing to read anyway
+	if (m_Size == 0)
+		return;
+
+	m_MappingHandle = CreateFileMappingA(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_MappingHandle == nullptr)
+	{
+		Unmap();
+		throw std::runtime_error("Failed to create file mapping: " + m_Path);
+	}
+
+	m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (m_Data == nullptr)
+	{
+		Unmap();
+		throw std::runtime_error("Failed to map view of file: " + m_Path);
+	}
+}
+
+void MappedFile::Unmap()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_FileHandle);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_MappingHandle = nullptr;
+	m_FileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+void MappedFile::Map()
+{
+	m_FileDescriptor = open(m_Path.c_str(), O_RDONLY);
+	if (m_FileDescriptor < 0)
+		throw std::runtime_error("Failed to open file for mapping: " + m_Path);
+
+	struct stat fileStat{};
+	if (fstat(m_FileDescriptor, &fileStat) != 0)
+	{
+		Unmap();
+		throw std::runtime_error("Failed to query file size: " + m_Path);
+	}
+
+	m_Size = static_cast<size_t>(fileStat.st_size);
+	// an empty file cannot be mapped, there is nothing to read anyway
+	if (m_Size == 0)
+		return;
+
+	void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		Unmap();
+		throw std::runtime_error("Failed to map file: " + m_Path);
+	}
+
+	// the contents are mostly read front to back (eg: copied into staging
+	// buffers) so let the kernel read ahead aggressively
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+	m_Data = static_cast<const uint8_t*>(data);
+}
+
+void MappedFile::Unmap()
+{
+	if (m_Data)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+	if (m_FileDescriptor >= 0)
+		close(m_FileDescriptor);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_FileDescriptor = -1;
+}
+
+#endif
+
+void MappedFile::Prefetch() const
+{
+	// a read per page faults it in; the sum keeps the reads from being
+	// optimized away
+	constexpr size_t pageSize = 4096;
+	volatile uint8_t sum = 0;
+	for (size_t offset = 0; offset < m_Size; offset += pageSize)
+		sum = static_cast<uint8_t>(sum + m_Data[offset]);
+}
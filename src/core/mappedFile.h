@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+// read-only memory mapped view of a whole file
+// the OS pages the file in on demand, so the contents can be handed to
+// other APIs (eg: memcpy into a staging buffer) without reading the file
+// into an intermediate buffer first
+class MappedFile
+{
+public:
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline const uint8_t* GetData() const { return m_Data; }
+	inline size_t GetSize() const { return m_Size; }
+	inline const std::string& GetPath() const { return m_Path; }
+
+	// reads every page of the file in now, eg: on a worker thread ahead of
+	// the thread that copies the contents
+	void Prefetch() const;
+
+private:
+	void Map();
+	void Unmap();
+
+private:
+	std::string m_Path;
+
+	const uint8_t* m_Data;
+	size_t m_Size;
+
+#ifdef _WIN32
+	void* m_FileHandle;
+	void* m_MappingHandle;
+#else
+	int m_FileDescriptor;
+#endif
+};
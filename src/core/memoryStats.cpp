@@ -0,0 +1,109 @@
+#include "memoryStats.h"
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <cstdio>
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+
+namespace memory {
+
+#ifdef _WIN32
+
+size_t GetCurrentResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return static_cast<size_t>(counters.WorkingSetSize);
+}
+
+size_t GetPeakResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return static_cast<size_t>(counters.PeakWorkingSetSize);
+}
+
+bool ResetPeakResidentBytes()
+{
+	return false;
+}
+
+#else
+
+size_t GetCurrentResidentBytes()
+{
+	// the second field of statm is the resident size in pages
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+
+	long totalPages = 0;
+	long residentPages = 0;
+	const int read = fscanf(file, "%ld %ld", &totalPages, &residentPages);
+	fclose(file);
+	if (read != 2)
+		return 0;
+
+	return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+size_t GetPeakResidentBytes()
+{
+#ifdef __linux__
+	// VmHWM can be reset, unlike the peak of getrusage
+	FILE* file = fopen("/proc/self/status", "r");
+	if (file != nullptr)
+	{
+		char line[256];
+		unsigned long long kilobytes = 0;
+		bool found = false;
+		while (!found && fgets(line, sizeof(line), file) != nullptr)
+			found = sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1;
+		fclose(file);
+
+		if (found)
+			return static_cast<size_t>(kilobytes) * 1024;
+	}
+#endif
+
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// kilobytes on linux, bytes on macOS
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);
+#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+bool ResetPeakResidentBytes()
+{
+#ifdef __linux__
+	FILE* file = fopen("/proc/self/clear_refs", "w");
+	if (file == nullptr)
+		return false;
+
+	const bool written = fputs("5", file) >= 0;
+	return fclose(file) == 0 && written;
+#else
+	return false;
+#endif
+}
+
+#endif
+
+} // namespace memory
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+
+// resident set size of the process, ie: the memory actually backed by
+// physical pages, including the pages of mapped files that were read
+// both return 0 if the OS does not report it
+namespace memory {
+
+size_t GetCurrentResidentBytes();
+// highest resident set size since the process started, or since the last
+// successful `ResetPeakResidentBytes`
+size_t GetPeakResidentBytes();
+// starts measuring the peak from the current resident set size, so that the
+// peak of a single run can be measured; returns false if the OS does not
+// support it (only linux does)
+bool ResetPeakResidentBytes();
+
+} // namespace memory
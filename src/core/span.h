@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// non-owning view of contiguous elements, a subset of c++20 `std::span`
+// the member names follow `std::span` so that range based for loops work and
+// it can be swapped for the standard one when the project moves to c++20
+template<typename T>
+class Span
+{
+public:
+	constexpr Span() = default;
+	constexpr Span(T* data, size_t size)
+		: m_Data{ data },
+		  m_Size{ size }
+	{}
+
+	// any container with contiguous `data()` and `size()`, eg: std::vector
+	template<typename Container>
+	constexpr Span(Container& container)
+		: m_Data{ container.data() },
+		  m_Size{ container.size() }
+	{}
+
+	constexpr T* data() const { return m_Data; }
+	constexpr size_t size() const { return m_Size; }
+	constexpr size_t size_bytes() const { return m_Size * sizeof(T); }
+	constexpr bool empty() const { return m_Size == 0; }
+
+	constexpr T* begin() const { return m_Data; }
+	constexpr T* end() const { return m_Data + m_Size; }
+
+	constexpr T& operator[](size_t index) const { return m_Data[index]; }
+
+	constexpr Span subspan(size_t offset, size_t count) const { return Span{ m_Data + offset, count }; }
+
+private:
+	T* m_Data = nullptr;
+	size_t m_Size = 0;
+};
+
+template<typename T>
+Span<const uint8_t> AsBytes(Span<T> span)
+{
+	return Span<const uint8_t>{ reinterpret_cast<const uint8_t*>(span.data()), span.size_bytes() };
+}
@@ -0,0 +1,93 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+	: m_Stop{ false }
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	m_Workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_Condition.wait(lock, [this]() { return m_Stop || !m_Tasks.empty(); });
+
+			// finish the queued tasks before stopping
+			if (m_Stop && m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	// no need to go through the queue for a single item
+	if (count == 1)
+	{
+		func(0);
+		return;
+	}
+
+	std::vector<std::future<void>> futures;
+	futures.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+		futures.push_back(Submit([&func, i]() { func(i); }));
+
+	// wait for every task before rethrowing, `func` must outlive all of them
+	std::exception_ptr exception = nullptr;
+	for (std::future<void>& future : futures)
+	{
+		try
+		{
+			future.get();
+		} catch (...)
+		{
+			if (!exception)
+				exception = std::current_exception();
+		}
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+void ThreadPool::ParallelForRange(size_t count, size_t minRangeSize, const std::function<void(size_t, size_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	// a few ranges per thread so that uneven ranges balance out
+	const size_t maxRanges = static_cast<size_t>(GetThreadCount()) * 4;
+	const size_t rangeCount = std::max<size_t>(1, std::min(maxRanges, count / std::max<size_t>(1, minRangeSize)));
+
+	ParallelFor(rangeCount, [&](size_t i) { func(count * i / rangeCount, count * (i + 1) / rangeCount); });
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+// fixed size pool of worker threads
+// tasks are run in the order they are submitted
+class ThreadPool
+{
+public:
+	// `threadCount` of 0 uses one thread per hardware thread
+	ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// exceptions thrown by the task are rethrown by `std::future::get()`
+	template<typename Func>
+	std::future<void> Submit(Func&& func)
+	{
+		auto task = std::make_shared<std::packaged_task<void()>>(std::forward<Func>(func));
+		std::future<void> future = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_Tasks.push([task]() { (*task)(); });
+		}
+		m_Condition.notify_one();
+
+		return future;
+	}
+
+	// calls `func(i)` for every i in [0, count) on the workers and blocks
+	// until all of them are done; the first exception thrown is rethrown
+	// must not be called from a task running on the same pool, the waiting
+	// worker could starve the pool
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	// splits [0, count) into contiguous ranges of at least `minRangeSize`
+	// items and calls `func(begin, end)` for each of them like `ParallelFor`
+	void ParallelForRange(size_t count, size_t minRangeSize, const std::function<void(size_t, size_t)>& func);
+
+	inline uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::queue<std::function<void()>> m_Tasks;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stop;
+};
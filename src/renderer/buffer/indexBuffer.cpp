@@ -1,68 +1,73 @@
 #include "indexBuffer.h"
 
 #include <stdexcept>
+#include <cstring>
 
 #include "renderer/swapchain.h"
-#include "utils/bufferUtils.h"
+#include "renderer/buffer/stagingUpload.h"
 
 
 IndexBuffer::IndexBuffer(const Device* device,
 	const CommandBuffer* commandBuffers,
-	const std::vector<uint32_t>& indices)
+	const EncodedStream& indexData,
+	ThreadPool& threadPool,
+	VkIndexType indexType,
+	VkDeviceSize maxStagingSize)
 	: m_Device{ device },
 	  m_CommandBuffers{ commandBuffers },
-	  m_Indices{ indices }
+	  m_IndexType{ indexType }
 {
-	CreateIndexBuffer();
+	CreateIndexBuffer(indexData, threadPool, maxStagingSize);
+}
+
+IndexBuffer::IndexBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	VkDeviceSize size,
+	VkIndexType indexType)
+	: m_Device{ device },
+	  m_CommandBuffers{ commandBuffers },
+	  m_IndexType{ indexType },
+	  m_UploadStats{}
+{
+	m_UploadStats.path = staging::CreateEmptyDeviceBuffer(
+		m_Device, size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer, m_BufferMemory);
 }
 
 IndexBuffer::~IndexBuffer()
 {
 	vkDestroyBuffer(m_Device->GetDevice(), m_IndexBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_BufferMemory, nullptr);
+	m_Device->GetAllocator().Free(m_BufferMemory);
 }
 
-void IndexBuffer::CreateIndexBuffer()
+void IndexBuffer::CreateIndexBuffer(const EncodedStream& indexData,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
 {
-	VkDeviceSize bufferSize = sizeof(m_Indices[0]) * m_Indices.size();
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	utils::buff::CreateBuffer(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // source memory during transfer
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory); // staging buffer (in the CPU); temporary buffer
-
-	// copy the vertex data to the buffer
-	void* data;
-	vkMapMemory(m_Device->GetDevice(),
-		stagingBufferMemory,
-		0,
-		bufferSize,
-		0,
-		&data); // mapping the buffer memory into CPU accessible memory
-	memcpy(data, m_Indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMemory);
-
-	utils::buff::CreateBuffer(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, // destination memory during
-																			 // transfer
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	// decoded into a staging buffer (in the CPU) and copied piece by piece,
+	// or straight into the buffer when the device memory is CPU accessible
+	m_UploadStats = staging::CreateDeviceBuffer(m_Device,
+		m_CommandBuffers,
+		indexData,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 		m_IndexBuffer,
-		m_BufferMemory); // the actual buffer (located in the device memory)
-
-	utils::buff::CopyBuffer(m_Device->GetDevice(),
-		m_Device->GetGraphicsQueue(),
-		m_CommandBuffers->GetCommandPool(),
-		stagingBuffer,
-		m_IndexBuffer,
-		bufferSize);
+		m_BufferMemory,
+		threadPool,
+		maxStagingSize);
+}
 
-	vkDestroyBuffer(m_Device->GetDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), stagingBufferMemory, nullptr);
+void IndexBuffer::Write(VkDeviceSize offset,
+	const EncodedStream& indexData,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+{
+	staging::AddUploadStats(m_UploadStats,
+		staging::WriteDeviceBuffer(m_Device,
+			m_CommandBuffers,
+			indexData,
+			m_UploadStats.path,
+			m_IndexBuffer,
+			m_BufferMemory,
+			offset,
+			threadPool,
+			maxStagingSize));
 }
@@ -4,27 +4,57 @@
 
 #include <vector>
 
+#include "core/codec.h"
+#include "core/threadPool.h"
 #include "renderer/device.h"
 #include "renderer/buffer/commandBuffer.h"
+#include "renderer/buffer/stagingUpload.h"
 
 
 class IndexBuffer
 {
 public:
-	IndexBuffer(const Device* device, const CommandBuffer* commandBuffers, const std::vector<uint32_t>& indices);
+	// `indexData` is only read while uploading, so it can point directly into
+	// a mapped file and be released once the constructor returns; it is
+	// decoded on `threadPool` straight into a staging buffer of at most
+	// `maxStagingSize` bytes, or into the buffer itself on devices with direct
+	// uploads
+	// `indexType` is either 16 or 32 bit
+	IndexBuffer(const Device* device,
+		const CommandBuffer* commandBuffers,
+		const EncodedStream& indexData,
+		ThreadPool& threadPool,
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32,
+		VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+	// an empty buffer of `size` bytes, filled piece by piece with `Write`,
+	// eg: by a streamed model
+	IndexBuffer(const Device* device,
+		const CommandBuffer* commandBuffers,
+		VkDeviceSize size,
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32);
 	~IndexBuffer();
 
+	// decodes `indexData` into the buffer from `offset` (in bytes), like the
+	// upload of the first constructor
+	void Write(VkDeviceSize offset,
+		const EncodedStream& indexData,
+		ThreadPool& threadPool,
+		VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+
 	inline VkBuffer GetIndexBuffer() const { return m_IndexBuffer; }
+	// of the upload in the constructor, or of every `Write` so far
+	inline const BufferUploadStats& GetUploadStats() const { return m_UploadStats; }
+	inline VkIndexType GetIndexType() const { return m_IndexType; }
 
 private:
-	void CreateIndexBuffer();
+	void CreateIndexBuffer(const EncodedStream& indexData, ThreadPool& threadPool, VkDeviceSize maxStagingSize);
 
 private:
 	const Device* m_Device;
 	const CommandBuffer* m_CommandBuffers;
-
-	std::vector<uint32_t> m_Indices;
+	VkIndexType m_IndexType;
 
 	VkBuffer m_IndexBuffer;
-	VkDeviceMemory m_BufferMemory;
+	DeviceAllocation m_BufferMemory;
+	BufferUploadStats m_UploadStats;
 };
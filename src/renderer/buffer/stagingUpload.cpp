@@ -0,0 +1,150 @@
+#include "stagingUpload.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils/bufferUtils.h"
+
+
+namespace staging {
+
+// the memory type picked for the device may not fit the buffer (its
+// `memoryTypeBits` depend on the usage), or its heap may be out of memory;
+// the buffer is staged then
+static bool CreateDirectBuffer(const Device* device,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory)
+{
+	try
+	{
+		utils::buff::CreateBufferInType(device->GetDevice(),
+			device->GetAllocator(),
+			size,
+			usage,
+			device->GetDirectUploadMemoryType(),
+			buffer,
+			bufferMemory);
+	} catch (const std::runtime_error&)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+BufferUploadStats CreateDeviceBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+{
+	const UploadPath path = CreateEmptyDeviceBuffer(device, data.decodedSize, usage, buffer, bufferMemory);
+	return WriteDeviceBuffer(
+		device, commandBuffers, data, path, buffer, bufferMemory, 0, threadPool, maxStagingSize);
+}
+
+UploadPath CreateEmptyDeviceBuffer(const Device* device,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory)
+{
+	if (device->SupportsDirectUploads() && CreateDirectBuffer(device, size, usage, buffer, bufferMemory))
+		return UploadPath::DIRECT;
+
+	utils::buff::CreateBuffer(device->GetDevice(),
+		device->GetAllocator(),
+		size,
+		usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, // destination of the copies from staging
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		buffer,
+		bufferMemory);
+	return UploadPath::STAGED;
+}
+
+BufferUploadStats WriteDeviceBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	UploadPath path,
+	VkBuffer buffer,
+	const DeviceAllocation& bufferMemory,
+	VkDeviceSize offset,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+{
+	if (path == UploadPath::STAGED)
+		return UploadBuffer(device, commandBuffers, data, buffer, offset, threadPool, maxStagingSize);
+
+	// the memory the GPU reads is written by the CPU, so there is nothing to
+	// copy or wait for; coherent memory needs no flush either
+	BufferUploadStats stats{};
+	stats.path = UploadPath::DIRECT;
+	if (data.decodedSize == 0)
+		return stats;
+
+	codec::Decode(data, bufferMemory.mapped + offset, threadPool);
+
+	stats.writtenBytes = data.decodedSize;
+	return stats;
+}
+
+BufferUploadStats UploadBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	VkBuffer destination,
+	VkDeviceSize destinationOffset,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+{
+	BufferUploadStats stats{};
+	stats.path = UploadPath::STAGED;
+	if (data.decodedSize == 0)
+		return stats;
+
+	// the pieces start at chunk boundaries, so that each one decodes on its own
+	const uint64_t granularity = codec::GetDecodeGranularity(data);
+	const VkDeviceSize pieceSize =
+		std::min<VkDeviceSize>(data.decodedSize, std::max<VkDeviceSize>(maxStagingSize / granularity, 1) * granularity);
+
+	VkBuffer stagingBuffer;
+	DeviceAllocation stagingBufferMemory;
+	utils::buff::CreateBuffer(device->GetDevice(),
+		device->GetAllocator(),
+		pieceSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // source memory during transfer
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory);
+
+	// stays mapped, coherent memory needs no flush between the pieces
+	for (VkDeviceSize offset = 0; offset < data.decodedSize; offset += pieceSize)
+	{
+		const VkDeviceSize size = std::min<VkDeviceSize>(pieceSize, data.decodedSize - offset);
+		codec::Decode(data, offset, size, stagingBufferMemory.mapped, threadPool);
+
+		// waits for the copy, the staging buffer is overwritten right after
+		utils::buff::CopyBuffer(device->GetDevice(),
+			device->GetGraphicsQueue(),
+			commandBuffers->GetCommandPool(),
+			stagingBuffer,
+			destination,
+			size,
+			destinationOffset + offset);
+		++stats.submitCount;
+	}
+
+	vkDestroyBuffer(device->GetDevice(), stagingBuffer, nullptr);
+	device->GetAllocator().Free(stagingBufferMemory);
+
+	stats.writtenBytes = data.decodedSize;
+	stats.copiedBytes = data.decodedSize;
+	stats.stagingBytes = pieceSize;
+	return stats;
+}
+
+} // namespace staging
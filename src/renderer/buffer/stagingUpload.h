@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "core/codec.h"
+#include "core/threadPool.h"
+#include "renderer/device.h"
+#include "renderer/buffer/commandBuffer.h"
+#include "renderer/buffer/uploadPath.h"
+
+
+// the largest staging buffer an upload allocates by default; larger data is
+// uploaded in pieces through the same staging buffer
+constexpr VkDeviceSize DEFAULT_MAX_STAGING_SIZE = 16 * 1024 * 1024;
+
+
+namespace staging {
+
+// creates `buffer` with `usage` and uploads `data` into it: on devices that
+// support direct uploads it is created in the memory type they picked for
+// them and `data` is decoded straight into it, otherwise, or when it cannot be
+// created there, it goes through `UploadBuffer`
+BufferUploadStats CreateDeviceBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+
+// creates `buffer` with `usage` and room for `size` bytes, to be filled
+// piece by piece with `WriteDeviceBuffer`; in the memory type picked for
+// direct uploads if the device supports them, in device local memory
+// otherwise; returns the path the writes take
+UploadPath CreateEmptyDeviceBuffer(const Device* device,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory);
+
+// decodes `data` into a buffer created by `CreateEmptyDeviceBuffer`, from
+// `offset`: straight into the mapped buffer or through `UploadBuffer`,
+// depending on `path`
+BufferUploadStats WriteDeviceBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	UploadPath path,
+	VkBuffer buffer,
+	const DeviceAllocation& bufferMemory,
+	VkDeviceSize offset,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+
+// decodes `data` into `destination`, from `destinationOffset`, through a host
+// visible staging buffer of at most `maxStagingSize` bytes, rounded up to the
+// chunks of the stream; every piece is copied and waited for before the next
+// one is decoded, so the memory an upload needs never grows with the data
+BufferUploadStats UploadBuffer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	const EncodedStream& data,
+	VkBuffer destination,
+	VkDeviceSize destinationOffset,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+
+} // namespace staging
@@ -3,158 +3,314 @@
 #include <stdexcept>
 #include <chrono>
 #include <array>
+#include <cstring>
 
 #include "renderer/swapchain.h"
 #include "utils/bufferUtils.h"
 
 
+// the uniform blocks of a frame are at offsets the device can bind
+static VkDeviceSize GetUniformAlignment(const Device* device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device->GetPhysicalDevice(), &properties);
+	return properties.limits.minUniformBufferOffsetAlignment;
+}
+
 UniformBuffer::UniformBuffer(const int maxFramesInFlight,
 	const Device* device,
 	const Pipeline* graphicsPipeline,
-	const Texture* texture)
+	const std::vector<const Texture*>& textures,
+	const VertexQuantization& quantization,
+	const std::vector<VkBuffer>& feedbackBuffers,
+	VkDeviceSize ringFrameSize)
 	: m_MaxFramesInFlight{ maxFramesInFlight },
 	  m_Device{ device },
 	  m_GraphicsPipeline{ graphicsPipeline },
-	  m_Texture{ texture }
+	  m_Textures{ textures },
+	  m_FeedbackBuffers{ feedbackBuffers },
+	  m_Ring{ static_cast<uint32_t>(maxFramesInFlight), ringFrameSize, GetUniformAlignment(device) },
+	  m_FrameBlock{},
+	  m_SetsPerFrame{ graphicsPipeline->IsBindless() || graphicsPipeline->IsVirtualTexture()
+						  ? 1
+						  : static_cast<uint32_t>(textures.size()) },
+	  m_TextureSlots{ graphicsPipeline->IsBindless() ? graphicsPipeline->GetBindlessTextureCount()
+													 : static_cast<uint32_t>(textures.size()) },
+	  m_ModelMatrix{ glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f))
+					 * glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f))
+					 * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.5f)) },
+	  m_Quantization{ quantization }
 {
-	CreateUniformBuffers();
-	CreateDescriptorPool();
+	if (m_Textures.size() > m_TextureSlots)
+		throw std::runtime_error("More textures than slots in the texture array!");
+
+	CreateUniformRing();
+	CreateDescriptorPools();
 	CreateDescriptorSets();
 }
 
 UniformBuffer::~UniformBuffer()
 {
-	for (size_t i = 0; i < m_MaxFramesInFlight; ++i)
-	{
-		vkDestroyBuffer(m_Device->GetDevice(), m_UniformBuffers[i], nullptr);
-		vkFreeMemory(m_Device->GetDevice(), m_UniformBuffersMemory[i], nullptr);
-	}
+	vkDestroyBuffer(m_Device->GetDevice(), m_RingBuffer, nullptr);
+	m_Device->GetAllocator().Free(m_RingMemory);
 
-	vkDestroyDescriptorPool(m_Device->GetDevice(), m_DescriptorPool, nullptr);
+	vkDestroyDescriptorPool(m_Device->GetDevice(), m_FramePool, nullptr);
+	vkDestroyDescriptorPool(m_Device->GetDevice(), m_TexturePool, nullptr);
 }
 
-void UniformBuffer::CreateUniformBuffers()
+void UniformBuffer::CreateUniformRing()
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-	m_UniformBuffers.resize(m_MaxFramesInFlight);
-	m_UniformBuffersMemory.resize(m_MaxFramesInFlight);
-	m_UniformBuffersMapped.resize(m_MaxFramesInFlight);
-
-	for (size_t i = 0; i < m_MaxFramesInFlight; ++i)
-	{
-		utils::buff::CreateBuffer(m_Device->GetDevice(),
-			m_Device->GetPhysicalDevice(),
-			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			m_UniformBuffers[i],
-			m_UniformBuffersMemory[i]);
-
-		vkMapMemory(m_Device->GetDevice(),
-			m_UniformBuffersMemory[i],
-			0,
-			bufferSize,
-			0,
-			&m_UniformBuffersMapped[i]); // persistent mapping; pointer for
-										 // application's lifetime
-	}
+	// persistent mapping of the allocator; coherent memory needs no flush
+	utils::buff::CreateBuffer(m_Device->GetDevice(),
+		m_Device->GetAllocator(),
+		m_Ring.GetSize(),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_RingBuffer,
+		m_RingMemory);
 }
 
-void UniformBuffer::CreateDescriptorPool()
+void UniformBuffer::CreateDescriptorPools()
 {
+	const uint32_t frameCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+
 	// describe descriptor sets
-	std::array<VkDescriptorPoolSize, 2> descriptorPoolSizes{};
-	descriptorPoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorPoolSizes[0].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
-	descriptorPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorPoolSizes[1].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+	std::array<VkDescriptorPoolSize, 2> framePoolSizes{};
+	framePoolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	framePoolSizes[0].descriptorCount = frameCount;
+	framePoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	framePoolSizes[1].descriptorCount = frameCount;
 
 	// allocate one for every frame
-	VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
-	descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptorPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
-	descriptorPoolCreateInfo.pPoolSizes = descriptorPoolSizes.data();
-	descriptorPoolCreateInfo.maxSets =
-		static_cast<uint32_t>(m_MaxFramesInFlight); // max descriptor sets that can be allocated
-
-	if (vkCreateDescriptorPool(m_Device->GetDevice(), &descriptorPoolCreateInfo, nullptr, &m_DescriptorPool)
+	VkDescriptorPoolCreateInfo framePoolCreateInfo{};
+	framePoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	framePoolCreateInfo.poolSizeCount = m_FeedbackBuffers.empty() ? 1 : 2;
+	framePoolCreateInfo.pPoolSizes = framePoolSizes.data();
+	framePoolCreateInfo.maxSets = frameCount; // max descriptor sets that can be allocated
+
+	if (vkCreateDescriptorPool(m_Device->GetDevice(), &framePoolCreateInfo, nullptr, &m_FramePool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create descriptor pool!");
+
+	// the tile cache and the page table of a virtual texture
+	VkDescriptorPoolSize texturePoolSize{};
+	texturePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	texturePoolSize.descriptorCount = frameCount * (IsVirtualTexture() ? 2 : m_TextureSlots);
+
+	// allocate one for every frame and texture, or one for every frame when
+	// bindless, whose texture array is written while it is bound
+	VkDescriptorPoolCreateInfo texturePoolCreateInfo{};
+	texturePoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	texturePoolCreateInfo.flags = IsBindless() ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0;
+	texturePoolCreateInfo.poolSizeCount = 1;
+	texturePoolCreateInfo.pPoolSizes = &texturePoolSize;
+	texturePoolCreateInfo.maxSets = frameCount * m_SetsPerFrame;
+
+	if (vkCreateDescriptorPool(m_Device->GetDevice(), &texturePoolCreateInfo, nullptr, &m_TexturePool)
 		!= VK_SUCCESS)
 		throw std::runtime_error("Failed to create descriptor pool!");
 }
 
-void UniformBuffer::CreateDescriptorSets()
+// `layout` for every set of `sets`
+static void AllocateDescriptorSets(VkDevice deviceVk,
+	VkDescriptorPool pool,
+	VkDescriptorSetLayout layout,
+	std::vector<VkDescriptorSet>& sets)
 {
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(
-		m_MaxFramesInFlight, m_GraphicsPipeline->GetDescriptorSetLayout());
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(sets.size(), layout);
 
 	VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
 	descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptorSetAllocateInfo.descriptorPool = m_DescriptorPool;
-	descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+	descriptorSetAllocateInfo.descriptorPool = pool;
+	descriptorSetAllocateInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
 	descriptorSetAllocateInfo.pSetLayouts = descriptorSetLayouts.data();
 
-	// we create one descriptor set for each frame with the same layout
-
-	m_DescriptorSets.resize(m_MaxFramesInFlight);
-	if (vkAllocateDescriptorSets(m_Device->GetDevice(), &descriptorSetAllocateInfo, m_DescriptorSets.data())
-		!= VK_SUCCESS)
+	if (vkAllocateDescriptorSets(deviceVk, &descriptorSetAllocateInfo, sets.data()) != VK_SUCCESS)
 		throw std::runtime_error("Failed to allocate descriptor sets!");
+}
+
+void UniformBuffer::CreateDescriptorSets()
+{
+	// we create a frame set for each frame, which binds the uniform ring at
+	// the dynamic offset of the block a draw uses, and a texture set with the
+	// same layout for each frame and texture, or one for each frame when
+	// bindless
+	m_FrameSets.resize(static_cast<size_t>(m_MaxFramesInFlight));
+	AllocateDescriptorSets(m_Device->GetDevice(), m_FramePool, m_GraphicsPipeline->GetFrameSetLayout(), m_FrameSets);
+	m_TextureSets.resize(static_cast<size_t>(m_MaxFramesInFlight) * m_SetsPerFrame);
+	AllocateDescriptorSets(
+		m_Device->GetDevice(), m_TexturePool, m_GraphicsPipeline->GetTextureSetLayout(), m_TextureSets);
 
 	// configure descriptors in the descriptor sets
-	for (size_t i = 0; i < m_MaxFramesInFlight; ++i)
+	m_BoundImageViews.resize(static_cast<size_t>(m_MaxFramesInFlight) * m_TextureSlots, VK_NULL_HANDLE);
+	for (size_t frameIdx = 0; frameIdx < m_FrameSets.size(); ++frameIdx)
 	{
 		// to configure descriptors that refer to buffers,
 		// `VkDescriptorBufferInfo`
 		VkDescriptorBufferInfo descriptorBufferInfo{};
-		descriptorBufferInfo.buffer = m_UniformBuffers[i];
+		descriptorBufferInfo.buffer = m_RingBuffer;
 		descriptorBufferInfo.offset = 0;
 		descriptorBufferInfo.range = sizeof(UniformBufferObject);
 
-		VkDescriptorImageInfo descriptorImageInfo{};
-		descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		descriptorImageInfo.imageView = m_Texture->GetImageView();
-		descriptorImageInfo.sampler = m_Texture->GetSampler();
-
 		// to update the descriptor sets
 		// we can update multiple descriptors at once in an array starting at
 		// index dstArrayElement
 		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
 		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = m_DescriptorSets[i];
+		descriptorWrites[0].dstSet = m_FrameSets[frameIdx];
 		descriptorWrites[0].dstBinding = 0;
 		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		descriptorWrites[0].descriptorCount = 1; // number of elements you want to update
 		descriptorWrites[0].pBufferInfo = &descriptorBufferInfo;
 
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = m_DescriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1; // number of elements you want to update
-		descriptorWrites[1].pImageInfo = &descriptorImageInfo;
+		// the whole buffer, a uint per texture
+		VkDescriptorBufferInfo feedbackBufferInfo{};
+		if (!m_FeedbackBuffers.empty())
+		{
+			feedbackBufferInfo.buffer = m_FeedbackBuffers[frameIdx];
+			feedbackBufferInfo.offset = 0;
+			feedbackBufferInfo.range = VK_WHOLE_SIZE;
+
+			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[1].dstSet = m_FrameSets[frameIdx];
+			descriptorWrites[1].dstBinding = 1;
+			descriptorWrites[1].dstArrayElement = 0;
+			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[1].descriptorCount = 1;
+			descriptorWrites[1].pBufferInfo = &feedbackBufferInfo;
+		}
 
 		// updates the configurations of the descriptor sets
 		vkUpdateDescriptorSets(
-			m_Device->GetDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+			m_Device->GetDevice(), m_FeedbackBuffers.empty() ? 1 : 2, descriptorWrites.data(), 0, nullptr);
+	}
+
+	// the slots past the textures stay unwritten, the array is partially
+	// bound
+	for (uint32_t frameIdx = 0; frameIdx < static_cast<uint32_t>(m_MaxFramesInFlight); ++frameIdx)
+	{
+		for (uint32_t textureIdx = 0; textureIdx < m_Textures.size(); ++textureIdx)
+			WriteTextureDescriptor(frameIdx, textureIdx, m_Textures[textureIdx]);
 	}
 }
 
+void UniformBuffer::UpdateTextures(uint32_t frameIdx, const std::vector<const Texture*>& textures)
+{
+	for (uint32_t textureIdx = 0; textureIdx < textures.size(); ++textureIdx)
+	{
+		if (m_BoundImageViews[frameIdx * m_TextureSlots + textureIdx] != textures[textureIdx]->GetImageView())
+			WriteTextureDescriptor(frameIdx, textureIdx, textures[textureIdx]);
+	}
+}
+
+uint32_t UniformBuffer::RegisterTexture(const Texture* texture)
+{
+	if (!IsBindless())
+		throw std::runtime_error("Textures can only be registered into the texture array of a bindless pipeline!");
+	if (m_Textures.size() == m_TextureSlots)
+		throw std::runtime_error("The texture array is full!");
+
+	// no frame samples the slot yet, so it is written into the sets of the
+	// frames in flight too (update unused while pending)
+	const uint32_t textureIdx = static_cast<uint32_t>(m_Textures.size());
+	m_Textures.push_back(texture);
+	for (uint32_t frameIdx = 0; frameIdx < static_cast<uint32_t>(m_MaxFramesInFlight); ++frameIdx)
+		WriteTextureDescriptor(frameIdx, textureIdx, texture);
+
+	return textureIdx;
+}
+
+void UniformBuffer::WriteVirtualTexture(const VirtualTexture& texture)
+{
+	if (!IsVirtualTexture())
+		throw std::runtime_error("Only a virtual texture pipeline samples a virtual texture!");
+
+	// the cache is sampled bilinear, the page table with texel fetches
+	VkDescriptorImageInfo cacheImageInfo{};
+	cacheImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	cacheImageInfo.imageView = texture.GetCacheView();
+	cacheImageInfo.sampler = texture.GetCacheSampler();
+
+	VkDescriptorImageInfo pageTableImageInfo{};
+	pageTableImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	pageTableImageInfo.imageView = texture.GetPageTableView();
+	pageTableImageInfo.sampler = texture.GetPageTableSampler();
+
+	for (uint32_t frameIdx = 0; frameIdx < static_cast<uint32_t>(m_MaxFramesInFlight); ++frameIdx)
+	{
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = GetTextureSet(frameIdx, 0);
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pImageInfo = &cacheImageInfo;
+
+		descriptorWrites[1] = descriptorWrites[0];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].pImageInfo = &pageTableImageInfo;
+
+		vkUpdateDescriptorSets(m_Device->GetDevice(),
+			static_cast<uint32_t>(descriptorWrites.size()),
+			descriptorWrites.data(),
+			0,
+			nullptr);
+	}
+}
+
+void UniformBuffer::WriteTextureDescriptor(uint32_t frameIdx, uint32_t textureIdx, const Texture* texture)
+{
+	VkDescriptorImageInfo descriptorImageInfo{};
+	descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	descriptorImageInfo.imageView = texture->GetImageView();
+	descriptorImageInfo.sampler = texture->GetSampler();
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = IsBindless() ? GetTextureSet(frameIdx, 0) : GetTextureSet(frameIdx, textureIdx);
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = IsBindless() ? textureIdx : 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1; // number of elements you want to update
+	descriptorWrite.pImageInfo = &descriptorImageInfo;
+
+	vkUpdateDescriptorSets(m_Device->GetDevice(), 1, &descriptorWrite, 0, nullptr);
+	m_BoundImageViews[frameIdx * m_TextureSlots + textureIdx] = texture->GetImageView();
+}
+
 void UniformBuffer::Update(uint32_t currentFrameIdx, const Camera* camera)
 {
 	static auto startTime = std::chrono::high_resolution_clock::now();
 	auto currentTime = std::chrono::high_resolution_clock::now();
 	float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
-	UniformBufferObject ubo{};
-	ubo.model = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f))
-				* glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(0.0f, 0.0f, 1.0f))
-				* glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.5f));
-	ubo.view = camera->GetViewMatrix();
-	ubo.proj = camera->GetProjectionMatrix();
+	m_FrameBlock.view = camera->GetViewMatrix();
+	m_FrameBlock.proj = camera->GetProjectionMatrix();
+	m_FrameBlock.texCoordTransform = glm::vec4{ m_Quantization.texCoordScale, m_Quantization.texCoordOffset };
+
+	// the blocks the frame pushed before were read by its previous
+	// submission, which is done
+	m_Ring.BeginFrame(currentFrameIdx);
+}
+
+uint32_t UniformBuffer::PushDraw(const glm::mat4& model)
+{
+	// the quantized positions are decoded by the model matrix, the model
+	// matrix used on the cpu stays in model space
+	UniformBufferObject ubo = m_FrameBlock;
+	ubo.model = model * glm::translate(glm::mat4(1.0f), m_Quantization.positionOffset)
+				* glm::scale(glm::mat4(1.0f), m_Quantization.positionScale);
+	return Push(ubo);
+}
+
+uint32_t UniformBuffer::Push(const UniformBufferObject& ubo)
+{
+	const uint64_t offset = m_Ring.Allocate(sizeof(ubo));
+	if (offset == NO_RING_OFFSET)
+		throw std::runtime_error("The uniform ring of the frame is full!");
 
 	// copy the data from ubo to the uniform buffer (in GPU)
-	memcpy(m_UniformBuffersMapped[currentFrameIdx], &ubo, sizeof(ubo));
+	memcpy(m_RingMemory.mapped + offset, &ubo, sizeof(ubo));
+	return static_cast<uint32_t>(offset);
 }
@@ -8,7 +8,9 @@
 
 #include "renderer/device.h"
 #include "renderer/pipeline.h"
+#include "renderer/memory/frameRingAllocator.h"
 #include "renderer/texture.h"
+#include "renderer/texture/virtualTexture.h"
 #include "renderer/camera.h"
 
 
@@ -20,38 +22,112 @@ struct UniformBufferObject
 	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 proj;
+	// maps the quantized texture coordinates to [0, 1]; xy is the scale and
+	// zw the offset
+	alignas(16) glm::vec4 texCoordTransform;
 };
 
+// the region of the uniform ring every frame in flight pushes its uniform
+// blocks into by default, 4096 blocks of up to 256 bytes
+constexpr VkDeviceSize DEFAULT_UNIFORM_RING_FRAME_SIZE = 1024 * 1024;
+
 
 class UniformBuffer
 {
 public:
+	// `feedbackBuffers` are the sampling feedback buffers of the frames, for
+	// pipelines that write it (see `MipStreamer`), or the feedback buffers of
+	// the virtual texture
+	// with a bindless pipeline, `textures` are registered into the first
+	// slots of the texture array of every frame, in order
 	UniformBuffer(const int maxFramesInFlight,
 		const Device* device,
 		const Pipeline* graphicsPipeline,
-		const Texture* texture);
+		const std::vector<const Texture*>& textures,
+		const VertexQuantization& quantization = VertexQuantization{},
+		const std::vector<VkBuffer>& feedbackBuffers = {},
+		VkDeviceSize ringFrameSize = DEFAULT_UNIFORM_RING_FRAME_SIZE);
 	~UniformBuffer();
 
+	// starts the frame over in the uniform ring and takes the camera the
+	// draws of the frame are seen from; the fence of the previous submission
+	// of the frame must have signaled, and the command buffer is recorded
+	// after
 	void Update(uint32_t currentFrameIdx, const Camera* camera);
+	// pushes the uniform block of a draw with its own model matrix (in model
+	// space, the quantized positions are decoded here) and the camera of the
+	// frame; returns the dynamic offset to bind the frame set with
+	uint32_t PushDraw(const glm::mat4& model);
+	// copies a uniform block into the region of the current frame of the
+	// uniform ring and returns the dynamic offset to bind the frame set with;
+	// throws when the region is full
+	uint32_t Push(const UniformBufferObject& ubo);
+	// points the descriptor sets of the frame at the textures, the ones that
+	// were replaced since; the frame must not be in flight
+	void UpdateTextures(uint32_t frameIdx, const std::vector<const Texture*>& textures);
+	// adds a texture to the next free slot of the texture array of every
+	// frame, which draws pass as their texture index, even while frames are
+	// in flight; only with a bindless pipeline, throws when it is full
+	uint32_t RegisterTexture(const Texture* texture);
+	// points the set of every frame at the tile cache and the page table of
+	// the texture; only with a virtual texture pipeline, before the first
+	// frame
+	void WriteVirtualTexture(const VirtualTexture& texture);
+
+	// every frame has a set of its uniform ring and feedback buffer
+	// (`FRAME_DESCRIPTOR_SET`), and a texture set (`TEXTURE_DESCRIPTOR_SET`)
+	// per texture, which only differ by the texture they sample; with a
+	// bindless or a virtual texture pipeline a frame has a single texture
+	// set, which `setIdx` 0 is
+	inline VkDescriptorSet GetFrameSet(const uint32_t frameIdx) const { return m_FrameSets[frameIdx]; }
+	inline VkDescriptorSet GetTextureSet(const uint32_t frameIdx, const uint32_t setIdx) const
+	{
+		return m_TextureSets[frameIdx * m_SetsPerFrame + setIdx];
+	}
+	inline const FrameRingAllocator& GetRing() const { return m_Ring; }
+	inline bool IsBindless() const { return m_GraphicsPipeline->IsBindless(); }
+	inline bool IsVirtualTexture() const { return m_GraphicsPipeline->IsVirtualTexture(); }
+	inline uint32_t GetTextureCount() const { return static_cast<uint32_t>(m_Textures.size()); }
 
-	inline VkDescriptorSet& GetDescriptorSetAtIndex(const uint32_t index) { return m_DescriptorSets[index]; }
-	inline VkDescriptorSet GetDescriptorSetAtIndex(const uint32_t index) const { return m_DescriptorSets[index]; }
+	// also needed on the cpu to cull the model
+	inline glm::mat4 GetModelMatrix() const { return m_ModelMatrix; }
 
 private:
-	void CreateUniformBuffers();
-	void CreateDescriptorPool();
+	void CreateUniformRing();
+	void CreateDescriptorPools();
 	void CreateDescriptorSets();
+	// the set of the texture, or its slot in the set of the frame
+	void WriteTextureDescriptor(uint32_t frameIdx, uint32_t textureIdx, const Texture* texture);
 
 private:
 	const int m_MaxFramesInFlight;
 	const Device* m_Device;
 	const Pipeline* m_GraphicsPipeline;
-	const Texture* m_Texture;
+	std::vector<const Texture*> m_Textures;
+	std::vector<VkBuffer> m_FeedbackBuffers;
+
+	// a single buffer for the uniform blocks of every frame, each frame has
+	// a region of it that stays mapped; the descriptor sets bind it with a
+	// dynamic offset
+	FrameRingAllocator m_Ring;
+	VkBuffer m_RingBuffer;
+	DeviceAllocation m_RingMemory;
+	// the part of the blocks of the current frame that every draw shares
+	UniformBufferObject m_FrameBlock;
 
-	std::vector<VkBuffer> m_UniformBuffers;
-	std::vector<VkDeviceMemory> m_UniformBuffersMemory;
-	std::vector<void*> m_UniformBuffersMapped;
+	// the texture sets of a bindless pipeline are updated after bind, which
+	// takes a pool of their own
+	VkDescriptorPool m_FramePool;
+	VkDescriptorPool m_TexturePool;
+	std::vector<VkDescriptorSet> m_FrameSets;
+	std::vector<VkDescriptorSet> m_TextureSets;
+	// texture sets
+	uint32_t m_SetsPerFrame;
+	// textures a frame can sample: one per set, or the slots of the array
+	uint32_t m_TextureSlots;
+	// the image view every texture of every frame samples
+	std::vector<VkImageView> m_BoundImageViews;
 
-	VkDescriptorPool m_DescriptorPool;
-	std::vector<VkDescriptorSet> m_DescriptorSets;
+	glm::mat4 m_ModelMatrix;
+	VertexQuantization m_Quantization;
 };
\ No newline at end of file
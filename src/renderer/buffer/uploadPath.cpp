@@ -0,0 +1,44 @@
+#include "uploadPath.h"
+
+#include <algorithm>
+
+
+namespace staging {
+
+std::optional<uint32_t> FindDirectWriteMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	uint32_t typeFilter)
+{
+	// the VRAM of discrete GPUs, or all of the memory of integrated ones
+	std::optional<uint32_t> largestHeap;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+	{
+		const VkMemoryHeap& heap = memoryProperties.memoryHeaps[i];
+		if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0
+			&& (!largestHeap || heap.size > memoryProperties.memoryHeaps[*largestHeap].size))
+			largestHeap = i;
+	}
+	if (!largestHeap)
+		return std::nullopt;
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		const VkMemoryType& type = memoryProperties.memoryTypes[i];
+		if ((typeFilter & (1u << i)) != 0 && type.heapIndex == *largestHeap
+			&& (type.propertyFlags & DIRECT_WRITE_MEMORY_PROPERTIES) == DIRECT_WRITE_MEMORY_PROPERTIES)
+			return i;
+	}
+
+	return std::nullopt;
+}
+
+void AddUploadStats(BufferUploadStats& total, const BufferUploadStats& stats)
+{
+	total.path = stats.path;
+	total.writtenBytes += stats.writtenBytes;
+	total.copiedBytes += stats.copiedBytes;
+	// every upload frees its staging buffer before the next one
+	total.stagingBytes = std::max(total.stagingBytes, stats.stagingBytes);
+	total.submitCount += stats.submitCount;
+}
+
+} // namespace staging
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <vulkan/vulkan.h>
+
+
+// device local memory the CPU writes into without a flush, which buffers are
+// created in when they are written directly
+constexpr VkMemoryPropertyFlags DIRECT_WRITE_MEMORY_PROPERTIES =
+	VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+enum class UploadPath
+{
+	// decoded into a host visible staging buffer and copied on the GPU
+	STAGED,
+	// decoded straight into the mapped buffer, without staging or a copy
+	DIRECT
+};
+
+// the bytes an upload moved and what it took to move them
+struct BufferUploadStats
+{
+	UploadPath path;
+	// decoded by the CPU, into the staging buffer or the buffer itself
+	uint64_t writtenBytes;
+	// copied by the GPU from the staging buffer into the buffer
+	uint64_t copiedBytes;
+	// host visible memory allocated for the upload, besides the buffer
+	uint64_t stagingBytes;
+	// copies submitted and waited for
+	uint32_t submitCount;
+};
+
+
+namespace staging {
+
+// the memory type of `typeFilter` with `DIRECT_WRITE_MEMORY_PROPERTIES` in
+// the largest device local heap: any device local memory of integrated GPUs
+// and lavapipe, or the VRAM of discrete GPUs with resizable BAR; not the
+// 256 MB window of the ones without it, which is too small to hold the
+// geometry of a scene
+std::optional<uint32_t> FindDirectWriteMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties,
+	uint32_t typeFilter = ~0u);
+
+// adds the stats of one more upload into the same buffer, eg: of every
+// piece of a streamed model
+void AddUploadStats(BufferUploadStats& total, const BufferUploadStats& stats);
+
+} // namespace staging
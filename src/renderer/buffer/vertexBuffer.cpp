@@ -1,77 +1,69 @@
 #include "vertexBuffer.h"
 
 #include <stdexcept>
+#include <cstring>
 
 #include "renderer/swapchain.h"
-#include "utils/bufferUtils.h"
+#include "renderer/buffer/stagingUpload.h"
 
 
 VertexBuffer::VertexBuffer(const Device* device,
 	const CommandBuffer* commandBuffers,
-	const std::vector<Vertex>& vertices)
+	const EncodedStream& vertexData,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+	: m_Device{ device },
+	  m_CommandBuffers{ commandBuffers }
+{
+	CreateVertexBuffer(vertexData, threadPool, maxStagingSize);
+}
+
+VertexBuffer::VertexBuffer(const Device* device, const CommandBuffer* commandBuffers, VkDeviceSize size)
 	: m_Device{ device },
 	  m_CommandBuffers{ commandBuffers },
-	  m_Vertices{ vertices }
+	  m_UploadStats{}
 {
-	CreateVertexBuffer();
+	m_UploadStats.path = staging::CreateEmptyDeviceBuffer(
+		m_Device, size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VertexBuffer, m_BufferMemory);
 }
 
 VertexBuffer::~VertexBuffer()
 {
 	vkDestroyBuffer(m_Device->GetDevice(), m_VertexBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_BufferMemory, nullptr);
+	m_Device->GetAllocator().Free(m_BufferMemory);
 }
 
-void VertexBuffer::CreateVertexBuffer()
+void VertexBuffer::CreateVertexBuffer(const EncodedStream& vertexData,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
 {
-	VkDeviceSize bufferSize = sizeof(m_Vertices[0]) * m_Vertices.size();
-
-	// we create one buffer accessible by the CPU and another one in the
-	// device's local memory
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	utils::buff::CreateBuffer(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // source memory during transfer
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory); // staging buffer (in the CPU accessible memory);
-							  // temporary buffer
-
-	// copy the vertex data to the buffer
-	void* data;
-	vkMapMemory(m_Device->GetDevice(),
-		stagingBufferMemory,
-		0,
-		bufferSize,
-		0,
-		&data); // mapping the buffer memory into CPU accessible memory
-	memcpy(data, m_Vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMemory);
-
-	utils::buff::CreateBuffer(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, // destination memory during
-																			  // transfer
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	// the vertex data is decoded into a staging buffer (in the CPU
+	// accessible memory) and copied into the buffer (in the device's local
+	// memory) piece by piece, or straight into the buffer when the device
+	// local memory is CPU accessible too
+	m_UploadStats = staging::CreateDeviceBuffer(m_Device,
+		m_CommandBuffers,
+		vertexData,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		m_VertexBuffer,
-		m_BufferMemory); // the actual buffer (in the device's local memory)
-
-	utils::buff::CopyBuffer(m_Device->GetDevice(),
-		m_Device->GetGraphicsQueue(),
-		m_CommandBuffers->GetCommandPool(),
-		stagingBuffer,
-		m_VertexBuffer,
-		bufferSize);
-
-	vkDestroyBuffer(m_Device->GetDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), stagingBufferMemory, nullptr);
+		m_BufferMemory,
+		threadPool,
+		maxStagingSize);
+}
 
-	// the driver may not immediately copy the data into the buffer memory
-	// so the writes to the buffer may not be visible yet
-	// this is why we set VK_MEMORY_PROPERTY_HOST_COHERENT_BIT in the memory
-	// type so that the mapped memory always matches the contents of the
-	// allocated memory
-}
\ No newline at end of file
+void VertexBuffer::Write(VkDeviceSize offset,
+	const EncodedStream& vertexData,
+	ThreadPool& threadPool,
+	VkDeviceSize maxStagingSize)
+{
+	staging::AddUploadStats(m_UploadStats,
+		staging::WriteDeviceBuffer(m_Device,
+			m_CommandBuffers,
+			vertexData,
+			m_UploadStats.path,
+			m_VertexBuffer,
+			m_BufferMemory,
+			offset,
+			threadPool,
+			maxStagingSize));
+}
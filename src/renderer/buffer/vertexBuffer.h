@@ -1,100 +1,143 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <vector>
-#include <functional>
 
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+#include "core/codec.h"
+#include "core/threadPool.h"
 #include "renderer/device.h"
 #include "renderer/buffer/commandBuffer.h"
+#include "renderer/buffer/stagingUpload.h"
+
+
+// how the vertices are stored in the vertex buffer (and in cooked meshes)
+// the quantized layouts are relative to the bounds of the mesh, see
+// `VertexQuantization`
+enum class VertexLayout : uint32_t
+{
+	FLOAT32 = 0, // same as `Vertex`, 20 bytes
+	FLOAT16 = 1, // float16 position relative to the center, unorm16 uv; 12 bytes
+	SNORM16 = 2, // snorm16 position normalized to the bounds, unorm16 uv; 12 bytes
+};
 
+// maps the values fetched by the vertex shader back to model space; a
+// decoded attribute is `offset + scale * value`
+// for positions this is folded into the model matrix, so the shader and the
+// cpu side work in the same model space whatever the layout
+struct VertexQuantization
+{
+	glm::vec3 positionOffset{ 0.0f };
+	glm::vec3 positionScale{ 1.0f };
+	glm::vec2 texCoordOffset{ 0.0f };
+	glm::vec2 texCoordScale{ 1.0f };
+};
 
+// full precision vertex used while loading and processing a mesh; it is
+// converted to the `VertexLayout` of the mesh before uploading
 struct Vertex
 {
 	glm::vec3 pos;
-	glm::vec3 color;
 	glm::vec2 texCoord;
 
-	static VkVertexInputBindingDescription GetBindingDescription()
+	static uint32_t GetStride(VertexLayout layout)
+	{
+		return layout == VertexLayout::FLOAT32 ? static_cast<uint32_t>(sizeof(Vertex)) : 12;
+	}
+
+	static VkVertexInputBindingDescription GetBindingDescription(VertexLayout layout = VertexLayout::FLOAT32)
 	{
 		VkVertexInputBindingDescription bindingDescription{};
 		bindingDescription.binding = 0; // specifies the index of the binding in the array of bindings
-		bindingDescription.stride = sizeof(Vertex); // specifies the number of bytes from one entry to the next
+		bindingDescription.stride = GetStride(layout); // specifies the number of bytes from one entry to the next
 		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // move to the next data entry after
 																	// each vertex
 
 		return bindingDescription;
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 3> GetAttributeDescriptions()
+	static std::array<VkVertexInputAttributeDescription, 2> GetAttributeDescriptions(
+		VertexLayout layout = VertexLayout::FLOAT32)
 	{
 		// for position
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+		std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
 		attributeDescriptions[0].binding = 0; // index of the per-vertex data
 		attributeDescriptions[0].location = 0; // references the location directive of the input in the vertex
 											   // shader.
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // type of data; position has 2 floats
-		attributeDescriptions[0].offset = offsetof(Vertex,
-			pos); // number of bytes from the begining of the per-vertex data
-		// for color
+		attributeDescriptions[0].offset = 0; // number of bytes from the begining of the per-vertex data
+		// for texture coordinates
 		attributeDescriptions[1].binding = 0; // index of the per-vertex data
 		attributeDescriptions[1].location = 1; // references the location directive of the input in the vertex
 											   // shader.
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT; // type of data; color has 3 floats
-		attributeDescriptions[1].offset = offsetof(Vertex,
-			color); // number of bytes from the begining of the per-vertex data
-		// for texture coordinates
-		attributeDescriptions[2].binding = 0; // index of the per-vertex data
-		attributeDescriptions[2].location = 2; // references the location directive of the input in the vertex
-											   // shader.
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT; // type of data; color has 3 floats
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord); // number of bytes from the begining of
-																	  // the per-vertex data
-		return attributeDescriptions;
-	}
 
-	bool operator==(const Vertex& other) const
-	{
-		return pos == other.pos && color == other.color && texCoord == other.texCoord;
-	}
-};
+		// type of data; the 16 bit positions have a 4th component so that
+		// they only use formats every device supports for vertex input
+		switch (layout)
+		{
+		case VertexLayout::FLOAT32:
+			attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+			attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+			attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+			break;
+		case VertexLayout::FLOAT16:
+			attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+			attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+			attributeDescriptions[1].offset = 8;
+			break;
+		case VertexLayout::SNORM16:
+			attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+			attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+			attributeDescriptions[1].offset = 8;
+			break;
+		}
 
-// hash function
-namespace std {
-template<>
-struct hash<Vertex>
-{
-	size_t operator()(Vertex const& vertex) const
-	{
-		return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1)
-			   ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
+		return attributeDescriptions;
 	}
+
+	bool operator==(const Vertex& other) const { return pos == other.pos && texCoord == other.texCoord; }
 };
-} // namespace std
 
 
 class VertexBuffer
 {
 public:
-	VertexBuffer(const Device* device, const CommandBuffer* commandBuffers, const std::vector<Vertex>& vertices);
+	// `vertexData` is only read while uploading, so it can point directly into
+	// a mapped file and be released once the constructor returns; it is
+	// decoded on `threadPool` straight into a staging buffer of at most
+	// `maxStagingSize` bytes, or into the buffer itself on devices with direct
+	// uploads
+	VertexBuffer(const Device* device,
+		const CommandBuffer* commandBuffers,
+		const EncodedStream& vertexData,
+		ThreadPool& threadPool,
+		VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+	// an empty buffer of `size` bytes, filled piece by piece with `Write`,
+	// eg: by a streamed model
+	VertexBuffer(const Device* device, const CommandBuffer* commandBuffers, VkDeviceSize size);
 	~VertexBuffer();
 
+	// decodes `vertexData` into the buffer from `offset` (in bytes), like the
+	// upload of the first constructor
+	void Write(VkDeviceSize offset,
+		const EncodedStream& vertexData,
+		ThreadPool& threadPool,
+		VkDeviceSize maxStagingSize = DEFAULT_MAX_STAGING_SIZE);
+
 	inline VkBuffer GetVertexBuffer() const { return m_VertexBuffer; }
+	// of the upload in the constructor, or of every `Write` so far
+	inline const BufferUploadStats& GetUploadStats() const { return m_UploadStats; }
 
 private:
-	void CreateVertexBuffer();
+	void CreateVertexBuffer(const EncodedStream& vertexData, ThreadPool& threadPool, VkDeviceSize maxStagingSize);
 
 private:
 	const Device* m_Device;
 	const CommandBuffer* m_CommandBuffers;
 
-	std::vector<Vertex> m_Vertices;
-
 	VkBuffer m_VertexBuffer;
-	VkDeviceMemory m_BufferMemory;
+	DeviceAllocation m_BufferMemory;
+	BufferUploadStats m_UploadStats;
 };
\ No newline at end of file
@@ -16,6 +16,8 @@ public:
 
 	inline glm::mat4 GetViewMatrix() const { return m_ViewMatrix; }
 	inline glm::mat4 GetProjectionMatrix() const { return m_ProjectionMatrix; }
+	inline glm::vec3 GetPosition() const { return m_CameraPos; }
+	inline float GetFOVy() const { return m_FOVy; } // in radians
 
 	void Orbit(GLFWwindow* window, double xpos, double ypos);
 
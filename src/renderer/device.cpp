@@ -1,24 +1,39 @@
 #include "device.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <set>
 
+#include "renderer/buffer/uploadPath.h"
 #include "utils/utils.h"
 
 
+// slots of the bindless texture array at most, which the descriptor pools
+// are sized by; enough for the textures of a whole scene
+constexpr uint32_t g_MaxBindlessTextures = 4096;
+
+
 Device::Device()
 	: m_VulkanInstance{ nullptr },
 	  m_WindowSurface{ nullptr },
 	  m_Config{ nullptr },
 	  m_PhysicalDevice{ VK_NULL_HANDLE },
-	  m_MsaaSamples{ VK_SAMPLE_COUNT_1_BIT }
+	  m_MsaaSamples{ VK_SAMPLE_COUNT_1_BIT },
+	  m_SupportsTextureCompressionBC{ false },
+	  m_SupportsSamplingFeedback{ false },
+	  m_MaxBindlessTextures{ 0 },
+	  m_DirectUploadMemoryType{ std::nullopt }
 {}
 
 Device::Device(VkInstance vulkanInstance, VkSurfaceKHR windowSurface, const VulkanConfig* config)
 	: m_VulkanInstance{ vulkanInstance },
 	  m_WindowSurface{ windowSurface },
-	  m_Config{ config }
+	  m_Config{ config },
+	  m_SupportsTextureCompressionBC{ false },
+	  m_SupportsSamplingFeedback{ false },
+	  m_MaxBindlessTextures{ 0 },
+	  m_DirectUploadMemoryType{ std::nullopt }
 {
 	PickPhysicalDevice();
 	CreateLogicalDevice();
@@ -26,6 +41,7 @@ Device::Device(VkInstance vulkanInstance, VkSurfaceKHR windowSurface, const Vulk
 
 Device::~Device()
 {
+	m_Allocator.reset();
 	vkDestroyDevice(m_DeviceVk, nullptr);
 }
 
@@ -55,12 +71,17 @@ void Device::PickPhysicalDevice()
 	if (m_PhysicalDevice == VK_NULL_HANDLE)
 		throw std::runtime_error("Failed to find a suitable GPU!");
 
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+	m_DirectUploadMemoryType = staging::FindDirectWriteMemoryType(memoryProperties);
+
 	// we dont need to write this
 	VkPhysicalDeviceProperties physicalDeviceProperties;
 	vkGetPhysicalDeviceProperties(m_PhysicalDevice, &physicalDeviceProperties);
 
 	std::cout << "Physical device info:\n"
-			  << "    Device name: " << physicalDeviceProperties.deviceName << "\n\n";
+			  << "    Device name: " << physicalDeviceProperties.deviceName << "\n"
+			  << "    Buffer uploads: " << (SupportsDirectUploads() ? "direct" : "staged") << "\n\n";
 }
 
 void Device::CreateLogicalDevice()
@@ -88,9 +109,26 @@ void Device::CreateLogicalDevice()
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading
 
+	// optional, most desktop GPUs have it but mobile ones do not
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+	m_SupportsTextureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	m_SupportsSamplingFeedback = supportedFeatures.fragmentStoresAndAtomics == VK_TRUE;
+	deviceFeatures.fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;
+
+	// the texture array is indexed by a push constant, which is dynamically
+	// uniform; the descriptor indexing features are chained to the device
+	VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	if (supportedFeatures.shaderSampledImageArrayDynamicIndexing == VK_TRUE)
+		m_MaxBindlessTextures = GetBindlessTextureLimit(indexingFeatures);
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
 	// create logical device
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = m_MaxBindlessTextures > 0 ? &indexingFeatures : nullptr;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
@@ -116,6 +154,8 @@ void Device::CreateLogicalDevice()
 	// get the queue handle
 	vkGetDeviceQueue(m_DeviceVk, indices.graphicsFamily.value(), 0, &m_GraphicsQueue);
 	vkGetDeviceQueue(m_DeviceVk, indices.presentFamily.value(), 0, &m_PresentQueue);
+
+	m_Allocator = std::make_unique<DeviceAllocator>(m_DeviceVk, m_PhysicalDevice);
 }
 
 bool Device::IsDeviceSuitable(VkPhysicalDevice physicalDevice)
@@ -155,6 +195,50 @@ bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
 	return requiredExtensions.empty();
 }
 
+uint32_t Device::GetBindlessTextureLimit(VkPhysicalDeviceDescriptorIndexingFeatures& indexingFeatures)
+{
+	// descriptor indexing is core since Vulkan 1.2, and its features are
+	// queried through the entry points of 1.1
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(m_PhysicalDevice, &physicalDeviceProperties);
+	if (physicalDeviceProperties.apiVersion < VK_API_VERSION_1_2)
+		return 0;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{};
+	supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedFeatures{};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supportedIndexing;
+	vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &supportedFeatures);
+
+	// a runtime sized array with slots that are never written, and slots
+	// that are written while the frames in flight sample the others
+	if (supportedIndexing.runtimeDescriptorArray != VK_TRUE
+		|| supportedIndexing.descriptorBindingPartiallyBound != VK_TRUE
+		|| supportedIndexing.descriptorBindingSampledImageUpdateAfterBind != VK_TRUE
+		|| supportedIndexing.descriptorBindingUpdateUnusedWhilePending != VK_TRUE)
+		return 0;
+
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties{};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &properties);
+
+	// a combined image sampler counts as a sampler and as a sampled image
+	return std::min({ g_MaxBindlessTextures,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers });
+}
+
 VkSampleCountFlagBits Device::GetMaxUsableSampleCount()
 {
 	VkPhysicalDeviceProperties physicalDeviceProperties;
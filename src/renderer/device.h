@@ -1,9 +1,11 @@
 #pragma once
 
+#include <memory>
 #include <optional>
 
 #include "vulkanContext.h"
 #include "core/vulkanConfig.h"
+#include "renderer/memory/deviceAllocator.h"
 
 
 class Device
@@ -18,8 +20,28 @@ public:
 
 	inline VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
 	inline VkQueue GetPresentQueue() const { return m_GraphicsQueue; }
+	// the memory of every buffer and image is sub-allocated from it
+	inline DeviceAllocator& GetAllocator() const { return *m_Allocator; }
 
 	inline VkSampleCountFlagBits GetMSAASamplesCount() const { return m_MsaaSamples; }
+	// BC1-7 sampled images; textures fall back to uncompressed RGBA without it
+	inline bool SupportsTextureCompressionBC() const { return m_SupportsTextureCompressionBC; }
+	// fragment shaders writing storage buffers, which the mip streaming
+	// feedback needs; textures are not streamed without it
+	inline bool SupportsSamplingFeedback() const { return m_SupportsSamplingFeedback; }
+	// partially bound, update after bind arrays of sampled images (descriptor
+	// indexing, Vulkan 1.2), that draws index with a push constant; the
+	// textures are bound one descriptor set per texture without it
+	inline bool SupportsBindlessTextures() const { return m_MaxBindlessTextures > 0; }
+	// slots of the texture array, 0 without bindless textures
+	inline uint32_t GetMaxBindlessTextures() const { return m_MaxBindlessTextures; }
+	// device local memory the CPU can write, that buffers are written into
+	// directly instead of through a staging buffer and a copy, see
+	// `staging::FindDirectWriteMemoryType`
+	inline bool SupportsDirectUploads() const { return m_DirectUploadMemoryType.has_value(); }
+	// the memory type those buffers are allocated from, only with direct
+	// uploads
+	inline uint32_t GetDirectUploadMemoryType() const { return *m_DirectUploadMemoryType; }
 
 private:
 	void PickPhysicalDevice();
@@ -29,6 +51,9 @@ private:
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice);
 
 	VkSampleCountFlagBits GetMaxUsableSampleCount();
+	// the slots of the texture array the device allows, 0 when it lacks a
+	// feature of `indexingFeatures`, which is filled with the ones to enable
+	uint32_t GetBindlessTextureLimit(VkPhysicalDeviceDescriptorIndexingFeatures& indexingFeatures);
 
 private:
 	VkInstance m_VulkanInstance;
@@ -41,5 +66,11 @@ private:
 	VkQueue m_GraphicsQueue;
 	VkQueue m_PresentQueue;
 
+	std::unique_ptr<DeviceAllocator> m_Allocator;
+
 	VkSampleCountFlagBits m_MsaaSamples;
+	bool m_SupportsTextureCompressionBC;
+	bool m_SupportsSamplingFeedback;
+	uint32_t m_MaxBindlessTextures;
+	std::optional<uint32_t> m_DirectUploadMemoryType;
 };
\ No newline at end of file
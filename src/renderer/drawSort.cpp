@@ -0,0 +1,36 @@
+#include "drawSort.h"
+
+#include <algorithm>
+#include <tuple>
+
+
+namespace draw {
+
+void SortDrawItems(std::vector<DrawItem>& items)
+{
+	// the lists are built once per model, a comparison sort is fast enough
+	std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+		return std::tie(a.state.pipeline, a.state.descriptorSet, a.state.vertexBuffer, a.state.material, a.item)
+			   < std::tie(b.state.pipeline, b.state.descriptorSet, b.state.vertexBuffer, b.state.material, b.item);
+	});
+}
+
+DrawBindStats CountBinds(const std::vector<DrawItem>& items)
+{
+	DrawBindStats stats{};
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		const DrawState& state = items[i].state;
+		const bool pipelineChanged = i == 0 || state.pipeline != items[i - 1].state.pipeline;
+
+		stats.pipelineBinds += pipelineChanged ? 1 : 0;
+		stats.descriptorSetBinds += pipelineChanged || state.descriptorSet != items[i - 1].state.descriptorSet ? 1 : 0;
+		stats.vertexBufferBinds += i == 0 || state.vertexBuffer != items[i - 1].state.vertexBuffer ? 1 : 0;
+		stats.materialPushes += pipelineChanged || state.material != items[i - 1].state.material ? 1 : 0;
+		++stats.draws;
+	}
+
+	return stats;
+}
+
+} // namespace draw
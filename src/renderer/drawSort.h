@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// the state a draw needs bound, from the most to the least expensive to
+// change; the values are indices into the pipelines, descriptor sets and
+// vertex buffers of the renderer, and the texture index a bindless pipeline
+// takes as a push constant (0 otherwise)
+struct DrawState
+{
+	uint32_t pipeline;
+	uint32_t descriptorSet;
+	uint32_t vertexBuffer;
+	uint32_t material;
+};
+
+// a draw of `item` (eg: a submesh) with the state it needs
+struct DrawItem
+{
+	DrawState state;
+	uint32_t item;
+};
+
+// how many times the state changes while submitting a list of draws
+struct DrawBindStats
+{
+	uint32_t pipelineBinds;
+	uint32_t descriptorSetBinds;
+	uint32_t vertexBufferBinds;
+	uint32_t materialPushes;
+	uint32_t draws;
+};
+
+
+namespace draw {
+
+// sorts by pipeline, then descriptor set, then vertex buffer, then material,
+// so that every state is bound once per group of draws instead of once per
+// draw; draws with the same state keep the order of their items
+void SortDrawItems(std::vector<DrawItem>& items);
+
+// the binds needed to submit the draws in their current order; a pipeline
+// bind also rebinds the descriptor set and pushes the material, as the
+// layouts may differ
+DrawBindStats CountBinds(const std::vector<DrawItem>& items);
+
+} // namespace draw
@@ -0,0 +1,320 @@
+#include "deviceAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+DeviceAllocator::DeviceAllocator(VkDevice device,
+	VkPhysicalDevice physicalDevice,
+	const DeviceAllocatorOptions& options)
+	: m_Device{ device },
+	  m_Options{ options },
+	  m_DedicatedCount{ 0 },
+	  m_DedicatedBytes{ 0 }
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+	VkPhysicalDeviceProperties physicalDeviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &physicalDeviceProperties);
+	m_BufferImageGranularity = physicalDeviceProperties.limits.bufferImageGranularity;
+	m_SupportsDedicatedQueries = physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_1;
+
+	m_Pools.resize(static_cast<size_t>(m_MemoryProperties.memoryTypeCount) * 2);
+}
+
+DeviceAllocator::~DeviceAllocator()
+{
+	// the memory is unmapped as it is freed
+	for (MemoryPool& pool : m_Pools)
+	{
+		for (MemoryBlock& block : pool.blocks)
+		{
+			if (block.memory != VK_NULL_HANDLE)
+				vkFreeMemory(m_Device, block.memory, nullptr);
+		}
+	}
+}
+
+DeviceAllocation DeviceAllocator::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	bool dedicated = false;
+	const VkMemoryRequirements requirements = GetBufferRequirements(buffer, dedicated);
+	return BindBuffer(buffer, requirements, FindMemoryType(requirements.memoryTypeBits, properties), dedicated);
+}
+
+DeviceAllocation DeviceAllocator::AllocateBufferInType(VkBuffer buffer, uint32_t memoryType)
+{
+	bool dedicated = false;
+	const VkMemoryRequirements requirements = GetBufferRequirements(buffer, dedicated);
+	if (memoryType >= m_MemoryProperties.memoryTypeCount || (requirements.memoryTypeBits & (1u << memoryType)) == 0)
+		throw std::runtime_error("The buffer cannot be in memory type " + std::to_string(memoryType) + "!");
+
+	return BindBuffer(buffer, requirements, memoryType, dedicated);
+}
+
+DeviceAllocation DeviceAllocator::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, ResourceTiling tiling)
+{
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.image = image;
+
+	VkMemoryRequirements requirements;
+	bool dedicated = false;
+	if (m_SupportsDedicatedQueries)
+	{
+		VkImageMemoryRequirementsInfo2 requirementsInfo{};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.image = image;
+		VkMemoryDedicatedRequirements dedicatedRequirements{};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+		VkMemoryRequirements2 requirements2{};
+		requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements2.pNext = &dedicatedRequirements;
+		vkGetImageMemoryRequirements2(m_Device, &requirementsInfo, &requirements2);
+
+		requirements = requirements2.memoryRequirements;
+		dedicated = dedicatedRequirements.prefersDedicatedAllocation == VK_TRUE
+					|| dedicatedRequirements.requiresDedicatedAllocation == VK_TRUE;
+	}
+	else
+	{
+		vkGetImageMemoryRequirements(m_Device, image, &requirements);
+	}
+
+	DeviceAllocation allocation = Allocate(requirements,
+		FindMemoryType(requirements.memoryTypeBits, properties),
+		tiling,
+		dedicated ? &dedicatedInfo : nullptr);
+	vkBindImageMemory(m_Device, image, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+void DeviceAllocator::Free(DeviceAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	if (allocation.block == DEDICATED_ALLOCATION)
+	{
+		vkFreeMemory(m_Device, allocation.memory, nullptr);
+		--m_DedicatedCount;
+		m_DedicatedBytes -= allocation.size;
+		allocation = DeviceAllocation{};
+		return;
+	}
+
+	MemoryPool& pool = m_Pools[allocation.pool];
+	MemoryBlock& block = pool.blocks[allocation.block];
+	block.allocator->Free(allocation.handle);
+
+	// an empty block is given back unless it is the last one of the pool,
+	// so that a resource created and destroyed over and over does not
+	// allocate device memory every time
+	if (block.allocator->IsEmpty())
+	{
+		const auto usedBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const MemoryBlock& other) {
+			return other.memory != VK_NULL_HANDLE;
+		});
+		if (usedBlocks > 1)
+		{
+			vkFreeMemory(m_Device, block.memory, nullptr);
+			block = MemoryBlock{};
+		}
+	}
+
+	allocation = DeviceAllocation{};
+}
+
+DeviceAllocatorStats DeviceAllocator::GetStats() const
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	DeviceAllocatorStats stats{};
+	stats.dedicatedCount = m_DedicatedCount;
+	stats.dedicatedBytes = m_DedicatedBytes;
+	for (const MemoryPool& pool : m_Pools)
+	{
+		for (const MemoryBlock& block : pool.blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+
+			const TlsfStats blockStats = block.allocator->GetStats();
+			++stats.blockCount;
+			stats.allocationCount += blockStats.allocationCount;
+			stats.blockBytes += blockStats.size;
+			stats.usedBytes += blockStats.usedBytes;
+			stats.freeRangeCount += blockStats.freeBlockCount;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeBlock);
+		}
+	}
+	stats.memoryObjectCount = stats.blockCount + stats.dedicatedCount;
+
+	return stats;
+}
+
+VkMemoryRequirements DeviceAllocator::GetBufferRequirements(VkBuffer buffer, bool& dedicated) const
+{
+	VkMemoryRequirements requirements;
+	dedicated = false;
+	if (m_SupportsDedicatedQueries)
+	{
+		VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.buffer = buffer;
+		VkMemoryDedicatedRequirements dedicatedRequirements{};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+		VkMemoryRequirements2 requirements2{};
+		requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements2.pNext = &dedicatedRequirements;
+		vkGetBufferMemoryRequirements2(m_Device, &requirementsInfo, &requirements2);
+
+		requirements = requirements2.memoryRequirements;
+		dedicated = dedicatedRequirements.prefersDedicatedAllocation == VK_TRUE
+					|| dedicatedRequirements.requiresDedicatedAllocation == VK_TRUE;
+	}
+	else
+	{
+		vkGetBufferMemoryRequirements(m_Device, buffer, &requirements);
+	}
+
+	return requirements;
+}
+
+DeviceAllocation DeviceAllocator::BindBuffer(VkBuffer buffer,
+	const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	bool dedicated)
+{
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = buffer;
+
+	DeviceAllocation allocation =
+		Allocate(requirements, memoryType, ResourceTiling::LINEAR, dedicated ? &dedicatedInfo : nullptr);
+	vkBindBufferMemory(m_Device, buffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+DeviceAllocation DeviceAllocator::Allocate(const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	ResourceTiling tiling,
+	const VkMemoryDedicatedAllocateInfo* dedicated)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	const VkDeviceSize blockSize = GetBlockSize(memoryType);
+
+	if (dedicated != nullptr || requirements.size > m_Options.dedicatedThreshold || requirements.size > blockSize)
+		return AllocateDedicated(requirements, memoryType, dedicated);
+
+	DeviceAllocation allocation{};
+
+	// without a granularity, buffers and images may be neighbours and share
+	// the blocks
+	const bool separateTilings = m_BufferImageGranularity > 1 && tiling == ResourceTiling::OPTIMAL;
+	allocation.pool = memoryType * 2 + (separateTilings ? 1 : 0);
+	allocation.size = requirements.size;
+	MemoryPool& pool = m_Pools[allocation.pool];
+
+	for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+	{
+		MemoryBlock& block = pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE)
+			continue;
+
+		allocation.handle = block.allocator->Allocate(requirements.size, requirements.alignment, allocation.offset);
+		if (allocation.handle != NO_TLSF_BLOCK)
+		{
+			allocation.memory = block.memory;
+			allocation.mapped = block.mapped != nullptr ? block.mapped + allocation.offset : nullptr;
+			allocation.block = i;
+			return allocation;
+		}
+	}
+
+	// the free lists round the sizes up, so a request just under the block
+	// size may not fit even an empty block; tried before the block has any
+	// memory, which is then not worth allocating
+	auto allocator = std::make_unique<TlsfAllocator>(blockSize);
+	allocation.handle = allocator->Allocate(requirements.size, requirements.alignment, allocation.offset);
+	if (allocation.handle == NO_TLSF_BLOCK)
+		return AllocateDedicated(requirements, memoryType, nullptr);
+
+	// a new block, in the slot of a freed one if there is any
+	auto slot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const MemoryBlock& block) {
+		return block.memory == VK_NULL_HANDLE;
+	});
+	if (slot == pool.blocks.end())
+		slot = pool.blocks.insert(pool.blocks.end(), MemoryBlock{});
+
+	slot->memory = AllocateMemory(blockSize, memoryType, nullptr, slot->mapped);
+	slot->allocator = std::move(allocator);
+	allocation.memory = slot->memory;
+	allocation.mapped = slot->mapped != nullptr ? slot->mapped + allocation.offset : nullptr;
+	allocation.block = static_cast<uint32_t>(slot - pool.blocks.begin());
+	return allocation;
+}
+
+DeviceAllocation DeviceAllocator::AllocateDedicated(const VkMemoryRequirements& requirements,
+	uint32_t memoryType,
+	const VkMemoryDedicatedAllocateInfo* dedicated)
+{
+	DeviceAllocation allocation{};
+	allocation.memory = AllocateMemory(requirements.size, memoryType, dedicated, allocation.mapped);
+	allocation.size = requirements.size;
+	++m_DedicatedCount;
+	m_DedicatedBytes += requirements.size;
+	return allocation;
+}
+
+VkDeviceMemory DeviceAllocator::AllocateMemory(VkDeviceSize size,
+	uint32_t memoryType,
+	const void* next,
+	uint8_t*& mapped)
+{
+	VkMemoryAllocateInfo memAllocInfo{};
+	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memAllocInfo.pNext = next;
+	memAllocInfo.allocationSize = size;
+	memAllocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_Device, &memAllocInfo, nullptr, &memory) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate " + std::to_string(size) + " bytes of device memory!");
+
+	// mapped for as long as it lives, the resources in it never map it
+	mapped = nullptr;
+	if ((m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0)
+	{
+		void* data;
+		if (vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+		{
+			vkFreeMemory(m_Device, memory, nullptr);
+			throw std::runtime_error("Failed to map device memory!");
+		}
+		mapped = static_cast<uint8_t*>(data);
+	}
+
+	return memory;
+}
+
+uint32_t DeviceAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1u << i)) != 0
+			&& (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceSize DeviceAllocator::GetBlockSize(uint32_t memoryType) const
+{
+	const VkMemoryHeap& heap = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex];
+	return std::min(m_Options.blockSize, heap.size / 8);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "renderer/memory/tlsfAllocator.h"
+
+
+// device memory the resources are sub-allocated from is allocated in blocks
+// of this size by default
+constexpr VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+// the block of an allocation that has device memory of its own
+constexpr uint32_t DEDICATED_ALLOCATION = ~0u;
+
+struct DeviceAllocatorOptions
+{
+	// of every block; the heaps smaller than 8 blocks get blocks of an eighth
+	// of their size
+	VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE;
+	// resources larger than this get device memory of their own, like the
+	// ones the driver prefers that for (eg: render targets)
+	VkDeviceSize dedicatedThreshold = DEFAULT_MEMORY_BLOCK_SIZE / 2;
+};
+
+// buffers and linear images vs optimally tiled images, which are kept in
+// separate blocks on devices with a `bufferImageGranularity`, so that they
+// never share one of its pages
+enum class ResourceTiling
+{
+	LINEAR,
+	OPTIMAL
+};
+
+struct DeviceAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// of host visible memory, which stays mapped for as long as it is
+	// allocated; null otherwise
+	uint8_t* mapped = nullptr;
+
+	// where it was allocated from
+	uint32_t pool = 0;
+	uint32_t block = DEDICATED_ALLOCATION;
+	uint32_t handle = NO_TLSF_BLOCK;
+};
+
+struct DeviceAllocatorStats
+{
+	// device memory objects, which count against `maxMemoryAllocationCount`
+	uint32_t memoryObjectCount;
+	uint32_t blockCount;
+	uint32_t dedicatedCount;
+	// resources sub-allocated from the blocks
+	uint32_t allocationCount;
+	VkDeviceSize blockBytes;
+	VkDeviceSize usedBytes;
+	VkDeviceSize dedicatedBytes;
+	// the free ranges of the blocks, and the largest of them: the less of the
+	// free bytes it holds, the more fragmented they are
+	uint32_t freeRangeCount;
+	VkDeviceSize largestFreeRange;
+};
+
+
+// sub-allocates the memory of buffers and images from large blocks of device
+// memory per memory type, with a `TlsfAllocator` per block, instead of
+// allocating device memory per resource; blocks of host visible memory are
+// mapped once, when they are allocated
+// the resources are allocated and freed from any thread
+class DeviceAllocator
+{
+public:
+	DeviceAllocator(VkDevice device, VkPhysicalDevice physicalDevice, const DeviceAllocatorOptions& options = {});
+	~DeviceAllocator();
+
+	DeviceAllocator(const DeviceAllocator&) = delete;
+	DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+	// allocates memory with `properties` for the resource and binds it;
+	// throws if the device has no such memory, or it is out of it
+	DeviceAllocation AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+	// from exactly `memoryType` instead (eg: a type picked for its heap);
+	// throws if the buffer cannot be in that type, or it is out of memory
+	DeviceAllocation AllocateBufferInType(VkBuffer buffer, uint32_t memoryType);
+	DeviceAllocation AllocateImage(VkImage image,
+		VkMemoryPropertyFlags properties,
+		ResourceTiling tiling = ResourceTiling::OPTIMAL);
+	// the resource bound to it must be destroyed first; `allocation` is reset
+	void Free(DeviceAllocation& allocation);
+
+	DeviceAllocatorStats GetStats() const;
+
+private:
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint8_t* mapped = nullptr;
+		std::unique_ptr<TlsfAllocator> allocator;
+	};
+
+	// the blocks of a memory type for the resources of a tiling; the blocks
+	// freed once empty leave their slot for the next one
+	struct MemoryPool
+	{
+		std::vector<MemoryBlock> blocks;
+	};
+
+	// of the buffer, and whether the driver prefers memory of its own for it
+	VkMemoryRequirements GetBufferRequirements(VkBuffer buffer, bool& dedicated) const;
+	// allocates the memory of the buffer from `memoryType` and binds it
+	DeviceAllocation BindBuffer(VkBuffer buffer,
+		const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		bool dedicated);
+	// `dedicated` is chained to the allocation of memory of its own, when the
+	// resource needs or prefers that
+	DeviceAllocation Allocate(const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		ResourceTiling tiling,
+		const VkMemoryDedicatedAllocateInfo* dedicated);
+	DeviceAllocation AllocateDedicated(const VkMemoryRequirements& requirements,
+		uint32_t memoryType,
+		const VkMemoryDedicatedAllocateInfo* dedicated);
+	VkDeviceMemory AllocateMemory(VkDeviceSize size, uint32_t memoryType, const void* next, uint8_t*& mapped);
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	VkDeviceSize GetBlockSize(uint32_t memoryType) const;
+
+private:
+	VkDevice m_Device;
+	DeviceAllocatorOptions m_Options;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+	VkDeviceSize m_BufferImageGranularity;
+	// the driver tells which resources it prefers dedicated memory for
+	// (Vulkan 1.1)
+	bool m_SupportsDedicatedQueries;
+
+	// two per memory type, a pool per tiling
+	std::vector<MemoryPool> m_Pools;
+	uint32_t m_DedicatedCount;
+	VkDeviceSize m_DedicatedBytes;
+
+	mutable std::mutex m_Mutex;
+};
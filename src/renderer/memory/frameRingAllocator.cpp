@@ -0,0 +1,63 @@
+#include "frameRingAllocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+FrameRingAllocator::FrameRingAllocator(uint32_t frameCount, uint64_t frameSize, uint64_t alignment)
+	: m_FrameCount{ frameCount },
+	  m_Alignment{ std::max<uint64_t>(alignment, 1) },
+	  m_FrameIdx{ 0 },
+	  m_Head{ 0 },
+	  m_AllocationCount{ 0 },
+	  m_PeakBytes{ 0 },
+	  m_FailedCount{ 0 }
+{
+	if (frameCount == 0 || frameSize == 0)
+		throw std::runtime_error("A frame ring needs at least a frame and a byte to allocate!");
+	if ((m_Alignment & (m_Alignment - 1)) != 0)
+		throw std::runtime_error("The alignment of a frame ring must be a power of two!");
+
+	// every region starts aligned
+	m_FrameSize = AlignUp(frameSize, m_Alignment);
+}
+
+void FrameRingAllocator::BeginFrame(uint32_t frameIdx)
+{
+	if (frameIdx >= m_FrameCount)
+		throw std::runtime_error("The frame is past the regions of the frame ring!");
+
+	m_FrameIdx = frameIdx;
+	m_Head = 0;
+	m_AllocationCount = 0;
+}
+
+uint64_t FrameRingAllocator::Allocate(uint64_t size)
+{
+	const uint64_t offset = AlignUp(m_Head, m_Alignment);
+	if (offset + size > m_FrameSize)
+	{
+		++m_FailedCount;
+		return NO_RING_OFFSET;
+	}
+
+	m_Head = offset + size;
+	++m_AllocationCount;
+	m_PeakBytes = std::max(m_PeakBytes, m_Head);
+	return m_FrameSize * m_FrameIdx + offset;
+}
+
+FrameRingStats FrameRingAllocator::GetStats() const
+{
+	FrameRingStats stats{};
+	stats.allocationCount = m_AllocationCount;
+	stats.usedBytes = m_Head;
+	stats.peakBytes = m_PeakBytes;
+	stats.failedCount = m_FailedCount;
+	return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+// the offset of an allocation that did not fit in the region of the frame
+constexpr uint64_t NO_RING_OFFSET = ~0ull;
+
+struct FrameRingStats
+{
+	// of the current frame
+	uint32_t allocationCount;
+	uint64_t usedBytes;
+	// the most bytes a frame used, and the allocations that did not fit
+	uint64_t peakBytes;
+	uint32_t failedCount;
+};
+
+
+// hands out ranges of a buffer that every frame in flight has a region of:
+// the ranges of a frame are bump allocated from its region, aligned, and are
+// all given back at once when the frame starts over, once the fence of its
+// previous submission signaled; nothing is freed one by one
+// only offsets are handed out, the memory itself is the caller's
+class FrameRingAllocator
+{
+public:
+	// `alignment` is a power of two (eg: `minUniformBufferOffsetAlignment`),
+	// the regions are rounded up to it
+	FrameRingAllocator(uint32_t frameCount, uint64_t frameSize, uint64_t alignment);
+
+	// the frame must not be in flight anymore, its ranges are reused
+	void BeginFrame(uint32_t frameIdx);
+	// `size` bytes in the region of the current frame; returns their offset
+	// from the start of the buffer, or `NO_RING_OFFSET` when the region is full
+	uint64_t Allocate(uint64_t size);
+
+	// of the whole buffer, every region
+	inline uint64_t GetSize() const { return m_FrameSize * m_FrameCount; }
+	inline uint64_t GetFrameSize() const { return m_FrameSize; }
+	inline uint64_t GetAlignment() const { return m_Alignment; }
+	inline uint32_t GetCurrentFrame() const { return m_FrameIdx; }
+	FrameRingStats GetStats() const;
+
+private:
+	uint32_t m_FrameCount;
+	uint64_t m_FrameSize;
+	uint64_t m_Alignment;
+
+	uint32_t m_FrameIdx;
+	// the next offset of the region of the current frame, from its start
+	uint64_t m_Head;
+	uint32_t m_AllocationCount;
+	uint64_t m_PeakBytes;
+	uint32_t m_FailedCount;
+};
@@ -0,0 +1,265 @@
+#include "tlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+
+// the end of a free block smaller than this stays with the allocation it
+// follows instead of becoming a block of its own
+constexpr uint64_t g_MinSplitSize = 16;
+
+static uint32_t FloorLog2(uint64_t value)
+{
+	uint32_t log = 0;
+	for (uint32_t shift = 32; shift > 0; shift /= 2)
+	{
+		if ((value >> shift) != 0)
+		{
+			value >>= shift;
+			log += shift;
+		}
+	}
+	return log;
+}
+
+static uint32_t LowestBit(uint64_t value)
+{
+	return FloorLog2(value & (~value + 1));
+}
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// the list of the free blocks of `size` bytes
+static void GetLevels(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (size < TLSF_SECOND_LEVEL_COUNT)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t log = FloorLog2(size);
+	firstLevel = log - TLSF_SECOND_LEVEL_BITS + 1;
+	secondLevel = static_cast<uint32_t>(size >> (log - TLSF_SECOND_LEVEL_BITS)) ^ TLSF_SECOND_LEVEL_COUNT;
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+	: m_Size{ size },
+	  m_AllocationCount{ 0 },
+	  m_FirstLevelMap{ 0 }
+{
+	if (size == 0)
+		throw std::runtime_error("A TLSF allocator needs at least a byte to allocate!");
+
+	m_SecondLevelMaps.fill(0);
+	m_FreeLists.fill(NO_TLSF_BLOCK);
+
+	// the first block in memory always keeps the first handle, so the blocks
+	// can be walked from it
+	InsertFree(CreateBlock(0, size, NO_TLSF_BLOCK, NO_TLSF_BLOCK));
+}
+
+uint32_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+	size = std::max<uint64_t>(size, 1);
+
+	// the first block of the list is often aligned already, otherwise one
+	// large enough for any padding is
+	uint32_t block = FindFree(size);
+	if (block != NO_TLSF_BLOCK
+		&& AlignUp(m_Blocks[block].offset, alignment) + size > m_Blocks[block].offset + m_Blocks[block].size)
+		block = FindFree(size + alignment - 1);
+	if (block == NO_TLSF_BLOCK)
+		return NO_TLSF_BLOCK;
+
+	RemoveFree(block);
+
+	// the padding in front stays a free block, which keeps the handle so
+	// that the first block in memory never changes
+	const uint64_t padding = AlignUp(m_Blocks[block].offset, alignment) - m_Blocks[block].offset;
+	if (padding > 0)
+	{
+		const uint32_t next = m_Blocks[block].next;
+		const uint32_t allocated =
+			CreateBlock(m_Blocks[block].offset + padding, m_Blocks[block].size - padding, block, next);
+		if (next != NO_TLSF_BLOCK)
+			m_Blocks[next].previous = allocated;
+		m_Blocks[block].next = allocated;
+		m_Blocks[block].size = padding;
+		InsertFree(block);
+		block = allocated;
+	}
+
+	SplitTail(block, size);
+	++m_AllocationCount;
+	offset = m_Blocks[block].offset;
+	return block;
+}
+
+void TlsfAllocator::Free(uint32_t block)
+{
+	assert(block < m_Blocks.size() && !m_Blocks[block].free);
+	--m_AllocationCount;
+
+	// free neighbours are never left next to each other
+	const uint32_t previous = m_Blocks[block].previous;
+	if (previous != NO_TLSF_BLOCK && m_Blocks[previous].free)
+	{
+		RemoveFree(previous);
+		MergeNext(previous);
+		block = previous;
+	}
+
+	const uint32_t next = m_Blocks[block].next;
+	if (next != NO_TLSF_BLOCK && m_Blocks[next].free)
+	{
+		RemoveFree(next);
+		MergeNext(block);
+	}
+
+	InsertFree(block);
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+	TlsfStats stats{};
+	stats.size = m_Size;
+	stats.allocationCount = m_AllocationCount;
+	for (uint32_t block = 0; block != NO_TLSF_BLOCK; block = m_Blocks[block].next)
+	{
+		const Block& current = m_Blocks[block];
+		if (current.free)
+		{
+			stats.freeBytes += current.size;
+			stats.largestFreeBlock = std::max(stats.largestFreeBlock, current.size);
+			++stats.freeBlockCount;
+		}
+		else
+		{
+			stats.usedBytes += current.size;
+		}
+	}
+
+	return stats;
+}
+
+uint32_t TlsfAllocator::CreateBlock(uint64_t offset, uint64_t size, uint32_t previous, uint32_t next)
+{
+	const Block block{ offset, size, previous, next, NO_TLSF_BLOCK, NO_TLSF_BLOCK, false };
+	if (!m_UnusedBlocks.empty())
+	{
+		const uint32_t index = m_UnusedBlocks.back();
+		m_UnusedBlocks.pop_back();
+		m_Blocks[index] = block;
+		return index;
+	}
+
+	m_Blocks.push_back(block);
+	return static_cast<uint32_t>(m_Blocks.size() - 1);
+}
+
+void TlsfAllocator::ReleaseBlock(uint32_t block)
+{
+	m_UnusedBlocks.push_back(block);
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+	uint32_t firstLevel, secondLevel;
+	GetLevels(m_Blocks[block].size, firstLevel, secondLevel);
+	uint32_t& head = m_FreeLists[firstLevel * TLSF_SECOND_LEVEL_COUNT + secondLevel];
+
+	Block& inserted = m_Blocks[block];
+	inserted.free = true;
+	inserted.previousFree = NO_TLSF_BLOCK;
+	inserted.nextFree = head;
+	if (head != NO_TLSF_BLOCK)
+		m_Blocks[head].previousFree = block;
+	head = block;
+
+	m_FirstLevelMap |= 1ull << firstLevel;
+	m_SecondLevelMaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+	uint32_t firstLevel, secondLevel;
+	GetLevels(m_Blocks[block].size, firstLevel, secondLevel);
+	uint32_t& head = m_FreeLists[firstLevel * TLSF_SECOND_LEVEL_COUNT + secondLevel];
+
+	Block& removed = m_Blocks[block];
+	removed.free = false;
+	if (removed.previousFree != NO_TLSF_BLOCK)
+		m_Blocks[removed.previousFree].nextFree = removed.nextFree;
+	if (removed.nextFree != NO_TLSF_BLOCK)
+		m_Blocks[removed.nextFree].previousFree = removed.previousFree;
+	if (head == block)
+		head = removed.nextFree;
+
+	if (head == NO_TLSF_BLOCK)
+	{
+		m_SecondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+		if (m_SecondLevelMaps[firstLevel] == 0)
+			m_FirstLevelMap &= ~(1ull << firstLevel);
+	}
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size) const
+{
+	// rounded up to the next list, every block of which fits
+	if (size >= TLSF_SECOND_LEVEL_COUNT)
+		size += (1ull << (FloorLog2(size) - TLSF_SECOND_LEVEL_BITS)) - 1;
+
+	uint32_t firstLevel, secondLevel;
+	GetLevels(size, firstLevel, secondLevel);
+	if (firstLevel >= TLSF_FIRST_LEVEL_COUNT)
+		return NO_TLSF_BLOCK;
+
+	// a larger list of the same power of two, or the smallest list of a
+	// larger one
+	uint32_t secondLevelMap = m_SecondLevelMaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		const uint64_t firstLevelMap = firstLevel + 1 < 64 ? m_FirstLevelMap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+			return NO_TLSF_BLOCK;
+
+		firstLevel = LowestBit(firstLevelMap);
+		secondLevelMap = m_SecondLevelMaps[firstLevel];
+	}
+
+	return m_FreeLists[firstLevel * TLSF_SECOND_LEVEL_COUNT + LowestBit(secondLevelMap)];
+}
+
+void TlsfAllocator::SplitTail(uint32_t block, uint64_t size)
+{
+	const uint64_t remainder = m_Blocks[block].size - size;
+	if (remainder < g_MinSplitSize)
+		return;
+
+	const uint32_t next = m_Blocks[block].next;
+	const uint32_t tail = CreateBlock(m_Blocks[block].offset + size, remainder, block, next);
+	if (next != NO_TLSF_BLOCK)
+		m_Blocks[next].previous = tail;
+	m_Blocks[block].next = tail;
+	m_Blocks[block].size = size;
+	InsertFree(tail);
+}
+
+void TlsfAllocator::MergeNext(uint32_t block)
+{
+	const uint32_t next = m_Blocks[block].next;
+	const uint32_t afterNext = m_Blocks[next].next;
+	m_Blocks[block].size += m_Blocks[next].size;
+	m_Blocks[block].next = afterNext;
+	if (afterNext != NO_TLSF_BLOCK)
+		m_Blocks[afterNext].previous = block;
+
+	ReleaseBlock(next);
+}
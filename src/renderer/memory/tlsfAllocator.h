@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// the handle of a failed allocation
+constexpr uint32_t NO_TLSF_BLOCK = ~0u;
+// the free lists of every power of two of the sizes are split in as many
+// lists of sizes in between
+constexpr uint32_t TLSF_SECOND_LEVEL_BITS = 5;
+constexpr uint32_t TLSF_SECOND_LEVEL_COUNT = 1u << TLSF_SECOND_LEVEL_BITS;
+// the sizes below `TLSF_SECOND_LEVEL_COUNT` share the first level
+constexpr uint32_t TLSF_FIRST_LEVEL_COUNT = 64 - TLSF_SECOND_LEVEL_BITS + 1;
+
+struct TlsfStats
+{
+	uint64_t size;
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBlock;
+	uint32_t allocationCount;
+	uint32_t freeBlockCount;
+};
+
+
+// sub-allocates the offsets of a range of `size` bytes with a two level
+// segregated fit: the free blocks are kept in lists by the power of two of
+// their size and 32 steps within it, so finding one that fits and freeing
+// one take a constant time however many there are; free neighbours are
+// merged as soon as a block is freed
+// only offsets are handed out, the memory itself is the caller's
+class TlsfAllocator
+{
+public:
+	explicit TlsfAllocator(uint64_t size);
+
+	// `size` bytes at an `offset` that is a multiple of `alignment` (a power
+	// of two); returns the handle to free them with, or `NO_TLSF_BLOCK` when
+	// no free block fits
+	uint32_t Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	void Free(uint32_t block);
+
+	inline uint64_t GetSize() const { return m_Size; }
+	inline bool IsEmpty() const { return m_AllocationCount == 0; }
+	// walks every block, for statistics rather than every frame
+	TlsfStats GetStats() const;
+
+private:
+	// a range of the allocator, free or allocated; the blocks next to each
+	// other in memory are linked in order, the free ones also in their list
+	struct Block
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t previous;
+		uint32_t next;
+		uint32_t previousFree;
+		uint32_t nextFree;
+		bool free;
+	};
+
+	uint32_t CreateBlock(uint64_t offset, uint64_t size, uint32_t previous, uint32_t next);
+	void ReleaseBlock(uint32_t block);
+
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+	// the first free block of a list of blocks of at least `size` bytes
+	uint32_t FindFree(uint64_t size) const;
+
+	// splits the end of the block past `size` into a free block
+	void SplitTail(uint32_t block, uint64_t size);
+	// merges the block with the free block that follows it
+	void MergeNext(uint32_t block);
+
+private:
+	uint64_t m_Size;
+	uint32_t m_AllocationCount;
+
+	std::vector<Block> m_Blocks;
+	std::vector<uint32_t> m_UnusedBlocks;
+
+	// a bit per first level with a free block, and per second level of it
+	uint64_t m_FirstLevelMap;
+	std::array<uint32_t, TLSF_FIRST_LEVEL_COUNT> m_SecondLevelMaps;
+	std::array<uint32_t, TLSF_FIRST_LEVEL_COUNT * TLSF_SECOND_LEVEL_COUNT> m_FreeLists;
+};
@@ -0,0 +1,251 @@
+#include "meshFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+MeshFile::MeshFile(const std::string& path)
+	: m_File{ std::make_unique<MappedFile>(path) },
+	  m_Header{}
+{
+	Validate();
+}
+
+void MeshFile::Validate()
+{
+	if (m_File->GetSize() < sizeof(MeshFileHeader))
+		throw std::runtime_error("Cooked mesh is too small: " + m_File->GetPath());
+
+	memcpy(&m_Header, m_File->GetData(), sizeof(MeshFileHeader));
+
+	if (m_Header.magic != MESH_FILE_MAGIC)
+		throw std::runtime_error("Not a cooked mesh file: " + m_File->GetPath());
+	if (m_Header.version != MESH_FILE_VERSION)
+		throw std::runtime_error("Unsupported cooked mesh version: " + m_File->GetPath());
+
+	const uint64_t attributesEnd =
+		sizeof(MeshFileHeader) + static_cast<uint64_t>(m_Header.attributeCount) * sizeof(MeshFileAttribute);
+	if (attributesEnd > m_File->GetSize())
+		throw std::runtime_error("Cooked mesh is truncated: " + m_File->GetPath());
+
+	const auto attributes = reinterpret_cast<const MeshFileAttribute*>(m_File->GetData() + sizeof(MeshFileHeader));
+	if (!MatchesVertexLayout(m_Header, attributes))
+		throw std::runtime_error("Cooked mesh vertex layout is not supported: " + m_File->GetPath());
+
+	if (m_Header.indexSize != sizeof(uint16_t) && m_Header.indexSize != sizeof(uint32_t))
+		throw std::runtime_error("Unsupported cooked mesh index size: " + m_File->GetPath());
+
+	// the encoded blobs are checked chunk by chunk while decoding them, the
+	// raw ones are uploaded as they are and must have the decoded size
+	const auto isValidEncoding = [](uint32_t encoding, uint64_t encodedSize, uint64_t decodedSize) {
+		if (encoding == static_cast<uint32_t>(StreamEncoding::RAW))
+			return encodedSize == decodedSize;
+		return encoding == static_cast<uint32_t>(StreamEncoding::DELTA)
+			   || encoding == static_cast<uint32_t>(StreamEncoding::INDEX)
+			   || encoding == static_cast<uint32_t>(StreamEncoding::LZ);
+	};
+	const uint64_t vertexSize = m_Header.vertexCount * m_Header.vertexStride;
+	const uint64_t indexSize = m_Header.indexCount * m_Header.indexSize;
+	if (!isValidEncoding(m_Header.vertexEncoding, m_Header.vertexEncodedSize, vertexSize)
+		|| !isValidEncoding(m_Header.indexEncoding, m_Header.indexEncodedSize, indexSize))
+		throw std::runtime_error("Unsupported cooked mesh encoding: " + m_File->GetPath());
+
+	// the blobs are read in place so they must be inside the file and aligned
+	const uint64_t vertexEnd = m_Header.vertexOffset + m_Header.vertexEncodedSize;
+	const uint64_t indexEnd = m_Header.indexOffset + m_Header.indexEncodedSize;
+	const uint64_t submeshEnd = m_Header.submeshOffset + m_Header.submeshCount * sizeof(Submesh);
+	const uint64_t meshletEnd = m_Header.meshletOffset + m_Header.meshletCount * sizeof(Meshlet);
+	const uint64_t lodEnd = m_Header.lodOffset + m_Header.lodCount * sizeof(MeshLod);
+	const uint64_t materialEnd = m_Header.materialOffset + m_Header.materialCount * sizeof(MeshMaterial);
+	if (vertexEnd > m_File->GetSize() || indexEnd > m_File->GetSize() || submeshEnd > m_File->GetSize()
+		|| meshletEnd > m_File->GetSize() || lodEnd > m_File->GetSize() || materialEnd > m_File->GetSize())
+		throw std::runtime_error("Cooked mesh is truncated: " + m_File->GetPath());
+	if (m_Header.vertexOffset % alignof(float) != 0 || m_Header.indexOffset % alignof(uint32_t) != 0
+		|| m_Header.submeshOffset % alignof(Submesh) != 0 || m_Header.meshletOffset % alignof(Meshlet) != 0
+		|| m_Header.lodOffset % alignof(MeshLod) != 0 || m_Header.materialOffset % alignof(MeshMaterial) != 0)
+		throw std::runtime_error("Cooked mesh blobs are misaligned: " + m_File->GetPath());
+
+	// the lods are drawn straight from the index buffer
+	const MeshLod* lods = GetLods();
+	for (uint64_t i = 0; i < m_Header.lodCount; ++i)
+	{
+		if (static_cast<uint64_t>(lods[i].firstIndex) + lods[i].indexCount > m_Header.indexCount)
+			throw std::runtime_error("Cooked mesh lod is out of range: " + m_File->GetPath());
+	}
+
+	// and every submesh is drawn from its vertex range with its lods
+	const Submesh* submeshes = GetSubmeshes();
+	for (uint64_t i = 0; i < m_Header.submeshCount; ++i)
+	{
+		const Submesh& submesh = submeshes[i];
+		if (static_cast<uint64_t>(submesh.firstVertex) + submesh.vertexCount > m_Header.vertexCount
+			|| static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > m_Header.indexCount
+			|| static_cast<uint64_t>(submesh.firstMeshlet) + submesh.meshletCount > m_Header.meshletCount
+			|| static_cast<uint64_t>(submesh.firstLod) + submesh.lodCount > m_Header.lodCount
+			|| submesh.lodCount == 0 || submesh.material >= m_Header.materialCount)
+			throw std::runtime_error("Cooked mesh submesh is out of range: " + m_File->GetPath());
+	}
+
+	// the names and paths are used as c strings
+	const MeshMaterial* materials = GetMaterials();
+	for (uint64_t i = 0; i < m_Header.materialCount; ++i)
+	{
+		if (memchr(materials[i].name, '\0', sizeof(materials[i].name)) == nullptr
+			|| memchr(materials[i].diffuseTexture, '\0', sizeof(materials[i].diffuseTexture)) == nullptr)
+			throw std::runtime_error("Cooked mesh material is not terminated: " + m_File->GetPath());
+	}
+}
+
+bool MeshFile::MatchesVertexLayout(const MeshFileHeader& header, const MeshFileAttribute* attributes)
+{
+	if (header.vertexLayout != static_cast<uint32_t>(VertexLayout::FLOAT32)
+		&& header.vertexLayout != static_cast<uint32_t>(VertexLayout::FLOAT16)
+		&& header.vertexLayout != static_cast<uint32_t>(VertexLayout::SNORM16))
+		return false;
+
+	const VertexLayout layout = static_cast<VertexLayout>(header.vertexLayout);
+	const auto attributeDescriptions = Vertex::GetAttributeDescriptions(layout);
+
+	if (header.vertexStride != Vertex::GetStride(layout) || header.attributeCount != attributeDescriptions.size())
+		return false;
+
+	for (size_t i = 0; i < attributeDescriptions.size(); ++i)
+	{
+		if (attributes[i].location != attributeDescriptions[i].location
+			|| attributes[i].format != static_cast<uint32_t>(attributeDescriptions[i].format)
+			|| attributes[i].offset != attributeDescriptions[i].offset)
+			return false;
+	}
+
+	return true;
+}
+
+bool MeshFile::IsCompatible(const std::string& path, uint32_t flags, VertexLayout layout)
+{
+	std::ifstream file{ path, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	MeshFileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION || header.flags != flags
+		|| header.vertexLayout != static_cast<uint32_t>(layout))
+		return false;
+
+	std::vector<MeshFileAttribute> attributes(header.attributeCount);
+	if (!file.read(reinterpret_cast<char*>(attributes.data()),
+			static_cast<std::streamsize>(attributes.size() * sizeof(MeshFileAttribute))))
+		return false;
+
+	return MatchesVertexLayout(header, attributes.data());
+}
+
+bool MeshFile::Write(const std::string& path, const MeshFileContents& contents)
+{
+	const auto attributeDescriptions = Vertex::GetAttributeDescriptions(contents.vertexLayout);
+
+	MeshFileHeader header{};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertexStride = Vertex::GetStride(contents.vertexLayout);
+	header.attributeCount = static_cast<uint32_t>(attributeDescriptions.size());
+	header.vertexCount = contents.vertexCount;
+	header.indexCount = contents.indexCount;
+	header.indexSize = contents.indexSize;
+	header.flags = contents.flags;
+	header.meshletCount = contents.meshletCount;
+	header.lodCount = contents.lodCount;
+	header.submeshCount = contents.submeshCount;
+	header.materialCount = contents.materialCount;
+	header.vertexLayout = static_cast<uint32_t>(contents.vertexLayout);
+	header.vertexEncoding = static_cast<uint32_t>(contents.vertexData.encoding);
+	header.indexEncoding = static_cast<uint32_t>(contents.indexData.encoding);
+	header.vertexEncodedSize = contents.vertexData.data.size();
+	header.indexEncodedSize = contents.indexData.data.size();
+
+	const uint64_t attributesEnd = sizeof(MeshFileHeader) + attributeDescriptions.size() * sizeof(MeshFileAttribute);
+	const uint64_t vertexSize = header.vertexEncodedSize;
+	const uint64_t indexSize = header.indexEncodedSize;
+	const uint64_t submeshSize = contents.submeshCount * sizeof(Submesh);
+	const uint64_t meshletSize = contents.meshletCount * sizeof(Meshlet);
+	const uint64_t lodSize = contents.lodCount * sizeof(MeshLod);
+	const uint64_t materialSize = contents.materialCount * sizeof(MeshMaterial);
+	header.vertexOffset = AlignUp(attributesEnd, MESH_FILE_BLOB_ALIGNMENT);
+	header.indexOffset = AlignUp(header.vertexOffset + vertexSize, MESH_FILE_BLOB_ALIGNMENT);
+	header.submeshOffset = AlignUp(header.indexOffset + indexSize, MESH_FILE_BLOB_ALIGNMENT);
+	header.meshletOffset = AlignUp(header.submeshOffset + submeshSize, MESH_FILE_BLOB_ALIGNMENT);
+	header.lodOffset = AlignUp(header.meshletOffset + meshletSize, MESH_FILE_BLOB_ALIGNMENT);
+	header.materialOffset = AlignUp(header.lodOffset + lodSize, MESH_FILE_BLOB_ALIGNMENT);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		header.boundsMin[i] = contents.boundsMin[i];
+		header.boundsMax[i] = contents.boundsMax[i];
+		header.positionOffset[i] = contents.quantization.positionOffset[i];
+		header.positionScale[i] = contents.quantization.positionScale[i];
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		header.texCoordOffset[i] = contents.quantization.texCoordOffset[i];
+		header.texCoordScale[i] = contents.quantization.texCoordScale[i];
+	}
+
+	std::vector<MeshFileAttribute> attributes(attributeDescriptions.size());
+	for (size_t i = 0; i < attributeDescriptions.size(); ++i)
+	{
+		attributes[i].location = attributeDescriptions[i].location;
+		attributes[i].format = static_cast<uint32_t>(attributeDescriptions[i].format);
+		attributes[i].offset = attributeDescriptions[i].offset;
+	}
+
+	// write to a temporary file first and rename it afterwards, so that a
+	// crash while cooking never leaves a half written mesh behind
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+			return false;
+
+		const char padding[MESH_FILE_BLOB_ALIGNMENT]{};
+		auto writeBlob = [&file, &padding](uint64_t position, uint64_t offset, const void* data, uint64_t size) {
+			file.write(padding, static_cast<std::streamsize>(offset - position));
+			file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+			return offset + size;
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(attributes.data()),
+			static_cast<std::streamsize>(attributes.size() * sizeof(MeshFileAttribute)));
+
+		uint64_t position = attributesEnd;
+		position = writeBlob(position, header.vertexOffset, contents.vertexData.data.data(), vertexSize);
+		position = writeBlob(position, header.indexOffset, contents.indexData.data.data(), indexSize);
+		position = writeBlob(position, header.submeshOffset, contents.submeshes, submeshSize);
+		position = writeBlob(position, header.meshletOffset, contents.meshlets, meshletSize);
+		position = writeBlob(position, header.lodOffset, contents.lods, lodSize);
+		position = writeBlob(position, header.materialOffset, contents.materials, materialSize);
+
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, path, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return true;
+}
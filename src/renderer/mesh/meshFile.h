@@ -0,0 +1,217 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "glm/glm.hpp"
+
+#include "core/codec.h"
+#include "core/mappedFile.h"
+#include "renderer/buffer/vertexBuffer.h"
+#include "renderer/mesh/meshLod.h"
+#include "renderer/mesh/meshMaterial.h"
+#include "renderer/mesh/meshlet.h"
+#include "renderer/mesh/submesh.h"
+
+
+// cooked binary mesh format
+// the file is laid out as:
+//     MeshFileHeader
+//     MeshFileAttribute[attributeCount]  (vertex layout descriptor)
+//     vertex blob  (vertexCount * vertexStride bytes in vertexLayout, at vertexOffset,
+//                   vertexEncodedSize bytes in vertexEncoding)
+//     index blob   (indexCount * indexSize bytes, at indexOffset, indexEncodedSize
+//                   bytes in indexEncoding)
+//     submesh blob (submeshCount * sizeof(Submesh) bytes, at submeshOffset)
+//     meshlet blob (meshletCount * sizeof(Meshlet) bytes, at meshletOffset)
+//     lod blob     (lodCount * sizeof(MeshLod) bytes, at lodOffset)
+//     material blob (materialCount * sizeof(MeshMaterial) bytes, at materialOffset)
+// the blobs are stored exactly as they are uploaded to the GPU so that
+// loading the mesh is just mapping the file, no parsing involved; only the
+// vertices and indices may be encoded, they are decoded straight into the
+// staging buffers when uploading
+constexpr uint32_t MESH_FILE_MAGIC = 0x4853454d; // "MESH"
+constexpr uint32_t MESH_FILE_VERSION = 9; // bump this when the layout or the contents change
+constexpr uint64_t MESH_FILE_BLOB_ALIGNMENT = 16;
+
+// how the contents were processed when cooking
+enum MeshFileFlags : uint32_t
+{
+	MESH_FILE_FLAG_NONE = 0,
+	MESH_FILE_FLAG_OPTIMIZED = 1 << 0, // triangles and vertices reordered by `mesh::OptimizeMesh`
+	MESH_FILE_FLAG_MESHLETS = 1 << 1, // triangles grouped by `mesh::BuildMeshlets`
+	MESH_FILE_FLAG_LODS = 1 << 2, // coarser levels appended by `mesh::BuildLodChain`
+	MESH_FILE_FLAG_SUBMESHES = 1 << 3, // split by `mesh::SplitSubmeshes` to fit 16 bit indices
+	MESH_FILE_FLAG_COMPRESSED = 1 << 4, // vertices and indices encoded by `codec::Encode`
+};
+
+struct MeshFileAttribute
+{
+	uint32_t location;
+	uint32_t format; // VkFormat
+	uint32_t offset;
+};
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+
+	uint32_t vertexStride;
+	uint32_t attributeCount;
+
+	uint64_t vertexCount;
+	uint64_t vertexOffset; // byte offset of the vertex blob from the start of the file
+	uint64_t indexCount;
+	uint64_t indexOffset; // byte offset of the index blob from the start of the file
+	uint32_t indexSize; // size of a single index in bytes, 2 or 4
+
+	// axis aligned bounding box of the vertex positions
+	float boundsMin[3];
+	float boundsMax[3];
+
+	uint32_t flags; // MeshFileFlags
+
+	uint64_t meshletCount;
+	uint64_t meshletOffset; // byte offset of the meshlet blob from the start of the file
+	uint64_t lodCount;
+	uint64_t lodOffset; // byte offset of the lod blob from the start of the file
+
+	uint32_t vertexLayout; // VertexLayout
+	// VertexQuantization of the vertex blob
+	float positionOffset[3];
+	float positionScale[3];
+	float texCoordOffset[2];
+	float texCoordScale[2];
+	uint32_t padding;
+
+	uint64_t submeshCount;
+	uint64_t submeshOffset; // byte offset of the submesh blob from the start of the file
+	uint64_t materialCount;
+	uint64_t materialOffset; // byte offset of the material blob from the start of the file
+
+	uint32_t vertexEncoding; // StreamEncoding
+	uint32_t indexEncoding; // StreamEncoding
+	uint64_t vertexEncodedSize; // size of the vertex blob in bytes
+	uint64_t indexEncodedSize; // size of the index blob in bytes
+};
+
+static_assert(sizeof(MeshFileHeader) == 216, "MeshFileHeader layout must not depend on the compiler");
+
+// the data written to a cooked mesh; the pointers are not owned
+struct MeshFileContents
+{
+	// `vertexCount` vertices in `vertexLayout`, as they are stored
+	EncodedStream vertexData{};
+	uint64_t vertexCount = 0;
+	VertexLayout vertexLayout = VertexLayout::FLOAT32;
+	VertexQuantization quantization{};
+	// bounds of the unquantized positions
+	glm::vec3 boundsMin{ 0.0f };
+	glm::vec3 boundsMax{ 0.0f };
+	EncodedStream indexData{}; // `indexCount` indices of `indexSize` bytes
+	uint64_t indexCount = 0;
+	uint32_t indexSize = sizeof(uint32_t);
+	const Submesh* submeshes = nullptr;
+	uint64_t submeshCount = 0;
+	const Meshlet* meshlets = nullptr;
+	uint64_t meshletCount = 0;
+	const MeshLod* lods = nullptr;
+	uint64_t lodCount = 0;
+	const MeshMaterial* materials = nullptr;
+	uint64_t materialCount = 0;
+	uint32_t flags = MESH_FILE_FLAG_NONE;
+};
+
+
+class MeshFile
+{
+public:
+	// maps the cooked mesh into memory and validates the header
+	MeshFile(const std::string& path);
+
+	// writes a cooked mesh; returns false if the file could not be written
+	static bool Write(const std::string& path, const MeshFileContents& contents);
+
+	// checks if the cooked mesh was written with the current version,
+	// `flags` and `layout` without mapping the whole file
+	static bool IsCompatible(const std::string& path,
+		uint32_t flags = MESH_FILE_FLAG_NONE,
+		VertexLayout layout = VertexLayout::FLOAT32);
+
+	// these point directly into the mapped file
+	inline EncodedStream GetVertexData() const
+	{
+		const Span<const uint8_t> data{ m_File->GetData() + m_Header.vertexOffset, m_Header.vertexEncodedSize };
+		return EncodedStream{ data,
+			m_Header.vertexCount * m_Header.vertexStride,
+			static_cast<StreamEncoding>(m_Header.vertexEncoding),
+			m_Header.vertexStride };
+	}
+	inline EncodedStream GetIndexData() const
+	{
+		const Span<const uint8_t> data{ m_File->GetData() + m_Header.indexOffset, m_Header.indexEncodedSize };
+		return EncodedStream{ data,
+			m_Header.indexCount * m_Header.indexSize,
+			static_cast<StreamEncoding>(m_Header.indexEncoding),
+			m_Header.indexSize };
+	}
+	inline const Submesh* GetSubmeshes() const
+	{
+		return reinterpret_cast<const Submesh*>(m_File->GetData() + m_Header.submeshOffset);
+	}
+
+	inline const Meshlet* GetMeshlets() const
+	{
+		return reinterpret_cast<const Meshlet*>(m_File->GetData() + m_Header.meshletOffset);
+	}
+	inline const MeshLod* GetLods() const
+	{
+		return reinterpret_cast<const MeshLod*>(m_File->GetData() + m_Header.lodOffset);
+	}
+	inline const MeshMaterial* GetMaterials() const
+	{
+		return reinterpret_cast<const MeshMaterial*>(m_File->GetData() + m_Header.materialOffset);
+	}
+
+	inline uint64_t GetVertexCount() const { return m_Header.vertexCount; }
+	inline uint32_t GetVertexStride() const { return m_Header.vertexStride; }
+	inline VertexLayout GetVertexLayout() const { return static_cast<VertexLayout>(m_Header.vertexLayout); }
+	inline VertexQuantization GetVertexQuantization() const
+	{
+		VertexQuantization quantization{};
+		quantization.positionOffset =
+			glm::vec3{ m_Header.positionOffset[0], m_Header.positionOffset[1], m_Header.positionOffset[2] };
+		quantization.positionScale =
+			glm::vec3{ m_Header.positionScale[0], m_Header.positionScale[1], m_Header.positionScale[2] };
+		quantization.texCoordOffset = glm::vec2{ m_Header.texCoordOffset[0], m_Header.texCoordOffset[1] };
+		quantization.texCoordScale = glm::vec2{ m_Header.texCoordScale[0], m_Header.texCoordScale[1] };
+		return quantization;
+	}
+	inline uint64_t GetIndexCount() const { return m_Header.indexCount; }
+	inline uint32_t GetIndexSize() const { return m_Header.indexSize; }
+	inline uint64_t GetSubmeshCount() const { return m_Header.submeshCount; }
+	inline uint64_t GetMeshletCount() const { return m_Header.meshletCount; }
+	inline uint64_t GetLodCount() const { return m_Header.lodCount; }
+	inline uint64_t GetMaterialCount() const { return m_Header.materialCount; }
+	inline uint32_t GetFlags() const { return m_Header.flags; }
+
+	inline glm::vec3 GetBoundsMin() const
+	{
+		return glm::vec3{ m_Header.boundsMin[0], m_Header.boundsMin[1], m_Header.boundsMin[2] };
+	}
+	inline glm::vec3 GetBoundsMax() const
+	{
+		return glm::vec3{ m_Header.boundsMax[0], m_Header.boundsMax[1], m_Header.boundsMax[2] };
+	}
+
+private:
+	void Validate();
+
+	static bool MatchesVertexLayout(const MeshFileHeader& header, const MeshFileAttribute* attributes);
+
+private:
+	std::unique_ptr<MappedFile> m_File;
+	MeshFileHeader m_Header;
+};
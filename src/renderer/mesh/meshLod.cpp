@@ -0,0 +1,83 @@
+#include "meshLod.h"
+
+#include <cmath>
+#include <limits>
+
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
+
+
+namespace mesh {
+
+// the cache size the levels are optimized for, same as `MeshOptimizeOptions`
+constexpr uint32_t g_LodCacheSize = 16;
+
+std::vector<MeshLod> BuildLodChain(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshLodOptions& options)
+{
+	std::vector<MeshLod> lods;
+	lods.push_back(MeshLod{ 0, static_cast<uint32_t>(indices.size()), 0.0f, 0 });
+
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (const Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+	const float maxError = glm::length(boundsMax - boundsMin) * 0.5f * options.maxRelativeError;
+
+	MeshSimplifier simplifier{ vertices, indices };
+	size_t previousIndexCount = indices.size();
+
+	while (lods.size() < options.maxLodCount)
+	{
+		const size_t targetIndexCount =
+			static_cast<size_t>(static_cast<float>(previousIndexCount / 3) * options.reduction) * 3;
+
+		simplifier.Simplify(targetIndexCount, maxError);
+		std::vector<uint32_t> lodIndices = simplifier.GetIndices();
+
+		if (lodIndices.empty()
+			|| static_cast<float>(lodIndices.size())
+				   > static_cast<float>(previousIndexCount) * (1.0f - options.minReduction))
+			break;
+
+		OptimizeVertexCache(lodIndices, vertices.size(), g_LodCacheSize);
+
+		lods.push_back(MeshLod{
+			static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), simplifier.GetError(), 0 });
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		previousIndexCount = lodIndices.size();
+	}
+
+	return lods;
+}
+
+uint32_t SelectLod(const MeshLod* lods,
+	size_t lodCount,
+	float distance,
+	float fovY,
+	float viewportHeight,
+	float maxPixelError)
+{
+	if (lodCount == 0)
+		return 0;
+
+	// pixels covered by one model space unit at `distance`
+	const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f) * std::max(distance, 1e-6f));
+
+	uint32_t lod = 0;
+	for (size_t i = 1; i < lodCount; ++i)
+	{
+		if (lods[i].error * pixelsPerUnit > maxPixelError)
+			break;
+
+		lod = static_cast<uint32_t>(i);
+	}
+
+	return lod;
+}
+
+} // namespace mesh
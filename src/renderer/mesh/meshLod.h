@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+// a level of detail of a mesh, a range of the shared index buffer
+// stored as is in cooked meshes, so the layout must not change without
+// bumping MESH_FILE_VERSION
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; // how far the surface moved from the full detail mesh, in model space units
+	uint32_t padding;
+};
+
+static_assert(sizeof(MeshLod) == 16, "MeshLod layout must not depend on the compiler");
+
+struct MeshLodOptions
+{
+	uint32_t maxLodCount = 8; // including the full detail mesh
+	// every level targets this fraction of the triangles of the previous one
+	float reduction = 0.5f;
+	// levels that move the surface further than this fraction of the radius
+	// of the mesh are not built
+	float maxRelativeError = 0.05f;
+	// a level that removes fewer triangles than this fraction of the previous
+	// one is not worth its memory, and ends the chain
+	float minReduction = 0.1f;
+};
+
+
+namespace mesh {
+
+// the full detail mesh (all of `indices`) becomes the first level, coarser
+// levels are appended to `indices` and optimized for the vertex cache
+// every level continues simplifying the previous one, with the error
+// measured against the full detail mesh
+std::vector<MeshLod> BuildLodChain(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshLodOptions& options = MeshLodOptions{});
+
+// picks the coarsest level whose error projects to at most `maxPixelError`
+// pixels at `distance` from a camera with the vertical field of view `fovY`
+// (in radians) rendering to a viewport `viewportHeight` pixels high
+uint32_t SelectLod(const MeshLod* lods,
+	size_t lodCount,
+	float distance,
+	float fovY,
+	float viewportHeight,
+	float maxPixelError);
+
+} // namespace mesh
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+
+// what a submesh is drawn with
+// stored as is in cooked meshes, so the layout must not change without
+// bumping MESH_FILE_VERSION; the strings are null terminated
+struct MeshMaterial
+{
+	char name[64];
+	// relative to the working directory, empty to use the default texture
+	char diffuseTexture[192];
+};
+
+static_assert(sizeof(MeshMaterial) == 256, "MeshMaterial layout must not depend on the compiler");
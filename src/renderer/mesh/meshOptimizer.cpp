@@ -0,0 +1,407 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+namespace mesh {
+
+constexpr uint32_t g_InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+// FIFO cache simulated with timestamps: a vertex is in the cache if fewer
+// than `cacheSize` vertices were added after it
+// `timestamp` is the stamp the next added vertex gets; it starts at
+// `cacheSize + 1` so that the zero initialized stamps count as not cached,
+// and bumping it by `cacheSize + 1` flushes the cache
+static inline bool IsCached(uint32_t vertex, const std::vector<uint32_t>& cacheTimestamps, uint32_t timestamp, uint32_t cacheSize)
+{
+	return timestamp - cacheTimestamps[vertex] <= cacheSize;
+}
+
+// returns the number of cache misses of the triangle
+static inline uint32_t UpdateCache(const uint32_t* triangle, std::vector<uint32_t>& cacheTimestamps, uint32_t& timestamp, uint32_t cacheSize)
+{
+	uint32_t misses = 0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		if (!IsCached(triangle[i], cacheTimestamps, timestamp, cacheSize))
+		{
+			cacheTimestamps[triangle[i]] = timestamp++;
+			++misses;
+		}
+	}
+
+	return misses;
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	size_t misses = 0;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		misses += UpdateCache(&indices[i], cacheTimestamps, timestamp, cacheSize);
+
+	const size_t triangleCount = indices.size() / 3;
+
+	VertexCacheStats stats{};
+	stats.acmr = triangleCount == 0 ? 0.0f : static_cast<float>(misses) / static_cast<float>(triangleCount);
+	stats.atvr = vertexCount == 0 ? 0.0f : static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+std::vector<uint32_t> GetPositionRemap(const std::vector<Vertex>& vertices)
+{
+	std::vector<uint32_t> sorted(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+		sorted[i] = static_cast<uint32_t>(i);
+
+	auto comparePositions = [&vertices](uint32_t lhs, uint32_t rhs) {
+		return memcmp(&vertices[lhs].pos, &vertices[rhs].pos, sizeof(glm::vec3));
+	};
+	std::sort(sorted.begin(), sorted.end(), [&](uint32_t lhs, uint32_t rhs) {
+		const int result = comparePositions(lhs, rhs);
+		return result < 0 || (result == 0 && lhs < rhs);
+	});
+
+	// the first vertex of every run of equal positions represents the run
+	std::vector<uint32_t> remap(vertices.size());
+	for (size_t i = 0; i < sorted.size(); ++i)
+		remap[sorted[i]] = i > 0 && comparePositions(sorted[i - 1], sorted[i]) == 0 ? remap[sorted[i - 1]] : sorted[i];
+
+	return remap;
+}
+
+void BuildTriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, TriangleAdjacency& adjacency)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	adjacency.counts.assign(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		++adjacency.counts[indices[i]];
+
+	adjacency.offsets.resize(vertexCount);
+	uint32_t offset = 0;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		adjacency.offsets[i] = offset;
+		offset += adjacency.counts[i];
+	}
+
+	// fill using the offsets as cursors, then move them back
+	adjacency.triangles.resize(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		adjacency.triangles[adjacency.offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+		adjacency.offsets[i] -= adjacency.counts[i];
+}
+
+// picks the next fanning vertex among the vertices of the triangles emitted
+// last; prefers vertices that are still in the cache after emitting all of
+// their remaining triangles, the oldest of them first since it will be
+// evicted first
+static uint32_t GetNextVertex(const std::vector<uint32_t>& candidates,
+	const std::vector<uint32_t>& liveTriangles,
+	const std::vector<uint32_t>& cacheTimestamps,
+	uint32_t timestamp,
+	uint32_t cacheSize,
+	std::vector<uint32_t>& deadEnds,
+	size_t& cursor)
+{
+	uint32_t bestVertex = g_InvalidIndex;
+	int64_t bestPriority = -1;
+
+	for (uint32_t vertex : candidates)
+	{
+		if (liveTriangles[vertex] == 0)
+			continue;
+
+		int64_t priority = 0;
+		const int64_t age = static_cast<int64_t>(timestamp - cacheTimestamps[vertex]);
+		if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= static_cast<int64_t>(cacheSize))
+			priority = age;
+
+		if (priority > bestPriority)
+		{
+			bestVertex = vertex;
+			bestPriority = priority;
+		}
+	}
+
+	if (bestVertex != g_InvalidIndex)
+		return bestVertex;
+
+	// dead end, go back to the most recently used vertex that has triangles left
+	while (!deadEnds.empty())
+	{
+		const uint32_t vertex = deadEnds.back();
+		deadEnds.pop_back();
+
+		if (liveTriangles[vertex] > 0)
+			return vertex;
+	}
+
+	// nothing recent left, continue with the next vertex in input order
+	for (; cursor < liveTriangles.size(); ++cursor)
+	{
+		if (liveTriangles[cursor] > 0)
+			return static_cast<uint32_t>(cursor);
+	}
+
+	return g_InvalidIndex;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	TriangleAdjacency adjacency;
+	BuildTriangleAdjacency(indices, vertexCount, adjacency);
+
+	std::vector<uint32_t> liveTriangles = adjacency.counts;
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	std::vector<uint32_t> deadEnds;
+	deadEnds.reserve(triangleCount * 3);
+	std::vector<uint32_t> candidates;
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	size_t cursor = 0;
+	uint32_t fanningVertex = GetNextVertex(candidates, liveTriangles, cacheTimestamps, timestamp, cacheSize, deadEnds, cursor);
+
+	while (fanningVertex != g_InvalidIndex)
+	{
+		candidates.clear();
+
+		// emit every remaining triangle around the fanning vertex
+		const uint32_t begin = adjacency.offsets[fanningVertex];
+		const uint32_t end = begin + adjacency.counts[fanningVertex];
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--liveTriangles[vertex];
+
+				if (!IsCached(vertex, cacheTimestamps, timestamp, cacheSize))
+					cacheTimestamps[vertex] = timestamp++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		fanningVertex = GetNextVertex(candidates, liveTriangles, cacheTimestamps, timestamp, cacheSize, deadEnds, cursor);
+	}
+
+	indices.swap(result);
+}
+
+// splits the triangles into clusters that can be reordered without hurting
+// the cache much; a triangle whose vertices all miss the cache starts a new
+// patch of the mesh anyway, and within such a patch a new cluster starts
+// whenever the ACMR of the cluster so far is within `threshold` of the patch
+static std::vector<size_t> GenerateClusters(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+
+	std::vector<size_t> patches;
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		if (UpdateCache(&indices[i * 3], cacheTimestamps, timestamp, cacheSize) == 3 || i == 0)
+			patches.push_back(i);
+	}
+	patches.push_back(triangleCount);
+
+	std::vector<size_t> clusters;
+	for (size_t patch = 0; patch + 1 < patches.size(); ++patch)
+	{
+		const size_t begin = patches[patch];
+		const size_t end = patches[patch + 1];
+
+		// the ACMR of the patch on its own, with a cold cache like the clusters
+		timestamp += cacheSize + 1;
+		size_t patchMisses = 0;
+		for (size_t i = begin; i < end; ++i)
+			patchMisses += UpdateCache(&indices[i * 3], cacheTimestamps, timestamp, cacheSize);
+		const float patchThreshold = threshold * static_cast<float>(patchMisses) / static_cast<float>(end - begin);
+
+		timestamp += cacheSize + 1;
+		clusters.push_back(begin);
+
+		size_t clusterBegin = begin;
+		size_t clusterMisses = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			clusterMisses += UpdateCache(&indices[i * 3], cacheTimestamps, timestamp, cacheSize);
+
+			const float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(i + 1 - clusterBegin);
+			if (i + 1 < end && clusterAcmr <= patchThreshold)
+			{
+				timestamp += cacheSize + 1;
+				clusters.push_back(i + 1);
+				clusterBegin = i + 1;
+				clusterMisses = 0;
+			}
+		}
+
+		// the last cluster ends with the patch instead of reaching the
+		// threshold, merge it into the previous one if its ACMR is too high
+		const float lastAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - clusterBegin);
+		if (clusterBegin != begin && lastAcmr > patchThreshold)
+			clusters.pop_back();
+	}
+	clusters.push_back(triangleCount);
+
+	return clusters;
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices,
+	const std::vector<Vertex>& vertices,
+	uint32_t cacheSize,
+	float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	const std::vector<size_t> clusters = GenerateClusters(indices, vertices.size(), cacheSize, threshold);
+	const size_t clusterCount = clusters.size() - 1;
+
+	// area weighted centroid and normal of every cluster and of the whole mesh
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3{ 0.0f });
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3{ 0.0f });
+	std::vector<float> areas(clusterCount, 0.0f);
+	glm::vec3 meshCentroid{ 0.0f };
+	float meshArea = 0.0f;
+
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		for (size_t i = clusters[cluster]; i < clusters[cluster + 1]; ++i)
+		{
+			const glm::vec3& p0 = vertices[indices[i * 3 + 0]].pos;
+			const glm::vec3& p1 = vertices[indices[i * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[i * 3 + 2]].pos;
+
+			// the length of the cross product is twice the area
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+
+			centroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[cluster] += normal;
+			areas[cluster] += area;
+		}
+
+		meshCentroid += centroids[cluster];
+		meshArea += areas[cluster];
+	}
+
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// clusters facing away from the center of the mesh are more likely to be
+	// in front of the rest, so they are drawn first
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		if (areas[cluster] <= 0.0f)
+			continue;
+
+		const glm::vec3 centroid = centroids[cluster] / areas[cluster];
+		const float normalLength = glm::length(normals[cluster]);
+		if (normalLength > 0.0f)
+			sortKeys[cluster] = glm::dot(centroid - meshCentroid, normals[cluster] / normalLength);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t i = 0; i < clusterCount; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t lhs, size_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	for (size_t cluster : order)
+		result.insert(result.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+
+	indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), g_InvalidIndex);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == g_InvalidIndex)
+		{
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(result);
+}
+
+MeshOptimizeStats OptimizeTriangles(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshOptimizeOptions& options)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	MeshOptimizeStats stats{};
+	stats.before = AnalyzeVertexCache(indices, vertices.size(), options.cacheSize);
+
+	OptimizeVertexCache(indices, vertices.size(), options.cacheSize);
+	if (options.overdrawThreshold > 1.0f)
+		OptimizeOverdraw(indices, vertices, options.cacheSize, options.overdrawThreshold);
+
+	stats.after = AnalyzeVertexCache(indices, vertices.size(), options.cacheSize);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return stats;
+}
+
+MeshOptimizeStats OptimizeMesh(std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshOptimizeOptions& options)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	MeshOptimizeStats stats = OptimizeTriangles(vertices, indices, options);
+	OptimizeVertexFetch(vertices, indices);
+
+	// the vertex fetch pass drops the unused vertices, which the ATVR counts
+	stats.after = AnalyzeVertexCache(indices, vertices.size(), options.cacheSize);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return stats;
+}
+
+} // namespace mesh
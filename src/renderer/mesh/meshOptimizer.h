@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+// post-transform vertex cache efficiency of an index buffer, simulated with
+// a FIFO cache
+struct VertexCacheStats
+{
+	float acmr; // average cache miss ratio; vertex shader invocations per triangle (0.5 - 3)
+	float atvr; // average transformed vertex ratio; vertex shader invocations per vertex (1 is optimal)
+};
+
+struct MeshOptimizeStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	double milliseconds;
+};
+
+struct MeshOptimizeOptions
+{
+	// size of the simulated FIFO cache, used for both optimization and stats
+	uint32_t cacheSize = 16;
+	// how much the ACMR may grow when splitting the triangles into more
+	// clusters for the overdraw pass; 1 disables the overdraw pass
+	float overdrawThreshold = 1.05f;
+};
+
+// the triangles using each vertex, stored contiguously per vertex
+// the triangles of vertex `v` are `triangles[offsets[v]]` to
+// `triangles[offsets[v] + counts[v] - 1]`
+struct TriangleAdjacency
+{
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+};
+
+
+namespace mesh {
+
+// maps every vertex to the lowest index of the vertices with the same
+// position (compared bitwise), so that vertices split by uv seams can be
+// treated as one
+std::vector<uint32_t> GetPositionRemap(const std::vector<Vertex>& vertices);
+
+void BuildTriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, TriangleAdjacency& adjacency);
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+// reorders the triangles for the post-transform vertex cache (Tipsify,
+// Sander et al. 2007); linear in the number of triangles
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+// splits the cache optimized triangles into clusters and sorts the clusters
+// so that the outward facing ones come first, which lets the depth test
+// reject more of the fragments behind them
+void OptimizeOverdraw(std::vector<uint32_t>& indices,
+	const std::vector<Vertex>& vertices,
+	uint32_t cacheSize,
+	float threshold);
+
+// reorders the vertices in the order the index buffer first uses them, so
+// that the vertex fetch walks memory mostly linearly; unused vertices are
+// dropped
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// runs the vertex cache and overdraw passes, which only reorder the
+// triangles, eg: for vertices that are already uploaded
+MeshOptimizeStats OptimizeTriangles(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshOptimizeOptions& options = MeshOptimizeOptions{});
+
+// runs the three passes above in order
+MeshOptimizeStats OptimizeMesh(std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshOptimizeOptions& options = MeshOptimizeOptions{});
+
+} // namespace mesh
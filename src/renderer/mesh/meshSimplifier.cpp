@@ -0,0 +1,538 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "meshOptimizer.h"
+
+
+namespace mesh {
+
+constexpr uint32_t g_InvalidIndex = std::numeric_limits<uint32_t>::max();
+// how much more moving a border away from its edges costs than moving a
+// vertex away from the plane of its triangles
+constexpr float g_BorderWeight = 10.0f;
+// a collapse may not rotate a triangle by more than ~75 degrees, which also
+// rejects collapses that would flip triangles
+constexpr float g_MinNormalCos = 0.25f;
+// a pass may also do collapses somewhat worse than the ones it needs, since
+// the better ones may be blocked by collapses done earlier in the pass
+constexpr float g_PassErrorSlack = 1.5f;
+
+// sum of squared distances to a set of planes, weighted by area
+// stored as the upper half of the symmetric 4x4 matrix
+struct Quadric
+{
+	double a2, b2, c2, d2;
+	double ab, ac, ad;
+	double bc, bd;
+	double cd;
+	double weight;
+};
+
+static Quadric MakePlaneQuadric(const glm::vec3& normal, const glm::vec3& point, double weight)
+{
+	const double a = normal.x;
+	const double b = normal.y;
+	const double c = normal.z;
+	const double d = -glm::dot(normal, point);
+
+	return Quadric{ a * a * weight, b * b * weight, c * c * weight, d * d * weight,
+		a * b * weight, a * c * weight, a * d * weight,
+		b * c * weight, b * d * weight,
+		c * d * weight,
+		weight };
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a2 += other.a2;
+	quadric.b2 += other.b2;
+	quadric.c2 += other.c2;
+	quadric.d2 += other.d2;
+	quadric.ab += other.ab;
+	quadric.ac += other.ac;
+	quadric.ad += other.ad;
+	quadric.bc += other.bc;
+	quadric.bd += other.bd;
+	quadric.cd += other.cd;
+	quadric.weight += other.weight;
+}
+
+// weighted average of the squared distances of `point` to the planes
+static float EvaluateQuadric(const Quadric& quadric, const glm::vec3& point)
+{
+	if (quadric.weight <= 0.0)
+		return 0.0f;
+
+	const double x = point.x;
+	const double y = point.y;
+	const double z = point.z;
+
+	const double error = quadric.a2 * x * x + quadric.b2 * y * y + quadric.c2 * z * z + quadric.d2
+						 + 2.0 * (quadric.ab * x * y + quadric.ac * x * z + quadric.ad * x + quadric.bc * y * z
+								  + quadric.bd * y + quadric.cd * z);
+
+	return static_cast<float>(std::fabs(error) / quadric.weight);
+}
+
+enum class VertexKind : uint8_t
+{
+	Manifold, // surrounded by triangles, can collapse to any neighbour
+	Border, // on an open border, can only collapse along the border
+	Locked, // on a corner of a border or on a non-manifold edge, never collapses
+};
+
+struct Collapse
+{
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+// the state of a simplification; vertices are identified by their position
+// (see `GetPositionRemap`) except where a collapse has to pick the vertex
+// (the wedge) on the other side of a uv seam
+class Simplifier
+{
+public:
+	Simplifier(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		: m_Vertices{ vertices },
+		  m_Indices{ indices },
+		  m_PositionRemap{ GetPositionRemap(vertices) },
+		  m_MaxError{ 0.0f }
+	{
+		m_PositionIndices.resize(m_Indices.size());
+		m_VertexRemap.resize(m_Vertices.size());
+		for (size_t i = 0; i < m_Vertices.size(); ++i)
+			m_VertexRemap[i] = static_cast<uint32_t>(i);
+
+		UpdateTopology();
+		ComputeQuadrics();
+	}
+
+	// returns false if no collapse was possible
+	bool RunPass(size_t targetIndexCount, float maxError)
+	{
+		const size_t triangleCount = m_Indices.size() / 3;
+		const size_t targetTriangleCount = targetIndexCount / 3;
+
+		std::vector<Collapse> collapses = GetCollapses();
+		if (collapses.empty())
+			return false;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.error < rhs.error;
+		});
+
+		// a collapse usually removes two triangles
+		const size_t goal = std::min(collapses.size() - 1, (triangleCount - targetTriangleCount) / 2);
+		const float passError = collapses[goal].error * g_PassErrorSlack;
+		const float errorLimit = maxError * maxError;
+
+		std::vector<bool> locked(m_Vertices.size(), false);
+		size_t removedTriangles = 0;
+		size_t collapseCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > errorLimit || triangleCount - removedTriangles <= targetTriangleCount)
+				break;
+			if (collapse.error > passError && collapseCount > 0)
+				break;
+
+			if (locked[collapse.from] || locked[collapse.to])
+				continue;
+
+			// the collapses were valid when they were collected, and locking
+			// keeps their surroundings as they were
+			FindWedges(collapse.from, collapse.to);
+			for (const auto& remap : m_WedgeRemap)
+				m_VertexRemap[remap.first] = remap.second;
+
+			AddQuadric(m_Quadrics[collapse.to], m_Quadrics[collapse.from]);
+
+			// the triangles around the collapsed vertex are stale for the rest
+			// of the pass, so none of their vertices may collapse again
+			const uint32_t begin = m_Adjacency.offsets[collapse.from];
+			const uint32_t end = begin + m_Adjacency.counts[collapse.from];
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t triangle = m_Adjacency.triangles[i];
+				bool removed = false;
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t position = m_PositionIndices[triangle * 3 + corner];
+					locked[position] = true;
+					removed |= position == collapse.to;
+				}
+
+				removedTriangles += removed ? 1 : 0;
+			}
+
+			m_MaxError = std::max(m_MaxError, collapse.error);
+			++collapseCount;
+		}
+
+		if (collapseCount == 0)
+			return false;
+
+		ApplyRemap();
+		UpdateTopology();
+		return true;
+	}
+
+	inline const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+	inline float GetError() const { return std::sqrt(m_MaxError); }
+
+private:
+	inline const glm::vec3& GetPosition(uint32_t position) const { return m_Vertices[position].pos; }
+
+	void UpdateTopology()
+	{
+		for (size_t i = 0; i < m_Indices.size(); ++i)
+			m_PositionIndices[i] = m_PositionRemap[m_Indices[i]];
+
+		BuildTriangleAdjacency(m_PositionIndices, m_Vertices.size(), m_Adjacency);
+		ClassifyVertices();
+	}
+
+	// number of triangles around `from` with the edge from -> to
+	uint32_t CountHalfEdges(uint32_t from, uint32_t to) const
+	{
+		uint32_t count = 0;
+
+		const uint32_t begin = m_Adjacency.offsets[from];
+		const uint32_t end = begin + m_Adjacency.counts[from];
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const uint32_t triangle = m_Adjacency.triangles[i];
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				if (m_PositionIndices[triangle * 3 + corner] == from
+					&& m_PositionIndices[triangle * 3 + (corner + 1) % 3] == to)
+					++count;
+			}
+		}
+
+		return count;
+	}
+
+	void ClassifyVertices()
+	{
+		const size_t vertexCount = m_Vertices.size();
+
+		m_Kinds.assign(vertexCount, VertexKind::Manifold);
+		m_BorderNext.assign(vertexCount, g_InvalidIndex);
+		m_BorderPrev.assign(vertexCount, g_InvalidIndex);
+
+		std::vector<uint8_t> borderOut(vertexCount, 0);
+		std::vector<uint8_t> borderIn(vertexCount, 0);
+
+		for (size_t i = 0; i < m_PositionIndices.size(); i += 3)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t from = m_PositionIndices[i + corner];
+				const uint32_t to = m_PositionIndices[i + (corner + 1) % 3];
+
+				// an edge used twice in the same direction is non-manifold
+				if (CountHalfEdges(from, to) > 1)
+				{
+					m_Kinds[from] = VertexKind::Locked;
+					m_Kinds[to] = VertexKind::Locked;
+				}
+
+				// an edge without a twin is on an open border
+				if (CountHalfEdges(to, from) == 0)
+				{
+					borderOut[from] = static_cast<uint8_t>(std::min(borderOut[from] + 1, 2));
+					borderIn[to] = static_cast<uint8_t>(std::min(borderIn[to] + 1, 2));
+					m_BorderNext[from] = to;
+					m_BorderPrev[to] = from;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			if (m_Kinds[i] == VertexKind::Locked || (borderOut[i] == 0 && borderIn[i] == 0))
+				continue;
+
+			m_Kinds[i] = borderOut[i] == 1 && borderIn[i] == 1 ? VertexKind::Border : VertexKind::Locked;
+		}
+	}
+
+	void ComputeQuadrics()
+	{
+		m_Quadrics.assign(m_Vertices.size(), Quadric{});
+
+		for (size_t i = 0; i < m_PositionIndices.size(); i += 3)
+		{
+			const uint32_t positions[3] = { m_PositionIndices[i + 0], m_PositionIndices[i + 1], m_PositionIndices[i + 2] };
+			const glm::vec3& p0 = GetPosition(positions[0]);
+			const glm::vec3& p1 = GetPosition(positions[1]);
+			const glm::vec3& p2 = GetPosition(positions[2]);
+
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			if (area <= 0.0f)
+				continue;
+
+			const Quadric quadric = MakePlaneQuadric(normal / area, p0, area);
+			for (uint32_t position : positions)
+				AddQuadric(m_Quadrics[position], quadric);
+
+			// keep the borders in place with planes through the border edges,
+			// perpendicular to the triangle
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t from = positions[corner];
+				const uint32_t to = positions[(corner + 1) % 3];
+				if (CountHalfEdges(to, from) != 0)
+					continue;
+
+				const glm::vec3 edge = GetPosition(to) - GetPosition(from);
+				const float length = glm::length(edge);
+				if (length <= 0.0f)
+					continue;
+
+				const glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+				const Quadric borderQuadric =
+					MakePlaneQuadric(edgeNormal, GetPosition(from), length * length * g_BorderWeight);
+				AddQuadric(m_Quadrics[from], borderQuadric);
+				AddQuadric(m_Quadrics[to], borderQuadric);
+			}
+		}
+	}
+
+	bool CanCollapse(uint32_t from, uint32_t to)
+	{
+		switch (m_Kinds[from])
+		{
+		case VertexKind::Manifold:
+			break;
+		case VertexKind::Border:
+			if (m_BorderNext[from] != to && m_BorderPrev[from] != to)
+				return false;
+			break;
+		default:
+			return false;
+		}
+
+		return !FlipsTriangles(from, to) && FindWedges(from, to);
+	}
+
+	std::vector<Collapse> GetCollapses()
+	{
+		std::vector<Collapse> collapses;
+
+		for (size_t i = 0; i < m_PositionIndices.size(); i += 3)
+		{
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t a = m_PositionIndices[i + corner];
+				const uint32_t b = m_PositionIndices[i + (corner + 1) % 3];
+
+				// interior edges show up once in each direction, border edges
+				// only once
+				if (a > b && m_BorderNext[a] != b)
+					continue;
+
+				Collapse best{ g_InvalidIndex, g_InvalidIndex, std::numeric_limits<float>::max() };
+				if (CanCollapse(a, b))
+					best = Collapse{ a, b, EvaluateQuadric(m_Quadrics[a], GetPosition(b)) };
+				if (CanCollapse(b, a))
+				{
+					const float error = EvaluateQuadric(m_Quadrics[b], GetPosition(a));
+					if (error < best.error)
+						best = Collapse{ b, a, error };
+				}
+
+				if (best.from != g_InvalidIndex)
+					collapses.push_back(best);
+			}
+		}
+
+		return collapses;
+	}
+
+	// picks for every vertex at `from` the vertex at `to` it shares an edge
+	// with, so that the uv mapping stays intact; fails if there is no such
+	// vertex or more than one (the collapse would cross a uv seam)
+	bool FindWedges(uint32_t from, uint32_t to)
+	{
+		m_WedgeRemap.clear();
+
+		const uint32_t begin = m_Adjacency.offsets[from];
+		const uint32_t end = begin + m_Adjacency.counts[from];
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const uint32_t triangle = m_Adjacency.triangles[i];
+
+			uint32_t fromVertex = g_InvalidIndex;
+			uint32_t toVertex = g_InvalidIndex;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				if (m_PositionIndices[triangle * 3 + corner] == from)
+					fromVertex = m_Indices[triangle * 3 + corner];
+				else if (m_PositionIndices[triangle * 3 + corner] == to)
+					toVertex = m_Indices[triangle * 3 + corner];
+			}
+
+			auto wedge = std::find_if(m_WedgeRemap.begin(), m_WedgeRemap.end(), [fromVertex](const auto& remap) {
+				return remap.first == fromVertex;
+			});
+			if (wedge == m_WedgeRemap.end())
+				m_WedgeRemap.push_back({ fromVertex, toVertex });
+			else if (wedge->second == g_InvalidIndex)
+				wedge->second = toVertex;
+			else if (toVertex != g_InvalidIndex && wedge->second != toVertex)
+				return false;
+		}
+
+		for (const auto& remap : m_WedgeRemap)
+		{
+			if (remap.second == g_InvalidIndex)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool FlipsTriangles(uint32_t from, uint32_t to) const
+	{
+		const glm::vec3& target = GetPosition(to);
+
+		const uint32_t begin = m_Adjacency.offsets[from];
+		const uint32_t end = begin + m_Adjacency.counts[from];
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const uint32_t triangle = m_Adjacency.triangles[i];
+
+			glm::vec3 positions[3];
+			glm::vec3 moved[3];
+			bool removed = false;
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t position = m_PositionIndices[triangle * 3 + corner];
+				positions[corner] = GetPosition(position);
+				moved[corner] = position == from ? target : positions[corner];
+				removed |= position == to;
+			}
+
+			// triangles with both vertices of the edge become degenerate and
+			// are removed
+			if (removed)
+				continue;
+
+			const glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+			const glm::vec3 movedNormal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			const float movedLength = glm::length(movedNormal);
+			if (movedLength <= 0.0f
+				|| glm::dot(normal, movedNormal) < g_MinNormalCos * glm::length(normal) * movedLength)
+				return true;
+		}
+
+		return false;
+	}
+
+	void ApplyRemap()
+	{
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < m_Indices.size(); i += 3)
+		{
+			const uint32_t v0 = m_VertexRemap[m_Indices[i + 0]];
+			const uint32_t v1 = m_VertexRemap[m_Indices[i + 1]];
+			const uint32_t v2 = m_VertexRemap[m_Indices[i + 2]];
+
+			// drop the triangles that collapsed into a line
+			const uint32_t p0 = m_PositionRemap[v0];
+			const uint32_t p1 = m_PositionRemap[v1];
+			const uint32_t p2 = m_PositionRemap[v2];
+			if (p0 == p1 || p1 == p2 || p2 == p0)
+				continue;
+
+			m_Indices[writeIndex + 0] = v0;
+			m_Indices[writeIndex + 1] = v1;
+			m_Indices[writeIndex + 2] = v2;
+			writeIndex += 3;
+		}
+
+		m_Indices.resize(writeIndex);
+		m_PositionIndices.resize(writeIndex);
+
+		// the collapsed vertices are no longer referenced, so the remap can
+		// start over for the next pass
+		for (size_t i = 0; i < m_VertexRemap.size(); ++i)
+			m_VertexRemap[i] = static_cast<uint32_t>(i);
+	}
+
+private:
+	const std::vector<Vertex>& m_Vertices;
+	std::vector<uint32_t> m_Indices;
+
+	const std::vector<uint32_t> m_PositionRemap;
+	std::vector<uint32_t> m_PositionIndices;
+	TriangleAdjacency m_Adjacency;
+
+	std::vector<VertexKind> m_Kinds;
+	std::vector<uint32_t> m_BorderNext;
+	std::vector<uint32_t> m_BorderPrev;
+
+	std::vector<Quadric> m_Quadrics;
+
+	std::vector<uint32_t> m_VertexRemap;
+	std::vector<std::pair<uint32_t, uint32_t>> m_WedgeRemap;
+
+	float m_MaxError; // squared
+};
+
+} // namespace mesh
+
+
+MeshSimplifier::MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	: m_Simplifier{ std::make_unique<mesh::Simplifier>(vertices, indices) }
+{}
+
+MeshSimplifier::~MeshSimplifier() = default;
+
+void MeshSimplifier::Simplify(size_t targetIndexCount, float maxError)
+{
+	while (m_Simplifier->GetIndices().size() > targetIndexCount)
+	{
+		if (!m_Simplifier->RunPass(targetIndexCount, maxError))
+			break;
+	}
+}
+
+const std::vector<uint32_t>& MeshSimplifier::GetIndices() const
+{
+	return m_Simplifier->GetIndices();
+}
+
+float MeshSimplifier::GetError() const
+{
+	return m_Simplifier->GetError();
+}
+
+
+namespace mesh {
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	size_t targetIndexCount,
+	float maxError,
+	float* resultError)
+{
+	MeshSimplifier simplifier{ vertices, indices };
+	simplifier.Simplify(targetIndexCount, maxError);
+
+	if (resultError)
+		*resultError = simplifier.GetError();
+
+	return simplifier.GetIndices();
+}
+
+} // namespace mesh
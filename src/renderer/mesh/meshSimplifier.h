@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+namespace mesh {
+class Simplifier;
+}
+
+// simplifies a mesh in steps, every step continuing from the triangles left
+// by the previous one; the error is still measured against the original
+// triangles, so a chain of levels costs about as much as the coarsest level
+// see `mesh::SimplifyMesh` for how the triangles are simplified
+class MeshSimplifier
+{
+public:
+	MeshSimplifier(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	~MeshSimplifier();
+
+	MeshSimplifier(const MeshSimplifier&) = delete;
+	MeshSimplifier& operator=(const MeshSimplifier&) = delete;
+
+	void Simplify(size_t targetIndexCount, float maxError);
+
+	const std::vector<uint32_t>& GetIndices() const;
+	// largest distance the surface moved so far, in model space units
+	float GetError() const;
+
+private:
+	std::unique_ptr<mesh::Simplifier> m_Simplifier;
+};
+
+
+namespace mesh {
+
+// simplifies the triangles with quadric error metric edge collapses (Garland
+// and Heckbert 1997) until at most `targetIndexCount` indices are left, or
+// until the next collapse would move the surface by more than `maxError`
+// (in model space units)
+// a collapse moves a vertex onto one of its neighbours, so the vertices are
+// never modified and the result can share the vertex buffer with the input
+// open borders only collapse along the border, and vertices split by a uv
+// seam only collapse together along the seam
+// returns the simplified indices; `resultError` is set to the largest
+// distance the surface moved
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	size_t targetIndexCount,
+	float maxError,
+	float* resultError = nullptr);
+
+} // namespace mesh
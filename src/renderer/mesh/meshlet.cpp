@@ -0,0 +1,357 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "meshOptimizer.h"
+
+
+namespace mesh {
+
+constexpr uint32_t g_InvalidIndex = std::numeric_limits<uint32_t>::max();
+// meshlets whose normals are spread this much (or more) are never culled by
+// the cone test; the cone would be too wide to cull anything in practice
+constexpr float g_MinConeDot = 0.1f;
+
+static void ComputeMeshletBounds(const std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices,
+	const std::vector<uint32_t>& meshletVertices,
+	Meshlet& meshlet)
+{
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (uint32_t vertex : meshletVertices)
+	{
+		boundsMin = glm::min(boundsMin, vertices[vertex].pos);
+		boundsMax = glm::max(boundsMax, vertices[vertex].pos);
+	}
+
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (uint32_t vertex : meshletVertices)
+		meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].pos - meshlet.center));
+
+	// the cone axis is the average of the triangle normals, and its angle is
+	// the largest angle between the axis and a normal
+	const uint32_t indexEnd = meshlet.firstIndex + meshlet.indexCount;
+	auto triangleNormal = [&](uint32_t index) {
+		const glm::vec3& p0 = vertices[indices[index + 0]].pos;
+		const glm::vec3& p1 = vertices[indices[index + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[index + 2]].pos;
+		return glm::cross(p1 - p0, p2 - p0);
+	};
+
+	glm::vec3 normalSum{ 0.0f };
+	for (uint32_t i = meshlet.firstIndex; i < indexEnd; i += 3)
+	{
+		const glm::vec3 normal = triangleNormal(i);
+		const float length = glm::length(normal);
+		if (length > 0.0f)
+			normalSum += normal / length;
+	}
+
+	meshlet.coneAxis = glm::vec3{ 0.0f };
+	meshlet.coneCutoff = 1.0f;
+
+	const float sumLength = glm::length(normalSum);
+	if (sumLength <= 0.0f)
+		return;
+
+	meshlet.coneAxis = normalSum / sumLength;
+
+	float minDot = 1.0f;
+	for (uint32_t i = meshlet.firstIndex; i < indexEnd; i += 3)
+	{
+		const glm::vec3 normal = triangleNormal(i);
+		const float length = glm::length(normal);
+		if (length > 0.0f)
+			minDot = std::min(minDot, glm::dot(meshlet.coneAxis, normal / length));
+	}
+
+	// the cutoff is the sine of the cone angle, which turns the test against
+	// the cone plus 90 degrees into a dot product against the view direction
+	if (minDot > g_MinConeDot)
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// spreads the lower 10 bits of `value` so that there are two zero bits
+// between every bit
+static uint32_t SpreadBits(uint32_t value)
+{
+	value &= 0x3ff;
+	value = (value | (value << 16)) & 0x030000ff;
+	value = (value | (value << 8)) & 0x0300f00f;
+	value = (value | (value << 4)) & 0x030c30c3;
+	value = (value | (value << 2)) & 0x09249249;
+	return value;
+}
+
+// the triangles sorted along a morton curve through their centroids, so that
+// triangles next to each other in the order are close in space too
+static std::vector<uint32_t> GetSpatialOrder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+	glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+	for (const Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.pos);
+		boundsMax = glm::max(boundsMax, vertex.pos);
+	}
+	const glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3{ std::numeric_limits<float>::min() });
+
+	std::vector<std::pair<uint32_t, uint32_t>> codes(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		const glm::vec3 centroid =
+			(vertices[indices[i * 3 + 0]].pos + vertices[indices[i * 3 + 1]].pos + vertices[indices[i * 3 + 2]].pos)
+			/ 3.0f;
+		const glm::uvec3 cell = glm::uvec3{ glm::clamp((centroid - boundsMin) / extent, 0.0f, 1.0f) * 1023.0f };
+
+		codes[i] = { SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2), static_cast<uint32_t>(i) };
+	}
+	std::sort(codes.begin(), codes.end());
+
+	std::vector<uint32_t> order(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+		order[i] = codes[i].second;
+	return order;
+}
+
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshletOptions& options)
+{
+	if (options.maxVertices < 3 || options.maxTriangles == 0)
+		throw std::runtime_error("Meshlets must have room for at least one triangle!");
+
+	const size_t triangleCount = indices.size() / 3;
+
+	std::vector<Meshlet> meshlets;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// grown along positions, so that vertices split by uv seams are still
+	// neighbours
+	const std::vector<uint32_t> positionRemap = GetPositionRemap(vertices);
+	std::vector<uint32_t> positionIndices(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+		positionIndices[i] = positionRemap[indices[i]];
+
+	TriangleAdjacency adjacency;
+	BuildTriangleAdjacency(positionIndices, vertices.size(), adjacency);
+	const std::vector<uint32_t> spatialOrder = GetSpatialOrder(vertices, indices);
+
+	std::vector<bool> emitted(triangleCount, false);
+	// the meshlet that last used each vertex, so the vertex set of the
+	// current meshlet never has to be cleared
+	std::vector<uint32_t> vertexMeshlet(vertices.size(), g_InvalidIndex);
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(options.maxVertices);
+	// same for the positions, which the meshlet grows along
+	std::vector<uint32_t> positionMeshlet(vertices.size(), g_InvalidIndex);
+	std::vector<uint32_t> meshletPositions;
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	std::vector<glm::vec3> triangleNormals(triangleCount);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		const glm::vec3& p0 = vertices[indices[i * 3 + 0]].pos;
+		const glm::vec3& p1 = vertices[indices[i * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[i * 3 + 2]].pos;
+		const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(normal);
+		triangleNormals[i] = length > 0.0f ? normal / length : glm::vec3{ 0.0f };
+	}
+
+	Meshlet meshlet{};
+	uint32_t meshletTriangles = 0;
+	glm::vec3 meshletNormal{ 0.0f };
+
+	auto countNewVertices = [&](uint32_t triangle) {
+		const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+		uint32_t count = 0;
+		for (uint32_t corner = 0; corner < 3; ++corner)
+			count += vertexMeshlet[indices[triangle * 3 + corner]] != meshletIndex ? 1 : 0;
+		return count;
+	};
+
+	auto finishMeshlet = [&]() {
+		meshlet.indexCount = static_cast<uint32_t>(result.size()) - meshlet.firstIndex;
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		ComputeMeshletBounds(vertices, result, meshletVertices, meshlet);
+		meshlets.push_back(meshlet);
+
+		meshlet = Meshlet{};
+		meshlet.firstIndex = static_cast<uint32_t>(result.size());
+		meshletTriangles = 0;
+		meshletVertices.clear();
+		meshletPositions.clear();
+		meshletNormal = glm::vec3{ 0.0f };
+	};
+
+	size_t cursor = 0;
+	while (true)
+	{
+		// the triangle around the current vertices that adds the fewest new
+		// vertices, which keeps the meshlet compact, and faces the same way
+		// as the meshlet, which keeps the normal cone narrow
+		const float normalLength = glm::length(meshletNormal);
+		const glm::vec3 averageNormal = normalLength > 0.0f ? meshletNormal / normalLength : glm::vec3{ 0.0f };
+
+		uint32_t bestTriangle = g_InvalidIndex;
+		uint32_t bestNewVertices = 4;
+		float bestScore = std::numeric_limits<float>::max();
+		for (size_t i = 0; i < meshletPositions.size(); ++i)
+		{
+			const uint32_t position = meshletPositions[i];
+			const uint32_t begin = adjacency.offsets[position];
+			const uint32_t end = begin + adjacency.counts[position];
+			for (uint32_t j = begin; j < end; ++j)
+			{
+				const uint32_t triangle = adjacency.triangles[j];
+				if (emitted[triangle])
+					continue;
+
+				const uint32_t newVertices = countNewVertices(triangle);
+				const float score = static_cast<float>(newVertices)
+									- options.coneWeight * glm::dot(triangleNormals[triangle], averageNormal);
+				if (score < bestScore)
+				{
+					bestTriangle = triangle;
+					bestNewVertices = newVertices;
+					bestScore = score;
+				}
+			}
+		}
+
+		// nothing connected left, continue with the next triangle nearby
+		if (bestTriangle == g_InvalidIndex)
+		{
+			while (cursor < triangleCount && emitted[spatialOrder[cursor]])
+				++cursor;
+			if (cursor == triangleCount)
+				break;
+
+			bestTriangle = spatialOrder[cursor];
+			bestNewVertices = countNewVertices(bestTriangle);
+		}
+
+		if (meshletTriangles == options.maxTriangles || meshletVertices.size() + bestNewVertices > options.maxVertices)
+			finishMeshlet();
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = indices[bestTriangle * 3 + corner];
+			if (vertexMeshlet[vertex] != meshlets.size())
+			{
+				vertexMeshlet[vertex] = static_cast<uint32_t>(meshlets.size());
+				meshletVertices.push_back(vertex);
+			}
+
+			const uint32_t position = positionIndices[bestTriangle * 3 + corner];
+			if (positionMeshlet[position] != meshlets.size())
+			{
+				positionMeshlet[position] = static_cast<uint32_t>(meshlets.size());
+				meshletPositions.push_back(position);
+			}
+
+			result.push_back(vertex);
+		}
+
+		emitted[bestTriangle] = true;
+		meshletNormal += triangleNormals[bestTriangle];
+		++meshletTriangles;
+	}
+
+	if (meshletTriangles > 0)
+		finishMeshlet();
+
+	indices.swap(result);
+	return meshlets;
+}
+
+MeshletCullParams GetMeshletCullParams(const glm::mat4& modelViewProjection, const glm::mat4& modelView)
+{
+	auto row = [&modelViewProjection](int i) {
+		return glm::vec4{ modelViewProjection[0][i], modelViewProjection[1][i], modelViewProjection[2][i],
+			modelViewProjection[3][i] };
+	};
+
+	MeshletCullParams params{};
+	params.frustumPlanes[0] = row(3) + row(0); // left
+	params.frustumPlanes[1] = row(3) - row(0); // right
+	params.frustumPlanes[2] = row(3) + row(1); // bottom
+	params.frustumPlanes[3] = row(3) - row(1); // top
+	params.frustumPlanes[4] = row(2); // near
+	params.frustumPlanes[5] = row(3) - row(2); // far
+
+	// normalized so that the distance to a plane can be compared to a radius
+	for (glm::vec4& plane : params.frustumPlanes)
+		plane /= glm::length(glm::vec3{ plane });
+
+	params.cameraPosition = glm::vec3{ glm::inverse(modelView) * glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f } };
+	params.frustumCulling = true;
+	params.backfaceCulling = true;
+	return params;
+}
+
+static bool IsOutsideFrustum(const Meshlet& meshlet, const MeshletCullParams& params)
+{
+	for (const glm::vec4& plane : params.frustumPlanes)
+	{
+		if (glm::dot(glm::vec3{ plane }, meshlet.center) + plane.w < -meshlet.radius)
+			return true;
+	}
+
+	return false;
+}
+
+static bool IsBackfacing(const Meshlet& meshlet, const MeshletCullParams& params)
+{
+	const glm::vec3 direction = meshlet.center - params.cameraPosition;
+	return glm::dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(direction) + meshlet.radius;
+}
+
+MeshletCullStats CullMeshlets(const Meshlet* meshlets,
+	size_t meshletCount,
+	const MeshletCullParams& params,
+	std::vector<MeshletDraw>& draws)
+{
+	MeshletCullStats stats{};
+	stats.totalMeshlets = static_cast<uint32_t>(meshletCount);
+
+	const size_t firstDraw = draws.size();
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		const Meshlet& meshlet = meshlets[i];
+
+		if (params.frustumCulling && IsOutsideFrustum(meshlet, params))
+		{
+			++stats.frustumCulled;
+			continue;
+		}
+		if (params.backfaceCulling && IsBackfacing(meshlet, params))
+		{
+			++stats.backfaceCulled;
+			continue;
+		}
+
+		if (draws.size() > firstDraw && draws.back().firstIndex + draws.back().indexCount == meshlet.firstIndex)
+			draws.back().indexCount += meshlet.indexCount;
+		else
+			draws.push_back(MeshletDraw{ meshlet.firstIndex, meshlet.indexCount });
+
+		stats.triangles += meshlet.indexCount / 3;
+	}
+
+	stats.drawCalls = static_cast<uint32_t>(draws.size() - firstDraw);
+	return stats;
+}
+
+} // namespace mesh
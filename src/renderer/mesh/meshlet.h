@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+// a cluster of triangles that is culled and drawn as a unit
+// its triangles are a contiguous range of the index buffer, so a meshlet is
+// drawn with a single `vkCmdDrawIndexed`
+// stored as is in cooked meshes, so the layout must not change without
+// bumping MESH_FILE_VERSION
+struct Meshlet
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount; // unique vertices referenced by the meshlet
+	uint32_t padding;
+
+	// bounding sphere in model space
+	glm::vec3 center;
+	float radius;
+
+	// every triangle normal is within the cone around `coneAxis`; the
+	// meshlet faces away from a viewer at `position` if
+	// dot(center - position, coneAxis) >= coneCutoff * length(center - position) + radius
+	// `coneCutoff` is 1 when the normals are spread too much to ever cull
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+static_assert(sizeof(Meshlet) == 48, "Meshlet layout must not depend on the compiler");
+
+struct MeshletOptions
+{
+	// 64 vertices and 124 triangles fit the limits of mesh shaders on
+	// most GPUs, which keeps the clusters usable by a GPU culling path
+	uint32_t maxVertices = 64;
+	uint32_t maxTriangles = 124;
+	// how much a triangle facing the same way as the meshlet is preferred
+	// over one that adds fewer vertices; higher values give narrower cones
+	// (more backface culling) at the cost of more meshlets
+	float coneWeight = 0.5f;
+};
+
+// the view of the mesh the meshlets are culled against, in model space
+struct MeshletCullParams
+{
+	glm::vec4 frustumPlanes[6]; // xyz is the normal pointing inwards, w the distance
+	glm::vec3 cameraPosition;
+	bool frustumCulling;
+	// only valid when the back faces are culled by the pipeline too,
+	// otherwise the back of a culled meshlet would have been visible
+	bool backfaceCulling;
+};
+
+// a range of the index buffer that passed culling
+struct MeshletDraw
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+struct MeshletCullStats
+{
+	uint32_t totalMeshlets;
+	uint32_t frustumCulled;
+	uint32_t backfaceCulled;
+	uint32_t drawCalls;
+	uint64_t triangles;
+};
+
+
+namespace mesh {
+
+// groups the triangles into meshlets and reorders `indices` so that the
+// triangles of every meshlet are contiguous
+// meshlets grow by adding the triangle that needs the fewest new vertices
+// among the triangles around the vertices they already have
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const MeshletOptions& options = MeshletOptions{});
+
+// the frustum is the clip volume vulkan rasterizes (-w <= x, y <= w and
+// 0 <= z <= w) transformed to model space by `modelViewProjection`
+MeshletCullParams GetMeshletCullParams(const glm::mat4& modelViewProjection, const glm::mat4& modelView);
+
+// appends the index ranges of the meshlets that pass culling to `draws`;
+// consecutive visible meshlets are merged into a single draw
+MeshletCullStats CullMeshlets(const Meshlet* meshlets,
+	size_t meshletCount,
+	const MeshletCullParams& params,
+	std::vector<MeshletDraw>& draws);
+
+} // namespace mesh
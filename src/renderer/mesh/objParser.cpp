@@ -0,0 +1,736 @@
+#include "objParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tinyobjloader/tiny_obj_loader.h"
+
+#include "core/mappedFile.h"
+
+
+namespace mesh {
+
+// chunks smaller than this are not worth a task of their own
+constexpr size_t g_MinChunkSize = 256 * 1024;
+// more chunks than threads, so that a chunk full of faces does not keep
+// every other thread waiting
+constexpr size_t g_ChunksPerThread = 4;
+
+// an `o`, `g` or `usemtl` record; the faces after it belong to a new shape
+struct ObjShapeRecord
+{
+	size_t index; // number of indices of the chunk before the record
+	bool isMaterial;
+	std::string value;
+};
+
+// geometry parsed from a single chunk of the file
+struct ObjChunk
+{
+	std::vector<float> positions;
+	std::vector<float> texCoords;
+	std::vector<float> normals;
+	std::vector<ObjIndex> indices;
+
+	// the shapes can only be built once the chunks are merged, the first
+	// faces of a chunk continue the last shape of the previous one
+	std::vector<ObjShapeRecord> shapeRecords;
+	std::vector<std::string> materialLibraries;
+
+	// negative (relative) OBJ indices resolve against the number of
+	// attributes declared before them, which is unknown until the previous
+	// chunks are parsed; they are stored relative to the start of the chunk
+	// and these hold the position of such components in `indices`
+	// (index * 3 + component)
+	std::vector<size_t> relativeComponents;
+};
+
+static inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool IsDigit(char c)
+{
+	return static_cast<unsigned int>(c - '0') < 10u;
+}
+
+static inline const char* SkipSpaces(const char* curr, const char* end)
+{
+	while (curr < end && IsSpace(*curr))
+		++curr;
+	return curr;
+}
+
+// same arithmetic as tinyobjloader's `tryParseDouble`, so the parsed values
+// are bit identical; it only avoids the per line string copies
+static bool TryParseDouble(const char* curr, const char* end, double* result)
+{
+	if (curr >= end)
+		return false;
+
+	double mantissa = 0.0;
+	int exponent = 0;
+	bool negative = false;
+
+	if (*curr == '+' || *curr == '-')
+	{
+		negative = *curr == '-';
+		++curr;
+	}
+	else if (!IsDigit(*curr))
+		return false;
+
+	// integer part
+	int read = 0;
+	while (curr < end && IsDigit(*curr))
+	{
+		mantissa *= 10;
+		mantissa += static_cast<int>(*curr - '0');
+		++curr;
+		++read;
+	}
+
+	if (read == 0)
+		return false;
+
+	// fractional part
+	if (curr < end && *curr == '.')
+	{
+		static const double powLut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+		constexpr int lutEntries = sizeof(powLut) / sizeof(powLut[0]);
+
+		++curr;
+		read = 1;
+		while (curr < end && IsDigit(*curr))
+		{
+			mantissa += static_cast<int>(*curr - '0') * (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+			++read;
+			++curr;
+		}
+	}
+
+	// exponent
+	if (curr < end && (*curr == 'e' || *curr == 'E'))
+	{
+		++curr;
+
+		bool negativeExponent = false;
+		if (curr < end && (*curr == '+' || *curr == '-'))
+		{
+			negativeExponent = *curr == '-';
+			++curr;
+		}
+		else if (curr >= end || !IsDigit(*curr))
+			return false;
+
+		read = 0;
+		while (curr < end && IsDigit(*curr))
+		{
+			exponent *= 10;
+			exponent += static_cast<int>(*curr - '0');
+			++curr;
+			++read;
+		}
+
+		if (read == 0)
+			return false;
+		if (negativeExponent)
+			exponent = -exponent;
+	}
+
+	*result = (negative ? -1 : 1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+	return true;
+}
+
+// parses the next whitespace separated number on the line
+static float ParseReal(const char*& curr, const char* end, double defaultValue = 0.0)
+{
+	curr = SkipSpaces(curr, end);
+
+	const char* tokenEnd = curr;
+	while (tokenEnd < end && !IsSpace(*tokenEnd) && *tokenEnd != '\r')
+		++tokenEnd;
+
+	double value = defaultValue;
+	TryParseDouble(curr, tokenEnd, &value);
+
+	curr = tokenEnd;
+	return static_cast<float>(value);
+}
+
+static int32_t ParseInt(const char*& curr, const char* end)
+{
+	bool negative = false;
+	if (curr < end && (*curr == '+' || *curr == '-'))
+	{
+		negative = *curr == '-';
+		++curr;
+	}
+
+	int32_t value = 0;
+	while (curr < end && IsDigit(*curr))
+	{
+		value = value * 10 + (*curr - '0');
+		++curr;
+	}
+
+	return negative ? -value : value;
+}
+
+// the rest of the line without the surrounding whitespace
+static std::string ParseName(const char* curr, const char* end)
+{
+	curr = SkipSpaces(curr, end);
+	while (end > curr && (IsSpace(end[-1]) || end[-1] == '\r'))
+		--end;
+
+	return std::string{ curr, end };
+}
+
+// checks if the line starts with the `keyword` record
+static inline bool IsRecord(const char* curr, const char* end, const char* keyword, size_t length)
+{
+	return static_cast<size_t>(end - curr) > length && memcmp(curr, keyword, length) == 0 && IsSpace(curr[length]);
+}
+
+static inline void SkipToSeparator(const char*& curr, const char* end)
+{
+	while (curr < end && *curr != '/' && !IsSpace(*curr) && *curr != '\r')
+		++curr;
+}
+
+// several files may be listed on one `mtllib` line
+static void ParseMaterialLibraries(const char* curr, const char* end, std::vector<std::string>& libraries)
+{
+	while ((curr = SkipSpaces(curr, end)) < end && *curr != '\r')
+	{
+		const char* nameEnd = curr;
+		while (nameEnd < end && !IsSpace(*nameEnd) && *nameEnd != '\r')
+			++nameEnd;
+
+		libraries.emplace_back(curr, nameEnd);
+		curr = nameEnd;
+	}
+}
+
+// corner of a face before triangulation
+struct FaceCorner
+{
+	ObjIndex index;
+	// bit i is set if component i (vertex, texcoord, normal) was a relative
+	// index, resolved against the start of the chunk
+	uint32_t relativeMask;
+};
+
+// makes an OBJ index zero based; relative (negative) indices are resolved
+// against the chunk and flagged so that they can be fixed up when merging
+static inline int32_t FixIndex(int32_t index, size_t localCount, uint32_t component, uint32_t& relativeMask)
+{
+	if (index > 0)
+		return index - 1;
+	if (index == 0)
+		return 0;
+
+	relativeMask |= 1u << component;
+	return static_cast<int32_t>(localCount) + index;
+}
+
+// face corner: `v`, `v/vt`, `v//vn` or `v/vt/vn`
+static FaceCorner ParseTriple(const char*& curr, const char* end, const ObjChunk& chunk)
+{
+	FaceCorner corner{ { -1, -1, -1 }, 0 };
+	ObjIndex& index = corner.index;
+
+	index.vertexIndex = FixIndex(ParseInt(curr, end), chunk.positions.size() / 3, 0, corner.relativeMask);
+	SkipToSeparator(curr, end);
+	if (curr >= end || *curr != '/')
+		return corner;
+	++curr;
+
+	// v//vn
+	if (curr < end && *curr == '/')
+	{
+		++curr;
+		index.normalIndex = FixIndex(ParseInt(curr, end), chunk.normals.size() / 3, 2, corner.relativeMask);
+		SkipToSeparator(curr, end);
+		return corner;
+	}
+
+	// v/vt/vn or v/vt
+	index.texCoordIndex = FixIndex(ParseInt(curr, end), chunk.texCoords.size() / 2, 1, corner.relativeMask);
+	SkipToSeparator(curr, end);
+	if (curr >= end || *curr != '/')
+		return corner;
+	++curr;
+
+	index.normalIndex = FixIndex(ParseInt(curr, end), chunk.normals.size() / 3, 2, corner.relativeMask);
+	SkipToSeparator(curr, end);
+	return corner;
+}
+
+static void PushCorner(const FaceCorner& corner, ObjChunk& chunk)
+{
+	for (uint32_t component = 0; component < 3; ++component)
+	{
+		if (corner.relativeMask & (1u << component))
+			chunk.relativeComponents.push_back(chunk.indices.size() * 3 + component);
+	}
+
+	chunk.indices.push_back(corner.index);
+}
+
+static void ParseLine(const char* curr, const char* end, ObjChunk& chunk, std::vector<FaceCorner>& face)
+{
+	curr = SkipSpaces(curr, end);
+	if (end - curr < 2)
+		return;
+
+	if (curr[0] == 'v' && IsSpace(curr[1]))
+	{
+		curr += 2;
+		chunk.positions.push_back(ParseReal(curr, end));
+		chunk.positions.push_back(ParseReal(curr, end));
+		chunk.positions.push_back(ParseReal(curr, end));
+	}
+	else if (curr[0] == 'v' && curr[1] == 't' && end - curr > 2 && IsSpace(curr[2]))
+	{
+		curr += 3;
+		chunk.texCoords.push_back(ParseReal(curr, end));
+		chunk.texCoords.push_back(ParseReal(curr, end));
+	}
+	else if (curr[0] == 'v' && curr[1] == 'n' && end - curr > 2 && IsSpace(curr[2]))
+	{
+		curr += 3;
+		chunk.normals.push_back(ParseReal(curr, end));
+		chunk.normals.push_back(ParseReal(curr, end));
+		chunk.normals.push_back(ParseReal(curr, end));
+	}
+	else if (curr[0] == 'f' && IsSpace(curr[1]))
+	{
+		curr = SkipSpaces(curr + 2, end);
+
+		face.clear();
+		while (curr < end && *curr != '\r')
+		{
+			face.push_back(ParseTriple(curr, end, chunk));
+			while (curr < end && (IsSpace(*curr) || *curr == '\r'))
+				++curr;
+		}
+
+		// polygon -> triangle fan
+		for (size_t k = 2; k < face.size(); ++k)
+		{
+			PushCorner(face[0], chunk);
+			PushCorner(face[k - 1], chunk);
+			PushCorner(face[k], chunk);
+		}
+	}
+	else if ((curr[0] == 'o' || curr[0] == 'g') && IsSpace(curr[1]))
+	{
+		chunk.shapeRecords.push_back(ObjShapeRecord{ chunk.indices.size(), false, ParseName(curr + 2, end) });
+	}
+	else if (IsRecord(curr, end, "usemtl", 6))
+	{
+		chunk.shapeRecords.push_back(ObjShapeRecord{ chunk.indices.size(), true, ParseName(curr + 7, end) });
+	}
+	else if (IsRecord(curr, end, "mtllib", 6))
+	{
+		ParseMaterialLibraries(curr + 7, end, chunk.materialLibraries);
+	}
+}
+
+static void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+	std::vector<FaceCorner> face;
+	face.reserve(4);
+
+	const char* lineBegin = begin;
+	while (lineBegin < end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(lineBegin, '\n', static_cast<size_t>(end - lineBegin)));
+		if (!lineEnd)
+			lineEnd = end;
+
+		ParseLine(lineBegin, lineEnd, chunk, face);
+		lineBegin = lineEnd + 1;
+	}
+}
+
+// converts the materials read by tinyobjloader, with the texture paths made
+// relative to the working directory
+static std::vector<ObjMaterial> ConvertMaterials(const std::vector<tinyobj::material_t>& materials,
+	const std::filesystem::path& baseDirectory)
+{
+	std::vector<ObjMaterial> result;
+	result.reserve(materials.size());
+	for (const tinyobj::material_t& material : materials)
+	{
+		ObjMaterial objMaterial{ material.name, "" };
+		if (!material.diffuse_texname.empty())
+			objMaterial.diffuseTexture = (baseDirectory / material.diffuse_texname).generic_string();
+		result.push_back(std::move(objMaterial));
+	}
+
+	return result;
+}
+
+// reads the material libraries and maps the material names to their index
+// the first material with a name wins, like in tinyobjloader; missing files
+// are skipped so that the model is still drawn with the default material
+static std::vector<ObjMaterial> LoadMaterials(const std::vector<std::string>& libraries,
+	const std::filesystem::path& baseDirectory,
+	std::map<std::string, int>& materialMap)
+{
+	std::vector<tinyobj::material_t> materials;
+	for (const std::string& library : libraries)
+	{
+		std::ifstream file{ baseDirectory / library };
+		if (!file.is_open())
+			continue;
+
+		std::string warning;
+		tinyobj::LoadMtl(&materialMap, &materials, &file, &warning);
+	}
+
+	return ConvertMaterials(materials, baseDirectory);
+}
+
+// appends the faces up to `indexEnd` as a shape, or to the last shape if it
+// has the same name and material
+static void AddShape(std::vector<ObjShape>& shapes,
+	const std::string& name,
+	int32_t materialIndex,
+	size_t indexBegin,
+	size_t indexEnd)
+{
+	if (indexEnd <= indexBegin)
+		return;
+
+	if (!shapes.empty())
+	{
+		ObjShape& last = shapes.back();
+		if (last.name == name && last.materialIndex == materialIndex && last.firstIndex + last.indexCount == indexBegin)
+		{
+			last.indexCount += indexEnd - indexBegin;
+			return;
+		}
+	}
+
+	shapes.push_back(ObjShape{ name, materialIndex, indexBegin, indexEnd - indexBegin });
+}
+
+// splits the text into line aligned chunks and parses them on the thread pool
+static std::vector<ObjChunk> ParseChunks(const char* data, size_t size, ThreadPool& threadPool)
+{
+	const size_t chunkCount = std::max<size_t>(1,
+		std::min<size_t>(threadPool.GetThreadCount() * g_ChunksPerThread, size / g_MinChunkSize));
+
+	std::vector<const char*> chunkBegins(chunkCount + 1);
+	chunkBegins[0] = data;
+	chunkBegins[chunkCount] = data + size;
+	for (size_t i = 1; i < chunkCount; ++i)
+	{
+		const char* begin = std::max(chunkBegins[i - 1], data + size * i / chunkCount);
+		const char* newline = static_cast<const char*>(memchr(begin, '\n', static_cast<size_t>(data + size - begin)));
+		chunkBegins[i] = newline ? newline + 1 : data + size;
+	}
+
+	std::vector<ObjChunk> chunks(chunkCount);
+	threadPool.ParallelFor(
+		chunkCount, [&](size_t i) { ParseChunk(chunkBegins[i], chunkBegins[i + 1], chunks[i]); });
+
+	return chunks;
+}
+
+ObjData ParseObj(const std::string& path, ThreadPool& threadPool)
+{
+	MappedFile file{ path };
+	std::vector<ObjChunk> chunks =
+		ParseChunks(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), threadPool);
+	const size_t chunkCount = chunks.size();
+
+	// offsets of each chunk in the merged arrays
+	struct ChunkOffsets
+	{
+		size_t positions;
+		size_t texCoords;
+		size_t normals;
+		size_t indices;
+	};
+
+	std::vector<ChunkOffsets> offsets(chunkCount);
+	ChunkOffsets total{};
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		offsets[i] = total;
+		total.positions += chunks[i].positions.size();
+		total.texCoords += chunks[i].texCoords.size();
+		total.normals += chunks[i].normals.size();
+		total.indices += chunks[i].indices.size();
+	}
+
+	ObjData objData{};
+	objData.positions.resize(total.positions);
+	objData.texCoords.resize(total.texCoords);
+	objData.normals.resize(total.normals);
+	objData.indices.resize(total.indices);
+
+	threadPool.ParallelFor(chunkCount, [&](size_t i) {
+		ObjChunk& chunk = chunks[i];
+		const ChunkOffsets& offset = offsets[i];
+
+		// resolve the relative indices now that the attribute counts before
+		// this chunk are known
+		for (size_t component : chunk.relativeComponents)
+		{
+			ObjIndex& index = chunk.indices[component / 3];
+			if (component % 3 == 0)
+				index.vertexIndex += static_cast<int32_t>(offset.positions / 3);
+			else if (component % 3 == 1)
+				index.texCoordIndex += static_cast<int32_t>(offset.texCoords / 2);
+			else
+				index.normalIndex += static_cast<int32_t>(offset.normals / 3);
+		}
+
+		std::copy(chunk.positions.begin(), chunk.positions.end(), objData.positions.begin() + offset.positions);
+		std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), objData.texCoords.begin() + offset.texCoords);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), objData.normals.begin() + offset.normals);
+		std::copy(chunk.indices.begin(), chunk.indices.end(), objData.indices.begin() + offset.indices);
+
+		// free the geometry of the chunk as soon as it is merged, the shape
+		// records are needed below
+		chunk.positions = {};
+		chunk.texCoords = {};
+		chunk.normals = {};
+		chunk.indices = {};
+		chunk.relativeComponents = {};
+	});
+
+	// the shapes and materials are few, no need for threads
+	std::vector<std::string> libraries;
+	for (const ObjChunk& chunk : chunks)
+		libraries.insert(libraries.end(), chunk.materialLibraries.begin(), chunk.materialLibraries.end());
+
+	std::map<std::string, int> materialMap;
+	objData.materials = LoadMaterials(libraries, std::filesystem::path{ path }.parent_path(), materialMap);
+
+	std::string name;
+	int32_t materialIndex = -1;
+	size_t shapeBegin = 0;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		for (const ObjShapeRecord& record : chunks[i].shapeRecords)
+		{
+			const size_t recordIndex = offsets[i].indices + record.index;
+			AddShape(objData.shapes, name, materialIndex, shapeBegin, recordIndex);
+			shapeBegin = std::max(shapeBegin, recordIndex);
+
+			if (record.isMaterial)
+			{
+				const auto material = materialMap.find(record.value);
+				materialIndex = material != materialMap.end() ? material->second : -1;
+			}
+			else
+			{
+				name = record.value;
+			}
+		}
+	}
+	AddShape(objData.shapes, name, materialIndex, shapeBegin, objData.indices.size());
+
+	return objData;
+}
+
+void StreamObj(const std::string& path,
+	const ObjStreamOptions& options,
+	ThreadPool& threadPool,
+	const std::function<void(const ObjData&)>& onWindow)
+{
+	std::ifstream file{ path, std::ios::binary };
+	if (!file.is_open())
+		throw std::runtime_error("Failed to open model: " + path);
+
+	const std::filesystem::path baseDirectory = std::filesystem::path{ path }.parent_path();
+	std::vector<tinyobj::material_t> materials;
+	std::map<std::string, int> materialMap;
+
+	// the positions and texcoords grow with every window, the faces and
+	// shapes only hold the current window
+	ObjData objData{};
+	size_t normalCount = 0;
+	std::string name;
+	int32_t materialIndex = -1;
+
+	std::vector<char> window(std::max<size_t>(options.windowSize, 1));
+	size_t carried = 0; // bytes of the last, incomplete line of the previous window
+	bool endOfFile = false;
+	while (!endOfFile)
+	{
+		file.read(window.data() + carried, static_cast<std::streamsize>(window.size() - carried));
+		const size_t read = static_cast<size_t>(file.gcount());
+		endOfFile = read < window.size() - carried;
+		const size_t size = carried + read;
+
+		// only whole lines are parsed, the rest is carried over to the next
+		// window
+		size_t end = size;
+		if (!endOfFile)
+		{
+			while (end > 0 && window[end - 1] != '\n')
+				--end;
+			if (end == 0)
+				throw std::runtime_error("OBJ line is longer than the stream window: " + path);
+		}
+
+		std::vector<ObjChunk> chunks = ParseChunks(window.data(), end, threadPool);
+
+		objData.indices.clear();
+		objData.shapes.clear();
+		size_t shapeBegin = 0;
+		for (ObjChunk& chunk : chunks)
+		{
+			// relative indices resolve against everything read before the chunk
+			const size_t indexOffset = objData.indices.size();
+			for (size_t component : chunk.relativeComponents)
+			{
+				ObjIndex& index = chunk.indices[component / 3];
+				if (component % 3 == 0)
+					index.vertexIndex += static_cast<int32_t>(objData.positions.size() / 3);
+				else if (component % 3 == 1)
+					index.texCoordIndex += static_cast<int32_t>(objData.texCoords.size() / 2);
+				else
+					index.normalIndex += static_cast<int32_t>(normalCount);
+			}
+
+			objData.positions.insert(objData.positions.end(), chunk.positions.begin(), chunk.positions.end());
+			objData.texCoords.insert(objData.texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+			normalCount += chunk.normals.size() / 3;
+			objData.indices.insert(objData.indices.end(), chunk.indices.begin(), chunk.indices.end());
+
+			if (!chunk.materialLibraries.empty())
+			{
+				for (const std::string& library : chunk.materialLibraries)
+				{
+					std::ifstream materialFile{ baseDirectory / library };
+					if (!materialFile.is_open())
+						continue;
+
+					std::string warning;
+					tinyobj::LoadMtl(&materialMap, &materials, &materialFile, &warning);
+				}
+				objData.materials = ConvertMaterials(materials, baseDirectory);
+			}
+
+			for (const ObjShapeRecord& record : chunk.shapeRecords)
+			{
+				const size_t recordIndex = indexOffset + record.index;
+				AddShape(objData.shapes, name, materialIndex, shapeBegin, recordIndex);
+				shapeBegin = std::max(shapeBegin, recordIndex);
+
+				if (record.isMaterial)
+				{
+					const auto material = materialMap.find(record.value);
+					materialIndex = material != materialMap.end() ? material->second : -1;
+				}
+				else
+				{
+					name = record.value;
+				}
+			}
+		}
+		AddShape(objData.shapes, name, materialIndex, shapeBegin, objData.indices.size());
+		chunks = {};
+
+		// the faces are handed over to be processed right away, they must
+		// not point past what has been read
+		const size_t positionCount = objData.positions.size() / 3;
+		const size_t texCoordCount = objData.texCoords.size() / 2;
+		for (const ObjIndex& index : objData.indices)
+		{
+			if (index.vertexIndex < 0 || static_cast<size_t>(index.vertexIndex) >= positionCount
+				|| (index.texCoordIndex >= 0 && static_cast<size_t>(index.texCoordIndex) >= texCoordCount))
+				throw std::runtime_error("OBJ face references a vertex declared after it: " + path);
+		}
+
+		if (!objData.indices.empty())
+			onWindow(objData);
+
+		memmove(window.data(), window.data() + end, size - end);
+		carried = size - end;
+	}
+}
+
+std::vector<std::string> FindMaterialLibraries(const std::string& path)
+{
+	MappedFile file{ path };
+	const char* data = reinterpret_cast<const char*>(file.GetData());
+	const char* end = data + file.GetSize();
+	const std::filesystem::path baseDirectory = std::filesystem::path{ path }.parent_path();
+
+	std::vector<std::string> libraries;
+	for (const char* line = data; line < end;)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+		if (!lineEnd)
+			lineEnd = end;
+
+		const char* curr = SkipSpaces(line, lineEnd);
+		if (IsRecord(curr, lineEnd, "mtllib", 6))
+			ParseMaterialLibraries(curr + 7, lineEnd, libraries);
+
+		line = lineEnd + 1;
+	}
+
+	for (std::string& library : libraries)
+		library = (baseDirectory / library).generic_string();
+	return libraries;
+}
+
+ObjData ParseObjReference(const std::string& path)
+{
+	tinyobj::attrib_t attrib;
+	std::vector<tinyobj::shape_t> shapes;
+	std::vector<tinyobj::material_t> materials;
+	std::string err;
+
+	// tinyobjloader expects the trailing separator
+	const std::filesystem::path baseDirectory = std::filesystem::path{ path }.parent_path();
+	const std::string materialDirectory = baseDirectory.empty() ? "" : baseDirectory.generic_string() + "/";
+	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str(), materialDirectory.c_str()))
+		throw std::runtime_error(err);
+
+	ObjData objData{};
+	objData.positions = std::move(attrib.vertices);
+	objData.texCoords = std::move(attrib.texcoords);
+	objData.normals = std::move(attrib.normals);
+	objData.materials = ConvertMaterials(materials, baseDirectory);
+
+	for (const tinyobj::shape_t& shape : shapes)
+	{
+		for (size_t face = 0; face < shape.mesh.material_ids.size(); ++face)
+		{
+			AddShape(objData.shapes,
+				shape.name,
+				shape.mesh.material_ids[face],
+				objData.indices.size(),
+				objData.indices.size() + 3);
+
+			for (size_t corner = face * 3; corner < face * 3 + 3; ++corner)
+			{
+				const tinyobj::index_t& index = shape.mesh.indices[corner];
+				objData.indices.push_back(ObjIndex{ index.vertex_index, index.texcoord_index, index.normal_index });
+			}
+		}
+	}
+
+	return objData;
+}
+
+} // namespace mesh
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/threadPool.h"
+
+
+// zero based indices of a single face corner, -1 if the attribute is missing
+struct ObjIndex
+{
+	int32_t vertexIndex;
+	int32_t texCoordIndex;
+	int32_t normalIndex;
+};
+
+// a material of the `mtllib` files referenced by the OBJ
+struct ObjMaterial
+{
+	std::string name;
+	// `map_Kd`, relative to the working directory; empty if the material has
+	// no diffuse texture
+	std::string diffuseTexture;
+};
+
+// a run of faces with the same object or group name (`o`, `g`) and the
+// same material (`usemtl`)
+struct ObjShape
+{
+	std::string name;
+	int32_t materialIndex; // into `ObjData::materials`, -1 if the faces have no material
+	size_t firstIndex; // into `ObjData::indices`
+	size_t indexCount;
+};
+
+// geometry of a whole OBJ file; faces are triangulated as fans and kept in
+// file order, 3 `ObjIndex` per triangle
+struct ObjData
+{
+	std::vector<float> positions; // xyz
+	std::vector<float> texCoords; // uv
+	std::vector<float> normals; // xyz
+	std::vector<ObjIndex> indices;
+
+	// cover `indices` in file order without gaps, empty shapes are dropped
+	std::vector<ObjShape> shapes;
+	std::vector<ObjMaterial> materials;
+};
+
+struct ObjStreamOptions
+{
+	// bytes of the file read and parsed at once, the memory needed to parse
+	// the file grows with this instead of the file size; a line must fit in
+	// a window
+	size_t windowSize = 16 * 1024 * 1024;
+};
+
+
+namespace mesh {
+
+// maps the file, splits it into line aligned chunks and parses the `v`, `vt`,
+// `vn`, `f`, `o`, `g`, `usemtl` and `mtllib` records of every chunk on the
+// thread pool; the numbers are parsed the same way as tinyobjloader so the
+// result matches it exactly
+// the `mtllib` files are read with tinyobjloader, relative to the OBJ
+ObjData ParseObj(const std::string& path, ThreadPool& threadPool);
+
+// reads the file in windows of `options.windowSize` bytes, parses every
+// window like `ParseObj` and calls `onWindow` as soon as it is parsed, so
+// that only the attributes and the faces of one window are in memory
+// `onWindow` gets the positions and texcoords read so far (the normals are
+// only counted, nothing uses them), the faces and shapes of the window (the
+// shapes are relative to the window) and the materials loaded so far
+// faces must only reference attributes declared before them and `usemtl`
+// must come after its `mtllib`, which is what every exporter writes
+void StreamObj(const std::string& path,
+	const ObjStreamOptions& options,
+	ThreadPool& threadPool,
+	const std::function<void(const ObjData&)>& onWindow);
+
+// the material libraries of the `mtllib` records, relative to the working
+// directory like the texture paths; only scans the lines, eg: to find the
+// files a cooked model depends on without parsing it
+std::vector<std::string> FindMaterialLibraries(const std::string& path);
+
+// single threaded reference parser (tinyobjloader)
+ObjData ParseObjReference(const std::string& path);
+
+} // namespace mesh
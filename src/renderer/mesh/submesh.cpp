@@ -0,0 +1,119 @@
+#include "submesh.h"
+
+#include <cstring>
+#include <limits>
+
+
+namespace mesh {
+
+constexpr uint32_t g_InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+std::vector<Submesh> SplitSubmeshes(std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const std::vector<SubmeshPart>& parts,
+	uint32_t maxVertices)
+{
+	std::vector<Submesh> submeshes;
+
+	// nothing to split, which is the case for most meshes
+	if (parts.size() == 1 && vertices.size() <= maxVertices)
+	{
+		submeshes.push_back(Submesh{ 0,
+			static_cast<uint32_t>(vertices.size()),
+			0,
+			static_cast<uint32_t>(indices.size()),
+			0,
+			0,
+			0,
+			0,
+			parts[0].material,
+			0 });
+		return submeshes;
+	}
+
+	std::vector<Vertex> result;
+	result.reserve(vertices.size() + vertices.size() / 8);
+
+	// local index of every vertex in the current submesh; a vertex belongs
+	// to the current submesh if its stamp matches the submesh index
+	std::vector<uint32_t> localIndices(vertices.size(), g_InvalidIndex);
+	std::vector<uint32_t> stamps(vertices.size(), g_InvalidIndex);
+
+	for (const SubmeshPart& part : parts)
+	{
+		Submesh submesh{};
+		submesh.firstVertex = static_cast<uint32_t>(result.size());
+		submesh.firstIndex = part.firstIndex;
+		submesh.material = part.material;
+
+		for (uint32_t index = part.firstIndex; index < part.firstIndex + part.indexCount; index += 3)
+		{
+			uint32_t* corners = &indices[index];
+
+			uint32_t newVertices = 0;
+			for (size_t corner = 0; corner < 3; ++corner)
+				newVertices += stamps[corners[corner]] != submeshes.size() ? 1 : 0;
+
+			// the triangle starts a new submesh if its vertices do not fit
+			if (submesh.vertexCount + newVertices > maxVertices)
+			{
+				submeshes.push_back(submesh);
+				submesh = Submesh{};
+				submesh.firstVertex = static_cast<uint32_t>(result.size());
+				submesh.firstIndex = index;
+				submesh.material = part.material;
+			}
+
+			const uint32_t stamp = static_cast<uint32_t>(submeshes.size());
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = corners[corner];
+				if (stamps[vertex] != stamp)
+				{
+					stamps[vertex] = stamp;
+					localIndices[vertex] = submesh.vertexCount++;
+					result.push_back(vertices[vertex]);
+				}
+				corners[corner] = localIndices[vertex];
+			}
+
+			submesh.indexCount += 3;
+		}
+
+		if (submesh.indexCount > 0)
+			submeshes.push_back(submesh);
+	}
+
+	vertices = std::move(result);
+	return submeshes;
+}
+
+uint32_t GetIndexSize(const std::vector<Submesh>& submeshes)
+{
+	for (const Submesh& submesh : submeshes)
+	{
+		if (submesh.vertexCount > MAX_SUBMESH_VERTICES)
+			return sizeof(uint32_t);
+	}
+
+	return sizeof(uint16_t);
+}
+
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, uint32_t indexSize)
+{
+	std::vector<uint8_t> result(indices.size() * indexSize);
+	if (indexSize == sizeof(uint32_t))
+	{
+		if (!indices.empty())
+			memcpy(result.data(), indices.data(), result.size());
+		return result;
+	}
+
+	uint16_t* shortIndices = reinterpret_cast<uint16_t*>(result.data());
+	for (size_t i = 0; i < indices.size(); ++i)
+		shortIndices[i] = static_cast<uint16_t>(indices[i]);
+
+	return result;
+}
+
+} // namespace mesh
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+// a part of a model with a single material and few enough vertices to be
+// drawn with 16 bit indices
+// the indices of a submesh are relative to `firstVertex`, which is passed as
+// the vertex offset of its draws
+// stored as is in cooked meshes, so the layout must not change without
+// bumping MESH_FILE_VERSION
+struct Submesh
+{
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+
+	// the full detail triangles
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	// ranges of the model's meshlets and lods that belong to the submesh
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	uint32_t firstLod;
+	uint32_t lodCount;
+
+	uint32_t material; // index into the materials of the model
+	uint32_t padding;
+};
+
+static_assert(sizeof(Submesh) == 40, "Submesh layout must not depend on the compiler");
+
+// a range of triangles that never shares a submesh with other triangles,
+// eg: the faces of one shape of an OBJ
+struct SubmeshPart
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t material;
+};
+
+// the most vertices a submesh drawn with 16 bit indices can reference
+constexpr uint32_t MAX_SUBMESH_VERTICES = 65535;
+
+
+namespace mesh {
+
+// splits the triangles of every part, in their current order, into
+// submeshes that reference at most `maxVertices` vertices each
+// `parts` must cover `indices` in order; empty parts are dropped
+// `vertices` is rewritten so that the vertices of every submesh are
+// contiguous (vertices shared by two submeshes are duplicated) and
+// `indices` is rewritten to be relative to the first vertex of its submesh
+// only the vertex and index ranges and the material of the submeshes are
+// filled
+std::vector<Submesh> SplitSubmeshes(std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices,
+	const std::vector<SubmeshPart>& parts,
+	uint32_t maxVertices = MAX_SUBMESH_VERTICES);
+
+// size in bytes of the indices the submeshes need: 2 if every submesh
+// references at most MAX_SUBMESH_VERTICES vertices, 4 otherwise
+uint32_t GetIndexSize(const std::vector<Submesh>& submeshes);
+
+// converts the indices to `indexSize` bytes each
+std::vector<uint8_t> PackIndices(const std::vector<uint32_t>& indices, uint32_t indexSize);
+
+} // namespace mesh
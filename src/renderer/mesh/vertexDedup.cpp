@@ -0,0 +1,274 @@
+#include "vertexDedup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+
+namespace mesh {
+
+constexpr uint32_t g_EmptySlot = std::numeric_limits<uint32_t>::max();
+// vertices handed to a single task when hashing or writing the output
+constexpr size_t g_MinRangeSize = 16 * 1024;
+
+// finalizer of MurmurHash3, every input bit affects every output bit
+static inline uint64_t Mix64(uint64_t value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdull;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ull;
+	value ^= value >> 33;
+	return value;
+}
+
+uint64_t HashVertex(const Vertex& vertex)
+{
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex is hashed in 32 bit words");
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+	uint64_t hash = 0x9e3779b97f4a7c15ull ^ sizeof(Vertex);
+
+	size_t offset = 0;
+	for (; offset + sizeof(uint64_t) <= sizeof(Vertex); offset += sizeof(uint64_t))
+	{
+		uint64_t word;
+		memcpy(&word, bytes + offset, sizeof(word));
+		hash = (hash ^ Mix64(word)) * 0x9e3779b97f4a7c15ull;
+	}
+	if (offset < sizeof(Vertex))
+	{
+		uint32_t word;
+		memcpy(&word, bytes + offset, sizeof(word));
+		hash = (hash ^ Mix64(word)) * 0x9e3779b97f4a7c15ull;
+	}
+
+	return Mix64(hash);
+}
+
+static inline bool IsSameVertex(const Vertex& lhs, const Vertex& rhs)
+{
+	return memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+}
+
+// open addressing hash table with linear probing
+// maps a vertex to a value (a unique vertex index or the position of the
+// first occurrence); the vertices themselves are not copied, slots only hold
+// the position of the vertex in the input and 32 bits of its hash to skip
+// most comparisons
+class VertexTable
+{
+public:
+	VertexTable(size_t expectedCount)
+	{
+		// keep the load factor at or below 0.5 so probe sequences stay short
+		size_t capacity = 16;
+		while (capacity < expectedCount * 2)
+			capacity *= 2;
+
+		m_Slots.assign(capacity, Slot{ 0, g_EmptySlot, 0 });
+		m_Mask = capacity - 1;
+	}
+
+	// returns the value stored for the vertex at `position`, or stores and
+	// returns `value` if the vertex is not in the table yet
+	inline uint32_t FindOrInsert(const std::vector<Vertex>& vertices, uint32_t position, uint64_t hash, uint32_t value)
+	{
+		// the low bits of the hash pick the partition, so the high bits
+		// pick the slot
+		const uint32_t tag = static_cast<uint32_t>(hash);
+		size_t slotIndex = static_cast<size_t>(hash >> 32) & m_Mask;
+
+		while (true)
+		{
+			Slot& slot = m_Slots[slotIndex];
+			if (slot.position == g_EmptySlot)
+			{
+				slot = Slot{ tag, position, value };
+				return value;
+			}
+
+			if (slot.tag == tag && IsSameVertex(vertices[slot.position], vertices[position]))
+				return slot.value;
+
+			slotIndex = (slotIndex + 1) & m_Mask;
+		}
+	}
+
+private:
+	struct Slot
+	{
+		uint32_t tag;
+		uint32_t position;
+		uint32_t value;
+	};
+
+	std::vector<Slot> m_Slots;
+	size_t m_Mask;
+};
+
+static void DeduplicateSerial(const std::vector<Vertex>& vertices,
+	std::vector<Vertex>& uniqueVertices,
+	std::vector<uint32_t>& indices)
+{
+	VertexTable table{ vertices.size() };
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(vertices.size()); ++i)
+	{
+		const uint32_t uniqueIndex = static_cast<uint32_t>(uniqueVertices.size());
+		indices[i] = table.FindOrInsert(vertices, i, HashVertex(vertices[i]), uniqueIndex);
+
+		if (indices[i] == uniqueIndex)
+			uniqueVertices.push_back(vertices[i]);
+	}
+}
+
+static void DeduplicatePartitioned(const std::vector<Vertex>& vertices,
+	std::vector<Vertex>& uniqueVertices,
+	std::vector<uint32_t>& indices,
+	ThreadPool& threadPool)
+{
+	const size_t count = vertices.size();
+
+	// power of two so the partition is just the low bits of the hash
+	size_t partitionCount = 1;
+	while (partitionCount < threadPool.GetThreadCount())
+		partitionCount *= 2;
+	const uint64_t partitionMask = partitionCount - 1;
+
+	std::vector<uint64_t> hashes(count);
+	threadPool.ParallelForRange(count, g_MinRangeSize, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			hashes[i] = HashVertex(vertices[i]);
+	});
+
+	// every partition only sees the vertices whose hash falls into it, so
+	// duplicates always end up in the same partition and the tables are
+	// never shared between threads
+	// `firstOccurrence[i]` is the position of the first vertex equal to `i`
+	std::vector<uint32_t> firstOccurrence(count);
+	threadPool.ParallelFor(partitionCount, [&](size_t partition) {
+		VertexTable table{ count / partitionCount + 1 };
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(count); ++i)
+		{
+			if ((hashes[i] & partitionMask) == partition)
+				firstOccurrence[i] = table.FindOrInsert(vertices, i, hashes[i], i);
+		}
+	});
+
+	hashes = std::vector<uint64_t>{};
+
+	// number the first occurrences in input order, which makes the output
+	// identical to the serial path
+	// `uniqueIndices[i]` is only meaningful for first occurrences
+	std::vector<uint32_t> uniqueIndices(count);
+	uint32_t uniqueCount = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		uniqueIndices[i] = uniqueCount;
+		uniqueCount += firstOccurrence[i] == i ? 1 : 0;
+	}
+
+	uniqueVertices.resize(uniqueCount);
+	threadPool.ParallelForRange(count, g_MinRangeSize, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			indices[i] = uniqueIndices[firstOccurrence[i]];
+			if (firstOccurrence[i] == i)
+				uniqueVertices[uniqueIndices[i]] = vertices[i];
+		}
+	});
+}
+
+VertexDedupStats DeduplicateVertices(const std::vector<Vertex>& vertices,
+	std::vector<Vertex>& uniqueVertices,
+	std::vector<uint32_t>& indices,
+	ThreadPool* threadPool)
+{
+	if (vertices.size() >= g_EmptySlot)
+		throw std::runtime_error("Too many vertices to index with 32 bit indices!");
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	uniqueVertices.clear();
+	indices.resize(vertices.size());
+
+	if (threadPool && threadPool->GetThreadCount() > 1 && vertices.size() > g_MinRangeSize)
+		DeduplicatePartitioned(vertices, uniqueVertices, indices, *threadPool);
+	else
+		DeduplicateSerial(vertices, uniqueVertices, indices);
+
+	const auto end = std::chrono::high_resolution_clock::now();
+
+	VertexDedupStats stats{};
+	stats.totalVertices = vertices.size();
+	stats.uniqueVertices = uniqueVertices.size();
+	stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return stats;
+}
+
+VertexDedupTable::VertexDedupTable()
+	: m_Slots(16, Slot{ 0, g_EmptySlot }),
+	  m_Mask{ 15 }
+{
+}
+
+size_t VertexDedupTable::FindSlot(const Vertex& vertex, uint64_t hash) const
+{
+	const uint32_t tag = static_cast<uint32_t>(hash);
+	size_t slotIndex = static_cast<size_t>(hash >> 32) & m_Mask;
+
+	while (true)
+	{
+		const Slot& slot = m_Slots[slotIndex];
+		if (slot.index == g_EmptySlot || (slot.tag == tag && IsSameVertex(m_Vertices[slot.index], vertex)))
+			return slotIndex;
+
+		slotIndex = (slotIndex + 1) & m_Mask;
+	}
+}
+
+uint32_t VertexDedupTable::Find(const Vertex& vertex) const
+{
+	return m_Slots[FindSlot(vertex, HashVertex(vertex))].index;
+}
+
+uint32_t VertexDedupTable::FindOrAdd(const Vertex& vertex)
+{
+	const uint64_t hash = HashVertex(vertex);
+	Slot& slot = m_Slots[FindSlot(vertex, hash)];
+	if (slot.index != g_EmptySlot)
+		return slot.index;
+
+	slot = Slot{ static_cast<uint32_t>(hash), static_cast<uint32_t>(m_Vertices.size()) };
+	m_Vertices.push_back(vertex);
+
+	// same load factor as `VertexTable`
+	if (m_Vertices.size() * 2 > m_Slots.size())
+		Grow();
+
+	return static_cast<uint32_t>(m_Vertices.size() - 1);
+}
+
+void VertexDedupTable::Clear()
+{
+	std::fill(m_Slots.begin(), m_Slots.end(), Slot{ 0, g_EmptySlot });
+	m_Vertices.clear();
+}
+
+void VertexDedupTable::Grow()
+{
+	m_Slots.assign(m_Slots.size() * 2, Slot{ 0, g_EmptySlot });
+	m_Mask = m_Slots.size() - 1;
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_Vertices.size()); ++i)
+	{
+		const uint64_t hash = HashVertex(m_Vertices[i]);
+		m_Slots[FindSlot(m_Vertices[i], hash)] = Slot{ static_cast<uint32_t>(hash), i };
+	}
+}
+
+} // namespace mesh
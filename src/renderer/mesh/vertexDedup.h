@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/threadPool.h"
+#include "renderer/buffer/vertexBuffer.h"
+
+
+struct VertexDedupStats
+{
+	size_t totalVertices; // vertices before deduplication (one per index)
+	size_t uniqueVertices;
+	double milliseconds;
+};
+
+
+namespace mesh {
+
+// hash of the raw bytes of a vertex
+// vertices are compared bitwise as well, so the hash is consistent with the
+// comparison even for -0.0f and NaNs
+uint64_t HashVertex(const Vertex& vertex);
+
+// collapses bitwise identical vertices of `vertices` (one vertex per index)
+// into `uniqueVertices` and writes an index per input vertex to `indices`
+// the unique vertices keep the order of their first occurrence, so the
+// result is the same with and without a thread pool; with a pool, the
+// vertices are partitioned by hash and each partition is deduplicated by a
+// different thread
+VertexDedupStats DeduplicateVertices(const std::vector<Vertex>& vertices,
+	std::vector<Vertex>& uniqueVertices,
+	std::vector<uint32_t>& indices,
+	ThreadPool* threadPool = nullptr);
+
+// incremental deduplication for vertices that arrive in pieces, eg: the
+// windows of a streamed OBJ; keeps a copy of every unique vertex, in the
+// order of their first occurrence, and grows as they are added
+class VertexDedupTable
+{
+public:
+	static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+	VertexDedupTable();
+
+	// index of `vertex` in `GetVertices()`, or NOT_FOUND
+	uint32_t Find(const Vertex& vertex) const;
+	// index of `vertex` in `GetVertices()`, added if it is not there yet
+	uint32_t FindOrAdd(const Vertex& vertex);
+	// removes every vertex but keeps the memory
+	void Clear();
+
+	inline const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+	inline size_t GetSize() const { return m_Vertices.size(); }
+
+private:
+	// slot of `vertex`, or the empty slot it would go to
+	size_t FindSlot(const Vertex& vertex, uint64_t hash) const;
+	void Grow();
+
+private:
+	struct Slot
+	{
+		uint32_t tag;
+		uint32_t index;
+	};
+
+	std::vector<Slot> m_Slots;
+	size_t m_Mask;
+	std::vector<Vertex> m_Vertices;
+};
+
+} // namespace mesh
@@ -0,0 +1,146 @@
+#include "vertexQuantizer.h"
+
+#include <cstring>
+
+#include "glm/gtc/packing.hpp"
+
+
+namespace mesh {
+
+// quantized vertex as laid out by `VertexLayout::FLOAT16` and
+// `VertexLayout::SNORM16`
+struct QuantizedVertex
+{
+	uint16_t pos[4]; // w is padding
+	uint16_t texCoord[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must match the attribute offsets");
+
+const char* GetVertexLayoutName(VertexLayout layout)
+{
+	switch (layout)
+	{
+	case VertexLayout::FLOAT32:
+		return "float32";
+	case VertexLayout::FLOAT16:
+		return "float16";
+	case VertexLayout::SNORM16:
+		return "snorm16";
+	}
+
+	return "unknown";
+}
+
+// a zero extent (eg: flat meshes or meshes without uvs) would divide by 0
+static float GetSafeScale(float extent)
+{
+	return extent > 0.0f ? extent : 1.0f;
+}
+
+void VertexBounds::Add(const Vertex& vertex)
+{
+	posMin = glm::min(posMin, vertex.pos);
+	posMax = glm::max(posMax, vertex.pos);
+	texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+	texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+}
+
+VertexQuantization GetVertexQuantization(const std::vector<Vertex>& vertices, VertexLayout layout)
+{
+	VertexBounds bounds;
+	for (const Vertex& vertex : vertices)
+		bounds.Add(vertex);
+
+	return GetVertexQuantization(bounds, layout);
+}
+
+VertexQuantization GetVertexQuantization(const VertexBounds& bounds, VertexLayout layout)
+{
+	VertexQuantization quantization{};
+	if (layout == VertexLayout::FLOAT32 || bounds.IsEmpty())
+		return quantization;
+
+	const glm::vec3& posMin = bounds.posMin;
+	const glm::vec3& posMax = bounds.posMax;
+	const glm::vec2& texCoordMin = bounds.texCoordMin;
+	const glm::vec2& texCoordMax = bounds.texCoordMax;
+
+	quantization.positionOffset = (posMin + posMax) * 0.5f;
+	if (layout == VertexLayout::SNORM16)
+	{
+		const glm::vec3 halfExtent = (posMax - posMin) * 0.5f;
+		quantization.positionScale =
+			glm::vec3{ GetSafeScale(halfExtent.x), GetSafeScale(halfExtent.y), GetSafeScale(halfExtent.z) };
+	}
+
+	// uvs outside of [0, 1] (eg: tiled textures) still fit in unorm16
+	const glm::vec2 texCoordExtent = texCoordMax - texCoordMin;
+	quantization.texCoordOffset = texCoordMin;
+	quantization.texCoordScale = glm::vec2{ GetSafeScale(texCoordExtent.x), GetSafeScale(texCoordExtent.y) };
+
+	return quantization;
+}
+
+std::vector<uint8_t> QuantizeVertices(const std::vector<Vertex>& vertices,
+	VertexLayout layout,
+	const VertexQuantization& quantization)
+{
+	std::vector<uint8_t> result(vertices.size() * Vertex::GetStride(layout));
+	if (layout == VertexLayout::FLOAT32)
+	{
+		if (!vertices.empty())
+			memcpy(result.data(), vertices.data(), result.size());
+		return result;
+	}
+
+	const glm::vec3 invPositionScale = 1.0f / quantization.positionScale;
+	const glm::vec2 invTexCoordScale = 1.0f / quantization.texCoordScale;
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const glm::vec3 pos = (vertices[i].pos - quantization.positionOffset) * invPositionScale;
+		const glm::vec2 texCoord = (vertices[i].texCoord - quantization.texCoordOffset) * invTexCoordScale;
+
+		QuantizedVertex quantized{};
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			quantized.pos[axis] = layout == VertexLayout::SNORM16 ? glm::packSnorm1x16(pos[axis])
+																  : glm::packHalf1x16(pos[axis]);
+		}
+		quantized.texCoord[0] = glm::packUnorm1x16(texCoord.x);
+		quantized.texCoord[1] = glm::packUnorm1x16(texCoord.y);
+
+		memcpy(result.data() + i * sizeof(QuantizedVertex), &quantized, sizeof(QuantizedVertex));
+	}
+
+	return result;
+}
+
+Vertex DequantizeVertex(const uint8_t* vertexData, VertexLayout layout, const VertexQuantization& quantization)
+{
+	Vertex vertex{};
+	if (layout == VertexLayout::FLOAT32)
+	{
+		memcpy(&vertex, vertexData, sizeof(Vertex));
+		return vertex;
+	}
+
+	QuantizedVertex quantized{};
+	memcpy(&quantized, vertexData, sizeof(QuantizedVertex));
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		vertex.pos[axis] = layout == VertexLayout::SNORM16 ? glm::unpackSnorm1x16(quantized.pos[axis])
+														   : glm::unpackHalf1x16(quantized.pos[axis]);
+	}
+	vertex.texCoord = glm::vec2{ glm::unpackUnorm1x16(quantized.texCoord[0]),
+		glm::unpackUnorm1x16(quantized.texCoord[1]) };
+
+	vertex.pos = quantization.positionOffset + quantization.positionScale * vertex.pos;
+	vertex.texCoord = quantization.texCoordOffset + quantization.texCoordScale * vertex.texCoord;
+
+	return vertex;
+}
+
+} // namespace mesh
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "renderer/buffer/vertexBuffer.h"
+
+
+namespace mesh {
+
+const char* GetVertexLayoutName(VertexLayout layout);
+
+// range of the positions and texture coordinates of a set of vertices, for
+// when they are never all in memory at once (eg: a streamed model)
+struct VertexBounds
+{
+	glm::vec3 posMin{ std::numeric_limits<float>::max() };
+	glm::vec3 posMax{ std::numeric_limits<float>::lowest() };
+	glm::vec2 texCoordMin{ std::numeric_limits<float>::max() };
+	glm::vec2 texCoordMax{ std::numeric_limits<float>::lowest() };
+
+	void Add(const Vertex& vertex);
+	inline bool IsEmpty() const { return posMin.x > posMax.x; }
+};
+
+// the quantization that fits the positions and texture coordinates of
+// `vertices` into the range of `layout`
+// snorm16 positions cover the bounding box, float16 positions are only
+// centered since half floats are most precise around 0
+VertexQuantization GetVertexQuantization(const std::vector<Vertex>& vertices, VertexLayout layout);
+VertexQuantization GetVertexQuantization(const VertexBounds& bounds, VertexLayout layout);
+
+// converts the vertices to `layout`; returns `Vertex::GetStride(layout)`
+// bytes per vertex, ready to be uploaded
+std::vector<uint8_t> QuantizeVertices(const std::vector<Vertex>& vertices,
+	VertexLayout layout,
+	const VertexQuantization& quantization);
+
+// decodes a single vertex the same way the vertex input does
+Vertex DequantizeVertex(const uint8_t* vertexData, VertexLayout layout, const VertexQuantization& quantization);
+
+} // namespace mesh
@@ -1,53 +1,784 @@
 #include "model.h"
 
-#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tinyobjloader/tiny_obj_loader.h"
+#include "core/hash.h"
+#include "core/memoryStats.h"
 
 
-Model::Model(const char* modelPath)
-	: m_ModelPath{ modelPath }
+Model::Model(const char* modelPath, const ModelLoadOptions& options)
+	: m_ModelPath{ modelPath },
+	  m_Options{ options },
+	  m_VertexCount{ 0 },
+	  m_VertexLayout{ options.vertexLayout },
+	  m_IndexCount{ 0 },
+	  m_IndexSize{ sizeof(uint32_t) },
+	  m_BoundsMin{ 0.0f },
+	  m_BoundsMax{ 0.0f },
+	  m_IsCooked{ false },
+	  m_DefaultMaterial{ std::numeric_limits<uint32_t>::max() },
+	  m_DedupStats{},
+	  m_OptimizeStats{},
+	  m_OptimizedTriangleCount{ 0 },
+	  m_OptimizedVertexCount{ 0 }
 {
 	LoadModel();
 }
 
+void Model::OnUploaded()
+{
+	if (m_Options.residency != GeometryResidency::RELEASE_AFTER_UPLOAD)
+		return;
+
+	// swapping with empty vectors actually frees the memory, unlike clear()
+	std::vector<Vertex>().swap(m_Vertices);
+	std::vector<uint8_t>().swap(m_VertexData);
+	std::vector<uint32_t>().swap(m_Indices);
+	std::vector<uint8_t>().swap(m_IndexData);
+	m_MeshFile.reset();
+}
+
+std::string Model::GetCookedPath(const std::string& modelPath)
+{
+	return std::filesystem::path{ modelPath }.replace_extension(".mesh").string();
+}
+
+bool Model::IsCookedMeshUpToDate(const std::string& cookedPath) const
+{
+	std::error_code errorCode;
+	if (!std::filesystem::exists(cookedPath, errorCode))
+		return false;
+
+	// a cooked mesh without its source is used as is
+	if (std::filesystem::exists(m_ModelPath, errorCode))
+	{
+		const auto sourceTime = std::filesystem::last_write_time(m_ModelPath, errorCode);
+		const auto cookedTime = std::filesystem::last_write_time(cookedPath, errorCode);
+		if (errorCode || cookedTime < sourceTime)
+			return false;
+	}
+
+	return MeshFile::IsCompatible(cookedPath, GetCookedMeshFlags(), m_Options.vertexLayout);
+}
+
+uint64_t Model::GetCacheKey() const
+{
+	// the materials come from the material libraries, with texture paths
+	// relative to the directory of the model
+	uint64_t sourceHash = hash::HashFile(m_ModelPath);
+	for (const std::string& library : mesh::FindMaterialLibraries(m_ModelPath))
+	{
+		std::error_code errorCode;
+		const bool exists = std::filesystem::is_regular_file(library, errorCode);
+		sourceHash = hash::Combine(sourceHash, exists ? hash::HashFile(library) : 0);
+	}
+	const std::string directory = std::filesystem::path{ m_ModelPath }.parent_path().generic_string();
+	sourceHash = hash::HashBytes(directory.data(), directory.size(), sourceHash);
+
+	const uint64_t parametersHash =
+		hash::Combine(GetCookedMeshFlags(), static_cast<uint64_t>(m_Options.vertexLayout));
+	return AssetCache::MakeKey("mesh", MESH_FILE_VERSION, sourceHash, parametersHash);
+}
+
+uint32_t Model::GetCookedMeshFlags() const
+{
+	uint32_t flags = MESH_FILE_FLAG_NONE;
+	if (m_Options.optimizeMesh)
+		flags |= MESH_FILE_FLAG_OPTIMIZED;
+	if (m_Options.buildMeshlets)
+		flags |= MESH_FILE_FLAG_MESHLETS;
+	if (m_Options.buildLods)
+		flags |= MESH_FILE_FLAG_LODS;
+	if (m_Options.splitSubmeshes)
+		flags |= MESH_FILE_FLAG_SUBMESHES;
+	if (m_Options.compressCookedMesh)
+		flags |= MESH_FILE_FLAG_COMPRESSED;
+	return flags;
+}
+
 void Model::LoadModel()
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	const std::string cookedPath = GetCookedPath(m_ModelPath);
+	if (m_Options.requireCookedMesh)
+	{
+		// the source model may have changed since, but it is up to the
+		// cooker to notice
+		if (!MeshFile::IsCompatible(cookedPath, GetCookedMeshFlags(), m_Options.vertexLayout))
+			throw std::runtime_error("Cooked mesh is missing or out of date, run assetCooker: " + cookedPath);
+
+		LoadCooked(cookedPath);
+		return;
+	}
+
+	if (m_Options.useCookedMesh && IsCookedMeshUpToDate(cookedPath))
+	{
+		LoadCooked(cookedPath);
+		return;
+	}
+
+	// a cooked mesh older than its source may still have the same contents
+	// as a cached one, eg: after a checkout that touched the source
+	uint64_t cacheKey = 0;
+	if (m_Options.useCookedMesh && m_Options.cache)
+	{
+		cacheKey = GetCacheKey();
+		if (m_Options.cache->Extract(cacheKey, cookedPath)
+			&& MeshFile::IsCompatible(cookedPath, GetCookedMeshFlags(), m_Options.vertexLayout))
+		{
+			LoadCooked(cookedPath);
+			return;
+		}
+	}
+
+	ThreadPool threadPool{ m_Options.threadCount };
+	if (m_Options.streamObj)
+		LoadObjStreamed(threadPool);
+	else
+		LoadObj(threadPool);
+
+	// a streamed model went to the stream target as it was built, there is
+	// nothing left to cook
+	if (!m_Options.useCookedMesh || m_Options.streamObj)
+		return;
+
+	// the vertices are delta coded per byte, the indices against the
+	// highest index so far, which the optimized vertex order keeps small
+	std::vector<uint8_t> encodedVertices;
+	std::vector<uint8_t> encodedIndices;
+	EncodedStream vertexData = codec::MakeRawStream(m_VertexData);
+	EncodedStream indexData = codec::MakeRawStream(m_IndexData);
+	if (m_Options.compressCookedMesh)
+	{
+		const uint32_t stride = Vertex::GetStride(m_Options.vertexLayout);
+		encodedVertices = codec::Encode(m_VertexData, StreamEncoding::DELTA, stride, threadPool);
+		encodedIndices = codec::Encode(m_IndexData, StreamEncoding::INDEX, m_IndexSize, threadPool);
+		vertexData = EncodedStream{ encodedVertices, m_VertexData.size(), StreamEncoding::DELTA, stride };
+		indexData = EncodedStream{ encodedIndices, m_IndexData.size(), StreamEncoding::INDEX, m_IndexSize };
+
+		std::cout << "Compressed cooked mesh: " << m_VertexData.size() + m_IndexData.size() << " -> "
+				  << encodedVertices.size() + encodedIndices.size() << " bytes\n\n";
+	}
+
+	// the cooked mesh is only a cache, failing to write it is not fatal
+	MeshFileContents contents{};
+	contents.vertexData = vertexData;
+	contents.vertexCount = m_Vertices.size();
+	contents.vertexLayout = m_Options.vertexLayout;
+	contents.quantization = m_Quantization;
+	contents.boundsMin = m_BoundsMin;
+	contents.boundsMax = m_BoundsMax;
+	contents.indexData = indexData;
+	contents.indexCount = m_Indices.size();
+	contents.indexSize = m_IndexSize;
+	contents.submeshes = m_Submeshes.data();
+	contents.submeshCount = m_Submeshes.size();
+	contents.meshlets = m_Meshlets.data();
+	contents.meshletCount = m_Meshlets.size();
+	contents.lods = m_Lods.data();
+	contents.lodCount = m_Lods.size();
+	contents.materials = m_Materials.data();
+	contents.materialCount = m_Materials.size();
+	contents.flags = GetCookedMeshFlags();
+	if (!MeshFile::Write(cookedPath, contents))
+		std::cout << "Failed to write cooked mesh: " << cookedPath << '\n';
+	else if (m_Options.cache)
+		m_Options.cache->StoreFile(cacheKey, cookedPath);
+}
+
+void Model::LoadCooked(const std::string& cookedPath)
+{
+	m_MeshFile = std::make_unique<MeshFile>(cookedPath);
+	m_IsCooked = true;
+
+	m_VertexCount = static_cast<size_t>(m_MeshFile->GetVertexCount());
+	m_VertexLayout = m_MeshFile->GetVertexLayout();
+	m_Quantization = m_MeshFile->GetVertexQuantization();
+	m_IndexCount = static_cast<size_t>(m_MeshFile->GetIndexCount());
+	m_IndexSize = m_MeshFile->GetIndexSize();
+	m_BoundsMin = m_MeshFile->GetBoundsMin();
+	m_BoundsMax = m_MeshFile->GetBoundsMax();
+
+	// small compared to the geometry, and needed every frame after the
+	// mapping is gone
+	m_Submeshes.assign(m_MeshFile->GetSubmeshes(), m_MeshFile->GetSubmeshes() + m_MeshFile->GetSubmeshCount());
+	m_Meshlets.assign(m_MeshFile->GetMeshlets(), m_MeshFile->GetMeshlets() + m_MeshFile->GetMeshletCount());
+	m_Lods.assign(m_MeshFile->GetLods(), m_MeshFile->GetLods() + m_MeshFile->GetLodCount());
+	m_Materials.assign(m_MeshFile->GetMaterials(), m_MeshFile->GetMaterials() + m_MeshFile->GetMaterialCount());
+}
+
+// the stats of the submeshes weighted by their triangles (ACMR) and
+// vertices (ATVR); `NormalizeOptimizeStats` divides the sums by the totals of
+// the full detail levels that were optimized, not by the index buffer, which
+// also holds the coarser levels, which gives the stats of the whole model
+static void AddOptimizeStats(MeshOptimizeStats& total,
+	const MeshOptimizeStats& stats,
+	size_t triangleCount,
+	size_t vertexCount)
+{
+	const float triangleWeight = static_cast<float>(triangleCount);
+	const float vertexWeight = static_cast<float>(vertexCount);
+
+	total.before.acmr += stats.before.acmr * triangleWeight;
+	total.before.atvr += stats.before.atvr * vertexWeight;
+	total.after.acmr += stats.after.acmr * triangleWeight;
+	total.after.atvr += stats.after.atvr * vertexWeight;
+	total.milliseconds += stats.milliseconds;
+}
+
+static MeshOptimizeStats NormalizeOptimizeStats(MeshOptimizeStats total, size_t triangleCount, size_t vertexCount)
+{
+	const float triangleWeight = 1.0f / static_cast<float>(std::max<size_t>(triangleCount, 1));
+	const float vertexWeight = 1.0f / static_cast<float>(std::max<size_t>(vertexCount, 1));
+
+	total.before.acmr *= triangleWeight;
+	total.before.atvr *= vertexWeight;
+	total.after.acmr *= triangleWeight;
+	total.after.atvr *= vertexWeight;
+	return total;
+}
+
+void Model::LoadObj(ThreadPool& threadPool)
+{
+	std::vector<SubmeshPart> parts;
+	{
+		const ObjData objData = m_Options.parallelObjParser ? mesh::ParseObj(m_ModelPath, threadPool)
+															: mesh::ParseObjReference(m_ModelPath);
+		m_DedupStats = BuildVertices(objData, threadPool, m_Vertices, m_Indices);
+
+		std::vector<uint32_t> materialIndices;
+		AddMaterials(objData, materialIndices);
+		parts = BuildParts(objData, materialIndices, m_Indices.size());
+	}
+
+	std::cout << "Loaded model: " << m_ModelPath << '\n'
+			  << "    Vertices: " << m_DedupStats.uniqueVertices << " unique of " << m_DedupStats.totalVertices
+			  << " (deduplicated in " << m_DedupStats.milliseconds << " ms)\n"
+			  << "    Shapes: " << parts.size() << " (" << m_Materials.size() << " materials)\n";
+
+	BuildSubmeshes(parts);
+	ComputeBounds();
+	PackGeometry();
+}
+
+// what the first pass over a streamed OBJ measures, and the second pass
+// checks that it wrote
+struct Model::StreamedGeometrySize
+{
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	size_t submeshCount = 0;
+	size_t partCount = 0;
+	uint32_t maxSubmeshVertices = 0;
+	mesh::VertexBounds bounds;
+};
+
+// the first pass sizes the buffers and the quantization, so the second one
+// can pack and write every piece as soon as it is built; only the faces of a
+// window and the vertices of the open submesh are in memory at once
+void Model::LoadObjStreamed(ThreadPool& threadPool)
+{
+	const StreamedGeometryTarget& target = m_Options.streamTarget;
+	if (!target.reserve || !target.writeVertices || !target.writeIndices)
+		throw std::runtime_error(std::string{ "Streaming an OBJ needs a target for its geometry: " } + m_ModelPath);
+
+	StreamedGeometrySize size{};
+	StreamObjPass(threadPool, size, false);
+
+	m_VertexCount = size.vertexCount;
+	m_IndexCount = size.indexCount;
+	m_IndexSize = size.maxSubmeshVertices > MAX_SUBMESH_VERTICES ? sizeof(uint32_t) : sizeof(uint16_t);
+	m_Quantization = mesh::GetVertexQuantization(size.bounds, m_Options.vertexLayout);
+	m_BoundsMin = size.bounds.IsEmpty() ? glm::vec3{ 0.0f } : size.bounds.posMin;
+	m_BoundsMax = size.bounds.IsEmpty() ? glm::vec3{ 0.0f } : size.bounds.posMax;
+	target.reserve(m_VertexCount * Vertex::GetStride(m_Options.vertexLayout), m_IndexCount * m_IndexSize, m_IndexSize);
+
+	m_DedupStats = VertexDedupStats{};
+	m_OptimizeStats = MeshOptimizeStats{};
+	m_OptimizedTriangleCount = 0;
+	m_OptimizedVertexCount = 0;
+	StreamedGeometrySize written{};
+	const size_t windowCount = StreamObjPass(threadPool, written, true);
+	if (written.vertexCount != size.vertexCount || written.indexCount != size.indexCount
+		|| written.submeshCount != size.submeshCount)
+		throw std::runtime_error(std::string{ "OBJ changed while streaming it: " } + m_ModelPath);
+	m_DedupStats.uniqueVertices = m_VertexCount;
+
+	// a model without faces still has a submesh and a material
+	if (m_Submeshes.empty())
+	{
+		Submesh submesh{};
+		submesh.material = GetDefaultMaterial();
+		submesh.firstLod = static_cast<uint32_t>(m_Lods.size());
+		submesh.lodCount = 1;
+		m_Lods.push_back(MeshLod{ 0, 0, 0.0f, 0 });
+		m_Submeshes.push_back(submesh);
+	}
+
+	std::cout << "Loaded model: " << m_ModelPath << " (streamed in " << windowCount << " windows of "
+			  << m_Options.streamOptions.windowSize / 1024 << " KB)\n"
+			  << "    Vertices: " << m_DedupStats.uniqueVertices << " unique of " << m_DedupStats.totalVertices
+			  << " (deduplicated in " << m_DedupStats.milliseconds << " ms)\n"
+			  << "    Shapes: " << size.partCount << " (" << m_Materials.size() << " materials)\n";
+
+	m_OptimizeStats = NormalizeOptimizeStats(m_OptimizeStats, m_OptimizedTriangleCount, m_OptimizedVertexCount);
+	PrintSubmeshStats();
+	PrintGeometryStats();
+	std::cout << "    Peak resident: " << memory::GetPeakResidentBytes() / (1024 * 1024) << " MB\n\n";
+}
+
+// one pass over the windows of the OBJ, which splits the shapes into
+// submeshes exactly like `mesh::SplitSubmeshes`; without `write` it only
+// measures them into `size`, with it it also builds their meshlets and
+// writes them to the stream target; returns the number of windows
+size_t Model::StreamObjPass(ThreadPool& threadPool, StreamedGeometrySize& size, bool write)
+{
+	constexpr uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+	const uint32_t maxVertices = m_Options.splitSubmeshes ? MAX_SUBMESH_VERTICES : UINT32_MAX;
+	const uint32_t stride = Vertex::GetStride(m_Options.vertexLayout);
+
+	// the open submesh, the shape of the OBJ it belongs to, and its triangles
+	// and vertices that are not written yet
+	mesh::VertexDedupTable submeshVertices;
+	Submesh submesh{};
+	bool isSubmeshOpen = false;
+	uint32_t submeshStamp = 0;
+	std::string shapeName;
+	int32_t shapeMaterial = -1;
+	std::vector<uint32_t> pendingIndices;
+	uint32_t writtenVertices = 0;
+
+	std::vector<uint32_t> materialIndices;
+	size_t windowCount = 0;
+
+	auto flush = [&]() {
+		if (write && !pendingIndices.empty())
+		{
+			const std::vector<Vertex>& vertices = submeshVertices.GetVertices();
+			const uint32_t firstIndex = submesh.firstIndex + submesh.indexCount
+				- static_cast<uint32_t>(pendingIndices.size());
+
+			// the vertices before are written already, only the triangles
+			// can move
+			if (m_Options.optimizeMesh)
+			{
+				const MeshOptimizeStats stats =
+					mesh::OptimizeTriangles(vertices, pendingIndices, m_Options.optimizeOptions);
+				AddOptimizeStats(m_OptimizeStats, stats, pendingIndices.size() / 3, vertices.size());
+				m_OptimizedTriangleCount += pendingIndices.size() / 3;
+				m_OptimizedVertexCount += vertices.size() - writtenVertices;
+			}
+
+			if (m_Options.buildMeshlets)
+			{
+				for (Meshlet meshlet : mesh::BuildMeshlets(vertices, pendingIndices, m_Options.meshletOptions))
+				{
+					meshlet.firstIndex += firstIndex;
+					m_Meshlets.push_back(meshlet);
+				}
+			}
+
+			const std::vector<Vertex> newVertices{ vertices.begin() + writtenVertices, vertices.end() };
+			const std::vector<uint8_t> vertexData =
+				mesh::QuantizeVertices(newVertices, m_Options.vertexLayout, m_Quantization);
+			const std::vector<uint8_t> indexData = mesh::PackIndices(pendingIndices, m_IndexSize);
+			m_Options.streamTarget.writeVertices(
+				static_cast<size_t>(submesh.firstVertex + writtenVertices) * stride, codec::MakeRawStream(vertexData));
+			m_Options.streamTarget.writeIndices(
+				static_cast<size_t>(firstIndex) * m_IndexSize, codec::MakeRawStream(indexData));
+		}
+
+		pendingIndices.clear();
+		writtenVertices = static_cast<uint32_t>(submeshVertices.GetSize());
+	};
+
+	auto closeSubmesh = [&]() {
+		if (!isSubmeshOpen)
+			return;
+
+		flush();
+		isSubmeshOpen = false;
+		submesh.vertexCount = static_cast<uint32_t>(submeshVertices.GetSize());
+		submeshVertices.Clear();
+
+		size.vertexCount += submesh.vertexCount;
+		size.indexCount += submesh.indexCount;
+		size.maxSubmeshVertices = std::max(size.maxSubmeshVertices, submesh.vertexCount);
+		++size.submeshCount;
+		if (!write)
+			return;
+
+		// the lods need the whole submesh, only the full detail level is
+		// streamed
+		submesh.meshletCount = static_cast<uint32_t>(m_Meshlets.size()) - submesh.firstMeshlet;
+		submesh.firstLod = static_cast<uint32_t>(m_Lods.size());
+		submesh.lodCount = 1;
+		m_Lods.push_back(MeshLod{ submesh.firstIndex, submesh.indexCount, 0.0f, 0 });
+		m_Submeshes.push_back(submesh);
+	};
+
+	auto openSubmesh = [&](uint32_t material) {
+		submesh = Submesh{};
+		submesh.firstVertex = static_cast<uint32_t>(size.vertexCount);
+		submesh.firstIndex = static_cast<uint32_t>(size.indexCount);
+		submesh.firstMeshlet = static_cast<uint32_t>(m_Meshlets.size());
+		submesh.material = material;
+		isSubmeshOpen = true;
+		++submeshStamp;
+		writtenVertices = 0;
+	};
+
+	mesh::StreamObj(m_ModelPath, m_Options.streamOptions, threadPool, [&](const ObjData& window) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		const VertexDedupStats dedupStats = BuildVertices(window, threadPool, vertices, indices);
+		if (write)
+		{
+			m_DedupStats.totalVertices += dedupStats.totalVertices;
+			m_DedupStats.milliseconds += dedupStats.milliseconds;
+			AddMaterials(window, materialIndices);
+		}
+
+		// index of every vertex of the window in the open submesh; valid if
+		// its stamp is the one of the open submesh
+		std::vector<uint32_t> localIndices(vertices.size(), invalidIndex);
+		std::vector<uint32_t> stamps(vertices.size(), 0);
+		auto isInSubmesh = [&](uint32_t vertex) {
+			if (stamps[vertex] == submeshStamp)
+				return true;
+
+			const uint32_t localIndex = submeshVertices.Find(vertices[vertex]);
+			if (localIndex == mesh::VertexDedupTable::NOT_FOUND)
+				return false;
+
+			stamps[vertex] = submeshStamp;
+			localIndices[vertex] = localIndex;
+			return true;
+		};
+
+		for (size_t shapeIndex = 0; shapeIndex < window.shapes.size(); ++shapeIndex)
+		{
+			// the first shape of a window continues the last one of the
+			// previous window if it has the same name and material, like
+			// contiguous shapes of a parsed OBJ
+			const ObjShape& shape = window.shapes[shapeIndex];
+			if (shapeIndex > 0 || !isSubmeshOpen || shape.name != shapeName || shape.materialIndex != shapeMaterial)
+			{
+				closeSubmesh();
+				openSubmesh(write ? GetMaterial(shape.materialIndex, materialIndices) : 0);
+				shapeName = shape.name;
+				shapeMaterial = shape.materialIndex;
+				++size.partCount;
+			}
+
+			for (size_t index = shape.firstIndex; index < shape.firstIndex + shape.indexCount; index += 3)
+			{
+				const uint32_t* corners = &indices[index];
+
+				uint32_t newVertices = 0;
+				for (size_t corner = 0; corner < 3; ++corner)
+					newVertices += isInSubmesh(corners[corner]) ? 0 : 1;
+
+				// the triangle starts a new submesh if its vertices do not fit
+				if (submeshVertices.GetSize() + newVertices > maxVertices)
+				{
+					const uint32_t material = submesh.material;
+					closeSubmesh();
+					openSubmesh(material);
+				}
+
+				for (size_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t vertex = corners[corner];
+					if (stamps[vertex] != submeshStamp)
+					{
+						const size_t vertexCount = submeshVertices.GetSize();
+						localIndices[vertex] = submeshVertices.FindOrAdd(vertices[vertex]);
+						stamps[vertex] = submeshStamp;
+						if (submeshVertices.GetSize() > vertexCount)
+							size.bounds.Add(vertices[vertex]);
+					}
+					pendingIndices.push_back(localIndices[vertex]);
+				}
+				submesh.indexCount += 3;
+
+				const size_t pendingBytes = pendingIndices.size() * sizeof(uint32_t)
+					+ (submeshVertices.GetSize() - writtenVertices) * sizeof(Vertex);
+				if (pendingBytes >= m_Options.maxStreamPendingBytes)
+					flush();
+			}
+		}
+
+		// nothing of the window is kept but the vertices of the open submesh
+		flush();
+		++windowCount;
+	});
+
+	closeSubmesh();
+	return windowCount;
+}
+
+// quantizes the vertices and packs the indices into what is uploaded; last,
+// every pass before works on the full precision vertices
+void Model::PackGeometry()
+{
+	m_Quantization = mesh::GetVertexQuantization(m_Vertices, m_Options.vertexLayout);
+	m_VertexData = mesh::QuantizeVertices(m_Vertices, m_Options.vertexLayout, m_Quantization);
+	m_IndexSize = mesh::GetIndexSize(m_Submeshes);
+	m_IndexData = mesh::PackIndices(m_Indices, m_IndexSize);
+	m_VertexCount = m_Vertices.size();
+	m_IndexCount = m_Indices.size();
+
+	PrintGeometryStats();
+	std::cout << '\n';
+}
+
+void Model::PrintGeometryStats() const
+{
+	std::cout << "    Vertex layout: " << mesh::GetVertexLayoutName(m_Options.vertexLayout) << " ("
+			  << Vertex::GetStride(m_Options.vertexLayout) << " bytes per vertex, "
+			  << m_VertexCount * Vertex::GetStride(m_Options.vertexLayout) << " bytes)\n"
+			  << "    Submeshes: " << m_Submeshes.size() << " (" << m_IndexSize * 8 << " bit indices, "
+			  << m_IndexCount * m_IndexSize << " bytes)\n";
+}
+
+uint32_t Model::GetDefaultMaterial()
+{
+	// faces without a material share an untextured one
+	if (m_DefaultMaterial == std::numeric_limits<uint32_t>::max())
+	{
+		m_DefaultMaterial = static_cast<uint32_t>(m_Materials.size());
+		m_Materials.push_back(MeshMaterial{ "default", "" });
+	}
+
+	return m_DefaultMaterial;
+}
+
+// converts the materials of the OBJ that are not converted yet, a streamed
+// OBJ loads more of them with every `mtllib`; `materialIndices` maps the
+// materials of the OBJ to m_Materials
+void Model::AddMaterials(const ObjData& objData, std::vector<uint32_t>& materialIndices)
+{
+	auto copyString = [](char* destination, size_t size, const std::string& source) {
+		if (source.size() >= size)
+			throw std::runtime_error("Material name or texture path is too long: " + source);
+
+		memcpy(destination, source.c_str(), source.size() + 1);
+	};
+
+	for (size_t i = materialIndices.size(); i < objData.materials.size(); ++i)
+	{
+		MeshMaterial material{};
+		copyString(material.name, sizeof(material.name), objData.materials[i].name);
+		copyString(material.diffuseTexture, sizeof(material.diffuseTexture), objData.materials[i].diffuseTexture);
+
+		materialIndices.push_back(static_cast<uint32_t>(m_Materials.size()));
+		m_Materials.push_back(material);
+	}
+}
+
+// converts a material index of the OBJ to an index into m_Materials
+uint32_t Model::GetMaterial(int32_t objMaterialIndex, const std::vector<uint32_t>& materialIndices)
+{
+	const bool hasMaterial = objMaterialIndex >= 0 && static_cast<size_t>(objMaterialIndex) < materialIndices.size();
+	return hasMaterial ? materialIndices[objMaterialIndex] : GetDefaultMaterial();
+}
+
+// every shape of the OBJ becomes a part, with its material index
+// converted to an index into m_Materials
+std::vector<SubmeshPart> Model::BuildParts(const ObjData& objData,
+	const std::vector<uint32_t>& materialIndices,
+	size_t indexCount)
+{
+	std::vector<SubmeshPart> parts;
+	parts.reserve(objData.shapes.size());
+	for (const ObjShape& shape : objData.shapes)
+	{
+		parts.push_back(SubmeshPart{ static_cast<uint32_t>(shape.firstIndex),
+			static_cast<uint32_t>(shape.indexCount),
+			GetMaterial(shape.materialIndex, materialIndices) });
+	}
+
+	// a model without faces still has a submesh and a material
+	if (parts.empty())
+		parts.push_back(SubmeshPart{ 0, static_cast<uint32_t>(indexCount), GetDefaultMaterial() });
+
+	return parts;
+}
+
+void Model::BuildSubmeshes(const std::vector<SubmeshPart>& parts)
+{
+	m_Submeshes = mesh::SplitSubmeshes(
+		m_Vertices, m_Indices, parts, m_Options.splitSubmeshes ? MAX_SUBMESH_VERTICES : UINT32_MAX);
+
+	// the submeshes are optimized one by one, so that the optimizer never
+	// moves triangles across shapes and materials
+	std::vector<uint32_t> indices;
+	indices.reserve(m_Indices.size());
+
+	m_OptimizeStats = MeshOptimizeStats{};
+	m_OptimizedTriangleCount = 0;
+	m_OptimizedVertexCount = 0;
+	std::vector<Vertex> submeshVertices;
+	for (Submesh& submesh : m_Submeshes)
+	{
+		// a model that is not split is the only submesh, no need to copy it
+		if (m_Submeshes.size() > 1)
+		{
+			submeshVertices.assign(m_Vertices.begin() + submesh.firstVertex,
+				m_Vertices.begin() + submesh.firstVertex + submesh.vertexCount);
+		}
+		std::vector<Vertex>& vertices = m_Submeshes.size() > 1 ? submeshVertices : m_Vertices;
+
+		std::vector<uint32_t> submeshIndices{ m_Indices.begin() + submesh.firstIndex,
+			m_Indices.begin() + submesh.firstIndex + submesh.indexCount };
+		submesh.firstIndex = static_cast<uint32_t>(indices.size());
+
+		BuildSubmesh(submesh, vertices, submeshIndices);
+
+		// the vertex fetch pass only reorders the vertices of a split
+		// submesh, every one of them is used; the only submesh may lose
+		// unused vertices
+		if (m_Submeshes.size() > 1)
+			std::copy(vertices.begin(), vertices.end(), m_Vertices.begin() + submesh.firstVertex);
+		else
+			submesh.vertexCount = static_cast<uint32_t>(m_Vertices.size());
+
+		indices.insert(indices.end(), submeshIndices.begin(), submeshIndices.end());
+	}
+
+	m_Indices = std::move(indices);
+	m_OptimizeStats = NormalizeOptimizeStats(m_OptimizeStats, m_OptimizedTriangleCount, m_OptimizedVertexCount);
+	PrintSubmeshStats();
+}
+
+// optimizes the vertices and indices of a submesh in place and appends its
+// meshlets and lods; `submesh.firstIndex` must already be where its indices
+// go in the index buffer
+// the meshlets and lods are built per submesh, so that they never reference
+// vertices of another submesh
+void Model::BuildSubmesh(Submesh& submesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const uint32_t indexOffset = submesh.firstIndex;
+
+	if (m_Options.optimizeMesh)
+	{
+		const MeshOptimizeStats stats = mesh::OptimizeMesh(vertices, indices, m_Options.optimizeOptions);
+		AddOptimizeStats(m_OptimizeStats, stats, indices.size() / 3, vertices.size());
+		m_OptimizedTriangleCount += indices.size() / 3;
+		m_OptimizedVertexCount += vertices.size();
+	}
+
+	// the index buffer is reordered by meshlet
+	submesh.firstMeshlet = static_cast<uint32_t>(m_Meshlets.size());
+	if (m_Options.buildMeshlets)
+	{
+		for (Meshlet meshlet : mesh::BuildMeshlets(vertices, indices, m_Options.meshletOptions))
+		{
+			meshlet.firstIndex += indexOffset;
+			m_Meshlets.push_back(meshlet);
+		}
+	}
+	submesh.meshletCount = static_cast<uint32_t>(m_Meshlets.size()) - submesh.firstMeshlet;
 
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, m_ModelPath))
-		throw std::runtime_error(warn + err);
+	// after the meshlets, so that the full detail level keeps the meshlet
+	// order and the coarser levels are appended after it
+	std::vector<MeshLod> lods{ MeshLod{ 0, submesh.indexCount, 0.0f, 0 } };
+	if (m_Options.buildLods)
+		lods = mesh::BuildLodChain(vertices, indices, m_Options.lodOptions);
+
+	submesh.firstLod = static_cast<uint32_t>(m_Lods.size());
+	submesh.lodCount = static_cast<uint32_t>(lods.size());
+	for (MeshLod& lod : lods)
+	{
+		lod.firstIndex += indexOffset;
+		m_Lods.push_back(lod);
+	}
+}
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+void Model::PrintSubmeshStats() const
+{
+	if (m_Options.optimizeMesh)
+	{
+		std::cout << "    ACMR: " << m_OptimizeStats.before.acmr << " -> " << m_OptimizeStats.after.acmr << '\n'
+				  << "    ATVR: " << m_OptimizeStats.before.atvr << " -> " << m_OptimizeStats.after.atvr
+				  << " (optimized in " << m_OptimizeStats.milliseconds << " ms)\n";
+	}
 
-	for (const tinyobj::shape_t& shape : shapes)
+	if (m_Options.buildMeshlets)
 	{
-		for (const auto& index : shape.mesh.indices)
+		std::cout << "    Meshlets: " << m_Meshlets.size() << " (at most " << m_Options.meshletOptions.maxVertices
+				  << " vertices and " << m_Options.meshletOptions.maxTriangles << " triangles each)\n";
+	}
+
+	if (m_Options.buildLods)
+	{
+		// triangles of every level summed over the submeshes
+		std::vector<uint64_t> lodTriangles;
+		for (const Submesh& submesh : m_Submeshes)
 		{
-			Vertex vertex{};
+			lodTriangles.resize(std::max<size_t>(lodTriangles.size(), submesh.lodCount));
+			for (uint32_t i = 0; i < submesh.lodCount; ++i)
+				lodTriangles[i] += m_Lods[submesh.firstLod + i].indexCount / 3;
+		}
 
-			vertex.pos = { attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2] };
+		std::cout << "    LODs: " << lodTriangles.size() << " (";
+		for (size_t i = 0; i < lodTriangles.size(); ++i)
+			std::cout << (i > 0 ? ", " : "") << lodTriangles[i];
+		std::cout << " triangles)\n";
+	}
+}
 
-			vertex.texCoord = { attrib.texcoords[2 * index.texcoord_index + 0],
-				// 0 coordinate in an obj file means bottom of the image
-				// but here 0 means top
-				// so we flip the coordinate
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1] };
+// builds a vertex per face corner of the OBJ and deduplicates them into
+// `vertices` and `indices`
+VertexDedupStats Model::BuildVertices(const ObjData& objData,
+	ThreadPool& threadPool,
+	std::vector<Vertex>& vertices,
+	std::vector<uint32_t>& indices)
+{
+	// one vertex per face corner, the duplicates are collapsed afterwards
+	std::vector<Vertex> corners(objData.indices.size());
 
-			vertex.color = { 1.0f, 1.0f, 1.0f };
+	threadPool.ParallelForRange(corners.size(), 16 * 1024, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			const ObjIndex& index = objData.indices[i];
+			Vertex& vertex = corners[i];
 
-			// check if the vertex is already in the map
-			if (uniqueVertices.count(vertex) == 0)
-				uniqueVertices[vertex] = static_cast<uint32_t>(m_Vertices.size()); // get the index of the vertex
+			vertex.pos = { objData.positions[3 * index.vertexIndex + 0],
+				objData.positions[3 * index.vertexIndex + 1],
+				objData.positions[3 * index.vertexIndex + 2] };
 
-			m_Vertices.push_back(vertex);
-			m_Indices.push_back(uniqueVertices[vertex]);
+			// faces without texture coordinates sample the corner of the texture
+			vertex.texCoord = glm::vec2{ 0.0f };
+			if (index.texCoordIndex >= 0)
+			{
+				vertex.texCoord = { objData.texCoords[2 * index.texCoordIndex + 0],
+					// 0 coordinate in an obj file means bottom of the image
+					// but here 0 means top
+					// so we flip the coordinate
+					1.0f - objData.texCoords[2 * index.texCoordIndex + 1] };
+			}
 		}
+	});
+
+	return mesh::DeduplicateVertices(corners, vertices, indices, m_Options.parallelDedup ? &threadPool : nullptr);
+}
+
+void Model::ComputeBounds()
+{
+	m_BoundsMin = glm::vec3{ std::numeric_limits<float>::max() };
+	m_BoundsMax = glm::vec3{ std::numeric_limits<float>::lowest() };
+	for (const Vertex& vertex : m_Vertices)
+	{
+		m_BoundsMin = glm::min(m_BoundsMin, vertex.pos);
+		m_BoundsMax = glm::max(m_BoundsMax, vertex.pos);
 	}
+	if (m_Vertices.empty())
+		m_BoundsMin = m_BoundsMax = glm::vec3{ 0.0f };
 }
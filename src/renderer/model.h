@@ -1,25 +1,245 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 
+#include "core/assetCache.h"
+#include "core/codec.h"
+#include "core/span.h"
 #include "buffer/vertexBuffer.h"
+#include "mesh/meshFile.h"
+#include "mesh/meshLod.h"
+#include "mesh/meshlet.h"
+#include "mesh/meshMaterial.h"
+#include "mesh/meshOptimizer.h"
+#include "mesh/objParser.h"
+#include "mesh/submesh.h"
+#include "mesh/vertexDedup.h"
+#include "mesh/vertexQuantizer.h"
 
 
+// whether the model keeps its vertices and indices on the cpu once they are
+// uploaded to the gpu
+enum class GeometryResidency
+{
+	// freed (or unmapped for cooked meshes), only the metadata needed to draw
+	// the model stays in memory
+	RELEASE_AFTER_UPLOAD,
+	// kept, eg: for tools or benchmarks that process the geometry after
+	// loading it
+	KEEP
+};
+
+// where a streamed OBJ writes its geometry, which is never all in memory at
+// once; `reserve` is called once with the size of the packed vertices and
+// indices and the size of an index before any write, and every write fills
+// a range of them, at a byte offset, in the vertex layout of the model
+struct StreamedGeometryTarget
+{
+	std::function<void(size_t vertexBytes, size_t indexBytes, uint32_t indexSize)> reserve;
+	std::function<void(size_t offset, const EncodedStream& data)> writeVertices;
+	std::function<void(size_t offset, const EncodedStream& data)> writeIndices;
+};
+
+struct ModelLoadOptions
+{
+	// load the cooked mesh next to the model if it is up to date, and cook
+	// it after parsing the source model otherwise
+	bool useCookedMesh = true;
+	// only ever load the cooked mesh and throw if it is missing or was
+	// cooked with other options, instead of parsing the source model; the
+	// assetCooker keeps the cooked meshes up to date
+	bool requireCookedMesh = false;
+	// looked up by the contents of the source model before parsing it, and
+	// filled with the mesh cooked from it; optional
+	AssetCache* cache = nullptr;
+	// parse the OBJ with the multi-threaded parser instead of tinyobjloader
+	bool parallelObjParser = true;
+	// read the OBJ in windows, twice: the first pass only sizes the
+	// geometry, the second builds the submeshes as the windows are parsed
+	// and writes them to `streamTarget` in pieces; the memory needed grows
+	// with the attributes of the OBJ instead of its faces, for scans too
+	// large to parse at once. The vertices are deduplicated per submesh, so
+	// the counts match parsing the whole file, but the submeshes have no lods
+	// and their vertices keep the order of first use. Streamed models are
+	// not cooked
+	bool streamObj = false;
+	ObjStreamOptions streamOptions{};
+	// required with `streamObj`
+	StreamedGeometryTarget streamTarget{};
+	// full precision vertices and indices a streamed OBJ holds before
+	// packing them and writing them to `streamTarget`, also written at the
+	// end of every window
+	size_t maxStreamPendingBytes = 16 * 1024 * 1024;
+	// deduplicate the vertices on multiple threads, partitioned by hash
+	bool parallelDedup = true;
+	// reorder the triangles and vertices of every submesh for the vertex
+	// cache, overdraw and vertex fetch; the cooked mesh stores the result
+	bool optimizeMesh = true;
+	MeshOptimizeOptions optimizeOptions{};
+	// group the triangles into meshlets that are culled individually
+	bool buildMeshlets = true;
+	MeshletOptions meshletOptions{};
+	// simplify the mesh into coarser levels of detail, appended to the index
+	// buffer and picked by their error on screen
+	bool buildLods = true;
+	MeshLodOptions lodOptions{};
+	// how the vertices are stored on the gpu; the 16 bit layouts are less
+	// than half the size of `Vertex`
+	VertexLayout vertexLayout = VertexLayout::SNORM16;
+	// split models with more than MAX_SUBMESH_VERTICES vertices into
+	// submeshes, so that every model is drawn with 16 bit indices
+	bool splitSubmeshes = true;
+	// encode the vertices and indices of the cooked mesh with
+	// `codec::Encode`, they are decoded while uploading them
+	bool compressCookedMesh = true;
+	// what happens to the cpu copy of the geometry after `Model::OnUploaded`
+	GeometryResidency residency = GeometryResidency::RELEASE_AFTER_UPLOAD;
+	// threads used for parsing and deduplication; 0 uses one per hardware
+	// thread
+	uint32_t threadCount = 0;
+};
+
 class Model
 {
 public:
-	Model(const char* modelPath);
+	Model(const char* modelPath, const ModelLoadOptions& options = ModelLoadOptions{});
+
+	// the vertices in `GetVertexLayout()` and the indices in `GetIndexType()`,
+	// ready to be decoded into the staging buffers; they either point into
+	// the mapped cooked mesh (encoded if it was cooked compressed) or into the
+	// vectors filled when parsing the source model (raw), and are empty once
+	// the geometry has been released
+	inline EncodedStream GetVertexData() const
+	{
+		return m_MeshFile ? m_MeshFile->GetVertexData() : codec::MakeRawStream(m_VertexData);
+	}
+	inline EncodedStream GetIndexData() const
+	{
+		return m_MeshFile ? m_MeshFile->GetIndexData() : codec::MakeRawStream(m_IndexData);
+	}
+
+	// frees (or unmaps) the vertices and indices if the residency policy
+	// allows it; call once they are uploaded, the metadata below stays valid
+	void OnUploaded();
+	// false once the geometry has been released, and for streamed models,
+	// whose geometry went to `ModelLoadOptions::streamTarget`
+	inline bool IsGeometryResident() const { return m_MeshFile || !m_VertexData.empty(); }
 
-	inline std::vector<Vertex> GetVertices() const { return m_Vertices; }
-	inline std::vector<uint32_t> GetIndices() const { return m_Indices; }
+	// metadata, valid for the whole lifetime of the model
+	inline size_t GetVertexCount() const { return m_VertexCount; }
+	inline VertexLayout GetVertexLayout() const { return m_VertexLayout; }
+	inline uint32_t GetVertexStride() const { return Vertex::GetStride(m_VertexLayout); }
+	// maps the quantized vertices back to model space
+	inline const VertexQuantization& GetVertexQuantization() const { return m_Quantization; }
+
+	inline size_t GetIndexCount() const { return m_IndexCount; }
+	inline uint32_t GetIndexSize() const { return m_IndexSize; }
+	inline VkIndexType GetIndexType() const
+	{
+		return m_IndexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	// every model has at least one submesh, and at least one per shape and
+	// material of the source model
+	// the indices of a submesh are relative to its first vertex
+	inline Span<const Submesh> GetSubmeshes() const { return m_Submeshes; }
+	// every model has at least one material; faces without a material in
+	// the source model use one without a texture
+	inline Span<const MeshMaterial> GetMaterials() const { return m_Materials; }
+	// empty if the model was loaded without meshlets; see `Submesh` for the
+	// meshlets and lods of each submesh
+	inline Span<const Meshlet> GetMeshlets() const { return m_Meshlets; }
+	// the lod chains of every submesh one after the other; the first level
+	// of a chain is the full detail submesh, which is the only level when
+	// the model was loaded without lods
+	// the meshlets only cover the first level
+	inline Span<const MeshLod> GetLods() const { return m_Lods; }
+
+	// axis aligned bounding box of the vertex positions
+	inline glm::vec3 GetBoundsMin() const { return m_BoundsMin; }
+	inline glm::vec3 GetBoundsMax() const { return m_BoundsMax; }
+
+	inline bool IsCooked() const { return m_IsCooked; }
+
+	// full precision vertices and 32 bit indices; only filled when the
+	// source model was parsed without streaming, until the geometry is
+	// released
+	inline const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+	inline const std::vector<uint32_t>& GetIndices() const { return m_Indices; }
+
+	// only filled when the source model was parsed
+	inline const VertexDedupStats& GetDedupStats() const { return m_DedupStats; }
+	// only filled when the source model was parsed and optimized; summed
+	// over the submeshes
+	inline const MeshOptimizeStats& GetOptimizeStats() const { return m_OptimizeStats; }
+
+	// path of the cooked mesh for a source model (eg: `room.obj` -> `room.mesh`)
+	static std::string GetCookedPath(const std::string& modelPath);
 
 private:
 	void LoadModel();
+	void LoadCooked(const std::string& cookedPath);
+	void LoadObj(ThreadPool& threadPool);
+	void LoadObjStreamed(ThreadPool& threadPool);
+	struct StreamedGeometrySize;
+	size_t StreamObjPass(ThreadPool& threadPool, StreamedGeometrySize& size, bool write);
+	VertexDedupStats BuildVertices(const ObjData& objData,
+		ThreadPool& threadPool,
+		std::vector<Vertex>& vertices,
+		std::vector<uint32_t>& indices);
+	void AddMaterials(const ObjData& objData, std::vector<uint32_t>& materialIndices);
+	uint32_t GetMaterial(int32_t objMaterialIndex, const std::vector<uint32_t>& materialIndices);
+	std::vector<SubmeshPart> BuildParts(const ObjData& objData,
+		const std::vector<uint32_t>& materialIndices,
+		size_t indexCount);
+	void BuildSubmeshes(const std::vector<SubmeshPart>& parts);
+	void BuildSubmesh(Submesh& submesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	void PrintSubmeshStats() const;
+	void ComputeBounds();
+	void PackGeometry();
+	void PrintGeometryStats() const;
+	uint32_t GetDefaultMaterial();
+
+	bool IsCookedMeshUpToDate(const std::string& cookedPath) const;
+	uint32_t GetCookedMeshFlags() const;
+	// of the cooked mesh in the asset cache
+	uint64_t GetCacheKey() const;
 
 private:
 	const char* m_ModelPath;
+	ModelLoadOptions m_Options;
 
+	// geometry, released by `OnUploaded` depending on the residency policy
 	std::vector<Vertex> m_Vertices;
+	std::vector<uint8_t> m_VertexData; // m_Vertices in the vertex layout
 	std::vector<uint32_t> m_Indices;
+	std::vector<uint8_t> m_IndexData; // m_Indices in `m_IndexSize` bytes each
+	std::unique_ptr<MeshFile> m_MeshFile;
+
+	// metadata, copied out of the cooked mesh so that it outlives the mapping
+	size_t m_VertexCount;
+	VertexLayout m_VertexLayout;
+	VertexQuantization m_Quantization;
+	size_t m_IndexCount;
+	uint32_t m_IndexSize;
+	std::vector<Submesh> m_Submeshes;
+	std::vector<Meshlet> m_Meshlets;
+	std::vector<MeshLod> m_Lods;
+	std::vector<MeshMaterial> m_Materials;
+	glm::vec3 m_BoundsMin;
+	glm::vec3 m_BoundsMax;
+	bool m_IsCooked;
+	// index of the material of the faces without one, UINT32_MAX until one
+	// of them is found
+	uint32_t m_DefaultMaterial;
+
+	VertexDedupStats m_DedupStats;
+	MeshOptimizeStats m_OptimizeStats;
+	// of the full detail levels the stats are weighted by
+	size_t m_OptimizedTriangleCount;
+	size_t m_OptimizedVertexCount;
 };
@@ -3,21 +3,49 @@
 #include <stdexcept>
 
 #include "shader.h"
-#include "renderer/buffer/vertexBuffer.h"
+#include "core/hash.h"
+#include "renderer/texture/mipStreamer.h"
+#include "renderer/texture/textureAtlas.h"
+#include "renderer/texture/virtualTexture.h"
 
 
-Pipeline::Pipeline(VkDevice deviceVk, VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples)
+// bump this to start over with empty pipeline caches
+constexpr uint32_t g_PipelineCacheVersion = 1;
+
+
+Pipeline::Pipeline(VkDevice deviceVk,
+	VkRenderPass renderPass,
+	VkSampleCountFlagBits msaaSamples,
+	VertexLayout vertexLayout,
+	AssetCache* cache,
+	bool samplingFeedback,
+	uint32_t bindlessTextureCount,
+	bool virtualTexture,
+	bool atlasTextures)
 	: m_DeviceVk{ deviceVk },
 	  m_RenderPass{ renderPass },
-	  m_MsaaSamples{ msaaSamples }
+	  m_MsaaSamples{ msaaSamples },
+	  m_VertexLayout{ vertexLayout },
+	  m_AssetCache{ cache },
+	  m_SamplingFeedback{ samplingFeedback },
+	  m_BindlessTextureCount{ bindlessTextureCount },
+	  m_VirtualTexture{ virtualTexture },
+	  m_AtlasTextures{ atlasTextures },
+	  m_CullMode{ VK_CULL_MODE_NONE }
 {
-	CreateDescriptorSetLayout();
+	if (m_VirtualTexture && (m_SamplingFeedback || IsBindless()))
+		throw std::runtime_error("A virtual texture has its own feedback and is not in a texture array!");
+	if (m_AtlasTextures && (m_SamplingFeedback || !IsBindless()))
+		throw std::runtime_error("Atlas pages are only sampled from a texture array, without the feedback!");
+
+	CreateDescriptorSetLayouts();
 	CreateGraphicsPipeline();
 }
 
 Pipeline::~Pipeline()
 {
-	vkDestroyDescriptorSetLayout(m_DeviceVk, m_DescriptorSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_DeviceVk, m_FrameSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_DeviceVk, m_TextureSetLayout, nullptr);
 
 	vkDestroyPipeline(m_DeviceVk, m_Pipeline, nullptr);
 	vkDestroyPipelineLayout(m_DeviceVk, m_PipelineLayout, nullptr);
@@ -27,14 +55,25 @@ void Pipeline::CreateGraphicsPipeline()
 {
 	// shaders
 	Shader vertexShader{ "assets/shaders/gradientTriangle.vert.spv", ShaderType::VERTEX, m_DeviceVk };
-	Shader fragmentShader{ "assets/shaders/gradientTriangle.frag.spv", ShaderType::FRAGMENT, m_DeviceVk };
+	const char* fragmentShaderPath = m_SamplingFeedback ? "assets/shaders/texturedFeedback.frag.spv"
+														: "assets/shaders/gradientTriangle.frag.spv";
+	if (IsBindless())
+	{
+		fragmentShaderPath = m_SamplingFeedback ? "assets/shaders/texturedBindlessFeedback.frag.spv"
+												: "assets/shaders/texturedBindless.frag.spv";
+	}
+	if (m_VirtualTexture)
+		fragmentShaderPath = "assets/shaders/texturedVirtual.frag.spv";
+	if (m_AtlasTextures)
+		fragmentShaderPath = "assets/shaders/texturedAtlas.frag.spv";
+	Shader fragmentShader{ fragmentShaderPath, ShaderType::FRAGMENT, m_DeviceVk };
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShader.GetShaderStage(), fragmentShader.GetShaderStage() };
 
 	// fixed functions
 	// vertex input
-	auto bindingDescription = Vertex::GetBindingDescription();
-	auto attributeDescriptions = Vertex::GetAttributeDescriptions();
+	auto bindingDescription = Vertex::GetBindingDescription(m_VertexLayout);
+	auto attributeDescriptions = Vertex::GetAttributeDescriptions(m_VertexLayout);
 
 	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
 	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -63,7 +102,7 @@ void Pipeline::CreateGraphicsPipeline()
 		VK_FALSE; // if true, the geometry never passes through rasterizer stage
 	rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL; // how fragments are generated
 	rasterizationStateCreateInfo.lineWidth = 1.0f; // thickness of lines
-	rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_NONE; // type of face culling; cull the back face
+	rasterizationStateCreateInfo.cullMode = m_CullMode; // type of face culling; cull the back face
 	// we specify counter clockwise because in the projection matrix we flipped
 	// the y-coord
 	rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE; // vertex order for faces to be considered
@@ -141,11 +180,20 @@ void Pipeline::CreateGraphicsPipeline()
 	// specify uniforms
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.setLayoutCount = 1;
-	pipelineLayoutCreateInfo.pSetLayouts = &m_DescriptorSetLayout;
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{ m_FrameSetLayout, m_TextureSetLayout };
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
 	// push constants are another way of passing dynamic values to the shaders
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(SamplingFeedbackConstants);
+	if (m_VirtualTexture)
+		pushConstantRange.size = sizeof(VirtualTextureConstants);
+	if (m_AtlasTextures)
+		pushConstantRange.size = sizeof(AtlasConstants);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = HasPushConstants() ? 1 : 0;
+	pipelineLayoutCreateInfo.pPushConstantRanges = HasPushConstants() ? &pushConstantRange : nullptr;
 
 	if (vkCreatePipelineLayout(m_DeviceVk, &pipelineLayoutCreateInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create pipeline layout!");
@@ -174,38 +222,140 @@ void Pipeline::CreateGraphicsPipeline()
 	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 	graphicsPipelineCreateInfo.basePipelineIndex = -1;
 
+	// the driver checks that the cached data was written by the same driver
+	// and device, and ignores it otherwise; the key only has to cover what
+	// the pipeline is built from
+	uint64_t parametersHash = hash::Combine(fragmentShader.GetCodeHash(), static_cast<uint64_t>(m_VertexLayout));
+	parametersHash = hash::Combine(parametersHash, static_cast<uint64_t>(m_MsaaSamples));
+	const uint64_t cacheKey =
+		AssetCache::MakeKey("pipeline", g_PipelineCacheVersion, vertexShader.GetCodeHash(), parametersHash);
+	std::vector<uint8_t> cacheData;
+	VkPipelineCache pipelineCache = CreatePipelineCache(cacheKey, cacheData);
+
 	// multiple graphicsPipelineCreateInfo can be passed
 	// pipelineCache (2nd param) can be used to store and reuse data
-	if (vkCreateGraphicsPipelines(m_DeviceVk, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &m_Pipeline)
-		!= VK_SUCCESS)
+	const VkResult result =
+		vkCreateGraphicsPipelines(m_DeviceVk, pipelineCache, 1, &graphicsPipelineCreateInfo, nullptr, &m_Pipeline);
+
+	StorePipelineCache(pipelineCache, cacheKey, cacheData);
+	vkDestroyPipelineCache(m_DeviceVk, pipelineCache, nullptr);
+
+	if (result != VK_SUCCESS)
 		throw std::runtime_error("Failed to create graphics pipeline!");
 }
 
-void Pipeline::CreateDescriptorSetLayout()
+VkPipelineCache Pipeline::CreatePipelineCache(uint64_t cacheKey, std::vector<uint8_t>& cacheData)
+{
+	if (!m_AssetCache)
+		return VK_NULL_HANDLE;
+
+	m_AssetCache->Load(cacheKey, cacheData);
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+	pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	// the pipeline can still be built without a cache
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	if (vkCreatePipelineCache(m_DeviceVk, &pipelineCacheCreateInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+
+	return pipelineCache;
+}
+
+void Pipeline::StorePipelineCache(VkPipelineCache pipelineCache,
+	uint64_t cacheKey,
+	const std::vector<uint8_t>& cacheData)
+{
+	if (pipelineCache == VK_NULL_HANDLE)
+		return;
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_DeviceVk, pipelineCache, &dataSize, nullptr) != VK_SUCCESS)
+		return;
+
+	std::vector<uint8_t> data(dataSize);
+	if (vkGetPipelineCacheData(m_DeviceVk, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+		return;
+	data.resize(dataSize);
+
+	// nothing new was compiled, eg: on every run after the first one
+	if (data != cacheData)
+		m_AssetCache->Store(cacheKey, data);
+}
+
+void Pipeline::CreateDescriptorSetLayouts()
 {
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
 	uboLayoutBinding.binding = 0; // binding used in the shader
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	// bound at the offset of the uniform block of the draw in the ring
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // shader stage that the descriptor will be
 															  // referencing
 	uboLayoutBinding.pImmutableSamplers = nullptr;
 
+	// the finest mip levels sampled, or the pages of a virtual texture,
+	// written by the fragment shader
+	VkDescriptorSetLayoutBinding feedbackLayoutBinding{};
+	feedbackLayoutBinding.binding = 1;
+	feedbackLayoutBinding.descriptorCount = 1;
+	feedbackLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	feedbackLayoutBinding.pImmutableSamplers = nullptr;
+	feedbackLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> frameBindings = { uboLayoutBinding, feedbackLayoutBinding };
+
+	VkDescriptorSetLayoutCreateInfo frameLayoutCreateInfo{};
+	frameLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	frameLayoutCreateInfo.bindingCount = m_SamplingFeedback || m_VirtualTexture ? 2 : 1;
+	frameLayoutCreateInfo.pBindings = frameBindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_DeviceVk, &frameLayoutCreateInfo, nullptr, &m_FrameSetLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create descriptor set layout!");
+
+	// every texture of the frame when bindless, the tile cache of a virtual
+	// texture
 	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
+	samplerLayoutBinding.binding = 0;
+	samplerLayoutBinding.descriptorCount = IsBindless() ? m_BindlessTextureCount : 1;
 	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+	// the page table of a virtual texture
+	VkDescriptorSetLayoutBinding pageTableLayoutBinding{};
+	pageTableLayoutBinding.binding = 1;
+	pageTableLayoutBinding.descriptorCount = 1;
+	pageTableLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pageTableLayoutBinding.pImmutableSamplers = nullptr;
+	pageTableLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	VkDescriptorSetLayoutCreateInfo descriptorLayoutCreateInfo{};
-	descriptorLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descriptorLayoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	descriptorLayoutCreateInfo.pBindings = bindings.data();
+	std::array<VkDescriptorSetLayoutBinding, 2> textureBindings = { samplerLayoutBinding, pageTableLayoutBinding };
 
-	if (vkCreateDescriptorSetLayout(m_DeviceVk, &descriptorLayoutCreateInfo, nullptr, &m_DescriptorSetLayout)
+	VkDescriptorSetLayoutCreateInfo textureLayoutCreateInfo{};
+	textureLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	textureLayoutCreateInfo.bindingCount = m_VirtualTexture ? 2 : 1;
+	textureLayoutCreateInfo.pBindings = textureBindings.data();
+
+	// the slots no texture was registered into are never written, and the
+	// ones registered while a frame is recorded or in flight are written
+	// while the set is bound
+	const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+												  | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+												  | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = 1;
+	bindingFlagsCreateInfo.pBindingFlags = &bindingFlags;
+	if (IsBindless())
+	{
+		textureLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+		textureLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	}
+
+	if (vkCreateDescriptorSetLayout(m_DeviceVk, &textureLayoutCreateInfo, nullptr, &m_TextureSetLayout)
 		!= VK_SUCCESS)
 		throw std::runtime_error("Failed to create descriptor set layout!");
-}
\ No newline at end of file
+}
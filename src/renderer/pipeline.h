@@ -1,33 +1,94 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 #include "glm/glm.hpp"
 
+#include "core/assetCache.h"
+#include "renderer/buffer/vertexBuffer.h"
+
+
+// the sets of the pipeline layout: the uniform ring and the feedback of the
+// frame, and the textures it samples; only the second one is ever updated
+// after bind, which its own pool is for (a dynamic uniform buffer cannot be
+// in a set layout that is)
+constexpr uint32_t FRAME_DESCRIPTOR_SET = 0;
+constexpr uint32_t TEXTURE_DESCRIPTOR_SET = 1;
 
 class Pipeline
 {
 public:
-	Pipeline(VkDevice deviceVk, VkRenderPass renderPass, VkSampleCountFlagBits msaaSamples);
+	// `vertexLayout` is the layout of the vertex buffers drawn with the pipeline
+	// the driver's pipeline cache is kept in `cache` (optional), so that the
+	// shaders are only compiled on the first run
+	// the uniform block is at binding 0 of the frame set, the texture at
+	// binding 0 of the texture set
+	// with `samplingFeedback` the fragment shader also writes the mip levels
+	// it samples the textures at into a storage buffer (binding 1 of the
+	// frame set), and takes `SamplingFeedbackConstants` as push constants, see
+	// `MipStreamer`
+	// with `bindlessTextureCount` the texture set holds an array of that many
+	// textures instead of a single one, partially bound and updated after
+	// bind, and every draw picks its texture with the `textureIndex` of the
+	// same push constants (see `Device::SupportsBindlessTextures`)
+	// with `virtualTexture` the fragment shader samples a `VirtualTexture`
+	// instead: its tile cache at binding 0 of the texture set, its page table
+	// at binding 1, and the pages it samples go to binding 1 of the frame set;
+	// it takes `VirtualTextureConstants` as push constants, and goes with
+	// neither of the other two
+	// with `atlasTextures` the textures of the array may be pages of an atlas
+	// (texturedAtlas.frag): every draw pushes `AtlasConstants`, the rect of its
+	// texture in the page, instead; it needs the texture array and goes
+	// without the feedback
+	Pipeline(VkDevice deviceVk,
+		VkRenderPass renderPass,
+		VkSampleCountFlagBits msaaSamples,
+		VertexLayout vertexLayout = VertexLayout::FLOAT32,
+		AssetCache* cache = nullptr,
+		bool samplingFeedback = false,
+		uint32_t bindlessTextureCount = 0,
+		bool virtualTexture = false,
+		bool atlasTextures = false);
 	~Pipeline();
 
 	inline VkPipeline GetPipeline() const { return m_Pipeline; }
 	inline VkPipelineLayout GetLayout() const { return m_PipelineLayout; }
+	inline VkCullModeFlags GetCullMode() const { return m_CullMode; }
+	inline bool HasSamplingFeedback() const { return m_SamplingFeedback; }
+	inline bool IsBindless() const { return m_BindlessTextureCount > 0; }
+	inline uint32_t GetBindlessTextureCount() const { return m_BindlessTextureCount; }
+	inline bool IsVirtualTexture() const { return m_VirtualTexture; }
+	inline bool HasAtlasTextures() const { return m_AtlasTextures; }
+	// the push constants are only there for the feedback, the texture array
+	// or the virtual texture; an atlas only goes with the texture array
+	inline bool HasPushConstants() const { return m_SamplingFeedback || IsBindless() || m_VirtualTexture; }
 
-	inline VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+	inline VkDescriptorSetLayout GetFrameSetLayout() const { return m_FrameSetLayout; }
+	inline VkDescriptorSetLayout GetTextureSetLayout() const { return m_TextureSetLayout; }
 
 private:
 	void CreateGraphicsPipeline();
-	void CreateDescriptorSetLayout(); // TODO: move this to Uniform buffers or
+	VkPipelineCache CreatePipelineCache(uint64_t cacheKey, std::vector<uint8_t>& cacheData);
+	void StorePipelineCache(VkPipelineCache pipelineCache, uint64_t cacheKey, const std::vector<uint8_t>& cacheData);
+	void CreateDescriptorSetLayouts(); // TODO: move this to Uniform buffers or
 									  // descriptor class
 
 private:
 	VkDevice m_DeviceVk;
 	VkRenderPass m_RenderPass;
 	VkSampleCountFlagBits m_MsaaSamples;
+	VertexLayout m_VertexLayout;
+	AssetCache* m_AssetCache;
+	bool m_SamplingFeedback;
+	uint32_t m_BindlessTextureCount;
+	bool m_VirtualTexture;
+	bool m_AtlasTextures;
+	VkCullModeFlags m_CullMode;
 
-	VkDescriptorSetLayout m_DescriptorSetLayout;
+	VkDescriptorSetLayout m_FrameSetLayout;
+	VkDescriptorSetLayout m_TextureSetLayout;
 
 	VkPipelineLayout m_PipelineLayout;
 	VkPipeline m_Pipeline;
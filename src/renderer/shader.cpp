@@ -2,12 +2,15 @@
 
 #include <fstream>
 
+#include "core/hash.h"
+
 
 Shader::Shader(const std::string& path, ShaderType type, VkDevice deviceVk)
 	: m_Path{ path },
 	  m_Type{ type },
 	  m_DeviceVk{ deviceVk },
 	  m_ShaderCode{},
+	  m_CodeHash{ 0 },
 	  m_ShaderModule{ VK_NULL_HANDLE },
 	  m_ShaderStage{}
 // has to be default initialized to initialize all its fields
@@ -34,6 +37,8 @@ void Shader::LoadShader()
 	file.seekg(0);
 	file.read(m_ShaderCode.data(), fileSize);
 	file.close();
+
+	m_CodeHash = hash::HashBytes(m_ShaderCode.data(), m_ShaderCode.size());
 }
 
 void Shader::CreateShaderModule()
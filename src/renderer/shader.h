@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -19,6 +20,8 @@ public:
 	~Shader();
 
 	inline VkPipelineShaderStageCreateInfo GetShaderStage() const { return m_ShaderStage; }
+	// hash of the SPIR-V, eg: to key the pipelines built from it
+	inline uint64_t GetCodeHash() const { return m_CodeHash; }
 
 private:
 	void LoadShader();
@@ -31,6 +34,7 @@ private:
 	VkDevice m_DeviceVk;
 
 	std::vector<char> m_ShaderCode;
+	uint64_t m_CodeHash;
 
 	VkShaderModule m_ShaderModule;
 	VkPipelineShaderStageCreateInfo m_ShaderStage;
@@ -222,7 +222,7 @@ void Swapchain::CreateColorResources()
 	VkFormat colorFormat = m_SwapchainImageFormat;
 
 	utils::img::CreateImage(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
+		m_Device->GetAllocator(),
 		m_SwapchainExtent.width,
 		m_SwapchainExtent.height,
 		1,
@@ -243,7 +243,7 @@ void Swapchain::CreateDepthResources()
 	VkFormat depthFormat = FindDepthFormat();
 
 	utils::img::CreateImage(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
+		m_Device->GetAllocator(),
 		m_SwapchainExtent.width,
 		m_SwapchainExtent.height,
 		1,
@@ -288,11 +288,11 @@ void Swapchain::CleanupSwapchain()
 {
 	vkDestroyImageView(m_Device->GetDevice(), m_DepthImageView, nullptr);
 	vkDestroyImage(m_Device->GetDevice(), m_DepthImage, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_DepthImageMemory, nullptr);
+	m_Device->GetAllocator().Free(m_DepthImageMemory);
 
 	vkDestroyImageView(m_Device->GetDevice(), m_ColorImageView, nullptr);
 	vkDestroyImage(m_Device->GetDevice(), m_ColorImage, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_ColorImageMemory, nullptr);
+	m_Device->GetAllocator().Free(m_ColorImageMemory);
 
 	for (auto framebuffer : m_SwapchainFramebuffers)
 		vkDestroyFramebuffer(m_Device->GetDevice(), framebuffer, nullptr);
@@ -32,7 +32,7 @@ public:
 	inline VkRenderPass GetRenderPass() const { return m_RenderPass; }
 
 	inline VkImage GetDepthImage() const { return m_DepthImage; }
-	inline VkDeviceMemory GetDepthImageMemory() const { return m_DepthImageMemory; }
+	inline const DeviceAllocation& GetDepthImageMemory() const { return m_DepthImageMemory; }
 	inline VkImageView GetDepthImageView() const { return m_DepthImageView; }
 
 	inline std::vector<VkFramebuffer> GetFramebuffers() const { return m_SwapchainFramebuffers; }
@@ -76,12 +76,12 @@ private:
 
 	// for multisampling
 	VkImage m_ColorImage;
-	VkDeviceMemory m_ColorImageMemory;
+	DeviceAllocation m_ColorImageMemory;
 	VkImageView m_ColorImageView;
 
 	// TODO: make a depth buffer class
 	VkImage m_DepthImage;
-	VkDeviceMemory m_DepthImageMemory;
+	DeviceAllocation m_DepthImageMemory;
 	VkImageView m_DepthImageView;
 
 	// TODO: make a framebuffer class
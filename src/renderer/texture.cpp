@@ -1,23 +1,33 @@
 #include "texture.h"
 
 #include <stdexcept>
-#include <cmath>
-#include <algorithm>
 
+// the texture loader and the cooked texture formats decode the images with it
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image/stb_image.h"
 
-#include "renderer/swapchain.h"
-#include "utils/bufferUtils.h"
 #include "utils/imageUtils.h"
-#include "utils/commandBufferUtils.h"
 
 
-Texture::Texture(const Device* device, const CommandBuffer* commandBuffers)
+Texture::Texture(const Device* device,
+	const std::string& path,
+	VkFormat format,
+	uint32_t width,
+	uint32_t height,
+	uint32_t levelCount,
+	uint32_t firstLevel,
+	VkImage image,
+	const DeviceAllocation& imageMemory)
 	: m_Device{ device },
-	  m_CommandBuffers{ commandBuffers }
+	  m_Path{ path },
+	  m_Format{ format },
+	  m_Width{ width },
+	  m_Height{ height },
+	  m_LevelCount{ levelCount },
+	  m_FirstLevel{ firstLevel },
+	  m_TextureImage{ image },
+	  m_TextureImageMemory{ imageMemory }
 {
-	CreateTextureImage();
 	CreateTextureImageView();
 	CreateTextureSampler();
 }
@@ -27,168 +37,13 @@ Texture::~Texture()
 	vkDestroySampler(m_Device->GetDevice(), m_TextureSampler, nullptr);
 	vkDestroyImageView(m_Device->GetDevice(), m_TextureImageView, nullptr);
 	vkDestroyImage(m_Device->GetDevice(), m_TextureImage, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), m_TextureImageMemory, nullptr);
-}
-
-void Texture::CreateTextureImage()
-{
-	int width = 0;
-	int height = 0;
-	int channels = 0;
-
-	// TODO: pass texture path in the class constructor and make this class more
-	// dynamic so that we can simply call this class to create and manage
-	// textures force alpha (even if there isnt one)
-	auto imgData = stbi_load("assets/textures/viking_room.png", &width, &height, &channels, STBI_rgb_alpha);
-	VkDeviceSize imgSize = width * height * 4;
-
-	if (!imgData)
-		throw std::runtime_error("Failed to load texture image!");
-
-	// calc mipmap levels
-	m_MipLevels = static_cast<uint32_t>(std::log2(std::max(width, height))) + 1;
-
-	// create a staging buffer
-	// we can use a staging image object but we are using VkBuffer
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	utils::buff::CreateBuffer(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		imgSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(m_Device->GetDevice(), stagingBufferMemory, 0, imgSize, 0, &data);
-	memcpy(data, imgData, static_cast<size_t>(imgSize));
-	vkUnmapMemory(m_Device->GetDevice(), stagingBufferMemory);
-
-	stbi_image_free(imgData);
-
-	// to blit the image we use this image as both src and destination (blit is
-	// a transfer command)
-	utils::img::CreateImage(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		static_cast<uint32_t>(width),
-		static_cast<uint32_t>(height),
-		m_MipLevels,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_TextureImage,
-		m_TextureImageMemory);
-
-	// copy staging buffer to the texture image
-	// transfer the image layout to DST_OPTIMAl
-	TransitionImageLayout(m_TextureImage,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		m_MipLevels);
-
-	utils::buff::CopyBufferToImage(m_Device->GetDevice(),
-		m_Device->GetGraphicsQueue(),
-		m_CommandBuffers->GetCommandPool(),
-		stagingBuffer,
-		m_TextureImage,
-		width,
-		height);
-
-	// to start sampling from the texture image in the shader
-	// uncomment and `m_MipLevels` to 1 (as a whole, not just for this
-	// function), if you are not generating mipmaps
-	// TransitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB,
-	// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-	// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_MipLevels);
-
-	// fill texture image mipmaps
-	utils::img::GenerateMipmaps(m_Device->GetDevice(),
-		m_Device->GetPhysicalDevice(),
-		m_CommandBuffers->GetCommandPool(),
-		m_Device->GetGraphicsQueue(),
-		m_TextureImage,
-		VK_FORMAT_R8G8B8A8_SRGB,
-		width,
-		height,
-		m_MipLevels);
-
-	vkDestroyBuffer(m_Device->GetDevice(), stagingBuffer, nullptr);
-	vkFreeMemory(m_Device->GetDevice(), stagingBufferMemory, nullptr);
-}
-
-void Texture::TransitionImageLayout(VkImage image,
-	VkFormat format,
-	VkImageLayout oldLayout,
-	VkImageLayout newLayout,
-	uint32_t mipLevels)
-{
-	// to copy the buffer into the image, we need the image to be in the right
-	// layout first one way to perform layout transitions is the use image
-	// memory barrier
-	VkCommandBuffer cmdBuff =
-		utils::cmd::BeginSingleTimeCommands(m_Device->GetDevice(), m_CommandBuffers->GetCommandPool());
-
-	VkImageMemoryBarrier imgMemBarrier{};
-	imgMemBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	imgMemBarrier.oldLayout = oldLayout; // use `VK_IMAGE_LAYOUT_UNDEFINED` as `oldLayout` if you
-										 // don't care about the existing contents of the image
-	imgMemBarrier.newLayout = newLayout;
-	imgMemBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // use indices of the queues if you use
-																 // barriers to transfer the ownership of the
-																 // queue family
-	imgMemBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	imgMemBarrier.image = image;
-	// specific part of the image that is affected
-	imgMemBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	imgMemBarrier.subresourceRange.baseMipLevel = 0;
-	imgMemBarrier.subresourceRange.levelCount = mipLevels;
-	imgMemBarrier.subresourceRange.baseArrayLayer = 0;
-	imgMemBarrier.subresourceRange.layerCount = 1;
-
-	// specify operations that the resource has to wait for
-	// handle access masks and pipeline stages
-	// to handle transfer writes that don't wait on anything
-	// and shader reads, which should wait on transfer writes
-	VkPipelineStageFlags srcStage;
-	VkPipelineStageFlags dstStage;
-
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-	{
-		imgMemBarrier.srcAccessMask = 0;
-		imgMemBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-	{
-		imgMemBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		imgMemBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else
-	{
-		throw std::runtime_error("Unsupported layout transition!");
-	}
-
-	vkCmdPipelineBarrier(cmdBuff, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imgMemBarrier);
-
-	utils::cmd::EndSingleTimeCommands(
-		m_Device->GetDevice(), m_Device->GetGraphicsQueue(), m_CommandBuffers->GetCommandPool(), cmdBuff);
+	m_Device->GetAllocator().Free(m_TextureImageMemory);
 }
 
 void Texture::CreateTextureImageView()
 {
 	m_TextureImageView = utils::img::CreateImageView(
-		m_Device->GetDevice(), m_TextureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_MipLevels);
+		m_Device->GetDevice(), m_TextureImage, m_Format, VK_IMAGE_ASPECT_COLOR_BIT, m_LevelCount - m_FirstLevel);
 }
 
 void Texture::CreateTextureSampler()
@@ -218,7 +73,10 @@ void Texture::CreateTextureSampler()
 	samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerCreateInfo.minLod = 0.0f;
-	samplerCreateInfo.maxLod = static_cast<float>(m_MipLevels);
+	// the levels of the image, which starts at m_FirstLevel: the lod is
+	// computed at the size of the image, so a texture without its finer
+	// levels is sampled blurrier instead of wrong
+	samplerCreateInfo.maxLod = static_cast<float>(m_LevelCount - m_FirstLevel);
 	samplerCreateInfo.mipLodBias = 0.0f; // lets us force vulkan to use lower LOD and level than it would
 										 // normally use
 
@@ -1,38 +1,63 @@
 #pragma once
 
+#include <string>
+
 #include <vulkan/vulkan.h>
 
 #include "renderer/device.h"
-#include "renderer/buffer/commandBuffer.h"
 
 
 class Texture
 {
 public:
-	Texture(const Device* device, const CommandBuffer* commandBuffers);
+	// takes over an image in SHADER_READ_ONLY_OPTIMAL layout with the levels
+	// of the mip chain from `firstLevel` uploaded, and creates its view and
+	// sampler; `width` and `height` are the size of the whole chain
+	// textures are loaded by `TextureLoader`, and shared through
+	// `TextureCache` or streamed by `MipStreamer`
+	Texture(const Device* device,
+		const std::string& path,
+		VkFormat format,
+		uint32_t width,
+		uint32_t height,
+		uint32_t levelCount,
+		uint32_t firstLevel,
+		VkImage image,
+		const DeviceAllocation& imageMemory);
 	~Texture();
 
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
 	inline VkImageView GetImageView() const { return m_TextureImageView; }
 	inline VkSampler GetSampler() const { return m_TextureSampler; }
+	inline const std::string& GetPath() const { return m_Path; }
+	inline VkFormat GetFormat() const { return m_Format; }
+	inline uint32_t GetWidth() const { return m_Width; }
+	inline uint32_t GetHeight() const { return m_Height; }
+	inline uint32_t GetLevelCount() const { return m_LevelCount; }
+	// the first level of the chain in the image, the ones above it are not
+	// resident
+	inline uint32_t GetFirstLevel() const { return m_FirstLevel; }
+	inline VkImage GetImage() const { return m_TextureImage; }
+	// device memory taken by the image
+	inline VkDeviceSize GetMemorySize() const { return m_TextureImageMemory.size; }
 
 private:
-	void CreateTextureImage();
 	void CreateTextureImageView();
 	void CreateTextureSampler();
 
-	void TransitionImageLayout(VkImage image,
-		VkFormat format,
-		VkImageLayout oldLayout,
-		VkImageLayout newLayout,
-		uint32_t mipLevels);
-
 private:
 	const Device* m_Device;
-	const CommandBuffer* m_CommandBuffers;
+	std::string m_Path;
 
-	uint32_t m_MipLevels;
+	VkFormat m_Format;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_LevelCount;
+	uint32_t m_FirstLevel;
 	VkImage m_TextureImage;
-	VkDeviceMemory m_TextureImageMemory;
+	DeviceAllocation m_TextureImageMemory;
 	VkImageView m_TextureImageView;
 	VkSampler m_TextureSampler;
 };
\ No newline at end of file
@@ -0,0 +1,786 @@
+#include "bcCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "glm/glm.hpp"
+
+
+namespace texture {
+
+constexpr uint32_t g_BlockTexelCount = BC_BLOCK_DIMENSION * BC_BLOCK_DIMENSION;
+
+// interpolation weights of the 2, 3 and 4 bit BC7 indices, out of 64
+constexpr uint32_t g_Bc7Weights2[4] = { 0, 21, 43, 64 };
+constexpr uint32_t g_Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+constexpr uint32_t g_Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// weight of the first endpoint for every BC1 index in the 4 colour mode
+constexpr float g_Bc1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+// RGBA8 texels of a block in row order
+using BlockTexels = uint8_t[g_BlockTexelCount][4];
+
+// blocks are little endian bit streams that start at the lowest bit of their
+// first byte
+class BitWriter
+{
+public:
+	BitWriter(uint8_t* data)
+		: m_Data{ data },
+		  m_Offset{ 0 }
+	{}
+
+	void Write(uint32_t value, uint32_t bitCount)
+	{
+		for (uint32_t i = 0; i < bitCount; ++i, ++m_Offset)
+		{
+			if ((value >> i) & 1)
+				m_Data[m_Offset >> 3] |= static_cast<uint8_t>(1u << (m_Offset & 7));
+		}
+	}
+
+private:
+	uint8_t* m_Data;
+	uint32_t m_Offset;
+};
+
+class BitReader
+{
+public:
+	BitReader(const uint8_t* data)
+		: m_Data{ data },
+		  m_Offset{ 0 }
+	{}
+
+	uint32_t Read(uint32_t bitCount)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bitCount; ++i, ++m_Offset)
+			value |= static_cast<uint32_t>((m_Data[m_Offset >> 3] >> (m_Offset & 7)) & 1) << i;
+		return value;
+	}
+
+private:
+	const uint8_t* m_Data;
+	uint32_t m_Offset;
+};
+
+const char* GetBlockFormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return "BC1";
+	case BlockFormat::BC5:
+		return "BC5";
+	case BlockFormat::BC7:
+		return "BC7";
+	}
+
+	return "unknown";
+}
+
+uint32_t GetBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+uint64_t GetEncodedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	const uint64_t blocksX = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	const uint64_t blocksY = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	return blocksX * blocksY * GetBlockSize(format);
+}
+
+// the texels past the right and bottom edges repeat the last column and row
+static void LoadBlock(const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	uint32_t blockX,
+	uint32_t blockY,
+	BlockTexels& block)
+{
+	for (uint32_t y = 0; y < BC_BLOCK_DIMENSION; ++y)
+	{
+		const uint32_t sourceY = std::min(blockY * BC_BLOCK_DIMENSION + y, height - 1);
+		for (uint32_t x = 0; x < BC_BLOCK_DIMENSION; ++x)
+		{
+			const uint32_t sourceX = std::min(blockX * BC_BLOCK_DIMENSION + x, width - 1);
+			memcpy(block[y * BC_BLOCK_DIMENSION + x], texels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+		}
+	}
+}
+
+static void StoreBlock(const BlockTexels& block,
+	uint32_t width,
+	uint32_t height,
+	uint32_t blockX,
+	uint32_t blockY,
+	uint8_t* texels)
+{
+	for (uint32_t y = 0; y < BC_BLOCK_DIMENSION && blockY * BC_BLOCK_DIMENSION + y < height; ++y)
+	{
+		const uint32_t targetY = blockY * BC_BLOCK_DIMENSION + y;
+		for (uint32_t x = 0; x < BC_BLOCK_DIMENSION && blockX * BC_BLOCK_DIMENSION + x < width; ++x)
+		{
+			const uint32_t targetX = blockX * BC_BLOCK_DIMENSION + x;
+			memcpy(texels + (static_cast<size_t>(targetY) * width + targetX) * 4, block[y * BC_BLOCK_DIMENSION + x], 4);
+		}
+	}
+}
+
+// direction of the largest spread of the points around their mean, by power
+// iteration on their covariance; zero if every point is the same
+static glm::vec4 GetPrincipalAxis(const glm::vec4* points, const glm::vec4& mean)
+{
+	glm::mat4 covariance{ 0.0f };
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const glm::vec4 offset = points[i] - mean;
+		covariance += glm::outerProduct(offset, offset);
+	}
+
+	// starting from the channel with the largest variance, which can not be
+	// orthogonal to the principal axis
+	int channel = 0;
+	for (int i = 1; i < 4; ++i)
+	{
+		if (covariance[i][i] > covariance[channel][channel])
+			channel = i;
+	}
+
+	glm::vec4 axis = covariance[channel];
+	for (int i = 0; i < 8; ++i)
+	{
+		const float length = glm::length(axis);
+		if (length < 1e-6f)
+			return glm::vec4{ 0.0f };
+
+		axis = covariance * (axis / length);
+	}
+
+	const float length = glm::length(axis);
+	return length < 1e-6f ? glm::vec4{ 0.0f } : axis / length;
+}
+
+// the ends of the segment through the points along their principal axis
+static void GetEndpoints(const glm::vec4* points, glm::vec4& low, glm::vec4& high)
+{
+	glm::vec4 mean{ 0.0f };
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+		mean += points[i];
+	mean /= static_cast<float>(g_BlockTexelCount);
+
+	const glm::vec4 axis = GetPrincipalAxis(points, mean);
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const float projection = glm::dot(points[i] - mean, axis);
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	low = glm::clamp(mean + axis * minProjection, 0.0f, 255.0f);
+	high = glm::clamp(mean + axis * maxProjection, 0.0f, 255.0f);
+}
+
+// least squares endpoints of the points for their interpolation weights
+// (`weights[i]` of `second`); returns false if the weights do not determine
+// them, eg: every point uses the same index
+static bool SolveEndpoints(const glm::vec4* points, const float* weights, glm::vec4& first, glm::vec4& second)
+{
+	float firstFirst = 0.0f;
+	float firstSecond = 0.0f;
+	float secondSecond = 0.0f;
+	glm::vec4 firstPoint{ 0.0f };
+	glm::vec4 secondPoint{ 0.0f };
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const float secondWeight = weights[i];
+		const float firstWeight = 1.0f - secondWeight;
+		firstFirst += firstWeight * firstWeight;
+		firstSecond += firstWeight * secondWeight;
+		secondSecond += secondWeight * secondWeight;
+		firstPoint += points[i] * firstWeight;
+		secondPoint += points[i] * secondWeight;
+	}
+
+	const float determinant = firstFirst * secondSecond - firstSecond * firstSecond;
+	if (std::abs(determinant) < 1e-6f)
+		return false;
+
+	first = glm::clamp((firstPoint * secondSecond - secondPoint * firstSecond) / determinant, 0.0f, 255.0f);
+	second = glm::clamp((secondPoint * firstFirst - firstPoint * firstSecond) / determinant, 0.0f, 255.0f);
+	return true;
+}
+
+static uint32_t GetSquaredError(const glm::ivec4& lhs, const glm::ivec4& rhs)
+{
+	const glm::ivec4 difference = lhs - rhs;
+	return static_cast<uint32_t>(difference.x * difference.x + difference.y * difference.y
+		+ difference.z * difference.z + difference.w * difference.w);
+}
+
+// BC1
+
+static uint16_t PackRgb565(const glm::vec4& color)
+{
+	const uint32_t r = static_cast<uint32_t>(color.r * 31.0f / 255.0f + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(color.g * 63.0f / 255.0f + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(color.b * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static glm::ivec4 UnpackRgb565(uint16_t color)
+{
+	const int r = (color >> 11) & 31;
+	const int g = (color >> 5) & 63;
+	const int b = color & 31;
+	return glm::ivec4{ (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255 };
+}
+
+static void GetBc1Palette(uint16_t color0, uint16_t color1, glm::ivec4 palette[4])
+{
+	palette[0] = UnpackRgb565(color0);
+	palette[1] = UnpackRgb565(color1);
+	if (color0 > color1)
+	{
+		palette[2] = (palette[0] * 2 + palette[1]) / 3;
+		palette[3] = (palette[0] + palette[1] * 2) / 3;
+	}
+	else
+	{
+		// the 3 colour mode, black instead of the 4th colour
+		palette[2] = (palette[0] + palette[1]) / 2;
+		palette[3] = glm::ivec4{ 0, 0, 0, 255 };
+	}
+}
+
+// picks the closest palette colour for every texel; returns the squared
+// error of the block
+static uint32_t FitBc1Indices(const BlockTexels& block, uint16_t color0, uint16_t color1, uint32_t indices[16])
+{
+	// equal endpoints select the 3 colour mode, whose black is not wanted
+	glm::ivec4 palette[4];
+	GetBc1Palette(color0, color1, palette);
+	const uint32_t paletteSize = color0 > color1 ? 4 : 1;
+
+	uint32_t error = 0;
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const glm::ivec4 texel{ block[i][0], block[i][1], block[i][2], 255 };
+		uint32_t bestError = GetSquaredError(texel, palette[0]);
+		indices[i] = 0;
+		for (uint32_t j = 1; j < paletteSize; ++j)
+		{
+			const uint32_t texelError = GetSquaredError(texel, palette[j]);
+			if (texelError < bestError)
+			{
+				bestError = texelError;
+				indices[i] = j;
+			}
+		}
+		error += bestError;
+	}
+
+	return error;
+}
+
+// the 4 colour mode needs the first endpoint to be the larger one
+static void OrderBc1Endpoints(uint16_t& color0, uint16_t& color1)
+{
+	if (color0 < color1)
+		std::swap(color0, color1);
+}
+
+static void EncodeBc1Block(const BlockTexels& block, uint8_t* output)
+{
+	glm::vec4 points[g_BlockTexelCount];
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+		points[i] = glm::vec4{ block[i][0], block[i][1], block[i][2], 0.0f };
+
+	glm::vec4 low;
+	glm::vec4 high;
+	GetEndpoints(points, low, high);
+
+	uint16_t color0 = PackRgb565(high);
+	uint16_t color1 = PackRgb565(low);
+	OrderBc1Endpoints(color0, color1);
+
+	uint32_t indices[g_BlockTexelCount];
+	uint32_t error = FitBc1Indices(block, color0, color1, indices);
+
+	for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+	{
+		float weights[g_BlockTexelCount];
+		for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+			weights[i] = 1.0f - g_Bc1Weights[indices[i]];
+
+		glm::vec4 first;
+		glm::vec4 second;
+		if (!SolveEndpoints(points, weights, first, second))
+			break;
+
+		uint16_t refined0 = PackRgb565(first);
+		uint16_t refined1 = PackRgb565(second);
+		OrderBc1Endpoints(refined0, refined1);
+
+		uint32_t refinedIndices[g_BlockTexelCount];
+		const uint32_t refinedError = FitBc1Indices(block, refined0, refined1, refinedIndices);
+		if (refinedError >= error)
+			break;
+
+		color0 = refined0;
+		color1 = refined1;
+		error = refinedError;
+		memcpy(indices, refinedIndices, sizeof(indices));
+	}
+
+	memset(output, 0, 8);
+	BitWriter writer{ output };
+	writer.Write(color0, 16);
+	writer.Write(color1, 16);
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+		writer.Write(indices[i], 2);
+}
+
+static void DecodeBc1Block(const uint8_t* input, BlockTexels& block)
+{
+	BitReader reader{ input };
+	const uint16_t color0 = static_cast<uint16_t>(reader.Read(16));
+	const uint16_t color1 = static_cast<uint16_t>(reader.Read(16));
+
+	glm::ivec4 palette[4];
+	GetBc1Palette(color0, color1, palette);
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const glm::ivec4& color = palette[reader.Read(2)];
+		for (int channel = 0; channel < 4; ++channel)
+			block[i][channel] = static_cast<uint8_t>(color[channel]);
+	}
+}
+
+// BC4, a single channel; BC5 is two of them
+
+static void GetBc4Palette(uint32_t value0, uint32_t value1, uint32_t palette[8])
+{
+	palette[0] = value0;
+	palette[1] = value1;
+	if (value0 > value1)
+	{
+		for (uint32_t i = 2; i < 8; ++i)
+			palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+	}
+	else
+	{
+		for (uint32_t i = 2; i < 6; ++i)
+			palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static void EncodeBc4Block(const BlockTexels& block, uint32_t channel, uint8_t* output)
+{
+	uint32_t minValue = 255;
+	uint32_t maxValue = 0;
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		minValue = std::min<uint32_t>(minValue, block[i][channel]);
+		maxValue = std::max<uint32_t>(maxValue, block[i][channel]);
+	}
+
+	// the 8 value mode, which covers the range of the block evenly
+	uint32_t palette[8];
+	GetBc4Palette(maxValue, minValue, palette);
+
+	memset(output, 0, 8);
+	BitWriter writer{ output };
+	writer.Write(maxValue, 8);
+	writer.Write(minValue, 8);
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const uint32_t value = block[i][channel];
+		uint32_t bestIndex = 0;
+		uint32_t bestError = 256;
+		for (uint32_t j = 0; j < (maxValue > minValue ? 8u : 1u); ++j)
+		{
+			const uint32_t error = value > palette[j] ? value - palette[j] : palette[j] - value;
+			if (error < bestError)
+			{
+				bestError = error;
+				bestIndex = j;
+			}
+		}
+		writer.Write(bestIndex, 3);
+	}
+}
+
+static void DecodeBc4Block(const uint8_t* input, uint32_t channel, BlockTexels& block)
+{
+	BitReader reader{ input };
+	const uint32_t value0 = reader.Read(8);
+	const uint32_t value1 = reader.Read(8);
+
+	uint32_t palette[8];
+	GetBc4Palette(value0, value1, palette);
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+		block[i][channel] = static_cast<uint8_t>(palette[reader.Read(3)]);
+}
+
+// BC7
+
+static uint32_t InterpolateBc7(uint32_t value0, uint32_t value1, uint32_t weight)
+{
+	return ((64 - weight) * value0 + weight * value1 + 32) >> 6;
+}
+
+// the 7 bit endpoint closest to `value` once the p-bit is appended to it
+static uint32_t QuantizeBc7Mode6(float value, uint32_t pBit)
+{
+	const float quantized = std::round((value - static_cast<float>(pBit)) * 0.5f);
+	return static_cast<uint32_t>(std::clamp(quantized, 0.0f, 127.0f));
+}
+
+struct Bc7Mode6Block
+{
+	// 7 bits per channel
+	uint32_t endpoints[2][4];
+	uint32_t pBits[2];
+	uint32_t indices[g_BlockTexelCount];
+	uint32_t error;
+};
+
+// picks the closest of the 16 interpolated colours for every texel
+static void FitBc7Mode6Indices(const BlockTexels& block, Bc7Mode6Block& encoded)
+{
+	glm::ivec4 palette[16];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			const uint32_t value0 = (encoded.endpoints[0][channel] << 1) | encoded.pBits[0];
+			const uint32_t value1 = (encoded.endpoints[1][channel] << 1) | encoded.pBits[1];
+			palette[i][channel] = static_cast<int>(InterpolateBc7(value0, value1, g_Bc7Weights4[i]));
+		}
+	}
+
+	encoded.error = 0;
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		const glm::ivec4 texel{ block[i][0], block[i][1], block[i][2], block[i][3] };
+		uint32_t bestError = GetSquaredError(texel, palette[0]);
+		encoded.indices[i] = 0;
+		for (uint32_t j = 1; j < 16; ++j)
+		{
+			const uint32_t texelError = GetSquaredError(texel, palette[j]);
+			if (texelError < bestError)
+			{
+				bestError = texelError;
+				encoded.indices[i] = j;
+			}
+		}
+		encoded.error += bestError;
+	}
+}
+
+// the best of the 4 p-bit combinations for the endpoints
+static Bc7Mode6Block QuantizeBc7Mode6Endpoints(const BlockTexels& block,
+	const glm::vec4& first,
+	const glm::vec4& second)
+{
+	Bc7Mode6Block best{};
+	best.error = UINT32_MAX;
+	for (uint32_t pBits = 0; pBits < 4; ++pBits)
+	{
+		Bc7Mode6Block encoded{};
+		encoded.pBits[0] = pBits & 1;
+		encoded.pBits[1] = pBits >> 1;
+		for (int channel = 0; channel < 4; ++channel)
+		{
+			encoded.endpoints[0][channel] = QuantizeBc7Mode6(first[channel], encoded.pBits[0]);
+			encoded.endpoints[1][channel] = QuantizeBc7Mode6(second[channel], encoded.pBits[1]);
+		}
+
+		FitBc7Mode6Indices(block, encoded);
+		if (encoded.error < best.error)
+			best = encoded;
+	}
+
+	return best;
+}
+
+static void EncodeBc7Block(const BlockTexels& block, uint8_t* output)
+{
+	glm::vec4 points[g_BlockTexelCount];
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+		points[i] = glm::vec4{ block[i][0], block[i][1], block[i][2], block[i][3] };
+
+	glm::vec4 low;
+	glm::vec4 high;
+	GetEndpoints(points, low, high);
+	Bc7Mode6Block encoded = QuantizeBc7Mode6Endpoints(block, low, high);
+
+	for (int iteration = 0; iteration < 2 && encoded.error > 0; ++iteration)
+	{
+		float weights[g_BlockTexelCount];
+		for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+			weights[i] = static_cast<float>(g_Bc7Weights4[encoded.indices[i]]) / 64.0f;
+
+		glm::vec4 first;
+		glm::vec4 second;
+		if (!SolveEndpoints(points, weights, first, second))
+			break;
+
+		const Bc7Mode6Block refined = QuantizeBc7Mode6Endpoints(block, first, second);
+		if (refined.error >= encoded.error)
+			break;
+
+		encoded = refined;
+	}
+
+	// the most significant bit of the first index is implied to be 0
+	if (encoded.indices[0] >= 8)
+	{
+		std::swap(encoded.endpoints[0], encoded.endpoints[1]);
+		std::swap(encoded.pBits[0], encoded.pBits[1]);
+		for (uint32_t& index : encoded.indices)
+			index = 15 - index;
+	}
+
+	memset(output, 0, 16);
+	BitWriter writer{ output };
+	writer.Write(1 << 6, 7); // mode 6
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		writer.Write(encoded.endpoints[0][channel], 7);
+		writer.Write(encoded.endpoints[1][channel], 7);
+	}
+	writer.Write(encoded.pBits[0], 1);
+	writer.Write(encoded.pBits[1], 1);
+	writer.Write(encoded.indices[0], 3);
+	for (uint32_t i = 1; i < g_BlockTexelCount; ++i)
+		writer.Write(encoded.indices[i], 4);
+}
+
+static const uint32_t* GetBc7Weights(uint32_t indexBits)
+{
+	return indexBits == 2 ? g_Bc7Weights2 : indexBits == 3 ? g_Bc7Weights3 : g_Bc7Weights4;
+}
+
+// the first index of a subset has its most significant bit implied
+static void ReadBc7Indices(BitReader& reader, uint32_t indexBits, uint32_t indices[16])
+{
+	indices[0] = reader.Read(indexBits - 1);
+	for (uint32_t i = 1; i < g_BlockTexelCount; ++i)
+		indices[i] = reader.Read(indexBits);
+}
+
+// an endpoint of fewer bits is widened by repeating its high bits
+static uint32_t ExpandBc7Endpoint(uint32_t value, uint32_t bitCount)
+{
+	return bitCount >= 8 ? value : (value << (8 - bitCount)) | (value >> (2 * bitCount - 8));
+}
+
+static void DecodeBc7Block(const uint8_t* input, BlockTexels& block)
+{
+	BitReader reader{ input };
+	uint32_t mode = 0;
+	while (mode < 8 && reader.Read(1) == 0)
+		++mode;
+
+	// the reserved mode decodes to transparent black
+	if (mode == 8)
+	{
+		memset(block, 0, sizeof(BlockTexels));
+		return;
+	}
+	if (mode < 4 || mode == 7)
+		throw std::runtime_error("Unsupported BC7 block mode: " + std::to_string(mode));
+
+	uint32_t rotation = 0;
+	uint32_t indexSelection = 0;
+	if (mode == 4 || mode == 5)
+		rotation = reader.Read(2);
+	if (mode == 4)
+		indexSelection = reader.Read(1);
+
+	const uint32_t colorBits = mode == 4 ? 5 : 7;
+	const uint32_t alphaBits = mode == 4 ? 6 : mode == 5 ? 8 : 7;
+
+	uint32_t endpoints[2][4];
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		endpoints[0][channel] = reader.Read(colorBits);
+		endpoints[1][channel] = reader.Read(colorBits);
+	}
+	endpoints[0][3] = reader.Read(alphaBits);
+	endpoints[1][3] = reader.Read(alphaBits);
+
+	if (mode == 6)
+	{
+		const uint32_t pBits[2] = { reader.Read(1), reader.Read(1) };
+		for (int endpoint = 0; endpoint < 2; ++endpoint)
+		{
+			for (int channel = 0; channel < 4; ++channel)
+				endpoints[endpoint][channel] = (endpoints[endpoint][channel] << 1) | pBits[endpoint];
+		}
+	}
+	else
+	{
+		for (int endpoint = 0; endpoint < 2; ++endpoint)
+		{
+			for (int channel = 0; channel < 3; ++channel)
+				endpoints[endpoint][channel] = ExpandBc7Endpoint(endpoints[endpoint][channel], colorBits);
+			endpoints[endpoint][3] = ExpandBc7Endpoint(endpoints[endpoint][3], alphaBits);
+		}
+	}
+
+	// mode 6 shares its indices between colour and alpha, mode 5 has 2 bit
+	// ones for both and mode 4 a 2 and a 3 bit set, swapped by the index
+	// selection bit
+	uint32_t colorIndices[g_BlockTexelCount];
+	uint32_t alphaIndices[g_BlockTexelCount];
+	uint32_t colorIndexBits = 4;
+	uint32_t alphaIndexBits = 4;
+	if (mode == 6)
+	{
+		ReadBc7Indices(reader, 4, colorIndices);
+		memcpy(alphaIndices, colorIndices, sizeof(colorIndices));
+	}
+	else if (mode == 5)
+	{
+		colorIndexBits = 2;
+		alphaIndexBits = 2;
+		ReadBc7Indices(reader, 2, colorIndices);
+		ReadBc7Indices(reader, 2, alphaIndices);
+	}
+	else
+	{
+		colorIndexBits = indexSelection ? 3 : 2;
+		alphaIndexBits = indexSelection ? 2 : 3;
+		ReadBc7Indices(reader, 2, indexSelection ? alphaIndices : colorIndices);
+		ReadBc7Indices(reader, 3, indexSelection ? colorIndices : alphaIndices);
+	}
+
+	const uint32_t* colorWeights = GetBc7Weights(colorIndexBits);
+	const uint32_t* alphaWeights = GetBc7Weights(alphaIndexBits);
+	for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+	{
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			block[i][channel] = static_cast<uint8_t>(
+				InterpolateBc7(endpoints[0][channel], endpoints[1][channel], colorWeights[colorIndices[i]]));
+		}
+		block[i][3] =
+			static_cast<uint8_t>(InterpolateBc7(endpoints[0][3], endpoints[1][3], alphaWeights[alphaIndices[i]]));
+
+		// the rotation swaps alpha with one of the colour channels
+		if (rotation != 0)
+			std::swap(block[i][3], block[i][rotation - 1]);
+	}
+}
+
+void Encode(BlockFormat format,
+	const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	uint8_t* blocks,
+	ThreadPool& threadPool)
+{
+	const uint32_t blocksX = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	const uint32_t blocksY = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	const uint32_t blockSize = GetBlockSize(format);
+
+	threadPool.ParallelForRange(blocksY, 1, [&](size_t begin, size_t end) {
+		BlockTexels block;
+		for (size_t blockY = begin; blockY < end; ++blockY)
+		{
+			for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+			{
+				LoadBlock(texels, width, height, blockX, static_cast<uint32_t>(blockY), block);
+				uint8_t* output = blocks + (blockY * blocksX + blockX) * blockSize;
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					EncodeBc1Block(block, output);
+					break;
+				case BlockFormat::BC5:
+					EncodeBc4Block(block, 0, output);
+					EncodeBc4Block(block, 1, output + 8);
+					break;
+				case BlockFormat::BC7:
+					EncodeBc7Block(block, output);
+					break;
+				}
+			}
+		}
+	});
+}
+
+// decodes the rows of blocks in [beginRow, endRow)
+static void DecodeRows(BlockFormat format,
+	const uint8_t* blocks,
+	uint32_t width,
+	uint32_t height,
+	uint8_t* texels,
+	size_t beginRow,
+	size_t endRow)
+{
+	const uint32_t blocksX = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	const uint32_t blockSize = GetBlockSize(format);
+
+	BlockTexels block;
+	for (size_t blockY = beginRow; blockY < endRow; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			const uint8_t* input = blocks + (blockY * blocksX + blockX) * blockSize;
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				DecodeBc1Block(input, block);
+				break;
+			case BlockFormat::BC5:
+				for (uint32_t i = 0; i < g_BlockTexelCount; ++i)
+				{
+					block[i][2] = 0;
+					block[i][3] = 255;
+				}
+				DecodeBc4Block(input, 0, block);
+				DecodeBc4Block(input + 8, 1, block);
+				break;
+			case BlockFormat::BC7:
+				DecodeBc7Block(input, block);
+				break;
+			}
+			StoreBlock(block, width, height, blockX, static_cast<uint32_t>(blockY), texels);
+		}
+	}
+}
+
+void Decode(BlockFormat format,
+	const uint8_t* blocks,
+	uint32_t width,
+	uint32_t height,
+	uint8_t* texels,
+	ThreadPool& threadPool)
+{
+	const uint32_t blocksY = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	threadPool.ParallelForRange(blocksY, 4, [&](size_t begin, size_t end) {
+		DecodeRows(format, blocks, width, height, texels, begin, end);
+	});
+}
+
+void Decode(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels)
+{
+	const uint32_t blocksY = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+	DecodeRows(format, blocks, width, height, texels, 0, blocksY);
+}
+
+} // namespace texture
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/threadPool.h"
+
+
+namespace texture {
+
+// block compressed formats, every block holds 4x4 texels
+enum class BlockFormat
+{
+	BC1, // RGB, 8 bytes per block (0.5 byte per texel), for opaque colours
+	BC5, // RG, 16 bytes per block, two BC4 channels, for tangent space normal maps
+	BC7 // RGBA, 16 bytes per block (1 byte per texel), for colours with alpha
+};
+
+constexpr uint32_t BC_BLOCK_DIMENSION = 4;
+
+const char* GetBlockFormatName(BlockFormat format);
+uint32_t GetBlockSize(BlockFormat format);
+// blocks at the right and bottom edges are padded, so a 1x1 level still
+// takes a whole block
+uint64_t GetEncodedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+// encodes the RGBA8 `texels` (`width * height`) into `GetEncodedSize` bytes
+// of `blocks`, rows of blocks in parallel on `threadPool`
+// the endpoints are fit along the principal axis of the block and refined by
+// least squares; BC7 blocks are only written in mode 6 (a single RGBA
+// subset with 16 interpolation steps), which is the best single mode for
+// smooth colours and alpha
+void Encode(BlockFormat format,
+	const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	uint8_t* blocks,
+	ThreadPool& threadPool);
+
+// decodes the blocks back into RGBA8 texels like a GPU samples them: BC1
+// alpha is 1, BC5 blue is 0 and alpha 1
+// BC7 blocks are decoded in the single subset modes (4, 5 and 6), it throws
+// on the partitioned ones, which the encoder never writes
+void Decode(BlockFormat format,
+	const uint8_t* blocks,
+	uint32_t width,
+	uint32_t height,
+	uint8_t* texels,
+	ThreadPool& threadPool);
+// on the calling thread, eg: from a task of the thread pool
+void Decode(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* texels);
+
+} // namespace texture
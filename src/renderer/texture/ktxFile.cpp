@@ -0,0 +1,390 @@
+#include "ktxFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "stb_image/stb_image.h"
+
+#include "core/hash.h"
+
+
+constexpr uint8_t g_KtxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// the KTXwriter value; textures written by other versions (or tools) are
+// cooked again
+const std::string g_KtxWriter = "vulkanBasics assetCooker " + std::to_string(KTX_FILE_VERSION);
+
+// basic data format descriptor of the Khronos data format specification
+constexpr uint32_t g_DfdVersion = 2; // 1.3
+constexpr uint32_t g_DfdModelBc1 = 128;
+constexpr uint32_t g_DfdModelBc5 = 132;
+constexpr uint32_t g_DfdModelBc7 = 134;
+constexpr uint32_t g_DfdPrimariesBt709 = 1;
+constexpr uint32_t g_DfdTransferLinear = 1;
+constexpr uint32_t g_DfdTransferSrgb = 2;
+constexpr uint32_t g_DfdChannelRed = 0; // also the colour channel of BC1 and BC7
+constexpr uint32_t g_DfdChannelGreen = 1;
+
+KtxFile::KtxFile(const std::string& path)
+	: m_File{ std::make_unique<MappedFile>(path) },
+	  m_Header{},
+	  m_BlockFormat{ texture::BlockFormat::BC1 }
+{
+	Validate();
+}
+
+static bool ToBlockFormat(uint32_t vkFormat, texture::BlockFormat& format)
+{
+	switch (vkFormat)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		format = texture::BlockFormat::BC1;
+		return true;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		format = texture::BlockFormat::BC5;
+		return true;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		format = texture::BlockFormat::BC7;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void KtxFile::Validate()
+{
+	if (m_File->GetSize() < sizeof(KtxHeader))
+		throw std::runtime_error("Cooked texture is too small: " + m_File->GetPath());
+
+	memcpy(&m_Header, m_File->GetData(), sizeof(KtxHeader));
+
+	if (memcmp(m_Header.identifier, g_KtxIdentifier, sizeof(g_KtxIdentifier)) != 0)
+		throw std::runtime_error("Not a KTX 2.0 file: " + m_File->GetPath());
+	if (!ToBlockFormat(m_Header.vkFormat, m_BlockFormat))
+		throw std::runtime_error("Unsupported KTX texture format: " + m_File->GetPath());
+	if (m_Header.pixelWidth == 0 || m_Header.pixelHeight == 0)
+		throw std::runtime_error("Cooked texture is empty: " + m_File->GetPath());
+	if (m_Header.pixelDepth != 0 || m_Header.layerCount != 0 || m_Header.faceCount != 1)
+		throw std::runtime_error("Only 2D KTX textures are supported: " + m_File->GetPath());
+	if (m_Header.supercompressionScheme != 0)
+		throw std::runtime_error("Supercompressed KTX textures are not supported: " + m_File->GetPath());
+
+	// a level count of 0 asks for the mips to be generated at load time
+	const uint32_t maxLevelCount = texture::GetMipLevelCount(m_Header.pixelWidth, m_Header.pixelHeight);
+	if (m_Header.levelCount == 0 || m_Header.levelCount > maxLevelCount)
+		throw std::runtime_error("Invalid KTX level count: " + m_File->GetPath());
+
+	if (m_File->GetSize() < sizeof(KtxHeader) + sizeof(KtxLevel) * m_Header.levelCount)
+		throw std::runtime_error("Cooked texture is truncated: " + m_File->GetPath());
+
+	m_Levels.resize(m_Header.levelCount);
+	memcpy(m_Levels.data(), m_File->GetData() + sizeof(KtxHeader), sizeof(KtxLevel) * m_Levels.size());
+
+	for (uint32_t level = 0; level < m_Header.levelCount; ++level)
+	{
+		const KtxLevel& levelIndex = m_Levels[level];
+		if (levelIndex.byteLength
+			!= texture::GetEncodedSize(m_BlockFormat, GetLevelWidth(level), GetLevelHeight(level)))
+			throw std::runtime_error("Invalid KTX level size: " + m_File->GetPath());
+		if (levelIndex.byteOffset > m_File->GetSize()
+			|| levelIndex.byteLength > m_File->GetSize() - levelIndex.byteOffset)
+			throw std::runtime_error("Cooked texture is truncated: " + m_File->GetPath());
+		// copies from the staging buffer need offsets aligned to the block
+		if (levelIndex.byteOffset % texture::GetBlockSize(m_BlockFormat) != 0)
+			throw std::runtime_error("Misaligned KTX level: " + m_File->GetPath());
+	}
+}
+
+uint64_t KtxFile::GetDataSize() const
+{
+	uint64_t size = 0;
+	for (const KtxLevel& level : m_Levels)
+		size += level.byteLength;
+	return size;
+}
+
+VkFormat KtxFile::GetVkFormat(texture::BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case texture::BlockFormat::BC1:
+		return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case texture::BlockFormat::BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case texture::BlockFormat::BC7:
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+
+	return VK_FORMAT_UNDEFINED;
+}
+
+std::string KtxFile::GetCookedPath(const std::string& imagePath)
+{
+	return std::filesystem::path{ imagePath }.replace_extension(".ktx2").string();
+}
+
+bool KtxFile::IsUpToDate(const std::string& path, const std::string& sourcePath)
+{
+	std::error_code errorCode;
+	if (!std::filesystem::exists(path, errorCode))
+		return false;
+
+	// a cooked texture without its source is used as is
+	if (std::filesystem::exists(sourcePath, errorCode))
+	{
+		const auto sourceTime = std::filesystem::last_write_time(sourcePath, errorCode);
+		const auto cookedTime = std::filesystem::last_write_time(path, errorCode);
+		if (errorCode || cookedTime < sourceTime)
+			return false;
+	}
+
+	return IsCompatible(path);
+}
+
+// the KTXwriter value, or an empty string if there is none
+static std::string ReadWriter(std::ifstream& file, const KtxHeader& header)
+{
+	std::vector<char> data(header.kvdByteLength);
+	file.seekg(header.kvdByteOffset);
+	if (data.empty() || !file.read(data.data(), static_cast<std::streamsize>(data.size())))
+		return {};
+
+	// entries are a 4 byte length, the key and the value, each followed by a
+	// 0, padded to 4 bytes
+	const char key[] = "KTXwriter";
+	size_t offset = 0;
+	while (offset + sizeof(uint32_t) <= data.size())
+	{
+		uint32_t length = 0;
+		memcpy(&length, data.data() + offset, sizeof(length));
+		offset += sizeof(length);
+		if (length > data.size() - offset)
+			break;
+
+		if (length > sizeof(key) && memcmp(data.data() + offset, key, sizeof(key)) == 0)
+			return std::string{ data.data() + offset + sizeof(key) };
+
+		offset += (length + 3) & ~3u;
+	}
+
+	return {};
+}
+
+bool KtxFile::IsCompatible(const std::string& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	KtxHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	texture::BlockFormat format;
+	if (memcmp(header.identifier, g_KtxIdentifier, sizeof(g_KtxIdentifier)) != 0
+		|| !ToBlockFormat(header.vkFormat, format) || header.kvdByteLength > 4096)
+		return false;
+
+	return ReadWriter(file, header) == g_KtxWriter;
+}
+
+// data format descriptor of the block format, as 32 bit words
+static std::vector<uint32_t> GetDataFormatDescriptor(texture::BlockFormat format, bool srgb)
+{
+	const uint32_t sampleCount = format == texture::BlockFormat::BC5 ? 2 : 1;
+	const uint32_t blockSize = 24 + 16 * sampleCount;
+	const uint32_t bitLength = format == texture::BlockFormat::BC5 ? 64 : texture::GetBlockSize(format) * 8;
+
+	uint32_t model = g_DfdModelBc1;
+	if (format == texture::BlockFormat::BC5)
+		model = g_DfdModelBc5;
+	else if (format == texture::BlockFormat::BC7)
+		model = g_DfdModelBc7;
+
+	std::vector<uint32_t> words;
+	words.push_back(4 + blockSize); // total size, including this word
+	words.push_back(0); // vendor and descriptor type: Khronos basic
+	words.push_back(g_DfdVersion | (blockSize << 16));
+	words.push_back(model | (g_DfdPrimariesBt709 << 8) | ((srgb ? g_DfdTransferSrgb : g_DfdTransferLinear) << 16));
+	words.push_back((texture::BC_BLOCK_DIMENSION - 1) | ((texture::BC_BLOCK_DIMENSION - 1) << 8)); // 4x4x1x1 texels
+	words.push_back(texture::GetBlockSize(format)); // bytes of plane 0
+	words.push_back(0);
+
+	for (uint32_t sample = 0; sample < sampleCount; ++sample)
+	{
+		const uint32_t channel = sample == 0 ? g_DfdChannelRed : g_DfdChannelGreen;
+		words.push_back((sample * bitLength) | ((bitLength - 1) << 16) | (channel << 24));
+		words.push_back(0); // sample position
+		words.push_back(0); // lower
+		words.push_back(UINT32_MAX); // upper
+	}
+
+	return words;
+}
+
+bool KtxFile::Write(const std::string& path,
+	texture::BlockFormat format,
+	bool srgb,
+	uint32_t width,
+	uint32_t height,
+	const std::vector<std::vector<uint8_t>>& levels)
+{
+	const std::vector<uint32_t> dataFormatDescriptor = GetDataFormatDescriptor(format, srgb);
+
+	// a single KTXwriter entry
+	const char key[] = "KTXwriter";
+	const uint32_t keyValueLength = static_cast<uint32_t>(sizeof(key) + g_KtxWriter.size() + 1);
+	std::vector<uint8_t> keyValueData(sizeof(uint32_t) + ((keyValueLength + 3) & ~3u), 0);
+	memcpy(keyValueData.data(), &keyValueLength, sizeof(keyValueLength));
+	memcpy(keyValueData.data() + sizeof(uint32_t), key, sizeof(key));
+	memcpy(keyValueData.data() + sizeof(uint32_t) + sizeof(key), g_KtxWriter.c_str(), g_KtxWriter.size() + 1);
+
+	KtxHeader header{};
+	memcpy(header.identifier, g_KtxIdentifier, sizeof(g_KtxIdentifier));
+	header.vkFormat = static_cast<uint32_t>(GetVkFormat(format, srgb));
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(KtxHeader) + sizeof(KtxLevel) * levels.size());
+	header.dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size() * sizeof(uint32_t));
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<uint32_t>(keyValueData.size());
+
+	// the smallest level first, so that a reader streaming the file gets a
+	// low resolution version early
+	const uint64_t blockSize = texture::GetBlockSize(format);
+	std::vector<KtxLevel> levelIndex(levels.size());
+	uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+	for (size_t level = levels.size(); level-- > 0;)
+	{
+		offset = (offset + blockSize - 1) / blockSize * blockSize;
+		levelIndex[level].byteOffset = offset;
+		levelIndex[level].byteLength = levels[level].size();
+		levelIndex[level].uncompressedByteLength = levels[level].size();
+		offset += levels[level].size();
+	}
+
+	// write to a temporary file first and rename it afterwards, so that a
+	// crash while cooking never leaves a half written texture behind
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levelIndex.data()),
+			static_cast<std::streamsize>(levelIndex.size() * sizeof(KtxLevel)));
+		file.write(reinterpret_cast<const char*>(dataFormatDescriptor.data()), header.dfdByteLength);
+		file.write(reinterpret_cast<const char*>(keyValueData.data()), header.kvdByteLength);
+
+		const char padding[16]{};
+		uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+		for (size_t level = levels.size(); level-- > 0;)
+		{
+			file.write(padding, static_cast<std::streamsize>(levelIndex[level].byteOffset - written));
+			file.write(reinterpret_cast<const char*>(levels[level].data()),
+				static_cast<std::streamsize>(levels[level].size()));
+			written = levelIndex[level].byteOffset + levels[level].size();
+		}
+
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, path, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return true;
+}
+
+bool KtxFile::IsNormalMap(const std::string& imagePath)
+{
+	std::string name = std::filesystem::path{ imagePath }.stem().string();
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+	const auto endsWith = [&name](const std::string& suffix) {
+		return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	return name.find("normal") != std::string::npos || endsWith("_n") || endsWith("_nrm");
+}
+
+texture::BlockFormat KtxFile::ChooseFormat(const std::string& imagePath,
+	const uint8_t* texels,
+	uint32_t width,
+	uint32_t height)
+{
+	if (IsNormalMap(imagePath))
+		return texture::BlockFormat::BC5;
+
+	const size_t texelCount = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		if (texels[i * 4 + 3] != 255)
+			return texture::BlockFormat::BC7;
+	}
+
+	return texture::BlockFormat::BC1;
+}
+
+uint64_t KtxFile::GetCacheKey(const std::string& imagePath, texture::MipFilter mipFilter)
+{
+	// the format also depends on the name of the image
+	const uint64_t paramsHash = hash::Combine(IsNormalMap(imagePath), static_cast<uint64_t>(mipFilter));
+	return AssetCache::MakeKey("ktx2", KTX_FILE_VERSION, hash::HashFile(imagePath), paramsHash);
+}
+
+bool KtxFile::Cook(const std::string& imagePath,
+	const std::string& path,
+	ThreadPool& threadPool,
+	AssetCache* cache,
+	texture::MipFilter mipFilter)
+{
+	const uint64_t cacheKey = cache ? GetCacheKey(imagePath, mipFilter) : 0;
+	if (cache && cache->Extract(cacheKey, path) && IsCompatible(path))
+		return true;
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	// force alpha (even if there isnt one), like the textures
+	stbi_uc* texels = stbi_load(imagePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!texels)
+		throw std::runtime_error("Failed to load texture image: " + imagePath);
+
+	const uint32_t textureWidth = static_cast<uint32_t>(width);
+	const uint32_t textureHeight = static_cast<uint32_t>(height);
+	const texture::BlockFormat format = ChooseFormat(imagePath, texels, textureWidth, textureHeight);
+	const bool srgb = format != texture::BlockFormat::BC5;
+
+	const std::vector<texture::MipLevel> mipChain =
+		texture::BuildMipChain(texels, textureWidth, textureHeight, mipFilter, srgb, threadPool);
+
+	std::vector<std::vector<uint8_t>> levels(mipChain.size() + 1);
+	levels[0].resize(texture::GetEncodedSize(format, textureWidth, textureHeight));
+	texture::Encode(format, texels, textureWidth, textureHeight, levels[0].data(), threadPool);
+	stbi_image_free(texels);
+
+	for (size_t level = 1; level < levels.size(); ++level)
+	{
+		const texture::MipLevel& mipLevel = mipChain[level - 1];
+		levels[level].resize(texture::GetEncodedSize(format, mipLevel.width, mipLevel.height));
+		texture::Encode(
+			format, mipLevel.texels.data(), mipLevel.width, mipLevel.height, levels[level].data(), threadPool);
+	}
+
+	const bool written = Write(path, format, srgb, textureWidth, textureHeight, levels);
+	if (written && cache)
+		cache->StoreFile(cacheKey, path);
+	return written;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "core/assetCache.h"
+#include "core/mappedFile.h"
+#include "core/span.h"
+#include "core/threadPool.h"
+#include "renderer/texture/bcCodec.h"
+#include "renderer/texture/mipChain.h"
+
+
+// cooked block compressed texture, a KTX 2.0 file
+// (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html) holding a
+// single 2D image with its whole mip chain, so it opens in the KTX tools
+// the file is laid out as:
+//     KtxHeader
+//     KtxLevel for every level, the largest first
+//     data format descriptor
+//     key/value data (KTXwriter, which carries KTX_FILE_VERSION)
+//     level blobs, the smallest first, each aligned to a block
+// only what the cooker writes is loaded: BC1, BC5 and BC7 without array
+// layers, cube faces, depth or supercompression
+constexpr uint32_t KTX_FILE_VERSION = 2; // bump this when the encoded blocks or the mip chain change
+
+struct KtxHeader
+{
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+struct KtxLevel
+{
+	uint64_t byteOffset; // from the start of the file
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(KtxHeader) == 80, "KtxHeader must match the KTX 2.0 layout");
+static_assert(sizeof(KtxLevel) == 24, "KtxLevel must match the KTX 2.0 layout");
+
+
+class KtxFile
+{
+public:
+	// maps the cooked texture into memory and validates the header and the
+	// level index
+	KtxFile(const std::string& path);
+
+	// writes the levels of the mip chain, the largest first, each holding
+	// `texture::GetEncodedSize` bytes; returns false if the file could not be
+	// written
+	static bool Write(const std::string& path,
+		texture::BlockFormat format,
+		bool srgb,
+		uint32_t width,
+		uint32_t height,
+		const std::vector<std::vector<uint8_t>>& levels);
+
+	// decodes the source image, builds its mip chain with `mipFilter` and
+	// encodes every level in the format picked by `ChooseFormat`, unless
+	// `cache` has it already; throws if the image cannot be decoded, returns
+	// false if the file could not be written
+	static bool Cook(const std::string& imagePath,
+		const std::string& path,
+		ThreadPool& threadPool,
+		AssetCache* cache = nullptr,
+		texture::MipFilter mipFilter = texture::MipFilter::KAISER);
+
+	// BC5 for normal maps (named like `brick_normal.png` or `brick_n.png`),
+	// BC7 for images with alpha and BC1 for opaque ones
+	static texture::BlockFormat ChooseFormat(const std::string& imagePath,
+		const uint8_t* texels,
+		uint32_t width,
+		uint32_t height);
+	// normal maps are linear, the colours are sRGB
+	static bool IsNormalMap(const std::string& imagePath);
+
+	// of the texture cooked from the image in the asset cache
+	static uint64_t GetCacheKey(const std::string& imagePath, texture::MipFilter mipFilter);
+
+	// checks if the cooked texture was written with the current version and
+	// after its source image, without mapping the whole file
+	static bool IsUpToDate(const std::string& path, const std::string& sourcePath);
+	// only checks the version, eg: when the cooker tracks the source images
+	static bool IsCompatible(const std::string& path);
+
+	// path of the cooked texture for a source image (eg: `room.png` -> `room.ktx2`)
+	static std::string GetCookedPath(const std::string& imagePath);
+
+	static VkFormat GetVkFormat(texture::BlockFormat format, bool srgb);
+
+	// points directly into the mapped file
+	inline Span<const uint8_t> GetLevelData(uint32_t level) const
+	{
+		return Span<const uint8_t>{ m_File->GetData() + m_Levels[level].byteOffset, m_Levels[level].byteLength };
+	}
+
+	inline VkFormat GetFormat() const { return static_cast<VkFormat>(m_Header.vkFormat); }
+	inline texture::BlockFormat GetBlockFormat() const { return m_BlockFormat; }
+	inline uint32_t GetWidth() const { return m_Header.pixelWidth; }
+	inline uint32_t GetHeight() const { return m_Header.pixelHeight; }
+	inline uint32_t GetLevelCount() const { return m_Header.levelCount; }
+	inline uint32_t GetLevelWidth(uint32_t level) const { return std::max(1u, m_Header.pixelWidth >> level); }
+	inline uint32_t GetLevelHeight(uint32_t level) const { return std::max(1u, m_Header.pixelHeight >> level); }
+	// of every level
+	uint64_t GetDataSize() const;
+
+	// reads the whole file in, see `MappedFile::Prefetch`
+	inline void Prefetch() const { m_File->Prefetch(); }
+
+private:
+	void Validate();
+
+private:
+	std::unique_ptr<MappedFile> m_File;
+	KtxHeader m_Header;
+	std::vector<KtxLevel> m_Levels;
+	texture::BlockFormat m_BlockFormat;
+};
@@ -0,0 +1,332 @@
+#include "mipChain.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MIP_CHAIN_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define MIP_CHAIN_SSE2 0
+#endif
+
+
+namespace texture {
+
+// radius of the Kaiser filter in texels of the level it makes, and the
+// shape of its window; wider or lower alpha is sharper but rings more
+constexpr float g_KaiserWidth = 3.0f;
+constexpr float g_KaiserAlpha = 4.0f;
+constexpr float g_Pi = 3.14159265358979f;
+
+// linear values are converted back to sRGB through a table of this size,
+// fine enough to stay within half a step of 8 bits in the darks
+constexpr uint32_t g_LinearToSrgbTableSize = 16384;
+
+constexpr uint32_t g_RowsPerTask = 16;
+
+// texels of the level above, and their weights, that make one texel of a
+// level along one axis
+struct AxisFilter
+{
+	std::vector<uint32_t> first; // of every texel of the level into `indices` and `weights`, and one past the last
+	std::vector<uint32_t> indices;
+	std::vector<float> weights;
+};
+
+const char* GetMipFilterName(MipFilter filter)
+{
+	switch (filter)
+	{
+	case MipFilter::BOX:
+		return "box";
+	case MipFilter::KAISER:
+		return "kaiser";
+	}
+
+	return "unknown";
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t size = std::max(width, height);
+	uint32_t levelCount = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		++levelCount;
+	}
+
+	return levelCount;
+}
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static float Sinc(float x)
+{
+	x *= g_Pi;
+	return std::abs(x) < 1e-5f ? 1.0f : std::sin(x) / x;
+}
+
+// modified Bessel function of the first kind, by its power series
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	const float halfSquared = x * x * 0.25f;
+	for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+	{
+		term *= halfSquared / static_cast<float>(k * k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+// `x` in texels of the level being made
+static float Kaiser(float x)
+{
+	if (std::abs(x) >= g_KaiserWidth)
+		return 0.0f;
+
+	const float ratio = x / g_KaiserWidth;
+	return Sinc(x) * BesselI0(g_KaiserAlpha * std::sqrt(1.0f - ratio * ratio)) / BesselI0(g_KaiserAlpha);
+}
+
+// the texels past the edges repeat the edge texel, so their weights are
+// merged into it
+static AxisFilter GetAxisFilter(uint32_t sourceSize, uint32_t size, MipFilter filter)
+{
+	const float scale = static_cast<float>(sourceSize) / static_cast<float>(size);
+	const float radius = filter == MipFilter::BOX ? scale * 0.5f : g_KaiserWidth * scale;
+
+	AxisFilter axisFilter;
+	axisFilter.first.reserve(size + 1);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const uint32_t first = static_cast<uint32_t>(axisFilter.indices.size());
+		axisFilter.first.push_back(first);
+
+		// in texels of the level above
+		const float center = (static_cast<float>(i) + 0.5f) * scale;
+		const int begin = static_cast<int>(std::floor(center - radius));
+		const int end = static_cast<int>(std::ceil(center + radius));
+
+		float sum = 0.0f;
+		for (int j = begin; j < end; ++j)
+		{
+			float weight = 0.0f;
+			if (filter == MipFilter::BOX)
+			{
+				// the part of the texel the box covers
+				const float low = std::max(static_cast<float>(j), center - radius);
+				const float high = std::min(static_cast<float>(j + 1), center + radius);
+				weight = std::max(0.0f, high - low);
+			}
+			else
+			{
+				weight = Kaiser((static_cast<float>(j) + 0.5f - center) / scale);
+			}
+			if (weight == 0.0f)
+				continue;
+
+			const uint32_t index = static_cast<uint32_t>(std::clamp(j, 0, static_cast<int>(sourceSize) - 1));
+			if (axisFilter.indices.size() > first && axisFilter.indices.back() == index)
+			{
+				axisFilter.weights.back() += weight;
+			}
+			else
+			{
+				axisFilter.indices.push_back(index);
+				axisFilter.weights.push_back(weight);
+			}
+			sum += weight;
+		}
+
+		for (size_t tap = first; tap < axisFilter.weights.size(); ++tap)
+			axisFilter.weights[tap] /= sum;
+	}
+	axisFilter.first.push_back(static_cast<uint32_t>(axisFilter.indices.size()));
+
+	return axisFilter;
+}
+
+// weighted sum of the RGBA texels at `indices * stride` floats from `source`;
+// the Kaiser lobes can overshoot, so the result is clamped to [0, 1] when
+// `saturate` is set
+static void FilterTexel(const float* source,
+	size_t stride,
+	const uint32_t* indices,
+	const float* weights,
+	uint32_t count,
+	bool saturate,
+	float* target)
+{
+#if MIP_CHAIN_SSE2
+	__m128 sum = _mm_setzero_ps();
+	for (uint32_t i = 0; i < count; ++i)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + indices[i] * stride), _mm_set1_ps(weights[i])));
+	if (saturate)
+		sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	_mm_storeu_ps(target, sum);
+#else
+	float sum[4] = {};
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const float* texel = source + indices[i] * stride;
+		for (int channel = 0; channel < 4; ++channel)
+			sum[channel] += texel[channel] * weights[i];
+	}
+	for (int channel = 0; channel < 4; ++channel)
+		target[channel] = saturate ? std::clamp(sum[channel], 0.0f, 1.0f) : sum[channel];
+#endif
+}
+
+// the filter is separable: the rows are filtered to the width of the level
+// first, then the columns to its height
+static void Downsample(const std::vector<float>& source,
+	uint32_t sourceWidth,
+	uint32_t sourceHeight,
+	uint32_t width,
+	uint32_t height,
+	MipFilter filter,
+	std::vector<float>& target,
+	ThreadPool& threadPool)
+{
+	const AxisFilter horizontal = GetAxisFilter(sourceWidth, width, filter);
+	const AxisFilter vertical = GetAxisFilter(sourceHeight, height, filter);
+
+	std::vector<float> rows(static_cast<size_t>(width) * sourceHeight * 4);
+	threadPool.ParallelForRange(sourceHeight, g_RowsPerTask, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y)
+		{
+			const float* sourceRow = source.data() + y * sourceWidth * 4;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint32_t first = horizontal.first[x];
+				FilterTexel(sourceRow,
+					4,
+					horizontal.indices.data() + first,
+					horizontal.weights.data() + first,
+					horizontal.first[x + 1] - first,
+					false,
+					rows.data() + (y * width + x) * 4);
+			}
+		}
+	});
+
+	target.resize(static_cast<size_t>(width) * height * 4);
+	threadPool.ParallelForRange(height, g_RowsPerTask, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; ++y)
+		{
+			const uint32_t first = vertical.first[y];
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				FilterTexel(rows.data() + x * 4,
+					static_cast<size_t>(width) * 4,
+					vertical.indices.data() + first,
+					vertical.weights.data() + first,
+					vertical.first[y + 1] - first,
+					true,
+					target.data() + (y * width + x) * 4);
+			}
+		}
+	});
+}
+
+static std::vector<float> ToLinear(const uint8_t* texels, size_t texelCount, bool srgb, ThreadPool& threadPool)
+{
+	static const std::array<float, 256> srgbToLinear = []() {
+		std::array<float, 256> table{};
+		for (uint32_t i = 0; i < 256; ++i)
+			table[i] = SrgbToLinear(static_cast<float>(i) / 255.0f);
+		return table;
+	}();
+
+	std::vector<float> linear(texelCount * 4);
+	threadPool.ParallelForRange(texelCount, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin * 4; i < end * 4; ++i)
+		{
+			const bool isColor = srgb && i % 4 != 3;
+			linear[i] = isColor ? srgbToLinear[texels[i]] : static_cast<float>(texels[i]) / 255.0f;
+		}
+	});
+
+	return linear;
+}
+
+static std::vector<uint8_t> ToTexels(const std::vector<float>& linear, bool srgb, ThreadPool& threadPool)
+{
+	static const std::vector<uint8_t> linearToSrgb = []() {
+		std::vector<uint8_t> table(g_LinearToSrgbTableSize);
+		for (uint32_t i = 0; i < g_LinearToSrgbTableSize; ++i)
+		{
+			const float value = LinearToSrgb(static_cast<float>(i) / static_cast<float>(g_LinearToSrgbTableSize - 1));
+			table[i] = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+		return table;
+	}();
+
+	// the values are clamped by the filter
+	std::vector<uint8_t> texels(linear.size());
+	threadPool.ParallelForRange(linear.size() / 4, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin * 4; i < end * 4; ++i)
+		{
+			if (srgb && i % 4 != 3)
+			{
+				const float index = linear[i] * static_cast<float>(g_LinearToSrgbTableSize - 1) + 0.5f;
+				texels[i] = linearToSrgb[static_cast<size_t>(index)];
+			}
+			else
+			{
+				texels[i] = static_cast<uint8_t>(linear[i] * 255.0f + 0.5f);
+			}
+		}
+	});
+
+	return texels;
+}
+
+std::vector<MipLevel> BuildMipChain(const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	MipFilter filter,
+	bool srgb,
+	ThreadPool& threadPool)
+{
+	const uint32_t levelCount = GetMipLevelCount(width, height);
+	std::vector<MipLevel> levels;
+	if (levelCount == 1)
+		return levels;
+
+	levels.reserve(levelCount - 1);
+	std::vector<float> previous = ToLinear(texels, static_cast<size_t>(width) * height, srgb, threadPool);
+	std::vector<float> current;
+	uint32_t previousWidth = width;
+	uint32_t previousHeight = height;
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		const uint32_t levelWidth = std::max(1u, previousWidth / 2);
+		const uint32_t levelHeight = std::max(1u, previousHeight / 2);
+		Downsample(previous, previousWidth, previousHeight, levelWidth, levelHeight, filter, current, threadPool);
+
+		levels.push_back(MipLevel{ levelWidth, levelHeight, ToTexels(current, srgb, threadPool) });
+
+		previous.swap(current);
+		previousWidth = levelWidth;
+		previousHeight = levelHeight;
+	}
+
+	return levels;
+}
+
+} // namespace texture
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/threadPool.h"
+
+
+namespace texture {
+
+enum class MipFilter
+{
+	BOX, // averages the texels each one covers, sharp but aliases fine patterns
+	KAISER // Kaiser windowed sinc over 3 texels of the level, keeps detail with little aliasing
+};
+
+struct MipLevel
+{
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> texels; // RGBA8
+};
+
+const char* GetMipFilterName(MipFilter filter);
+
+// of a full chain down to 1x1, the image included
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// every level below the RGBA8 image, each half the size of the one above
+// (rounded down, at least 1), in order
+// the levels are filtered in linear space, from the previous level kept in
+// floats so that the rounding errors do not add up; with `srgb` the colour
+// channels are converted from and to sRGB, alpha is always linear
+std::vector<MipLevel> BuildMipChain(const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	MipFilter filter,
+	bool srgb,
+	ThreadPool& threadPool);
+
+} // namespace texture
@@ -0,0 +1,185 @@
+#include "mipResidency.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+MipResidency::MipResidency(uint64_t budget, uint32_t windowFrames)
+	: m_Budget{ budget },
+	  m_WindowFrames{ std::max(1u, windowFrames) },
+	  m_FrameCount{ 0 },
+	  m_CommittedBytes{ 0 },
+	  m_Raises{ 0 },
+	  m_Drops{ 0 }
+{
+}
+
+uint32_t MipResidency::AddTexture(const std::vector<uint64_t>& levelSizes, uint32_t tailLevel)
+{
+	assert(tailLevel < levelSizes.size());
+
+	Entry texture{};
+	texture.sizesFrom.resize(levelSizes.size() + 1, 0);
+	for (size_t level = levelSizes.size(); level-- > 0;)
+		texture.sizesFrom[level] = texture.sizesFrom[level + 1] + levelSizes[level];
+	texture.sizesFrom.pop_back();
+
+	texture.tailLevel = tailLevel;
+	texture.residentLevel = tailLevel;
+	texture.pendingLevel = NOT_SAMPLED;
+	texture.finestLevels = { NOT_SAMPLED, NOT_SAMPLED };
+
+	m_CommittedBytes += texture.sizesFrom[tailLevel];
+	m_Textures.push_back(std::move(texture));
+	return static_cast<uint32_t>(m_Textures.size() - 1);
+}
+
+void MipResidency::AddFeedback(const uint32_t* finestLevels)
+{
+	++m_FrameCount;
+	for (size_t i = 0; i < m_Textures.size(); ++i)
+	{
+		if (finestLevels[i] == NOT_SAMPLED)
+			continue;
+
+		Entry& texture = m_Textures[i];
+		texture.finestLevels[0] = std::min(texture.finestLevels[0], finestLevels[i]);
+		texture.lastSampledFrame = m_FrameCount;
+	}
+
+	if (m_FrameCount % m_WindowFrames == 0)
+	{
+		for (Entry& texture : m_Textures)
+			texture.finestLevels = { NOT_SAMPLED, texture.finestLevels[0] };
+	}
+}
+
+std::vector<MipChange> MipResidency::Plan(uint64_t maxUploadSize)
+{
+	std::vector<uint32_t> raises;
+	std::vector<uint32_t> drops;
+	uint64_t droppableBytes = 0;
+	for (uint32_t i = 0; i < m_Textures.size(); ++i)
+	{
+		const Entry& texture = m_Textures[i];
+		if (texture.pendingLevel != NOT_SAMPLED)
+			continue;
+
+		const uint32_t wantedLevel = GetWantedLevel(i);
+		if (wantedLevel < texture.residentLevel)
+		{
+			raises.push_back(i);
+		}
+		else if (wantedLevel > texture.residentLevel)
+		{
+			drops.push_back(i);
+			droppableBytes += GetSize(i, texture.residentLevel) - GetSize(i, wantedLevel);
+		}
+	}
+
+	// the textures missing the most levels first, then the ones sampled last
+	std::sort(raises.begin(), raises.end(), [this](uint32_t a, uint32_t b) {
+		const uint32_t missingA = m_Textures[a].residentLevel - GetWantedLevel(a);
+		const uint32_t missingB = m_Textures[b].residentLevel - GetWantedLevel(b);
+		if (missingA != missingB)
+			return missingA > missingB;
+		return m_Textures[a].lastSampledFrame > m_Textures[b].lastSampledFrame;
+	});
+	// the ones sampled the longest ago are dropped first
+	std::sort(drops.begin(), drops.end(), [this](uint32_t a, uint32_t b) {
+		return m_Textures[a].lastSampledFrame < m_Textures[b].lastSampledFrame;
+	});
+
+	std::vector<MipChange> changes;
+	size_t nextDrop = 0;
+	uint64_t uploadSize = 0;
+	for (uint32_t i : raises)
+	{
+		Entry& texture = m_Textures[i];
+		const uint64_t residentSize = GetSize(i, texture.residentLevel);
+
+		// as fine as it fits, with every drop left; the tails alone may be
+		// over the budget, and an unlimited one is the largest uint64_t
+		const uint64_t headroom = m_Budget - std::min(m_Budget, m_CommittedBytes);
+		const auto fits = [&](uint64_t growth) { return growth <= headroom || growth - headroom <= droppableBytes; };
+		uint32_t level = GetWantedLevel(i);
+		while (level < texture.residentLevel && !fits(GetSize(i, level) - residentSize))
+			++level;
+
+		if (level == texture.residentLevel)
+			continue;
+		if (uploadSize > 0 && uploadSize + GetSize(i, level) > maxUploadSize)
+			continue;
+
+		const uint64_t growth = GetSize(i, level) - residentSize;
+		while (m_CommittedBytes + growth > m_Budget && nextDrop < drops.size())
+		{
+			const uint32_t dropped = drops[nextDrop++];
+			const uint32_t droppedLevel = GetWantedLevel(dropped);
+			const uint64_t freedBytes =
+				GetSize(dropped, m_Textures[dropped].residentLevel) - GetSize(dropped, droppedLevel);
+
+			m_Textures[dropped].residentLevel = droppedLevel;
+			m_CommittedBytes -= freedBytes;
+			droppableBytes -= freedBytes;
+			++m_Drops;
+			changes.push_back(MipChange{ dropped, droppedLevel });
+		}
+
+		texture.pendingLevel = level;
+		m_CommittedBytes += growth;
+		uploadSize += GetSize(i, level);
+		changes.push_back(MipChange{ i, level });
+	}
+
+	return changes;
+}
+
+void MipResidency::SetResident(uint32_t texture, uint32_t firstLevel)
+{
+	Entry& resident = m_Textures[texture];
+	assert(resident.pendingLevel == firstLevel);
+
+	resident.residentLevel = firstLevel;
+	resident.pendingLevel = NOT_SAMPLED;
+	++m_Raises;
+}
+
+void MipResidency::Cancel(uint32_t texture)
+{
+	Entry& cancelled = m_Textures[texture];
+	assert(cancelled.pendingLevel != NOT_SAMPLED);
+
+	m_CommittedBytes -= GetSize(texture, cancelled.pendingLevel) - GetSize(texture, cancelled.residentLevel);
+	cancelled.pendingLevel = NOT_SAMPLED;
+}
+
+uint32_t MipResidency::GetWantedLevel(uint32_t texture) const
+{
+	const Entry& wanted = m_Textures[texture];
+	return std::min(std::min(wanted.finestLevels[0], wanted.finestLevels[1]), wanted.tailLevel);
+}
+
+uint64_t MipResidency::GetSize(uint32_t texture, uint32_t firstLevel) const
+{
+	return m_Textures[texture].sizesFrom[firstLevel];
+}
+
+MipResidencyStats MipResidency::GetStats() const
+{
+	MipResidencyStats stats{};
+	stats.textureCount = static_cast<uint32_t>(m_Textures.size());
+	stats.residentBytes = m_CommittedBytes;
+	stats.raises = m_Raises;
+	stats.drops = m_Drops;
+	for (uint32_t i = 0; i < m_Textures.size(); ++i)
+	{
+		const uint32_t wantedLevel = GetWantedLevel(i);
+		stats.wantedBytes += GetSize(i, wantedLevel);
+		stats.fullBytes += GetSize(i, 0);
+		if (wantedLevel < m_Textures[i].residentLevel)
+			stats.missingLevels += m_Textures[i].residentLevel - wantedLevel;
+	}
+
+	return stats;
+}
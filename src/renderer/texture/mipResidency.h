@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+// the finest level a texture was sampled at in a frame, for the ones that
+// were not sampled
+constexpr uint32_t NOT_SAMPLED = ~0u;
+// bytes of the texels the streamed textures keep resident by default
+constexpr uint64_t DEFAULT_MIP_STREAMING_BUDGET = 256ull * 1024 * 1024;
+// frames a texture keeps wanting its finest sampled level for; it is only
+// wanted coarser once it was not sampled that fine for a whole window
+constexpr uint32_t DEFAULT_MIP_FEEDBACK_WINDOW = 60;
+
+// a texture to make resident from `firstLevel`, finer than it is (a raise:
+// its levels have to be read) or coarser (a drop)
+struct MipChange
+{
+	uint32_t texture;
+	uint32_t firstLevel;
+};
+
+struct MipResidencyStats
+{
+	uint32_t textureCount;
+	// bytes of the texels: resident, pending raises included, the ones the
+	// sampling asks for, and every level of every texture
+	uint64_t residentBytes;
+	uint64_t wantedBytes;
+	uint64_t fullBytes;
+	// levels wanted but not resident, summed over the textures
+	uint32_t missingLevels;
+	uint64_t raises;
+	uint64_t drops;
+};
+
+
+// which levels of the streamed textures to keep resident, from the levels
+// the fragment shaders sampled them at: every texture wants the finest
+// level it was sampled at lately, within a budget; the textures that want
+// fewer levels than they have are dropped to what they want, least recently
+// sampled first, only when the budget is needed for another one
+// `MipStreamer` reads and uploads the levels, this only does the accounting
+class MipResidency
+{
+public:
+	MipResidency(uint64_t budget = DEFAULT_MIP_STREAMING_BUDGET, uint32_t windowFrames = DEFAULT_MIP_FEEDBACK_WINDOW);
+
+	// `levelSizes` holds the bytes of every level of the chain; the levels
+	// from `tailLevel` on are always resident, and are when it is added
+	uint32_t AddTexture(const std::vector<uint64_t>& levelSizes, uint32_t tailLevel);
+
+	// the finest level of the whole chain every texture was sampled at in a
+	// frame, or `NOT_SAMPLED`; once per frame
+	void AddFeedback(const uint32_t* finestLevels);
+
+	// the raises to start, most missing levels first, with up to
+	// `maxUploadSize` bytes to read (or a single larger one), and the drops
+	// that make room for them; a raise that does not fit the budget even
+	// then only goes as fine as it can
+	// the raises are pending until `SetResident` or `Cancel`, the budget
+	// counts them already; the drops are made right away
+	std::vector<MipChange> Plan(uint64_t maxUploadSize);
+	// the pending raise of the texture is resident
+	void SetResident(uint32_t texture, uint32_t firstLevel);
+	// the pending raise of the texture did not happen
+	void Cancel(uint32_t texture);
+
+	inline uint32_t GetResidentLevel(uint32_t texture) const { return m_Textures[texture].residentLevel; }
+	uint32_t GetWantedLevel(uint32_t texture) const;
+	// bytes of the levels from `firstLevel` on
+	uint64_t GetSize(uint32_t texture, uint32_t firstLevel) const;
+
+	inline uint64_t GetBudget() const { return m_Budget; }
+	MipResidencyStats GetStats() const;
+
+private:
+	struct Entry
+	{
+		// bytes of the levels from every level on
+		std::vector<uint64_t> sizesFrom;
+		uint32_t tailLevel;
+		uint32_t residentLevel;
+		// the raise being read, or `NOT_SAMPLED`
+		uint32_t pendingLevel;
+		// finest level sampled in the current and the previous window
+		std::array<uint32_t, 2> finestLevels;
+		uint64_t lastSampledFrame;
+	};
+
+private:
+	uint64_t m_Budget;
+	uint32_t m_WindowFrames;
+
+	std::vector<Entry> m_Textures;
+	uint64_t m_FrameCount;
+	// resident bytes and the growth of the pending raises
+	uint64_t m_CommittedBytes;
+
+	uint64_t m_Raises;
+	uint64_t m_Drops;
+};
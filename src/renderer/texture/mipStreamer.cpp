@@ -0,0 +1,399 @@
+#include "mipStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "utils/bufferUtils.h"
+
+
+MipStreamer::MipStreamer(const Device* device,
+	const CommandBuffer* commandBuffers,
+	ThreadPool& threadPool,
+	uint32_t maxFramesInFlight,
+	const MipStreamerOptions& options)
+	: m_Device{ device },
+	  m_CommandBuffers{ commandBuffers },
+	  m_ThreadPool{ &threadPool },
+	  m_MaxFramesInFlight{ maxFramesInFlight },
+	  m_Options{ options },
+	  m_Compressed{ device->SupportsTextureCompressionBC() },
+	  m_Residency{ options.budget, options.feedbackWindow },
+	  m_Frames(maxFramesInFlight),
+	  m_FrameCount{ 0 },
+	  m_UploadedBytes{ 0 },
+	  m_CopiedBytes{ 0 }
+{
+}
+
+MipStreamer::~MipStreamer()
+{
+	// the tasks still write into the pending raises
+	for (const std::unique_ptr<PendingRaise>& raise : m_PendingRaises)
+		raise->future.wait();
+
+	for (FrameResources& frame : m_Frames)
+		FreeFrame(frame);
+}
+
+void MipStreamer::Load(const std::vector<std::string>& paths)
+{
+	TextureLoadOptions loadOptions = m_Options.loadOptions;
+	loadOptions.maxLevelSize = m_Options.tailSize;
+	TextureLoader loader{ m_Device, m_CommandBuffers, *m_ThreadPool, loadOptions };
+	m_Textures = loader.Load(paths);
+	m_Paths = paths;
+
+	m_TexturePointers.clear();
+	for (const std::unique_ptr<Texture>& texture : m_Textures)
+	{
+		std::vector<uint64_t> levelSizes(texture->GetLevelCount());
+		for (uint32_t level = 0; level < texture->GetLevelCount(); ++level)
+		{
+			levelSizes[level] =
+				texture::GetLevelSize(texture->GetFormat(), texture->GetWidth(), texture->GetHeight(), level);
+		}
+
+		m_Residency.AddTexture(levelSizes, texture->GetFirstLevel());
+		m_TexturePointers.push_back(texture.get());
+	}
+
+	// read back by the host every frame, so kept mapped in host memory
+	const VkDeviceSize feedbackSize = std::max<size_t>(1, m_Textures.size()) * sizeof(uint32_t);
+	for (FrameResources& frame : m_Frames)
+	{
+		utils::buff::CreateBuffer(m_Device->GetDevice(),
+			m_Device->GetAllocator(),
+			feedbackSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.feedbackBuffer,
+			frame.feedbackMemory);
+
+		frame.feedback = reinterpret_cast<uint32_t*>(frame.feedbackMemory.mapped);
+		// every byte 0xFF is NOT_SAMPLED
+		memset(frame.feedback, 0xFF, static_cast<size_t>(feedbackSize));
+	}
+}
+
+void MipStreamer::Update(uint32_t frameIdx, VkCommandBuffer commandBuffer)
+{
+	++m_FrameCount;
+	FrameResources& frame = m_Frames[frameIdx];
+
+	// replaced since the frames in flight were recorded
+	m_RetiredTextures.erase(std::remove_if(m_RetiredTextures.begin(),
+								m_RetiredTextures.end(),
+								[this](const RetiredTexture& retired) {
+									return retired.frame + m_MaxFramesInFlight <= m_FrameCount;
+								}),
+		m_RetiredTextures.end());
+
+	if (frame.feedbackRecorded)
+	{
+		m_Residency.AddFeedback(frame.feedback);
+		memset(frame.feedback, 0xFF, m_Textures.size() * sizeof(uint32_t));
+		frame.feedbackRecorded = false;
+	}
+
+	UploadRaises(frame, commandBuffer);
+
+	// the reads already started keep the threads busy for a while
+	if (m_PendingRaises.size() >= m_ThreadPool->GetThreadCount() * 2)
+		return;
+
+	std::vector<MipChange> drops;
+	for (const MipChange& change : m_Residency.Plan(m_Options.maxUploadSize))
+	{
+		if (change.firstLevel < m_Textures[change.texture]->GetFirstLevel())
+			StartRaise(change.texture, change.firstLevel);
+		else
+			drops.push_back(change);
+	}
+	RecordDrops(drops, commandBuffer);
+}
+
+void MipStreamer::EndFrame(uint32_t frameIdx, VkCommandBuffer commandBuffer)
+{
+	FrameResources& frame = m_Frames[frameIdx];
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = frame.feedbackBuffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		0,
+		nullptr,
+		1,
+		&barrier,
+		0,
+		nullptr);
+
+	frame.feedbackRecorded = true;
+}
+
+MipStreamerStats MipStreamer::GetStats() const
+{
+	MipStreamerStats stats{};
+	stats.residency = m_Residency.GetStats();
+	stats.uploadedBytes = m_UploadedBytes;
+	stats.copiedBytes = m_CopiedBytes;
+	return stats;
+}
+
+void MipStreamer::StartRaise(uint32_t texture, uint32_t firstLevel)
+{
+	auto raise = std::make_unique<PendingRaise>();
+	raise->texture = texture;
+	raise->firstLevel = firstLevel;
+
+	// a single thread per texture, the other ones read the other raises
+	PendingRaise* pending = raise.get();
+	raise->future = m_ThreadPool->Submit([this, pending]() {
+		pending->prepared = texture::PrepareTexture(m_Paths[pending->texture],
+			m_Compressed,
+			m_Options.loadOptions.requireCooked,
+			m_Options.loadOptions.cache,
+			1);
+		texture::SkipLevels(pending->prepared, pending->firstLevel);
+	});
+	m_PendingRaises.push_back(std::move(raise));
+}
+
+void MipStreamer::UploadRaises(FrameResources& frame, VkCommandBuffer commandBuffer)
+{
+	// the raises that were read, in the order they were started
+	std::vector<PendingRaise*> ready;
+	VkDeviceSize stagingSize = 0;
+	for (const std::unique_ptr<PendingRaise>& raise : m_PendingRaises)
+	{
+		if (raise->future.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+			continue;
+
+		const VkDeviceSize size = (raise->prepared.stagingSize + TEXTURE_STAGING_ALIGNMENT - 1)
+								  / TEXTURE_STAGING_ALIGNMENT * TEXTURE_STAGING_ALIGNMENT;
+		if (!ready.empty() && stagingSize + size > m_Options.maxUploadSize)
+			break;
+
+		ready.push_back(raise.get());
+		stagingSize += size;
+	}
+	if (ready.empty())
+		return;
+
+	// the frames that copied from it are done
+	if (stagingSize > frame.stagingSize)
+		AllocateStaging(frame, std::max(stagingSize, m_Options.maxUploadSize));
+
+	std::vector<ImageUpload> uploads;
+	VkDeviceSize offset = 0;
+	for (PendingRaise* raise : ready)
+	{
+		try
+		{
+			raise->future.get();
+		} catch (...)
+		{
+			m_Residency.Cancel(raise->texture);
+			throw;
+		}
+
+		PreparedTexture& prepared = raise->prepared;
+		texture::WriteStaging(prepared, frame.staging + offset, *m_ThreadPool);
+
+		ImageUpload upload{};
+		std::unique_ptr<Texture> replacement = texture::CreateTexture(m_Device, prepared, true, upload);
+		for (VkBufferImageCopy& region : upload.regions)
+			region.bufferOffset += offset;
+		uploads.push_back(std::move(upload));
+
+		Replace(raise->texture, std::move(replacement));
+		m_Residency.SetResident(raise->texture, raise->firstLevel);
+		m_UploadedBytes += prepared.stagingSize;
+		offset += (prepared.stagingSize + TEXTURE_STAGING_ALIGNMENT - 1) / TEXTURE_STAGING_ALIGNMENT
+				  * TEXTURE_STAGING_ALIGNMENT;
+		// unmaps the cooked file
+		prepared = PreparedTexture{};
+	}
+	texture::RecordUploads(commandBuffer, frame.stagingBuffer, uploads);
+
+	m_PendingRaises.erase(std::remove_if(m_PendingRaises.begin(),
+							  m_PendingRaises.end(),
+							  [](const std::unique_ptr<PendingRaise>& raise) { return !raise->future.valid(); }),
+		m_PendingRaises.end());
+}
+
+void MipStreamer::RecordDrops(const std::vector<MipChange>& drops, VkCommandBuffer commandBuffer)
+{
+	if (drops.empty())
+		return;
+
+	// the coarser levels are already resident in the image being replaced,
+	// so they are copied on the GPU instead of being read again
+	std::vector<std::unique_ptr<Texture>> replacements;
+	std::vector<ImageUpload> images;
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (const MipChange& drop : drops)
+	{
+		const Texture& texture = *m_Textures[drop.texture];
+		PreparedTexture shape{};
+		shape.path = texture.GetPath();
+		shape.format = texture.GetFormat();
+		shape.width = texture.GetWidth();
+		shape.height = texture.GetHeight();
+		shape.levelCount = texture.GetLevelCount();
+		shape.firstLevel = drop.firstLevel;
+
+		ImageUpload image{};
+		replacements.push_back(texture::CreateTexture(m_Device, shape, true, image));
+		images.push_back(image);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.layerCount = 1;
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.image = texture.GetImage();
+		barrier.subresourceRange.levelCount = texture.GetLevelCount() - texture.GetFirstLevel();
+		barriers.push_back(barrier);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.image = image.image;
+		barrier.subresourceRange.levelCount = image.levelCount;
+		barriers.push_back(barrier);
+	}
+
+	// the frames in flight may still sample the old images
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(barriers.size()),
+		barriers.data());
+
+	for (size_t i = 0; i < drops.size(); ++i)
+	{
+		const Texture& texture = *m_Textures[drops[i].texture];
+		const uint32_t skipped = drops[i].firstLevel - texture.GetFirstLevel();
+
+		std::vector<VkImageCopy> regions(images[i].levelCount);
+		for (uint32_t level = 0; level < images[i].levelCount; ++level)
+		{
+			VkImageCopy& region = regions[level];
+			region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.srcSubresource.mipLevel = level + skipped;
+			region.srcSubresource.layerCount = 1;
+			region.dstSubresource = region.srcSubresource;
+			region.dstSubresource.mipLevel = level;
+			region.extent.width = std::max(1u, texture.GetWidth() >> (drops[i].firstLevel + level));
+			region.extent.height = std::max(1u, texture.GetHeight() >> (drops[i].firstLevel + level));
+			region.extent.depth = 1;
+		}
+
+		vkCmdCopyImage(commandBuffer,
+			texture.GetImage(),
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			images[i].image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()),
+			regions.data());
+		m_CopiedBytes += m_Residency.GetSize(drops[i].texture, drops[i].firstLevel);
+	}
+
+	// only the new images are sampled from now on
+	barriers.clear();
+	for (const ImageUpload& image : images)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image.image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = image.levelCount;
+		barrier.subresourceRange.layerCount = 1;
+		barriers.push_back(barrier);
+	}
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(barriers.size()),
+		barriers.data());
+
+	for (size_t i = 0; i < drops.size(); ++i)
+		Replace(drops[i].texture, std::move(replacements[i]));
+}
+
+void MipStreamer::Replace(uint32_t texture, std::unique_ptr<Texture> replacement)
+{
+	m_TexturePointers[texture] = replacement.get();
+	m_RetiredTextures.push_back(RetiredTexture{ std::move(m_Textures[texture]), m_FrameCount });
+	m_Textures[texture] = std::move(replacement);
+}
+
+void MipStreamer::AllocateStaging(FrameResources& frame, VkDeviceSize size)
+{
+	if (frame.stagingBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), frame.stagingBuffer, nullptr);
+		m_Device->GetAllocator().Free(frame.stagingMemory);
+	}
+
+	utils::buff::CreateBuffer(m_Device->GetDevice(),
+		m_Device->GetAllocator(),
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame.stagingBuffer,
+		frame.stagingMemory);
+
+	frame.staging = frame.stagingMemory.mapped;
+	frame.stagingSize = size;
+}
+
+void MipStreamer::FreeFrame(FrameResources& frame)
+{
+	if (frame.feedbackBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), frame.feedbackBuffer, nullptr);
+		m_Device->GetAllocator().Free(frame.feedbackMemory);
+	}
+	if (frame.stagingBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), frame.stagingBuffer, nullptr);
+		m_Device->GetAllocator().Free(frame.stagingMemory);
+	}
+	frame = FrameResources{};
+}
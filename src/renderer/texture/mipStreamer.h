@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "core/threadPool.h"
+#include "renderer/device.h"
+#include "renderer/texture.h"
+#include "renderer/buffer/commandBuffer.h"
+#include "renderer/texture/mipResidency.h"
+#include "renderer/texture/textureLoader.h"
+#include "renderer/texture/textureUpload.h"
+
+
+// the levels of a streamed texture no larger than this on either side are
+// always resident
+constexpr uint32_t DEFAULT_MIP_TAIL_SIZE = 64;
+// bytes of levels uploaded per frame at most, but for a single larger raise
+constexpr VkDeviceSize DEFAULT_MAX_MIP_UPLOAD_SIZE = 16 * 1024 * 1024;
+
+struct MipStreamerOptions
+{
+	// see `MipResidency`
+	uint64_t budget = DEFAULT_MIP_STREAMING_BUDGET;
+	uint32_t feedbackWindow = DEFAULT_MIP_FEEDBACK_WINDOW;
+	uint32_t tailSize = DEFAULT_MIP_TAIL_SIZE;
+	VkDeviceSize maxUploadSize = DEFAULT_MAX_MIP_UPLOAD_SIZE;
+	// how the tails and the levels streamed in are read
+	TextureLoadOptions loadOptions;
+};
+
+struct MipStreamerStats
+{
+	MipResidencyStats residency;
+	// by the frames since the textures were loaded
+	uint64_t uploadedBytes;
+	uint64_t copiedBytes; // of the levels kept by the drops
+};
+
+// the push constants of the fragment shader that records the sampling
+// feedback (texturedFeedback.frag)
+struct SamplingFeedbackConstants
+{
+	uint32_t textureIndex;
+	uint32_t firstLevel;
+};
+
+
+// textures that start with only their mip tail resident, and get their finer
+// levels streamed in as the fragment shader samples them finer: every frame
+// writes the finest level it sampled each texture at into a feedback buffer,
+// which is read back once the frame is done and drives a `MipResidency`
+// without sparse residency an image cannot hold only some of its levels, so
+// the image of a texture is replaced by one with the new levels, uploaded
+// from the cooked file when levels are added and copied from the old image
+// when they are dropped; the old one lives on until the frames in flight
+// that may sample it are done
+class MipStreamer
+{
+public:
+	MipStreamer(const Device* device,
+		const CommandBuffer* commandBuffers,
+		ThreadPool& threadPool,
+		uint32_t maxFramesInFlight,
+		const MipStreamerOptions& options = {});
+	~MipStreamer();
+
+	MipStreamer(const MipStreamer&) = delete;
+	MipStreamer& operator=(const MipStreamer&) = delete;
+
+	// loads the mip tails of the textures, blocking, and creates the feedback
+	// buffers for them; once, before the first frame
+	void Load(const std::vector<std::string>& paths);
+
+	// once the frame is done with the previous commands recorded for
+	// `frameIdx`, before its render pass: reads their feedback, destroys the
+	// images no frame in flight samples anymore and records the uploads and
+	// copies of the levels that change; `GetTextures` may return new textures
+	// after it, which the descriptor sets of the frame have to be updated to
+	void Update(uint32_t frameIdx, VkCommandBuffer commandBuffer);
+	// after the render pass, makes the feedback visible to the host
+	void EndFrame(uint32_t frameIdx, VkCommandBuffer commandBuffer);
+
+	inline const std::vector<const Texture*>& GetTextures() const { return m_TexturePointers; }
+	// a uint per texture, the finest level of its chain sampled by the frame
+	inline VkBuffer GetFeedbackBuffer(uint32_t frameIdx) const { return m_Frames[frameIdx].feedbackBuffer; }
+	MipStreamerStats GetStats() const;
+
+private:
+	// what the frames in flight use: the feedback they write, and the
+	// staging buffer the uploads they record are copied from
+	struct FrameResources
+	{
+		VkBuffer feedbackBuffer = VK_NULL_HANDLE;
+		DeviceAllocation feedbackMemory;
+		uint32_t* feedback = nullptr;
+		// false until commands that write it were recorded
+		bool feedbackRecorded = false;
+
+		VkBuffer stagingBuffer = VK_NULL_HANDLE;
+		DeviceAllocation stagingMemory;
+		uint8_t* staging = nullptr;
+		VkDeviceSize stagingSize = 0;
+	};
+
+	// the levels of a raise, read on the thread pool
+	struct PendingRaise
+	{
+		uint32_t texture;
+		uint32_t firstLevel;
+		std::future<void> future;
+		PreparedTexture prepared;
+	};
+
+	// a texture that was replaced, and the frame it was replaced in
+	struct RetiredTexture
+	{
+		std::unique_ptr<Texture> texture;
+		uint64_t frame;
+	};
+
+	void StartRaise(uint32_t texture, uint32_t firstLevel);
+	// uploads the raises that were read, up to the bytes of a frame
+	void UploadRaises(FrameResources& frame, VkCommandBuffer commandBuffer);
+	void RecordDrops(const std::vector<MipChange>& drops, VkCommandBuffer commandBuffer);
+	void Replace(uint32_t texture, std::unique_ptr<Texture> replacement);
+
+	void AllocateStaging(FrameResources& frame, VkDeviceSize size);
+	void FreeFrame(FrameResources& frame);
+
+private:
+	const Device* m_Device;
+	const CommandBuffer* m_CommandBuffers;
+	ThreadPool* m_ThreadPool;
+	uint32_t m_MaxFramesInFlight;
+	MipStreamerOptions m_Options;
+	bool m_Compressed;
+
+	std::vector<std::string> m_Paths;
+	std::vector<std::unique_ptr<Texture>> m_Textures;
+	std::vector<const Texture*> m_TexturePointers;
+	MipResidency m_Residency;
+
+	std::vector<FrameResources> m_Frames;
+	// written by the tasks, so they do not move
+	std::vector<std::unique_ptr<PendingRaise>> m_PendingRaises;
+	std::vector<RetiredTexture> m_RetiredTextures;
+	uint64_t m_FrameCount;
+
+	uint64_t m_UploadedBytes;
+	uint64_t m_CopiedBytes;
+};
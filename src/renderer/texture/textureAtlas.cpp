@@ -0,0 +1,220 @@
+#include "textureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+// a row of textures in a page, as tall as the first one put in it
+struct AtlasShelf
+{
+	uint32_t page;
+	uint32_t y;
+	uint32_t height;
+	uint32_t width; // taken from the left
+};
+
+static uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// repeats the edge texels of the `width` by `height` texels at (x, y) of the
+// level `gutter` texels out on every side
+static void FillGutter(texture::MipLevel& level,
+	uint32_t x,
+	uint32_t y,
+	uint32_t width,
+	uint32_t height,
+	uint32_t gutter)
+{
+	uint8_t* texels = level.texels.data();
+	const size_t rowSize = static_cast<size_t>(level.width) * 4;
+
+	// the rows first, then the rows above and below copy the first and last
+	for (uint32_t row = y; row < y + height; ++row)
+	{
+		uint8_t* first = texels + row * rowSize + static_cast<size_t>(x) * 4;
+		uint8_t* last = first + static_cast<size_t>(width - 1) * 4;
+		for (uint32_t i = 1; i <= gutter; ++i)
+		{
+			memcpy(first - static_cast<size_t>(i) * 4, first, 4);
+			memcpy(last + static_cast<size_t>(i) * 4, last, 4);
+		}
+	}
+
+	const size_t rowOffset = static_cast<size_t>(x - gutter) * 4;
+	const size_t gutterRowSize = static_cast<size_t>(width + 2 * gutter) * 4;
+	for (uint32_t i = 1; i <= gutter; ++i)
+	{
+		memcpy(texels + (y - i) * rowSize + rowOffset, texels + y * rowSize + rowOffset, gutterRowSize);
+		memcpy(texels + (y + height - 1 + i) * rowSize + rowOffset,
+			texels + (y + height - 1) * rowSize + rowOffset,
+			gutterRowSize);
+	}
+}
+
+namespace texture {
+
+AtlasLayout PackAtlas(const std::vector<MipLevel>& images, const AtlasOptions& options)
+{
+	if (options.levelCount == 0 || options.gutter == 0)
+		throw std::runtime_error("An atlas needs at least a level and a texel of gutter!");
+
+	AtlasLayout layout{};
+	layout.pageSize = options.pageSize;
+	layout.levelCount = options.levelCount;
+	// the rects and gutters of the coarsest level start on whole texels
+	layout.alignment = 1u << (options.levelCount - 1);
+	layout.padding = options.gutter << (options.levelCount - 1);
+	layout.rects.resize(images.size(), AtlasRect{ NO_ATLAS_PAGE, 0, 0, 0, 0 });
+
+	// a texture with its gutter on both sides, rounded up so that the next
+	// one is aligned too
+	const auto getFootprint = [&layout](uint32_t size) { return AlignUp(size + 2 * layout.padding, layout.alignment); };
+
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < images.size(); ++i)
+	{
+		const MipLevel& image = images[i];
+		if (image.width == 0 || image.height == 0 || image.width > options.maxTextureSize
+			|| image.height > options.maxTextureSize || getFootprint(image.width) > options.pageSize
+			|| getFootprint(image.height) > options.pageSize)
+			continue;
+
+		order.push_back(i);
+	}
+
+	// the tallest first, so that every shelf is filled with textures of about
+	// its height
+	std::stable_sort(order.begin(), order.end(), [&images](uint32_t a, uint32_t b) {
+		if (images[a].height != images[b].height)
+			return images[a].height > images[b].height;
+		return images[a].width > images[b].width;
+	});
+
+	std::vector<AtlasShelf> shelves;
+	std::vector<uint32_t> pageHeights; // taken by the shelves of every page, from the top
+	for (uint32_t i : order)
+	{
+		const uint32_t width = getFootprint(images[i].width);
+		const uint32_t height = getFootprint(images[i].height);
+
+		// the first shelf it fits in, or a new one in the first page with
+		// room left below its shelves
+		auto shelf = std::find_if(shelves.begin(), shelves.end(), [&](const AtlasShelf& candidate) {
+			return candidate.height >= height && candidate.width + width <= options.pageSize;
+		});
+		if (shelf == shelves.end())
+		{
+			uint32_t page = 0;
+			while (page < pageHeights.size() && pageHeights[page] + height > options.pageSize)
+				++page;
+			if (page == pageHeights.size())
+				pageHeights.push_back(0);
+
+			shelves.push_back(AtlasShelf{ page, pageHeights[page], height, 0 });
+			pageHeights[page] += height;
+			shelf = shelves.end() - 1;
+		}
+
+		layout.rects[i] = AtlasRect{ shelf->page,
+			shelf->width + layout.padding,
+			shelf->y + layout.padding,
+			images[i].width,
+			images[i].height };
+		shelf->width += width;
+		layout.packedTexels += static_cast<uint64_t>(images[i].width) * images[i].height;
+	}
+	layout.pageCount = static_cast<uint32_t>(pageHeights.size());
+
+	return layout;
+}
+
+std::vector<AtlasPage> BuildAtlasPages(const std::vector<MipLevel>& images,
+	const AtlasLayout& layout,
+	const AtlasOptions& options,
+	ThreadPool& threadPool)
+{
+	std::vector<AtlasPage> pages(layout.pageCount);
+	for (AtlasPage& page : pages)
+	{
+		for (uint32_t level = 0; level < layout.levelCount; ++level)
+		{
+			const uint32_t size = std::max(1u, layout.pageSize >> level);
+			page.levels.push_back(MipLevel{ size, size, std::vector<uint8_t>(static_cast<size_t>(size) * size * 4) });
+		}
+	}
+
+	for (uint32_t i = 0; i < images.size(); ++i)
+	{
+		const AtlasRect& rect = layout.rects[i];
+		if (rect.page == NO_ATLAS_PAGE)
+			continue;
+
+		// a texture smaller than the alignment runs out of levels before the
+		// page, its last one is repeated
+		const MipLevel& image = images[i];
+		const std::vector<MipLevel> chain =
+			BuildMipChain(image.texels.data(), image.width, image.height, options.mipFilter, options.srgb, threadPool);
+
+		for (uint32_t level = 0; level < layout.levelCount; ++level)
+		{
+			const MipLevel& source =
+				level == 0 || chain.empty() ? image : chain[std::min<size_t>(level, chain.size()) - 1];
+			MipLevel& destination = pages[rect.page].levels[level];
+
+			// the rects are aligned, so they start on a texel of every level;
+			// a texture that is not a power of two is a texel smaller in the
+			// coarser levels than its rect
+			const uint32_t x = rect.x >> level;
+			const uint32_t y = rect.y >> level;
+			const size_t rowSize = static_cast<size_t>(source.width) * 4;
+			for (uint32_t row = 0; row < source.height; ++row)
+			{
+				memcpy(destination.texels.data() + ((y + row) * static_cast<size_t>(destination.width) + x) * 4,
+					source.texels.data() + row * rowSize,
+					rowSize);
+			}
+
+			FillGutter(destination, x, y, source.width, source.height, layout.padding >> level);
+		}
+	}
+
+	return pages;
+}
+
+AtlasTransform GetAtlasTransform(const AtlasLayout& layout, uint32_t texture)
+{
+	const AtlasRect& rect = layout.rects[texture];
+	const float pageSize = static_cast<float>(layout.pageSize);
+
+	AtlasTransform transform{};
+	transform.page = rect.page;
+	transform.scale[0] = static_cast<float>(rect.width) / pageSize;
+	transform.scale[1] = static_cast<float>(rect.height) / pageSize;
+	transform.offset[0] = static_cast<float>(rect.x) / pageSize;
+	transform.offset[1] = static_cast<float>(rect.y) / pageSize;
+	return transform;
+}
+
+bool RemapTexCoords(const AtlasTransform& transform, float* texCoords, size_t count, size_t stride)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float* texCoord = texCoords + i * stride;
+		if (texCoord[0] < 0.0f || texCoord[0] > 1.0f || texCoord[1] < 0.0f || texCoord[1] > 1.0f)
+			return false;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		float* texCoord = texCoords + i * stride;
+		texCoord[0] = texCoord[0] * transform.scale[0] + transform.offset[0];
+		texCoord[1] = texCoord[1] * transform.scale[1] + transform.offset[1];
+	}
+
+	return true;
+}
+
+} // namespace texture
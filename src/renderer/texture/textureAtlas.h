@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/threadPool.h"
+#include "renderer/texture/mipChain.h"
+
+
+// the page of the textures that are not packed, eg: larger than
+// `maxTextureSize`, which keep an image of their own
+constexpr uint32_t NO_ATLAS_PAGE = ~0u;
+
+struct AtlasOptions
+{
+	// texels on a side of a page
+	uint32_t pageSize = 2048;
+	// the textures larger than this on either side are not packed
+	uint32_t maxTextureSize = 256;
+	// of the pages, the finer levels of every texture down to 1/32 of its
+	// size; the coarser ones would blend the textures with each other
+	uint32_t levelCount = 6;
+	// texels of gutter around every texture in the coarsest level, twice as
+	// many in every finer one
+	uint32_t gutter = 1;
+	// of the mip chain of every texture; the colour channels are filtered in
+	// linear space with `srgb`
+	texture::MipFilter mipFilter = texture::MipFilter::KAISER;
+	bool srgb = true;
+};
+
+// where a texture is in the pages, in texels of their first level and
+// without the gutter
+struct AtlasRect
+{
+	uint32_t page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct AtlasLayout
+{
+	uint32_t pageSize;
+	uint32_t levelCount;
+	uint32_t pageCount;
+	// gutter around every texture in the first level, and the texels every
+	// rect starts at a multiple of, so that it starts on a texel in every
+	// level
+	uint32_t padding;
+	uint32_t alignment;
+	// one per texture, in order
+	std::vector<AtlasRect> rects;
+	// of the textures, without their gutters
+	uint64_t packedTexels;
+};
+
+// a page of the atlas and its levels, RGBA8 like the levels of `BuildMipChain`
+struct AtlasPage
+{
+	std::vector<texture::MipLevel> levels;
+};
+
+// of the uv of a texture into the page it is packed in:
+// `uv * scale + offset`, like `UniformBufferObject::texCoordTransform`
+struct AtlasTransform
+{
+	uint32_t page;
+	float scale[2];
+	float offset[2];
+};
+
+// the push constants of the fragment shader that samples a texture packed
+// in a page (texturedAtlas.frag): the ones of texturedBindless.frag, with
+// the page as the texture index, followed by the transform of the texture
+struct AtlasConstants
+{
+	uint32_t textureIndex;
+	uint32_t firstLevel;
+	float scale[2];
+	float offset[2];
+};
+
+
+namespace texture {
+
+// packs the textures no larger than `maxTextureSize` into as few pages as
+// it can, in shelves of decreasing height; only the sizes of the images are
+// read, so their texels may be empty
+AtlasLayout PackAtlas(const std::vector<MipLevel>& images, const AtlasOptions& options = {});
+
+// writes the RGBA8 images into the levels of the pages of `layout`: every
+// texture gets its own mip chain, so the filter never blends it with its
+// neighbours, and a gutter that repeats its edge texels in every level, so
+// that bilinear and trilinear samples within the texture never read past it
+std::vector<AtlasPage> BuildAtlasPages(const std::vector<MipLevel>& images,
+	const AtlasLayout& layout,
+	const AtlasOptions& options,
+	ThreadPool& threadPool);
+
+AtlasTransform GetAtlasTransform(const AtlasLayout& layout, uint32_t texture);
+
+// moves the texture coordinates of a mesh into the rect of its texture, so
+// that meshes that sample the same page can be drawn together; returns false
+// and leaves them untouched if one is outside [0, 1], those repeat the
+// texture and need the shader to wrap them within the rect
+// (texturedAtlas.frag)
+// `count` coordinates, `stride` floats apart (eg: the size of a vertex)
+bool RemapTexCoords(const AtlasTransform& transform, float* texCoords, size_t count, size_t stride = 2);
+
+} // namespace texture
@@ -0,0 +1,158 @@
+#include "textureCache.h"
+
+#include <cassert>
+#include <filesystem>
+#include <unordered_map>
+#include <utility>
+
+
+TextureHandle::TextureHandle(TextureCache* cache, uint32_t entry)
+	: m_Cache{ cache },
+	  m_Entry{ entry }
+{
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+	: m_Cache{ other.m_Cache },
+	  m_Entry{ other.m_Entry }
+{
+	if (m_Cache)
+		m_Cache->AddRef(m_Entry);
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept
+	: m_Cache{ other.m_Cache },
+	  m_Entry{ other.m_Entry }
+{
+	other.m_Cache = nullptr;
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept
+{
+	std::swap(m_Cache, other.m_Cache);
+	std::swap(m_Entry, other.m_Entry);
+	return *this;
+}
+
+TextureHandle::~TextureHandle()
+{
+	if (m_Cache)
+		m_Cache->Release(m_Entry);
+}
+
+const Texture* TextureHandle::Get() const
+{
+	return m_Cache ? m_Cache->m_Textures[m_Entry].get() : nullptr;
+}
+
+TextureCache::TextureCache(const Device* device,
+	const CommandBuffer* commandBuffers,
+	ThreadPool& threadPool,
+	const TextureCacheOptions& options)
+	: m_Device{ device },
+	  m_CommandBuffers{ commandBuffers },
+	  m_ThreadPool{ &threadPool },
+	  m_LoadOptions{ options.loadOptions },
+	  m_Residency{ options.budget },
+	  m_LoadStats{}
+{
+}
+
+TextureCache::~TextureCache()
+{
+	// the textures are destroyed with `m_Textures`, so no handle may be left
+	for (uint32_t entry = 0; entry < m_Residency.GetEntryCount(); ++entry)
+		assert(m_Residency.GetRefCount(entry) == 0);
+}
+
+TextureHandle TextureCache::Acquire(const std::string& path, const TextureParams& params)
+{
+	return std::move(Acquire(std::vector<std::string>{ path }, params)[0]);
+}
+
+std::vector<TextureHandle> TextureCache::Acquire(const std::vector<std::string>& paths, const TextureParams& params)
+{
+	// a texture that appears several times is acquired once, and only
+	// referenced again by the other paths
+	std::unordered_map<std::string, uint32_t> acquired;
+	std::vector<std::string> loadPaths;
+	std::vector<uint32_t> loadEntries;
+
+	// the handles release the references if loading throws
+	std::vector<TextureHandle> handles;
+	handles.reserve(paths.size());
+	for (const std::string& path : paths)
+	{
+		const std::string key = GetKey(path, params);
+		const auto it = acquired.find(key);
+		if (it != acquired.end())
+		{
+			m_Residency.AddRef(it->second);
+			handles.push_back(TextureHandle{ this, it->second });
+			continue;
+		}
+
+		bool resident = false;
+		const uint32_t entry = m_Residency.Acquire(key, resident);
+		acquired.emplace(key, entry);
+		if (!resident)
+		{
+			loadPaths.push_back(path);
+			loadEntries.push_back(entry);
+		}
+
+		handles.push_back(TextureHandle{ this, entry });
+	}
+
+	m_Textures.resize(m_Residency.GetEntryCount());
+	if (!loadPaths.empty())
+	{
+		TextureLoader loader{ m_Device, m_CommandBuffers, *m_ThreadPool, m_LoadOptions };
+		std::vector<std::unique_ptr<Texture>> textures = loader.Load(loadPaths, params.allowCompressed);
+		m_LoadStats = loader.GetStats();
+
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			m_Residency.OnLoaded(loadEntries[i], textures[i]->GetMemorySize());
+			m_Textures[loadEntries[i]] = std::move(textures[i]);
+		}
+		Evict();
+	}
+
+	return handles;
+}
+
+void TextureCache::SetBudget(uint64_t budget)
+{
+	m_Residency.SetBudget(budget);
+	Evict();
+}
+
+void TextureCache::AddRef(uint32_t entry)
+{
+	m_Residency.AddRef(entry);
+}
+
+void TextureCache::Release(uint32_t entry)
+{
+	m_Residency.Release(entry);
+	if (m_Residency.GetRefCount(entry) == 0 && m_Residency.IsOverBudget())
+		Evict();
+}
+
+void TextureCache::Evict()
+{
+	for (uint32_t entry : m_Residency.Evict())
+		m_Textures[entry].reset();
+}
+
+std::string TextureCache::GetKey(const std::string& path, const TextureParams& params)
+{
+	std::error_code error;
+	std::string key = std::filesystem::weakly_canonical(path, error).generic_string();
+	if (error)
+		key = path;
+
+	key += params.allowCompressed ? "\nbc" : "\nrgba8";
+	return key;
+}
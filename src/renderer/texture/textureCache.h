@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/threadPool.h"
+#include "renderer/device.h"
+#include "renderer/texture.h"
+#include "renderer/buffer/commandBuffer.h"
+#include "renderer/texture/textureLoader.h"
+#include "renderer/texture/textureResidency.h"
+
+
+class TextureCache;
+
+// what a texture is loaded with, part of its key in the cache
+struct TextureParams
+{
+	// the block compressed KTX2 texture on devices that support it, the
+	// RGBA8 one otherwise
+	bool allowCompressed = true;
+};
+
+struct TextureCacheOptions
+{
+	// see `TextureResidency`
+	uint64_t budget = DEFAULT_TEXTURE_BUDGET;
+	TextureLoadOptions loadOptions;
+};
+
+
+// a reference to a texture of a `TextureCache`, which stays resident as long
+// as a handle to it exists; copies share the texture
+// the GPU must be done with the texture when its last handle is destroyed,
+// since the cache may free it right away
+class TextureHandle
+{
+public:
+	TextureHandle() = default;
+	TextureHandle(const TextureHandle& other);
+	TextureHandle(TextureHandle&& other) noexcept;
+	TextureHandle& operator=(TextureHandle other) noexcept;
+	~TextureHandle();
+
+	const Texture* Get() const;
+	inline const Texture* operator->() const { return Get(); }
+	inline explicit operator bool() const { return m_Cache != nullptr; }
+
+private:
+	friend class TextureCache;
+	// adopts a reference the cache already took
+	TextureHandle(TextureCache* cache, uint32_t entry);
+
+private:
+	TextureCache* m_Cache = nullptr;
+	uint32_t m_Entry = 0;
+};
+
+
+// textures shared by everything that draws with them: a texture is loaded
+// once per canonical path and `TextureParams`, and returned as refcounted
+// handles; the ones nothing references anymore stay resident until they
+// take more than the budget, and are evicted least recently used first, to
+// be loaded again the next time they are acquired
+// must outlive its handles; not thread safe
+class TextureCache
+{
+public:
+	TextureCache(const Device* device,
+		const CommandBuffer* commandBuffers,
+		ThreadPool& threadPool,
+		const TextureCacheOptions& options = {});
+	~TextureCache();
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// blocks until the texture is loaded, if it is not resident
+	TextureHandle Acquire(const std::string& path, const TextureParams& params = {});
+	// a handle per path, with every texture that is not resident loaded at
+	// once by a `TextureLoader`
+	std::vector<TextureHandle> Acquire(const std::vector<std::string>& paths, const TextureParams& params = {});
+
+	// evicts right away if the textures take more than the new budget
+	void SetBudget(uint64_t budget);
+	inline uint64_t GetBudget() const { return m_Residency.GetBudget(); }
+
+	inline const TextureCacheStats& GetStats() const { return m_Residency.GetStats(); }
+	// of the last textures loaded, see `TextureLoader::GetStats`
+	inline const TextureLoadStats& GetLoadStats() const { return m_LoadStats; }
+
+private:
+	friend class TextureHandle;
+	void AddRef(uint32_t entry);
+	void Release(uint32_t entry);
+	void Evict();
+
+	// the canonical path, so that the different spellings of a path share
+	// the texture, with the parameters
+	static std::string GetKey(const std::string& path, const TextureParams& params);
+
+private:
+	const Device* m_Device;
+	const CommandBuffer* m_CommandBuffers;
+	ThreadPool* m_ThreadPool;
+	TextureLoadOptions m_LoadOptions;
+
+	TextureResidency m_Residency;
+	// by entry of `m_Residency`, null while it is not resident
+	std::vector<std::unique_ptr<Texture>> m_Textures;
+
+	TextureLoadStats m_LoadStats;
+};
@@ -0,0 +1,441 @@
+#include "textureLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "utils/bufferUtils.h"
+#include "utils/imageUtils.h"
+
+
+TextureLoader::TextureLoader(const Device* device,
+	const CommandBuffer* commandBuffers,
+	ThreadPool& threadPool,
+	const TextureLoadOptions& options)
+	: m_Device{ device },
+	  m_CommandBuffers{ commandBuffers },
+	  m_ThreadPool{ &threadPool },
+	  m_Options{ options },
+	  m_CurrentBatch{ 0 },
+	  m_Stats{}
+{
+	VkCommandBufferAllocateInfo cmdBuffAllocInfo{};
+	cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cmdBuffAllocInfo.commandPool = m_CommandBuffers->GetCommandPool();
+	cmdBuffAllocInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (StagingBatch& batch : m_Batches)
+	{
+		if (vkAllocateCommandBuffers(m_Device->GetDevice(), &cmdBuffAllocInfo, &batch.commandBuffer) != VK_SUCCESS
+			|| vkCreateFence(m_Device->GetDevice(), &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS)
+			throw std::runtime_error("Failed to create texture upload batch!");
+	}
+}
+
+TextureLoader::~TextureLoader()
+{
+	for (StagingBatch& batch : m_Batches)
+	{
+		Wait(batch);
+		FreeStaging(batch);
+		vkDestroyFence(m_Device->GetDevice(), batch.fence, nullptr);
+		vkFreeCommandBuffers(m_Device->GetDevice(), m_CommandBuffers->GetCommandPool(), 1, &batch.commandBuffer);
+	}
+}
+
+std::vector<std::unique_ptr<Texture>> TextureLoader::Load(const std::vector<std::string>& paths, bool allowCompressed)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	m_Stats = TextureLoadStats{};
+	m_Stats.textureCount = static_cast<uint32_t>(paths.size());
+
+	const bool compressed = allowCompressed && m_Device->SupportsTextureCompressionBC();
+	const uint32_t threadCount = m_ThreadPool->GetThreadCount();
+	const size_t maxInFlight = m_Options.maxTexturesInFlight > 0 ? m_Options.maxTexturesInFlight : threadCount * 2;
+	// a texture that has to be cooked gets its share of the threads, like
+	// the jobs of the assetCooker
+	const uint32_t cookThreadCount = std::max<uint32_t>(
+		1, threadCount / static_cast<uint32_t>(std::max<size_t>(1, std::min(paths.size(), maxInFlight))));
+
+	// written by the tasks, read by this thread once their future is ready
+	std::vector<PreparedTexture> prepared(paths.size());
+	std::vector<std::future<void>> futures(paths.size());
+	size_t submitted = 0;
+	const auto prepareNext = [&]() {
+		if (submitted == paths.size())
+			return;
+
+		const size_t i = submitted++;
+		futures[i] = m_ThreadPool->Submit([&, i]() {
+			prepared[i] = texture::PrepareTexture(
+				paths[i], compressed, m_Options.requireCooked, m_Options.cache, cookThreadCount);
+		});
+	};
+
+	std::vector<std::unique_ptr<Texture>> textures;
+	textures.reserve(paths.size());
+	try
+	{
+		while (submitted < std::min(paths.size(), maxInFlight))
+			prepareNext();
+
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			const auto waitStart = std::chrono::high_resolution_clock::now();
+			futures[i].get();
+			const auto waitEnd = std::chrono::high_resolution_clock::now();
+			m_Stats.prepareWaitMilliseconds += std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+
+			prepareNext();
+			textures.push_back(Stage(prepared[i]));
+			// unmaps the cooked file
+			prepared[i] = PreparedTexture{};
+		}
+
+		Submit(m_Batches[m_CurrentBatch]);
+		for (StagingBatch& batch : m_Batches)
+			Wait(batch);
+	} catch (...)
+	{
+		// the tasks still write into `prepared`, and the GPU may still copy
+		// into the images of `textures`
+		for (size_t i = 0; i < submitted; ++i)
+		{
+			if (futures[i].valid())
+				futures[i].wait();
+		}
+		for (StagingBatch& batch : m_Batches)
+			Wait(batch);
+		throw;
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	m_Stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return textures;
+}
+
+AtlasTextures TextureLoader::LoadAtlas(const std::vector<std::string>& paths, const AtlasOptions& options)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	m_Stats = TextureLoadStats{};
+
+	const uint32_t cookThreadCount = std::max<uint32_t>(
+		1, m_ThreadPool->GetThreadCount() / static_cast<uint32_t>(std::max<size_t>(1, paths.size())));
+
+	// written by the tasks, read by this thread once their future is ready
+	std::vector<PreparedTexture> prepared(paths.size());
+	std::vector<std::future<void>> futures;
+	futures.reserve(paths.size());
+	// only the sizes of the ones too large to be packed
+	std::vector<texture::MipLevel> images(paths.size());
+	try
+	{
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			futures.push_back(m_ThreadPool->Submit([&, i]() {
+				prepared[i] =
+					texture::PrepareTexture(paths[i], false, m_Options.requireCooked, m_Options.cache, cookThreadCount);
+			}));
+		}
+
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			const auto waitStart = std::chrono::high_resolution_clock::now();
+			futures[i].get();
+			const auto waitEnd = std::chrono::high_resolution_clock::now();
+			m_Stats.prepareWaitMilliseconds += std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+
+			// the texel blob is decoded whole, its first level is the image
+			texture::MipLevel& image = images[i];
+			image.width = prepared[i].width;
+			image.height = prepared[i].height;
+			if (image.width <= options.maxTextureSize && image.height <= options.maxTextureSize)
+			{
+				image.texels.resize(prepared[i].stagingSize);
+				texture::WriteStaging(prepared[i], image.texels.data(), *m_ThreadPool);
+				image.texels.resize(static_cast<size_t>(image.width) * image.height * TEXTURE_FILE_TEXEL_SIZE);
+			}
+			// unmaps the cooked file
+			prepared[i] = PreparedTexture{};
+		}
+	} catch (...)
+	{
+		// the tasks still write into `prepared`
+		for (std::future<void>& future : futures)
+		{
+			if (future.valid())
+				future.wait();
+		}
+		throw;
+	}
+
+	AtlasTextures atlas{};
+	atlas.layout = texture::PackAtlas(images, options);
+	std::vector<AtlasPage> pages = texture::BuildAtlasPages(images, atlas.layout, options, *m_ThreadPool);
+	images.clear();
+
+	m_Stats.textureCount = atlas.layout.pageCount;
+	const uint32_t pageSize = atlas.layout.pageSize;
+	try
+	{
+		for (uint32_t i = 0; i < pages.size(); ++i)
+		{
+			// the levels one after the other, like the texel blob of a
+			// cooked texture
+			std::vector<uint8_t> texels;
+			texels.reserve(TextureFile::GetTexelSize(pageSize, pageSize, atlas.layout.levelCount));
+			for (const texture::MipLevel& level : pages[i].levels)
+				texels.insert(texels.end(), level.texels.begin(), level.texels.end());
+			pages[i] = AtlasPage{};
+
+			PreparedTexture page = texture::PrepareTexels(
+				"atlas page " + std::to_string(i), pageSize, pageSize, atlas.layout.levelCount, std::move(texels));
+			atlas.pages.push_back(Stage(page));
+		}
+
+		Submit(m_Batches[m_CurrentBatch]);
+		for (StagingBatch& batch : m_Batches)
+			Wait(batch);
+	} catch (...)
+	{
+		// the GPU may still copy into the pages
+		for (StagingBatch& batch : m_Batches)
+			Wait(batch);
+		throw;
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	m_Stats.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+	return atlas;
+}
+
+std::unique_ptr<Texture> TextureLoader::Stage(PreparedTexture& texture)
+{
+	if (m_Options.maxLevelSize > 0)
+	{
+		texture::SkipLevels(texture,
+			texture::GetFirstLevelWithin(texture.width, texture.height, texture.levelCount, m_Options.maxLevelSize));
+	}
+
+	VkDeviceSize offset = 0;
+	StagingBatch& batch = Reserve(texture.stagingSize, offset);
+	texture::WriteStaging(texture, batch.mapped + offset, *m_ThreadPool);
+
+	ImageUpload upload{};
+	std::unique_ptr<Texture> result = texture::CreateTexture(m_Device, texture, m_Options.maxLevelSize > 0, upload);
+	for (VkBufferImageCopy& region : upload.regions)
+		region.bufferOffset += offset;
+	batch.uploads.push_back(std::move(upload));
+
+	return result;
+}
+
+TextureLoader::StagingBatch& TextureLoader::Reserve(VkDeviceSize size, VkDeviceSize& offset)
+{
+	size = (size + TEXTURE_STAGING_ALIGNMENT - 1) / TEXTURE_STAGING_ALIGNMENT * TEXTURE_STAGING_ALIGNMENT;
+
+	StagingBatch* batch = &m_Batches[m_CurrentBatch];
+	if (batch->used + size > batch->size && !batch->uploads.empty())
+	{
+		// the GPU copies this batch while the next textures are staged in
+		// the other one, once its own copies are done
+		Submit(*batch);
+		m_CurrentBatch = 1 - m_CurrentBatch;
+		batch = &m_Batches[m_CurrentBatch];
+
+		const auto waitStart = std::chrono::high_resolution_clock::now();
+		Wait(*batch);
+		const auto waitEnd = std::chrono::high_resolution_clock::now();
+		m_Stats.uploadWaitMilliseconds += std::chrono::duration<double, std::milli>(waitEnd - waitStart).count();
+	}
+
+	if (size > batch->size)
+		AllocateStaging(*batch, std::max(size, m_Options.maxStagingSize / 2));
+
+	offset = batch->used;
+	batch->used += size;
+	return *batch;
+}
+
+void TextureLoader::AllocateStaging(StagingBatch& batch, VkDeviceSize size)
+{
+	FreeStaging(batch);
+
+	utils::buff::CreateBuffer(m_Device->GetDevice(),
+		m_Device->GetAllocator(),
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		batch.buffer,
+		batch.memory);
+
+	// mapped as long as it lives, coherent memory needs no flush
+	batch.mapped = batch.memory.mapped;
+	batch.size = size;
+}
+
+void TextureLoader::FreeStaging(StagingBatch& batch)
+{
+	if (batch.buffer == VK_NULL_HANDLE)
+		return;
+
+	vkDestroyBuffer(m_Device->GetDevice(), batch.buffer, nullptr);
+	m_Device->GetAllocator().Free(batch.memory);
+	batch.buffer = VK_NULL_HANDLE;
+	batch.mapped = nullptr;
+	batch.size = 0;
+}
+
+void TextureLoader::Submit(StagingBatch& batch)
+{
+	if (batch.uploads.empty())
+		return;
+
+	VkCommandBufferBeginInfo cmdBuffBegin{};
+	cmdBuffBegin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBuffBegin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkResetCommandBuffer(batch.commandBuffer, 0);
+	vkBeginCommandBuffer(batch.commandBuffer, &cmdBuffBegin);
+
+	texture::RecordUploads(batch.commandBuffer, batch.buffer, batch.uploads);
+	vkEndCommandBuffer(batch.commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+	// the fence is waited for before the staging buffer is written again,
+	// the queue itself keeps running
+	if (vkQueueSubmit(m_Device->GetGraphicsQueue(), 1, &submitInfo, batch.fence) != VK_SUCCESS)
+		throw std::runtime_error("Failed to submit texture uploads!");
+
+	batch.submitted = true;
+	++m_Stats.batchCount;
+	m_Stats.stagedBytes += batch.used;
+}
+
+void TextureLoader::Wait(StagingBatch& batch)
+{
+	if (batch.submitted)
+	{
+		vkWaitForFences(m_Device->GetDevice(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(m_Device->GetDevice(), 1, &batch.fence);
+		batch.submitted = false;
+	}
+
+	batch.uploads.clear();
+	batch.used = 0;
+}
+
+namespace texture {
+
+std::unique_ptr<Texture> CreateTexture(const Device* device,
+	const PreparedTexture& texture,
+	bool copySource,
+	ImageUpload& upload)
+{
+	const uint32_t width = std::max(1u, texture.width >> texture.firstLevel);
+	const uint32_t height = std::max(1u, texture.height >> texture.firstLevel);
+	const uint32_t levelCount = texture.levelCount - texture.firstLevel;
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	if (copySource)
+		usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+	DeviceAllocation imageMemory;
+	utils::img::CreateImage(device->GetDevice(),
+		device->GetAllocator(),
+		width,
+		height,
+		levelCount,
+		VK_SAMPLE_COUNT_1_BIT,
+		texture.format,
+		VK_IMAGE_TILING_OPTIMAL,
+		usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		upload.image,
+		imageMemory);
+	upload.levelCount = levelCount;
+	upload.regions = texture.regions;
+
+	return std::make_unique<Texture>(device,
+		texture.path,
+		texture.format,
+		texture.width,
+		texture.height,
+		texture.levelCount,
+		texture.firstLevel,
+		upload.image,
+		imageMemory);
+}
+
+void RecordUploads(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, const std::vector<ImageUpload>& uploads)
+{
+	if (uploads.empty())
+		return;
+
+	std::vector<VkImageMemoryBarrier> barriers(uploads.size());
+	for (size_t i = 0; i < uploads.size(); ++i)
+	{
+		VkImageMemoryBarrier& barrier = barriers[i];
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = uploads[i].image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = uploads[i].levelCount;
+		barrier.subresourceRange.layerCount = 1;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(barriers.size()),
+		barriers.data());
+
+	for (const ImageUpload& upload : uploads)
+	{
+		vkCmdCopyBufferToImage(commandBuffer,
+			stagingBuffer,
+			upload.image,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(upload.regions.size()),
+			upload.regions.data());
+	}
+
+	for (VkImageMemoryBarrier& barrier : barriers)
+	{
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(barriers.size()),
+		barriers.data());
+}
+
+} // namespace texture
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "core/assetCache.h"
+#include "core/threadPool.h"
+#include "renderer/device.h"
+#include "renderer/texture.h"
+#include "renderer/buffer/commandBuffer.h"
+#include "renderer/texture/textureAtlas.h"
+#include "renderer/texture/textureUpload.h"
+
+
+struct TextureLoadOptions
+{
+	// only loads the cooked textures and throws if one is missing; the
+	// assetCooker keeps them up to date
+	bool requireCooked = false;
+	// looked up before cooking a texture, and filled with the cooked ones
+	// (optional)
+	AssetCache* cache = nullptr;
+	// split between two batches: the textures of one are staged while the
+	// GPU copies the other; a texture larger than a batch gets a batch of
+	// its own size
+	VkDeviceSize maxStagingSize = DEFAULT_MAX_TEXTURE_STAGING_SIZE;
+	// textures opened and read ahead of the one being staged; 0 for two per
+	// thread of the pool
+	uint32_t maxTexturesInFlight = 0;
+	// the levels larger than this on either side are left out, eg: to only
+	// load the mip tail of streamed textures, which are then also created to
+	// be copied from; 0 for every level
+	uint32_t maxLevelSize = 0;
+};
+
+// the copies into an image and its levels, recorded by `RecordUploads`
+struct ImageUpload
+{
+	VkImage image;
+	uint32_t levelCount;
+	std::vector<VkBufferImageCopy> regions; // offsets from the start of the staging buffer
+};
+
+struct TextureLoadStats
+{
+	uint32_t textureCount;
+	uint32_t batchCount; // queue submissions
+	uint64_t stagedBytes;
+	// the staging thread waited for a texture to be read, and for the GPU to
+	// be done with a batch
+	double prepareWaitMilliseconds;
+	double uploadWaitMilliseconds;
+	double milliseconds;
+};
+
+// the small textures of a set packed into the pages of an atlas, see
+// `TextureLoader::LoadAtlas`
+struct AtlasTextures
+{
+	// a rect per texture, at NO_ATLAS_PAGE for the ones left out
+	AtlasLayout layout;
+	// with every level of the layout
+	std::vector<std::unique_ptr<Texture>> pages;
+};
+
+
+// loads textures in a pipeline: the cooked files are opened and read on the
+// thread pool, several textures ahead of the one being written into a
+// staging buffer, and the uploads are submitted in batches, each a single
+// command buffer with one barrier for every image of the batch before and
+// after the copies
+// the staging buffers are kept between loads
+class TextureLoader
+{
+public:
+	TextureLoader(const Device* device,
+		const CommandBuffer* commandBuffers,
+		ThreadPool& threadPool,
+		const TextureLoadOptions& options = {});
+	~TextureLoader();
+
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// loads the textures of `paths` (the source images, the cooked textures
+	// next to them are loaded) and blocks until every one is uploaded; on
+	// devices with BC texture compression those are the block compressed
+	// KTX2 files unless `allowCompressed` is false, and the RGBA8 ones
+	// otherwise, both with their mip chain
+	std::vector<std::unique_ptr<Texture>> Load(const std::vector<std::string>& paths, bool allowCompressed = true);
+
+	// packs the textures of `paths` no larger than `options.maxTextureSize`
+	// into the pages of an atlas and uploads the pages like any texture;
+	// the RGBA8 cooked textures are read, and get their mips built again
+	// within their rects (see `texture::BuildAtlasPages`), the larger ones
+	// are only opened for their size and left to be loaded on their own
+	AtlasTextures LoadAtlas(const std::vector<std::string>& paths, const AtlasOptions& options = {});
+
+	// of the last `Load` or `LoadAtlas`, which counts the pages
+	inline const TextureLoadStats& GetStats() const { return m_Stats; }
+
+private:
+	// a staging buffer, the command buffer that copies from it and the
+	// images it is copied to
+	struct StagingBatch
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		DeviceAllocation memory;
+		uint8_t* mapped = nullptr;
+		VkDeviceSize size = 0;
+		VkDeviceSize used = 0;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		bool submitted = false;
+
+		std::vector<ImageUpload> uploads;
+	};
+
+	std::unique_ptr<Texture> Stage(PreparedTexture& texture);
+	// `size` bytes of the current batch, submitting it and switching to the
+	// other one when it is full
+	StagingBatch& Reserve(VkDeviceSize size, VkDeviceSize& offset);
+
+	void AllocateStaging(StagingBatch& batch, VkDeviceSize size);
+	void FreeStaging(StagingBatch& batch);
+	void Submit(StagingBatch& batch);
+	// waits for the copies of the batch and empties it
+	void Wait(StagingBatch& batch);
+
+private:
+	const Device* m_Device;
+	const CommandBuffer* m_CommandBuffers;
+	ThreadPool* m_ThreadPool;
+	TextureLoadOptions m_Options;
+
+	std::array<StagingBatch, 2> m_Batches;
+	uint32_t m_CurrentBatch;
+
+	TextureLoadStats m_Stats;
+};
+
+
+namespace texture {
+
+// creates the image the uploaded levels of `texture` are copied into, with
+// `copySource` to copy its levels into another image, and the texture that
+// takes it over; `upload` gets the image and the regions of the levels, with
+// offsets from the start of the texture in the staging buffer
+std::unique_ptr<Texture> CreateTexture(const Device* device,
+	const PreparedTexture& texture,
+	bool copySource,
+	ImageUpload& upload);
+
+// one barrier command for every image before and after the copies, instead
+// of a transition per image; the images are then sampled by fragment shaders
+void RecordUploads(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, const std::vector<ImageUpload>& uploads);
+
+} // namespace texture
@@ -0,0 +1,94 @@
+#include "textureResidency.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+TextureResidency::TextureResidency(uint64_t budget)
+	: m_Budget{ budget },
+	  m_UseCounter{ 0 },
+	  m_Stats{}
+{
+}
+
+uint32_t TextureResidency::Acquire(const std::string& key, bool& resident)
+{
+	const auto [it, inserted] = m_Indices.try_emplace(key, static_cast<uint32_t>(m_Entries.size()));
+	if (inserted)
+		m_Entries.push_back(Entry{ key, 0, 0, 0, false, false });
+
+	Entry& entry = m_Entries[it->second];
+	++entry.refCount;
+	entry.lastUse = ++m_UseCounter;
+
+	resident = entry.resident;
+	if (resident)
+	{
+		++m_Stats.hits;
+	}
+	else
+	{
+		++m_Stats.misses;
+		if (entry.evicted)
+			++m_Stats.reloads;
+	}
+
+	return it->second;
+}
+
+void TextureResidency::AddRef(uint32_t entry)
+{
+	++m_Entries[entry].refCount;
+}
+
+void TextureResidency::Release(uint32_t entry)
+{
+	assert(m_Entries[entry].refCount > 0);
+	--m_Entries[entry].refCount;
+	m_Entries[entry].lastUse = ++m_UseCounter;
+}
+
+void TextureResidency::OnLoaded(uint32_t entry, uint64_t size)
+{
+	Entry& loaded = m_Entries[entry];
+	assert(!loaded.resident);
+	loaded.size = size;
+	loaded.resident = true;
+
+	++m_Stats.residentCount;
+	m_Stats.residentBytes += size;
+	m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_Stats.residentBytes);
+}
+
+std::vector<uint32_t> TextureResidency::Evict()
+{
+	std::vector<uint32_t> evicted;
+	if (!IsOverBudget())
+		return evicted;
+
+	std::vector<uint32_t> candidates;
+	for (uint32_t i = 0; i < m_Entries.size(); ++i)
+	{
+		if (m_Entries[i].resident && m_Entries[i].refCount == 0)
+			candidates.push_back(i);
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+		return m_Entries[a].lastUse < m_Entries[b].lastUse;
+	});
+
+	for (uint32_t i : candidates)
+	{
+		if (!IsOverBudget())
+			break;
+
+		Entry& entry = m_Entries[i];
+		entry.resident = false;
+		entry.evicted = true;
+		--m_Stats.residentCount;
+		m_Stats.residentBytes -= entry.size;
+		++m_Stats.evictions;
+		evicted.push_back(i);
+	}
+
+	return evicted;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// textures that are not referenced anymore are kept resident until they take
+// more than this
+constexpr uint64_t DEFAULT_TEXTURE_BUDGET = 256ull * 1024 * 1024;
+
+struct TextureCacheStats
+{
+	uint64_t hits; // acquired while resident
+	uint64_t misses; // had to be loaded
+	uint64_t reloads; // misses of textures that were evicted before
+	uint64_t evictions;
+	uint32_t residentCount;
+	uint64_t residentBytes;
+	uint64_t peakResidentBytes;
+};
+
+
+// the bookkeeping of `TextureCache` without the GPU: an entry per key with
+// its references, its size while resident and when it was last used
+// an entry is only evicted once nothing references it, so the referenced
+// textures may take more than the budget on their own; not thread safe
+class TextureResidency
+{
+public:
+	explicit TextureResidency(uint64_t budget = DEFAULT_TEXTURE_BUDGET);
+
+	// the entry of `key`, created the first time, with one more reference;
+	// `resident` is false when it has to be loaded, see `OnLoaded`
+	uint32_t Acquire(const std::string& key, bool& resident);
+	void AddRef(uint32_t entry);
+	void Release(uint32_t entry);
+	void OnLoaded(uint32_t entry, uint64_t size);
+
+	// the entries to free, least recently used first, for the resident ones
+	// to fit the budget again; they are not resident anymore when it returns
+	std::vector<uint32_t> Evict();
+
+	inline void SetBudget(uint64_t budget) { m_Budget = budget; }
+	inline uint64_t GetBudget() const { return m_Budget; }
+	inline bool IsOverBudget() const { return m_Stats.residentBytes > m_Budget; }
+
+	inline uint32_t GetEntryCount() const { return static_cast<uint32_t>(m_Entries.size()); }
+	inline const std::string& GetKey(uint32_t entry) const { return m_Entries[entry].key; }
+	inline uint32_t GetRefCount(uint32_t entry) const { return m_Entries[entry].refCount; }
+	inline bool IsResident(uint32_t entry) const { return m_Entries[entry].resident; }
+	inline const TextureCacheStats& GetStats() const { return m_Stats; }
+
+private:
+	struct Entry
+	{
+		std::string key;
+		uint64_t size;
+		uint32_t refCount;
+		// a counter bumped on every acquire and release, rather than the
+		// time, so that entries used in the same frame keep their order
+		uint64_t lastUse;
+		bool resident;
+		bool evicted;
+	};
+
+private:
+	uint64_t m_Budget;
+
+	std::vector<Entry> m_Entries;
+	std::unordered_map<std::string, uint32_t> m_Indices;
+	uint64_t m_UseCounter;
+
+	TextureCacheStats m_Stats;
+};
@@ -0,0 +1,243 @@
+#include "textureUpload.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "stb_image/stb_image.h"
+
+#include "renderer/texture/bcCodec.h"
+
+
+namespace texture {
+
+static VkBufferImageCopy GetLevelRegion(uint32_t level, VkDeviceSize offset, uint32_t width, uint32_t height)
+{
+	VkBufferImageCopy region{};
+	region.bufferOffset = offset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = level;
+	region.imageSubresource.layerCount = 1;
+	// levels smaller than a block are copied at their own size
+	region.imageExtent = { std::max(1u, width >> level), std::max(1u, height >> level), 1 };
+	return region;
+}
+
+// staged like the texel blob of the cooked texture
+static void AddTexelRegions(PreparedTexture& texture)
+{
+	for (uint32_t level = 0; level < texture.levelCount; ++level)
+	{
+		texture.regions.push_back(GetLevelRegion(
+			level, TextureFile::GetTexelSize(texture.width, texture.height, level), texture.width, texture.height));
+	}
+	texture.stagingSize = TextureFile::GetTexelSize(texture.width, texture.height, texture.levelCount);
+}
+
+static void PrepareCompressedTexture(PreparedTexture& texture,
+	bool requireCooked,
+	AssetCache* cache,
+	uint32_t cookThreadCount)
+{
+	const std::string cookedPath = KtxFile::GetCookedPath(texture.path);
+	if (requireCooked && !KtxFile::IsCompatible(cookedPath))
+		throw std::runtime_error("Cooked texture is missing or out of date, run assetCooker: " + cookedPath);
+
+	// unlike the RGBA8 texels, the blocks are not kept in memory when the
+	// file cannot be written, encoding them again on every run is too slow
+	if (!requireCooked && !KtxFile::IsUpToDate(cookedPath, texture.path))
+	{
+		ThreadPool cookPool{ cookThreadCount };
+		if (!KtxFile::Cook(texture.path, cookedPath, cookPool, cache))
+			throw std::runtime_error("Failed to write cooked texture: " + cookedPath);
+	}
+
+	texture.ktxFile = std::make_unique<KtxFile>(cookedPath);
+	const KtxFile& ktxFile = *texture.ktxFile;
+	texture.format = ktxFile.GetFormat();
+	texture.width = ktxFile.GetWidth();
+	texture.height = ktxFile.GetHeight();
+	texture.levelCount = ktxFile.GetLevelCount();
+
+	// the levels are staged largest first, back to back; every level is a
+	// whole number of blocks, so they stay aligned to the block
+	for (uint32_t level = 0; level < texture.levelCount; ++level)
+	{
+		texture.regions.push_back(GetLevelRegion(level, texture.stagingSize, texture.width, texture.height));
+		texture.stagingSize += ktxFile.GetLevelData(level).size();
+	}
+}
+
+static void PrepareUncompressedTexture(PreparedTexture& texture,
+	bool requireCooked,
+	AssetCache* cache,
+	uint32_t cookThreadCount)
+{
+	const std::string cookedPath = TextureFile::GetCookedPath(texture.path);
+	if (requireCooked && !TextureFile::IsCompatible(cookedPath))
+		throw std::runtime_error("Cooked texture is missing or out of date, run assetCooker: " + cookedPath);
+
+	// a cooked texture older than its image may still have the same
+	// contents as a cached one, eg: after a checkout that touched the image
+	bool isCooked = requireCooked || TextureFile::IsUpToDate(cookedPath, texture.path);
+	uint64_t cacheKey = 0;
+	if (!isCooked && cache)
+	{
+		cacheKey = TextureFile::GetCacheKey(texture.path, MipFilter::KAISER);
+		isCooked = cache->Extract(cacheKey, cookedPath) && TextureFile::IsCompatible(cookedPath);
+	}
+
+	if (isCooked)
+	{
+		texture.textureFile = std::make_unique<TextureFile>(cookedPath);
+		texture.width = texture.textureFile->GetWidth();
+		texture.height = texture.textureFile->GetHeight();
+		texture.levelCount = texture.textureFile->GetLevelCount();
+	}
+	else
+	{
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		// force alpha (even if there isnt one)
+		stbi_uc* texels = stbi_load(texture.path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!texels)
+			throw std::runtime_error("Failed to load texture image: " + texture.path);
+
+		texture.width = static_cast<uint32_t>(width);
+		texture.height = static_cast<uint32_t>(height);
+		texture.levelCount = GetMipLevelCount(texture.width, texture.height);
+
+		ThreadPool cookPool{ cookThreadCount };
+		texture.texels = TextureFile::BuildTexels(texels, texture.width, texture.height, MipFilter::KAISER, cookPool);
+		stbi_image_free(texels);
+
+		// the cooked texture is only a cache, failing to write it is not fatal
+		if (!TextureFile::Write(
+				cookedPath, texture.width, texture.height, texture.levelCount, texture.texels.data(), cookPool))
+			std::cout << "Failed to write cooked texture: " << cookedPath << '\n';
+		else if (cache)
+			cache->StoreFile(cacheKey, cookedPath);
+	}
+
+	AddTexelRegions(texture);
+}
+
+PreparedTexture PrepareTexture(const std::string& path,
+	bool compressed,
+	bool requireCooked,
+	AssetCache* cache,
+	uint32_t cookThreadCount)
+{
+	PreparedTexture texture{};
+	texture.path = path;
+	if (compressed)
+		PrepareCompressedTexture(texture, requireCooked, cache, cookThreadCount);
+	else
+		PrepareUncompressedTexture(texture, requireCooked, cache, cookThreadCount);
+
+	// the thread staging the texture then copies from memory instead of
+	// waiting for the disk
+	if (texture.ktxFile)
+		texture.ktxFile->Prefetch();
+	if (texture.textureFile)
+		texture.textureFile->Prefetch();
+
+	return texture;
+}
+
+PreparedTexture PrepareTexels(const std::string& path,
+	uint32_t width,
+	uint32_t height,
+	uint32_t levelCount,
+	std::vector<uint8_t> texels)
+{
+	PreparedTexture texture{};
+	texture.path = path;
+	texture.width = width;
+	texture.height = height;
+	texture.levelCount = levelCount;
+	AddTexelRegions(texture);
+
+	if (texels.size() != texture.stagingSize)
+		throw std::runtime_error("The texels do not match the levels of the texture: " + path);
+
+	texture.texels = std::move(texels);
+	return texture;
+}
+
+void WriteStaging(const PreparedTexture& texture, uint8_t* destination, ThreadPool& threadPool)
+{
+	if (texture.ktxFile)
+	{
+		for (uint32_t level = texture.firstLevel; level < texture.levelCount; ++level)
+		{
+			const Span<const uint8_t> levelData = texture.ktxFile->GetLevelData(level);
+			memcpy(destination + texture.regions[level - texture.firstLevel].bufferOffset,
+				levelData.data(),
+				levelData.size());
+		}
+	}
+	else if (texture.textureFile)
+	{
+		codec::Decode(texture.textureFile->GetTexelData(), destination, threadPool);
+	}
+	else
+	{
+		memcpy(destination, texture.texels.data(), texture.texels.size());
+	}
+}
+
+void SkipLevels(PreparedTexture& texture, uint32_t firstLevel)
+{
+	const uint32_t skipped = firstLevel - texture.firstLevel;
+	if (skipped == 0)
+		return;
+
+	texture.regions.erase(texture.regions.begin(), texture.regions.begin() + skipped);
+	texture.firstLevel = firstLevel;
+
+	// the blocks of the skipped levels are not staged at all
+	const VkDeviceSize skippedSize = texture.ktxFile ? texture.regions.front().bufferOffset : 0;
+	texture.stagingSize -= skippedSize;
+	for (VkBufferImageCopy& region : texture.regions)
+	{
+		region.bufferOffset -= skippedSize;
+		region.imageSubresource.mipLevel -= skipped;
+	}
+}
+
+uint32_t GetFirstLevelWithin(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t maxSize)
+{
+	uint32_t level = 0;
+	while (level + 1 < levelCount && std::max(width >> level, height >> level) > maxSize)
+		++level;
+
+	return level;
+}
+
+uint64_t GetLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level)
+{
+	const uint64_t levelWidth = std::max(1u, width >> level);
+	const uint64_t levelHeight = std::max(1u, height >> level);
+	const uint64_t blockCount = ((levelWidth + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION)
+								* ((levelHeight + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION);
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		return blockCount * 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return blockCount * 16;
+	default:
+		return levelWidth * levelHeight * 4;
+	}
+}
+
+} // namespace texture
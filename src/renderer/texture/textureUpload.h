@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "core/assetCache.h"
+#include "core/threadPool.h"
+#include "renderer/textureFile.h"
+#include "renderer/texture/ktxFile.h"
+
+
+// host visible memory the texture uploads in flight take by default
+constexpr VkDeviceSize DEFAULT_MAX_TEXTURE_STAGING_SIZE = 64 * 1024 * 1024;
+// staging offsets of the textures are aligned to this, a multiple of the
+// texel and block sizes of every format they are uploaded in
+constexpr VkDeviceSize TEXTURE_STAGING_ALIGNMENT = 16;
+
+// a texture read and ready to be written into a staging buffer: the
+// cooked file it comes from and the regions its levels are copied by
+struct PreparedTexture
+{
+	std::string path;
+	VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levelCount = 0;
+	// the levels above it are not uploaded, see `SkipLevels`
+	uint32_t firstLevel = 0;
+	// bytes of the uploaded levels in the staging buffer
+	VkDeviceSize stagingSize = 0;
+	// a region per uploaded level, offsets from the start of the texture in
+	// the staging buffer
+	std::vector<VkBufferImageCopy> regions;
+
+	// the texels come from one of them
+	std::unique_ptr<KtxFile> ktxFile;
+	std::unique_ptr<TextureFile> textureFile;
+	// the decoded image and its mip chain, when the cooked texture could not
+	// be written
+	std::vector<uint8_t> texels;
+};
+
+
+namespace texture {
+
+// opens the cooked texture of the image, the block compressed KTX2 with
+// `compressed` and the RGBA8 one otherwise, and reads its pages in; runs on
+// a worker thread, so a texture that has to be cooked first is cooked on a
+// pool of `cookThreadCount` threads of its own
+// with `requireCooked` only the cooked texture is opened, and it throws if
+// it is missing; otherwise `cache` (optional) is looked up before cooking
+PreparedTexture PrepareTexture(const std::string& path,
+	bool compressed,
+	bool requireCooked,
+	AssetCache* cache,
+	uint32_t cookThreadCount);
+
+// a texture of RGBA8 texels built in memory (eg: the page of an atlas),
+// every level laid out like the texel blob of a cooked texture; throws if
+// `texels` is not the size of `levelCount` levels
+PreparedTexture PrepareTexels(const std::string& path,
+	uint32_t width,
+	uint32_t height,
+	uint32_t levelCount,
+	std::vector<uint8_t> texels);
+
+// writes the levels of the texture at the offsets of its regions from
+// `destination`, decoding the RGBA8 texels on `threadPool`; `destination`
+// is only written, so it can be write-combined staging memory
+void WriteStaging(const PreparedTexture& texture, uint8_t* destination, ThreadPool& threadPool);
+
+// only uploads the levels from `firstLevel`, into an image that starts at
+// it; the block compressed levels are staged from there, the RGBA8 ones are
+// still decoded as a whole
+void SkipLevels(PreparedTexture& texture, uint32_t firstLevel);
+
+// the first level of the chain no larger than `maxSize` on either side, or
+// the last one
+uint32_t GetFirstLevelWithin(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t maxSize);
+
+// bytes of the texels of a level, in one of the formats textures are
+// uploaded in
+uint64_t GetLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level);
+
+} // namespace texture
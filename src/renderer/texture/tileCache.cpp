@@ -0,0 +1,313 @@
+#include "tileCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+
+// frames a tile is not evicted for after it was sampled or became resident,
+// longer than its feedback takes to come back with the frames in flight
+constexpr uint64_t g_KeepFrames = 4;
+
+static bool IsPowerOfTwo(uint32_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+uint32_t VirtualTextureLayout::GetLevel(uint32_t page) const
+{
+	return static_cast<uint32_t>(std::upper_bound(firstPage.begin(), firstPage.end(), page) - firstPage.begin() - 1);
+}
+
+uint32_t VirtualTextureLayout::GetParent(uint32_t page) const
+{
+	const uint32_t level = GetLevel(page);
+	if (level + 1 == levelCount)
+		return NO_TILE;
+
+	const uint32_t x = (page - firstPage[level]) % pagesX[level];
+	const uint32_t y = (page - firstPage[level]) / pagesX[level];
+	return GetPage(level + 1, x / 2, y / 2);
+}
+
+namespace texture {
+
+VirtualTextureLayout GetVirtualTextureLayout(uint32_t width, uint32_t height, uint32_t tileSize)
+{
+	if (!IsPowerOfTwo(tileSize) || tileSize < BC_BLOCK_DIMENSION)
+		throw std::runtime_error("The tiles of a virtual texture must be a power of two of at least a block!");
+	if (!IsPowerOfTwo(width) || !IsPowerOfTwo(height) || width < tileSize || height < tileSize)
+	{
+		throw std::runtime_error("A virtual texture must have power of two sides no smaller than a tile, not "
+								 + std::to_string(width) + "x" + std::to_string(height) + "!");
+	}
+
+	VirtualTextureLayout layout{};
+	layout.width = width;
+	layout.height = height;
+	layout.tileSize = tileSize;
+
+	uint32_t pagesX = width / tileSize;
+	uint32_t pagesY = height / tileSize;
+	while (true)
+	{
+		layout.pagesX.push_back(pagesX);
+		layout.pagesY.push_back(pagesY);
+		layout.firstPage.push_back(layout.pageCount);
+		layout.pageCount += pagesX * pagesY;
+		if (pagesX == 1 && pagesY == 1)
+			break;
+
+		pagesX = std::max(1u, pagesX / 2);
+		pagesY = std::max(1u, pagesY / 2);
+	}
+	layout.levelCount = static_cast<uint32_t>(layout.pagesX.size());
+
+	return layout;
+}
+
+void CopyTile(const KtxFile& file, const VirtualTextureLayout& layout, uint32_t page, uint8_t* blocks)
+{
+	const uint32_t level = layout.GetLevel(page);
+	const uint32_t x = (page - layout.firstPage[level]) % layout.pagesX[level];
+	const uint32_t y = (page - layout.firstPage[level]) / layout.pagesX[level];
+
+	const uint32_t blockSize = GetBlockSize(file.GetBlockFormat());
+	const int32_t levelBlocksX =
+		static_cast<int32_t>((file.GetLevelWidth(level) + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION);
+	const int32_t levelBlocksY =
+		static_cast<int32_t>((file.GetLevelHeight(level) + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION);
+	const uint8_t* data = file.GetLevelData(level).data();
+
+	// the first block of the tile, in its border
+	const int32_t borderBlocks = static_cast<int32_t>(VIRTUAL_TILE_BORDER / BC_BLOCK_DIMENSION);
+	const int32_t tileBlocks = static_cast<int32_t>(layout.tileSize / BC_BLOCK_DIMENSION);
+	const int32_t startX = static_cast<int32_t>(x) * tileBlocks - borderBlocks;
+	const int32_t startY = static_cast<int32_t>(y) * tileBlocks - borderBlocks;
+
+	const int32_t rowBlocks = tileBlocks + 2 * borderBlocks;
+	for (int32_t row = 0; row < rowBlocks; ++row)
+	{
+		const int32_t sourceY = std::clamp(startY + row, 0, levelBlocksY - 1);
+		const uint8_t* source = data + static_cast<size_t>(sourceY) * static_cast<size_t>(levelBlocksX) * blockSize;
+		uint8_t* destination = blocks + static_cast<size_t>(row) * static_cast<size_t>(rowBlocks) * blockSize;
+
+		// the blocks within the level in one go, the ones past its edges
+		// repeat the edge
+		const int32_t first = std::clamp(startX, 0, levelBlocksX);
+		const int32_t last = std::clamp(startX + rowBlocks, 0, levelBlocksX);
+		for (int32_t column = 0; column < rowBlocks; ++column)
+		{
+			const int32_t sourceX = startX + column;
+			if (sourceX == first && first < last)
+			{
+				memcpy(destination + static_cast<size_t>(column) * blockSize,
+					source + static_cast<size_t>(first) * blockSize,
+					static_cast<size_t>(last - first) * blockSize);
+				column += last - first - 1;
+				continue;
+			}
+
+			memcpy(destination + static_cast<size_t>(column) * blockSize,
+				source + static_cast<size_t>(std::clamp(sourceX, 0, levelBlocksX - 1)) * blockSize,
+				blockSize);
+		}
+	}
+}
+
+} // namespace texture
+
+
+TileCache::TileCache(const VirtualTextureLayout& layout, uint32_t cacheSize)
+	: m_Layout{ layout },
+	  m_CacheSize{ cacheSize },
+	  m_PageSlots(layout.pageCount, NO_TILE),
+	  m_PageStates(layout.pageCount, PageState::EMPTY),
+	  m_Slots(static_cast<size_t>(cacheSize) * cacheSize),
+	  m_QueuedFrames(layout.pageCount, 0),
+	  m_FrameCount{ 0 },
+	  m_PageTableDirty{ true },
+	  m_ResidentTiles{ 0 },
+	  m_PendingTiles{ 0 },
+	  m_RequestedTiles{ 0 },
+	  m_Loads{ 0 },
+	  m_Evictions{ 0 }
+{
+	if (cacheSize == 0 || cacheSize > 256)
+		throw std::runtime_error("A tile cache must have between 1 and 256 slots on a side!");
+}
+
+void TileCache::AddFeedback(const std::vector<uint32_t>& pages)
+{
+	++m_FrameCount;
+	m_RequestedTiles = static_cast<uint32_t>(pages.size());
+	m_Missing.clear();
+
+	// the tile a page is drawn from, which is kept resident by being sampled
+	const auto touch = [this](uint32_t page) {
+		uint32_t drawn = page;
+		while (drawn != NO_TILE && m_PageStates[drawn] != PageState::RESIDENT)
+			drawn = m_Layout.GetParent(drawn);
+		if (drawn != NO_TILE)
+			m_Slots[m_PageSlots[drawn]].lastSampledFrame = m_FrameCount;
+
+		return drawn == page;
+	};
+
+	for (uint32_t page : pages)
+	{
+		if (!touch(page))
+			m_Missing.push_back(page);
+
+		// the next coarser level is blended in too
+		const uint32_t parent = m_Layout.GetParent(page);
+		if (parent != NO_TILE)
+			touch(parent);
+	}
+}
+
+std::vector<TileLoad> TileCache::Plan(uint32_t maxLoads)
+{
+	// the coarsest page missing on the way from every sampled page to the
+	// tile it falls back to, so the pages are refined a level at a time
+	std::vector<uint32_t> pages;
+	const uint32_t root = m_Layout.pageCount - 1;
+	if (m_PageStates[root] == PageState::EMPTY)
+	{
+		m_QueuedFrames[root] = m_FrameCount;
+		pages.push_back(root);
+	}
+	for (uint32_t page : m_Missing)
+	{
+		uint32_t missing = NO_TILE;
+		for (uint32_t ancestor = page; ancestor != NO_TILE && m_PageStates[ancestor] == PageState::EMPTY;
+			 ancestor = m_Layout.GetParent(ancestor))
+			missing = ancestor;
+
+		if (missing != NO_TILE && m_QueuedFrames[missing] != m_FrameCount)
+		{
+			m_QueuedFrames[missing] = m_FrameCount;
+			pages.push_back(missing);
+		}
+	}
+	if (pages.empty())
+		return {};
+
+	// the pages of the coarser levels come after the finer ones
+	std::sort(pages.begin(), pages.end(), std::greater<uint32_t>{});
+
+	// the free slots first, then the tiles sampled the longest ago; the root
+	// is never evicted, so every page falls back to something
+	std::vector<uint32_t> slots;
+	for (uint32_t i = 0; i < m_Slots.size(); ++i)
+	{
+		const Slot& slot = m_Slots[i];
+		if (slot.page == NO_TILE
+			|| (slot.page != root && m_PageStates[slot.page] == PageState::RESIDENT
+				&& slot.lastSampledFrame + g_KeepFrames <= m_FrameCount))
+			slots.push_back(i);
+	}
+	const size_t loadCount = std::min({ static_cast<size_t>(maxLoads), pages.size(), slots.size() });
+	std::partial_sort(slots.begin(), slots.begin() + loadCount, slots.end(), [this](uint32_t a, uint32_t b) {
+		const bool freeA = m_Slots[a].page == NO_TILE;
+		const bool freeB = m_Slots[b].page == NO_TILE;
+		if (freeA != freeB)
+			return freeA;
+		return m_Slots[a].lastSampledFrame < m_Slots[b].lastSampledFrame;
+	});
+
+	std::vector<TileLoad> loads;
+	loads.reserve(loadCount);
+	for (size_t i = 0; i < loadCount; ++i)
+	{
+		Slot& slot = m_Slots[slots[i]];
+		if (slot.page != NO_TILE)
+		{
+			m_PageStates[slot.page] = PageState::EMPTY;
+			m_PageSlots[slot.page] = NO_TILE;
+			--m_ResidentTiles;
+			++m_Evictions;
+			m_PageTableDirty = true;
+		}
+
+		slot.page = pages[i];
+		slot.lastSampledFrame = m_FrameCount;
+		m_PageStates[pages[i]] = PageState::PENDING;
+		m_PageSlots[pages[i]] = slots[i];
+		++m_PendingTiles;
+		++m_Loads;
+		loads.push_back(TileLoad{ pages[i], slots[i] });
+	}
+
+	return loads;
+}
+
+void TileCache::SetResident(uint32_t page)
+{
+	assert(m_PageStates[page] == PageState::PENDING);
+
+	m_PageStates[page] = PageState::RESIDENT;
+	m_Slots[m_PageSlots[page]].lastSampledFrame = m_FrameCount;
+	--m_PendingTiles;
+	++m_ResidentTiles;
+	m_PageTableDirty = true;
+}
+
+void TileCache::Cancel(uint32_t page)
+{
+	assert(m_PageStates[page] == PageState::PENDING);
+
+	m_Slots[m_PageSlots[page]] = Slot{};
+	m_PageStates[page] = PageState::EMPTY;
+	m_PageSlots[page] = NO_TILE;
+	--m_PendingTiles;
+}
+
+void TileCache::BuildPageTable(std::vector<uint32_t>& entries)
+{
+	entries.resize(m_Layout.pageCount);
+
+	// the coarser levels first, so every page that is not resident copies
+	// the entry of its parent
+	for (uint32_t level = m_Layout.levelCount; level-- > 0;)
+	{
+		for (uint32_t y = 0; y < m_Layout.pagesY[level]; ++y)
+		{
+			for (uint32_t x = 0; x < m_Layout.pagesX[level]; ++x)
+			{
+				const uint32_t page = m_Layout.GetPage(level, x, y);
+				if (m_PageStates[page] == PageState::RESIDENT)
+				{
+					const uint32_t slot = m_PageSlots[page];
+					entries[page] = (slot % m_CacheSize) | (slot / m_CacheSize) << 8 | level << 16 | 1u << 24;
+				}
+				else if (level + 1 < m_Layout.levelCount)
+				{
+					entries[page] = entries[m_Layout.GetPage(level + 1, x / 2, y / 2)];
+				}
+				else
+				{
+					entries[page] = 0;
+				}
+			}
+		}
+	}
+
+	m_PageTableDirty = false;
+}
+
+TileCacheStats TileCache::GetStats() const
+{
+	TileCacheStats stats{};
+	stats.slotCount = static_cast<uint32_t>(m_Slots.size());
+	stats.residentTiles = m_ResidentTiles;
+	stats.pendingTiles = m_PendingTiles;
+	stats.requestedTiles = m_RequestedTiles;
+	stats.missingTiles = static_cast<uint32_t>(m_Missing.size());
+	stats.loads = m_Loads;
+	stats.evictions = m_Evictions;
+	return stats;
+}
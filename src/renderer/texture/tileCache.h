@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/texture/ktxFile.h"
+
+
+// texels on a side of a tile of a virtual texture by default, a multiple of
+// the block size
+constexpr uint32_t DEFAULT_VIRTUAL_TILE_SIZE = 128;
+// texels around every tile in the cache, copied from its neighbours so that
+// bilinear filtering does not bleed into the next slot; a block, so the
+// tiles are copied as whole blocks
+constexpr uint32_t VIRTUAL_TILE_BORDER = 4;
+// slots on a side of the tile cache by default, at most 256 so that a slot
+// fits the page table
+constexpr uint32_t DEFAULT_TILE_CACHE_SIZE = 32;
+// the page a level of the virtual texture maps to no slot, and the slot of
+// no page
+constexpr uint32_t NO_TILE = ~0u;
+
+// the pages of every level of a virtual texture, the finest first; a page
+// is a tile of `tileSize` texels of a level, and the coarsest level fits a
+// single one
+struct VirtualTextureLayout
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t tileSize = 0;
+	uint32_t levelCount = 0;
+	// of every level
+	std::vector<uint32_t> pagesX;
+	std::vector<uint32_t> pagesY;
+	std::vector<uint32_t> firstPage;
+	uint32_t pageCount = 0;
+
+	inline uint32_t GetPage(uint32_t level, uint32_t x, uint32_t y) const
+	{
+		return firstPage[level] + y * pagesX[level] + x;
+	}
+	uint32_t GetLevel(uint32_t page) const;
+	// the page of the next coarser level that covers `page`, or `NO_TILE`
+	uint32_t GetParent(uint32_t page) const;
+};
+
+// a page to read into a slot of the cache
+struct TileLoad
+{
+	uint32_t page;
+	uint32_t slot;
+};
+
+struct TileCacheStats
+{
+	uint32_t slotCount;
+	uint32_t residentTiles;
+	uint32_t pendingTiles;
+	// pages sampled by the last frame, and the ones of them drawn from a
+	// coarser tile since they were not resident
+	uint32_t requestedTiles;
+	uint32_t missingTiles;
+	uint64_t loads;
+	uint64_t evictions;
+};
+
+
+namespace texture {
+
+// the pages of a virtual texture; the sides have to be powers of two no
+// smaller than `tileSize`, it throws otherwise
+VirtualTextureLayout GetVirtualTextureLayout(uint32_t width, uint32_t height, uint32_t tileSize);
+
+// copies the blocks of a page of the cooked texture with a border of
+// `VIRTUAL_TILE_BORDER` texels on every side into `blocks`, rows of
+// `(tileSize + 2 * VIRTUAL_TILE_BORDER) / 4` blocks; the border and the
+// pages of levels smaller than a tile repeat the edges of the level
+void CopyTile(const KtxFile& file, const VirtualTextureLayout& layout, uint32_t page, uint8_t* blocks);
+
+} // namespace texture
+
+
+// which pages of a virtual texture are resident in the slots of its tile
+// cache, from the pages the fragment shaders sampled: a page that is not
+// resident is drawn from its finest resident ancestor, and is loaded after
+// the coarser pages it falls back to; the least recently sampled tiles are
+// evicted for them
+// `VirtualTexture` reads and uploads the tiles and the page table, this only
+// does the accounting
+class TileCache
+{
+public:
+	// `cacheSize` slots on a side
+	TileCache(const VirtualTextureLayout& layout, uint32_t cacheSize = DEFAULT_TILE_CACHE_SIZE);
+
+	// the pages a frame sampled; once per frame
+	void AddFeedback(const std::vector<uint32_t>& pages);
+
+	// up to `maxLoads` pages to read, the coarsest first, each into a slot of
+	// a tile that was not sampled by the last few frames; the pages are
+	// pending until `SetResident` or `Cancel`, and the tiles they replace are
+	// evicted right away
+	std::vector<TileLoad> Plan(uint32_t maxLoads);
+	void SetResident(uint32_t page);
+	void Cancel(uint32_t page);
+
+	// the entry of every page of every level, like `VirtualTextureLayout`:
+	// the RGBA8 texel of the page table, the slot of the page or of its
+	// finest resident ancestor (x and y), its level, and 0 in alpha when
+	// not even the coarsest page is resident
+	void BuildPageTable(std::vector<uint32_t>& entries);
+	// a page became resident or was evicted since the last `BuildPageTable`
+	inline bool IsPageTableDirty() const { return m_PageTableDirty; }
+
+	inline uint32_t GetSlot(uint32_t page) const { return m_PageSlots[page]; }
+	inline bool IsResident(uint32_t page) const { return m_PageStates[page] == PageState::RESIDENT; }
+	inline const VirtualTextureLayout& GetLayout() const { return m_Layout; }
+	inline uint32_t GetCacheSize() const { return m_CacheSize; }
+	TileCacheStats GetStats() const;
+
+private:
+	enum class PageState : uint8_t
+	{
+		EMPTY,
+		PENDING,
+		RESIDENT
+	};
+
+	struct Slot
+	{
+		uint32_t page = NO_TILE;
+		uint64_t lastSampledFrame = 0;
+	};
+
+private:
+	VirtualTextureLayout m_Layout;
+	uint32_t m_CacheSize;
+
+	std::vector<uint32_t> m_PageSlots;
+	std::vector<PageState> m_PageStates;
+	std::vector<Slot> m_Slots;
+	// the pages sampled by the last frame that are not resident
+	std::vector<uint32_t> m_Missing;
+	// frame a page was last queued by `Plan`, so it is queued once
+	std::vector<uint64_t> m_QueuedFrames;
+
+	uint64_t m_FrameCount;
+	bool m_PageTableDirty;
+	uint32_t m_ResidentTiles;
+	uint32_t m_PendingTiles;
+	uint32_t m_RequestedTiles;
+	uint64_t m_Loads;
+	uint64_t m_Evictions;
+};
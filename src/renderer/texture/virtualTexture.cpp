@@ -0,0 +1,496 @@
+#include "virtualTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "utils/bufferUtils.h"
+#include "utils/imageUtils.h"
+
+
+static VkImageMemoryBarrier GetImageBarrier(VkImage image,
+	uint32_t levelCount,
+	VkImageLayout oldLayout,
+	VkImageLayout newLayout,
+	VkAccessFlags srcAccessMask,
+	VkAccessFlags dstAccessMask)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcAccessMask = srcAccessMask;
+	barrier.dstAccessMask = dstAccessMask;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.layerCount = 1;
+	return barrier;
+}
+
+VirtualTexture::VirtualTexture(const Device* device,
+	ThreadPool& threadPool,
+	uint32_t maxFramesInFlight,
+	const VirtualTextureOptions& options)
+	: m_Device{ device },
+	  m_ThreadPool{ &threadPool },
+	  m_MaxFramesInFlight{ maxFramesInFlight },
+	  m_Options{ options },
+	  m_Format{ VK_FORMAT_UNDEFINED },
+	  m_Transcode{ !device->SupportsTextureCompressionBC() },
+	  m_TileBytes{ 0 },
+	  m_CacheImage{ VK_NULL_HANDLE },
+	  m_CacheMemory{ VK_NULL_HANDLE },
+	  m_CacheView{ VK_NULL_HANDLE },
+	  m_CacheSampler{ VK_NULL_HANDLE },
+	  m_PageTableImage{ VK_NULL_HANDLE },
+	  m_PageTableMemory{ VK_NULL_HANDLE },
+	  m_PageTableView{ VK_NULL_HANDLE },
+	  m_PageTableSampler{ VK_NULL_HANDLE },
+	  m_ImagesInitialized{ false },
+	  m_Frames(maxFramesInFlight),
+	  m_UploadedBytes{ 0 },
+	  m_PageTableUploads{ 0 }
+{
+	if (!device->SupportsSamplingFeedback())
+		throw std::runtime_error("Virtual textures need fragmentStoresAndAtomics for their feedback!");
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	// the tasks still read the cooked texture and write into the pending tiles
+	for (const std::unique_ptr<PendingTile>& tile : m_PendingTiles)
+		tile->future.wait();
+
+	for (FrameResources& frame : m_Frames)
+		FreeFrame(frame);
+
+	VkDevice deviceVk = m_Device->GetDevice();
+	vkDestroySampler(deviceVk, m_PageTableSampler, nullptr);
+	vkDestroyImageView(deviceVk, m_PageTableView, nullptr);
+	vkDestroyImage(deviceVk, m_PageTableImage, nullptr);
+	m_Device->GetAllocator().Free(m_PageTableMemory);
+
+	vkDestroySampler(deviceVk, m_CacheSampler, nullptr);
+	vkDestroyImageView(deviceVk, m_CacheView, nullptr);
+	vkDestroyImage(deviceVk, m_CacheImage, nullptr);
+	m_Device->GetAllocator().Free(m_CacheMemory);
+}
+
+void VirtualTexture::Load(const std::string& path)
+{
+	const std::string cookedPath = KtxFile::GetCookedPath(path);
+	if (m_Options.requireCooked && !KtxFile::IsCompatible(cookedPath))
+		throw std::runtime_error("Cooked texture is missing or out of date, run assetCooker: " + cookedPath);
+	if (!m_Options.requireCooked && !KtxFile::IsUpToDate(cookedPath, path)
+		&& !KtxFile::Cook(path, cookedPath, *m_ThreadPool, m_Options.cache))
+		throw std::runtime_error("Failed to write cooked texture: " + cookedPath);
+
+	m_File = std::make_unique<KtxFile>(cookedPath);
+	m_Layout = texture::GetVirtualTextureLayout(m_File->GetWidth(), m_File->GetHeight(), m_Options.tileSize);
+	if (m_File->GetLevelCount() < m_Layout.levelCount)
+		throw std::runtime_error("Cooked texture is missing the levels of a virtual texture: " + cookedPath);
+	m_TileCache = std::make_unique<TileCache>(m_Layout, m_Options.cacheSize);
+
+	// BC5 is linear either way
+	const texture::BlockFormat blockFormat = m_File->GetBlockFormat();
+	const bool srgb = m_File->GetFormat() != KtxFile::GetVkFormat(blockFormat, false);
+	m_Format = m_Transcode ? (srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM) : m_File->GetFormat();
+
+	const uint32_t slotSize = m_Layout.tileSize + 2 * VIRTUAL_TILE_BORDER;
+	m_TileBytes = m_Transcode ? static_cast<VkDeviceSize>(slotSize) * slotSize * 4
+							  : texture::GetEncodedSize(blockFormat, slotSize, slotSize);
+	m_PageTable.resize(m_Layout.pageCount);
+
+	CreateImages();
+	CreateSamplers();
+	CreateFrameResources();
+}
+
+void VirtualTexture::Update(uint32_t frameIdx, VkCommandBuffer commandBuffer)
+{
+	FrameResources& frame = m_Frames[frameIdx];
+
+	if (frame.feedbackRecorded)
+	{
+		m_SampledPages.clear();
+		for (uint32_t page = 0; page < m_Layout.pageCount; ++page)
+		{
+			if (frame.feedback[page] != 0)
+				m_SampledPages.push_back(page);
+		}
+		memset(frame.feedback, 0, m_Layout.pageCount * sizeof(uint32_t));
+
+		m_TileCache->AddFeedback(m_SampledPages);
+		frame.feedbackRecorded = false;
+	}
+
+	// reads up to two frames of uploads ahead
+	const size_t maxPending = static_cast<size_t>(m_Options.maxUploadTiles) * 2;
+	if (m_PendingTiles.size() < maxPending)
+	{
+		const uint32_t maxLoads = static_cast<uint32_t>(maxPending - m_PendingTiles.size());
+		for (const TileLoad& load : m_TileCache->Plan(maxLoads))
+			StartLoad(load);
+	}
+
+	UploadTiles(frame, commandBuffer);
+}
+
+void VirtualTexture::EndFrame(uint32_t frameIdx, VkCommandBuffer commandBuffer)
+{
+	FrameResources& frame = m_Frames[frameIdx];
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = frame.feedbackBuffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		0,
+		nullptr,
+		1,
+		&barrier,
+		0,
+		nullptr);
+
+	frame.feedbackRecorded = true;
+}
+
+VirtualTextureConstants VirtualTexture::GetConstants() const
+{
+	VirtualTextureConstants constants{};
+	constants.width = m_Layout.width;
+	constants.height = m_Layout.height;
+	constants.tileSize = m_Layout.tileSize;
+	constants.tileBorder = VIRTUAL_TILE_BORDER;
+	constants.levelCount = m_Layout.levelCount;
+	constants.cacheSize = m_Options.cacheSize;
+	return constants;
+}
+
+VirtualTextureStats VirtualTexture::GetStats() const
+{
+	VirtualTextureStats stats{};
+	if (m_TileCache)
+		stats.cache = m_TileCache->GetStats();
+	stats.uploadedBytes = m_UploadedBytes;
+	stats.pageTableUploads = m_PageTableUploads;
+	return stats;
+}
+
+void VirtualTexture::StartLoad(const TileLoad& load)
+{
+	auto tile = std::make_unique<PendingTile>();
+	tile->load = load;
+
+	// a tile is small, so a single thread copies and decodes it, and the
+	// other ones the other tiles
+	PendingTile* pending = tile.get();
+	tile->future = m_ThreadPool->Submit([this, pending]() {
+		pending->texels.resize(static_cast<size_t>(m_TileBytes));
+		if (!m_Transcode)
+		{
+			texture::CopyTile(*m_File, m_Layout, pending->load.page, pending->texels.data());
+			return;
+		}
+
+		const uint32_t slotSize = m_Layout.tileSize + 2 * VIRTUAL_TILE_BORDER;
+		std::vector<uint8_t> blocks(texture::GetEncodedSize(m_File->GetBlockFormat(), slotSize, slotSize));
+		texture::CopyTile(*m_File, m_Layout, pending->load.page, blocks.data());
+		texture::Decode(m_File->GetBlockFormat(), blocks.data(), slotSize, slotSize, pending->texels.data());
+	});
+	m_PendingTiles.push_back(std::move(tile));
+}
+
+void VirtualTexture::UploadTiles(FrameResources& frame, VkCommandBuffer commandBuffer)
+{
+	// the tiles that were read, in the order they were started
+	const uint32_t slotSize = m_Layout.tileSize + 2 * VIRTUAL_TILE_BORDER;
+	std::vector<VkBufferImageCopy> tileRegions;
+	for (const std::unique_ptr<PendingTile>& tile : m_PendingTiles)
+	{
+		if (tileRegions.size() == m_Options.maxUploadTiles)
+			break;
+		if (tile->future.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+			continue;
+
+		try
+		{
+			tile->future.get();
+		} catch (...)
+		{
+			m_TileCache->Cancel(tile->load.page);
+			throw;
+		}
+
+		const VkDeviceSize offset = tileRegions.size() * m_TileBytes;
+		memcpy(frame.staging + offset, tile->texels.data(), static_cast<size_t>(m_TileBytes));
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = offset;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset.x = static_cast<int32_t>(tile->load.slot % m_Options.cacheSize * slotSize);
+		region.imageOffset.y = static_cast<int32_t>(tile->load.slot / m_Options.cacheSize * slotSize);
+		region.imageExtent = { slotSize, slotSize, 1 };
+		tileRegions.push_back(region);
+
+		m_TileCache->SetResident(tile->load.page);
+		m_UploadedBytes += m_TileBytes;
+	}
+	m_PendingTiles.erase(std::remove_if(m_PendingTiles.begin(),
+							 m_PendingTiles.end(),
+							 [](const std::unique_ptr<PendingTile>& tile) { return !tile->future.valid(); }),
+		m_PendingTiles.end());
+
+	// after the tiles that became resident, and the ones evicted for the
+	// loads that just started; a page table is small enough to be written
+	// whole
+	std::vector<VkBufferImageCopy> pageTableRegions;
+	if (m_TileCache->IsPageTableDirty())
+	{
+		const VkDeviceSize pageTableOffset = m_Options.maxUploadTiles * m_TileBytes;
+		m_TileCache->BuildPageTable(m_PageTable);
+		memcpy(frame.staging + pageTableOffset, m_PageTable.data(), m_PageTable.size() * sizeof(uint32_t));
+
+		for (uint32_t level = 0; level < m_Layout.levelCount; ++level)
+		{
+			VkBufferImageCopy region{};
+			region.bufferOffset = pageTableOffset + m_Layout.firstPage[level] * sizeof(uint32_t);
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { m_Layout.pagesX[level], m_Layout.pagesY[level], 1 };
+			pageTableRegions.push_back(region);
+		}
+		++m_PageTableUploads;
+	}
+
+	// the images are undefined until they are first written; the cache is
+	// only sampled where the page table maps a tile
+	const VkImageLayout oldLayout =
+		m_ImagesInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	const VkAccessFlags oldAccess = m_ImagesInitialized ? VK_ACCESS_SHADER_READ_BIT : 0;
+	std::vector<VkImageMemoryBarrier> transferBarriers;
+	std::vector<VkImageMemoryBarrier> shaderBarriers;
+	if (!tileRegions.empty())
+	{
+		transferBarriers.push_back(GetImageBarrier(m_CacheImage,
+			1,
+			oldLayout,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			oldAccess,
+			VK_ACCESS_TRANSFER_WRITE_BIT));
+		shaderBarriers.push_back(GetImageBarrier(m_CacheImage,
+			1,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT));
+	}
+	else if (!m_ImagesInitialized)
+	{
+		shaderBarriers.push_back(GetImageBarrier(m_CacheImage,
+			1,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			0,
+			VK_ACCESS_SHADER_READ_BIT));
+	}
+	// dirty until it is first written
+	if (!pageTableRegions.empty())
+	{
+		transferBarriers.push_back(GetImageBarrier(m_PageTableImage,
+			m_Layout.levelCount,
+			oldLayout,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			oldAccess,
+			VK_ACCESS_TRANSFER_WRITE_BIT));
+		shaderBarriers.push_back(GetImageBarrier(m_PageTableImage,
+			m_Layout.levelCount,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT));
+	}
+	if (shaderBarriers.empty())
+		return;
+
+	// the frames in flight may still sample the slots and the page table
+	if (!transferBarriers.empty())
+	{
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			static_cast<uint32_t>(transferBarriers.size()),
+			transferBarriers.data());
+	}
+	if (!tileRegions.empty())
+	{
+		vkCmdCopyBufferToImage(commandBuffer,
+			frame.stagingBuffer,
+			m_CacheImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(tileRegions.size()),
+			tileRegions.data());
+	}
+	if (!pageTableRegions.empty())
+	{
+		vkCmdCopyBufferToImage(commandBuffer,
+			frame.stagingBuffer,
+			m_PageTableImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(pageTableRegions.size()),
+			pageTableRegions.data());
+	}
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(shaderBarriers.size()),
+		shaderBarriers.data());
+
+	m_ImagesInitialized = true;
+}
+
+void VirtualTexture::CreateImages()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+
+	const uint32_t cacheTexels = m_Options.cacheSize * (m_Layout.tileSize + 2 * VIRTUAL_TILE_BORDER);
+	if (cacheTexels > properties.limits.maxImageDimension2D)
+		throw std::runtime_error("The tile cache is larger than the images of the device!");
+
+	utils::img::CreateImage(m_Device->GetDevice(),
+		m_Device->GetAllocator(),
+		cacheTexels,
+		cacheTexels,
+		1,
+		VK_SAMPLE_COUNT_1_BIT,
+		m_Format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_CacheImage,
+		m_CacheMemory);
+	m_CacheView =
+		utils::img::CreateImageView(m_Device->GetDevice(), m_CacheImage, m_Format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+
+	// a level per level of the virtual texture, the pages halve like the
+	// levels of an image
+	utils::img::CreateImage(m_Device->GetDevice(),
+		m_Device->GetAllocator(),
+		m_Layout.pagesX[0],
+		m_Layout.pagesY[0],
+		m_Layout.levelCount,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_FORMAT_R8G8B8A8_UINT,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_PageTableImage,
+		m_PageTableMemory);
+	m_PageTableView = utils::img::CreateImageView(m_Device->GetDevice(),
+		m_PageTableImage,
+		VK_FORMAT_R8G8B8A8_UINT,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		m_Layout.levelCount);
+}
+
+void VirtualTexture::CreateSamplers()
+{
+	// the shader picks the level and the texel within the tile itself; the
+	// borders hold up to bilinear filtering, not to anisotropic
+	VkSamplerCreateInfo samplerCreateInfo{};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1.0f;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerCreateInfo.compareEnable = VK_FALSE;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = 0.0f;
+	if (vkCreateSampler(m_Device->GetDevice(), &samplerCreateInfo, nullptr, &m_CacheSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create tile cache sampler!");
+
+	// integer texels are only ever fetched
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.maxLod = static_cast<float>(m_Layout.levelCount);
+	if (vkCreateSampler(m_Device->GetDevice(), &samplerCreateInfo, nullptr, &m_PageTableSampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create page table sampler!");
+}
+
+void VirtualTexture::CreateFrameResources()
+{
+	const VkDeviceSize feedbackSize = m_Layout.pageCount * sizeof(uint32_t);
+	const VkDeviceSize stagingSize = m_Options.maxUploadTiles * m_TileBytes + m_Layout.pageCount * sizeof(uint32_t);
+	for (FrameResources& frame : m_Frames)
+	{
+		// read back by the host every frame, so kept mapped in host memory
+		utils::buff::CreateBuffer(m_Device->GetDevice(),
+			m_Device->GetAllocator(),
+			feedbackSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.feedbackBuffer,
+			frame.feedbackMemory);
+
+		frame.feedback = reinterpret_cast<uint32_t*>(frame.feedbackMemory.mapped);
+		memset(frame.feedback, 0, static_cast<size_t>(feedbackSize));
+
+		utils::buff::CreateBuffer(m_Device->GetDevice(),
+			m_Device->GetAllocator(),
+			stagingSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.stagingBuffer,
+			frame.stagingMemory);
+
+		frame.staging = frame.stagingMemory.mapped;
+	}
+}
+
+void VirtualTexture::FreeFrame(FrameResources& frame)
+{
+	if (frame.feedbackBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), frame.feedbackBuffer, nullptr);
+		m_Device->GetAllocator().Free(frame.feedbackMemory);
+	}
+	if (frame.stagingBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_Device->GetDevice(), frame.stagingBuffer, nullptr);
+		m_Device->GetAllocator().Free(frame.stagingMemory);
+	}
+	frame = FrameResources{};
+}
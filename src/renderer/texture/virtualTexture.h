@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "core/assetCache.h"
+#include "core/threadPool.h"
+#include "renderer/device.h"
+#include "renderer/texture/ktxFile.h"
+#include "renderer/texture/tileCache.h"
+
+
+// tiles uploaded per frame at most by default, 2.3 MB of BC7 tiles of 128
+// texels
+constexpr uint32_t DEFAULT_MAX_TILE_UPLOADS = 128;
+
+struct VirtualTextureOptions
+{
+	uint32_t tileSize = DEFAULT_VIRTUAL_TILE_SIZE;
+	// slots on a side of the tile cache
+	uint32_t cacheSize = DEFAULT_TILE_CACHE_SIZE;
+	uint32_t maxUploadTiles = DEFAULT_MAX_TILE_UPLOADS;
+	// only the cooked texture is opened, otherwise the image is cooked when
+	// it is missing, through `cache` (optional)
+	bool requireCooked = false;
+	AssetCache* cache = nullptr;
+};
+
+struct VirtualTextureStats
+{
+	TileCacheStats cache;
+	// by the frames since the texture was loaded
+	uint64_t uploadedBytes;
+	uint64_t pageTableUploads;
+};
+
+// the push constants of the fragment shader that samples a virtual texture
+// (texturedVirtual.frag)
+struct VirtualTextureConstants
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileSize;
+	uint32_t tileBorder;
+	uint32_t levelCount;
+	uint32_t cacheSize;
+};
+
+
+// a texture too large to be resident, eg: terrain or photogrammetry, split
+// into tiles of every level of its mip chain that are read into the slots of
+// a tile cache (a single image) as the fragment shader samples them
+// the shader finds the slot of a page in the page table, an image with a
+// texel per page of every level that holds the slot of the page or of its
+// finest resident ancestor, and writes every page it samples into a
+// feedback buffer, read back once the frame is done and fed to a
+// `TileCache`; the tiles are read from the cooked texture on the thread
+// pool, decoded to RGBA8 on devices without BC, and at most
+// `maxUploadTiles` of them are uploaded per frame
+// the slots are written with copies instead of sparse residency, so it runs
+// on any device with the sampling feedback (`Device::SupportsSamplingFeedback`)
+class VirtualTexture
+{
+public:
+	VirtualTexture(const Device* device,
+		ThreadPool& threadPool,
+		uint32_t maxFramesInFlight,
+		const VirtualTextureOptions& options = {});
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// opens the cooked texture of the image and creates the tile cache, the
+	// page table and the feedback buffers; no tile is resident until the
+	// first frames ask for them, and the pages are drawn black until then
+	// throws if the image is not a power of two on both sides
+	void Load(const std::string& path);
+
+	// once the frame is done with the previous commands recorded for
+	// `frameIdx`, before its render pass: reads their feedback, records the
+	// uploads of the tiles that were read and of the page table, and starts
+	// reading the tiles the frames sampled next
+	void Update(uint32_t frameIdx, VkCommandBuffer commandBuffer);
+	// after the render pass, makes the feedback visible to the host
+	void EndFrame(uint32_t frameIdx, VkCommandBuffer commandBuffer);
+
+	// the tile cache at binding 0 of the texture set, sampled with its own
+	// sampler
+	inline VkImageView GetCacheView() const { return m_CacheView; }
+	inline VkSampler GetCacheSampler() const { return m_CacheSampler; }
+	// the page table at binding 1 of the texture set, an RGBA8_UINT image
+	// with a level per level of the virtual texture
+	inline VkImageView GetPageTableView() const { return m_PageTableView; }
+	inline VkSampler GetPageTableSampler() const { return m_PageTableSampler; }
+	// a uint per page at binding 1 of the frame set, not 0 when the frame
+	// sampled it
+	inline VkBuffer GetFeedbackBuffer(uint32_t frameIdx) const { return m_Frames[frameIdx].feedbackBuffer; }
+	VirtualTextureConstants GetConstants() const;
+
+	inline const VirtualTextureLayout& GetLayout() const { return m_Layout; }
+	VirtualTextureStats GetStats() const;
+
+private:
+	struct FrameResources
+	{
+		VkBuffer feedbackBuffer = VK_NULL_HANDLE;
+		DeviceAllocation feedbackMemory;
+		uint32_t* feedback = nullptr;
+		// false until commands that write it were recorded
+		bool feedbackRecorded = false;
+
+		// the tiles, then the page table
+		VkBuffer stagingBuffer = VK_NULL_HANDLE;
+		DeviceAllocation stagingMemory;
+		uint8_t* staging = nullptr;
+	};
+
+	// a page read on the thread pool
+	struct PendingTile
+	{
+		TileLoad load;
+		std::future<void> future;
+		std::vector<uint8_t> texels;
+	};
+
+	void StartLoad(const TileLoad& load);
+	// records the copies of the tiles that were read, and of the page table
+	// when it changed
+	void UploadTiles(FrameResources& frame, VkCommandBuffer commandBuffer);
+
+	void CreateImages();
+	void CreateSamplers();
+	void CreateFrameResources();
+	void FreeFrame(FrameResources& frame);
+
+private:
+	const Device* m_Device;
+	ThreadPool* m_ThreadPool;
+	uint32_t m_MaxFramesInFlight;
+	VirtualTextureOptions m_Options;
+
+	std::unique_ptr<KtxFile> m_File;
+	VirtualTextureLayout m_Layout;
+	std::unique_ptr<TileCache> m_TileCache;
+	// of the cache, the tiles are decoded to RGBA8 when it is not the format
+	// of the cooked texture
+	VkFormat m_Format;
+	bool m_Transcode;
+	// bytes of a tile with its border
+	VkDeviceSize m_TileBytes;
+
+	VkImage m_CacheImage;
+	DeviceAllocation m_CacheMemory;
+	VkImageView m_CacheView;
+	VkSampler m_CacheSampler;
+	VkImage m_PageTableImage;
+	DeviceAllocation m_PageTableMemory;
+	VkImageView m_PageTableView;
+	VkSampler m_PageTableSampler;
+	// the images are undefined until the first frame
+	bool m_ImagesInitialized;
+
+	std::vector<FrameResources> m_Frames;
+	// written by the tasks, so they do not move
+	std::vector<std::unique_ptr<PendingTile>> m_PendingTiles;
+	std::vector<uint32_t> m_SampledPages;
+	std::vector<uint32_t> m_PageTable;
+
+	uint64_t m_UploadedBytes;
+	uint64_t m_PageTableUploads;
+};
@@ -0,0 +1,209 @@
+#include "textureFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "stb_image/stb_image.h"
+
+#include "core/hash.h"
+
+
+TextureFile::TextureFile(const std::string& path)
+	: m_File{ std::make_unique<MappedFile>(path) },
+	  m_Header{}
+{
+	Validate();
+}
+
+void TextureFile::Validate()
+{
+	if (m_File->GetSize() < sizeof(TextureFileHeader))
+		throw std::runtime_error("Cooked texture is too small: " + m_File->GetPath());
+
+	memcpy(&m_Header, m_File->GetData(), sizeof(TextureFileHeader));
+
+	if (m_Header.magic != TEXTURE_FILE_MAGIC)
+		throw std::runtime_error("Not a cooked texture file: " + m_File->GetPath());
+	if (m_Header.version != TEXTURE_FILE_VERSION)
+		throw std::runtime_error("Unsupported cooked texture version: " + m_File->GetPath());
+	if (m_Header.width == 0 || m_Header.height == 0)
+		throw std::runtime_error("Cooked texture is empty: " + m_File->GetPath());
+	if (m_Header.levelCount == 0 || m_Header.levelCount > texture::GetMipLevelCount(m_Header.width, m_Header.height))
+		throw std::runtime_error("Invalid cooked texture level count: " + m_File->GetPath());
+
+	// the encoded texels are checked chunk by chunk while decoding them
+	if (m_Header.texelEncoding != static_cast<uint32_t>(StreamEncoding::RAW)
+		&& m_Header.texelEncoding != static_cast<uint32_t>(StreamEncoding::LZ)
+		&& m_Header.texelEncoding != static_cast<uint32_t>(StreamEncoding::DELTA))
+		throw std::runtime_error("Unsupported cooked texture encoding: " + m_File->GetPath());
+	if (m_Header.texelEncoding == static_cast<uint32_t>(StreamEncoding::RAW)
+		&& m_Header.texelEncodedSize != GetTexelSize())
+		throw std::runtime_error("Cooked texture is truncated: " + m_File->GetPath());
+
+	if (m_Header.texelOffset > m_File->GetSize()
+		|| m_Header.texelEncodedSize > m_File->GetSize() - m_Header.texelOffset)
+		throw std::runtime_error("Cooked texture is truncated: " + m_File->GetPath());
+}
+
+std::string TextureFile::GetCookedPath(const std::string& imagePath)
+{
+	return std::filesystem::path{ imagePath }.replace_extension(".tex").string();
+}
+
+bool TextureFile::IsUpToDate(const std::string& path, const std::string& sourcePath)
+{
+	std::error_code errorCode;
+	if (!std::filesystem::exists(path, errorCode))
+		return false;
+
+	// a cooked texture without its source is used as is
+	if (std::filesystem::exists(sourcePath, errorCode))
+	{
+		const auto sourceTime = std::filesystem::last_write_time(sourcePath, errorCode);
+		const auto cookedTime = std::filesystem::last_write_time(path, errorCode);
+		if (errorCode || cookedTime < sourceTime)
+			return false;
+	}
+
+	return IsCompatible(path);
+}
+
+bool TextureFile::IsCompatible(const std::string& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	TextureFileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		return false;
+
+	return header.magic == TEXTURE_FILE_MAGIC && header.version == TEXTURE_FILE_VERSION;
+}
+
+bool TextureFile::Write(const std::string& path,
+	uint32_t width,
+	uint32_t height,
+	uint32_t levelCount,
+	const uint8_t* texels,
+	ThreadPool& threadPool)
+{
+	const Span<const uint8_t> data{ texels, static_cast<size_t>(GetTexelSize(width, height, levelCount)) };
+
+	// delta coding wins on smooth images, plain LZ on flat colours and
+	// noise; encoding is cheap next to decoding the source image
+	std::vector<uint8_t> encoded = codec::Encode(data, StreamEncoding::LZ, TEXTURE_FILE_TEXEL_SIZE, threadPool);
+	StreamEncoding encoding = StreamEncoding::LZ;
+	std::vector<uint8_t> deltaEncoded = codec::Encode(data, StreamEncoding::DELTA, TEXTURE_FILE_TEXEL_SIZE, threadPool);
+	if (deltaEncoded.size() < encoded.size())
+	{
+		encoded = std::move(deltaEncoded);
+		encoding = StreamEncoding::DELTA;
+	}
+
+	TextureFileHeader header{};
+	header.magic = TEXTURE_FILE_MAGIC;
+	header.version = TEXTURE_FILE_VERSION;
+	header.width = width;
+	header.height = height;
+	header.levelCount = levelCount;
+	header.texelEncoding = static_cast<uint32_t>(encoding);
+	header.texelOffset = sizeof(TextureFileHeader);
+	header.texelEncodedSize = encoded.size();
+
+	// write to a temporary file first and rename it afterwards, so that a
+	// crash while cooking never leaves a half written texture behind
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(tempPath, path, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(tempPath, errorCode);
+		return false;
+	}
+
+	return true;
+}
+
+uint64_t TextureFile::GetTexelSize(uint32_t width, uint32_t height, uint32_t levelCount)
+{
+	uint64_t size = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+		size += static_cast<uint64_t>(std::max(1u, width >> level)) * std::max(1u, height >> level);
+	return size * TEXTURE_FILE_TEXEL_SIZE;
+}
+
+std::vector<uint8_t> TextureFile::BuildTexels(const uint8_t* texels,
+	uint32_t width,
+	uint32_t height,
+	texture::MipFilter mipFilter,
+	ThreadPool& threadPool)
+{
+	const std::vector<texture::MipLevel> mipChain =
+		texture::BuildMipChain(texels, width, height, mipFilter, true, threadPool);
+
+	std::vector<uint8_t> chain(GetTexelSize(width, height, texture::GetMipLevelCount(width, height)));
+	const size_t imageSize = static_cast<size_t>(width) * height * TEXTURE_FILE_TEXEL_SIZE;
+	memcpy(chain.data(), texels, imageSize);
+	size_t offset = imageSize;
+	for (const texture::MipLevel& level : mipChain)
+	{
+		memcpy(chain.data() + offset, level.texels.data(), level.texels.size());
+		offset += level.texels.size();
+	}
+
+	return chain;
+}
+
+uint64_t TextureFile::GetCacheKey(const std::string& imagePath, texture::MipFilter mipFilter)
+{
+	return AssetCache::MakeKey(
+		"texture", TEXTURE_FILE_VERSION, hash::HashFile(imagePath), static_cast<uint64_t>(mipFilter));
+}
+
+bool TextureFile::Cook(const std::string& imagePath,
+	const std::string& path,
+	ThreadPool& threadPool,
+	AssetCache* cache,
+	texture::MipFilter mipFilter)
+{
+	const uint64_t cacheKey = cache ? GetCacheKey(imagePath, mipFilter) : 0;
+	if (cache && cache->Extract(cacheKey, path) && IsCompatible(path))
+		return true;
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	// force alpha (even if there isnt one), like the textures
+	stbi_uc* texels = stbi_load(imagePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!texels)
+		throw std::runtime_error("Failed to load texture image: " + imagePath);
+
+	const uint32_t textureWidth = static_cast<uint32_t>(width);
+	const uint32_t textureHeight = static_cast<uint32_t>(height);
+	const std::vector<uint8_t> chain = BuildTexels(texels, textureWidth, textureHeight, mipFilter, threadPool);
+	stbi_image_free(texels);
+
+	const bool written = Write(path,
+		textureWidth,
+		textureHeight,
+		texture::GetMipLevelCount(textureWidth, textureHeight),
+		chain.data(),
+		threadPool);
+	if (written && cache)
+		cache->StoreFile(cacheKey, path);
+	return written;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/assetCache.h"
+#include "core/codec.h"
+#include "core/mappedFile.h"
+#include "core/threadPool.h"
+#include "renderer/texture/mipChain.h"
+
+
+// cooked texture format, the RGBA8 texels of a decoded image and of its mip
+// chain so that loading it skips decoding the source image and generating
+// the mips
+// the file is laid out as:
+//     TextureFileHeader
+//     texel blob (every level, the largest first, each `GetLevelWidth(level) *
+//                 GetLevelHeight(level) * 4` bytes, at texelOffset,
+//                 texelEncodedSize bytes in texelEncoding)
+constexpr uint32_t TEXTURE_FILE_MAGIC = 0x52584554; // "TEXR"
+constexpr uint32_t TEXTURE_FILE_VERSION = 2; // bump this when the layout or the contents change
+constexpr uint32_t TEXTURE_FILE_TEXEL_SIZE = 4;
+
+struct TextureFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t texelEncoding; // StreamEncoding
+	uint32_t levelCount;
+	uint64_t texelOffset; // byte offset of the texel blob from the start of the file
+	uint64_t texelEncodedSize; // size of the texel blob in bytes
+};
+
+static_assert(sizeof(TextureFileHeader) == 40, "TextureFileHeader layout must not depend on the compiler");
+
+
+class TextureFile
+{
+public:
+	// maps the cooked texture into memory and validates the header
+	TextureFile(const std::string& path);
+
+	// encodes `texels` (`GetTexelSize(width, height, levelCount)` bytes of
+	// RGBA8 texels, laid out like the texel blob) with whichever of LZ and
+	// DELTA makes them smaller and writes them; returns false if the file
+	// could not be written
+	static bool Write(const std::string& path,
+		uint32_t width,
+		uint32_t height,
+		uint32_t levelCount,
+		const uint8_t* texels,
+		ThreadPool& threadPool);
+
+	// the `width * height` RGBA8 texels of an image followed by every level
+	// of its mip chain, laid out like the texel blob
+	static std::vector<uint8_t> BuildTexels(const uint8_t* texels,
+		uint32_t width,
+		uint32_t height,
+		texture::MipFilter mipFilter,
+		ThreadPool& threadPool);
+
+	// decodes the source image, builds its mip chain with `mipFilter` and
+	// writes them with `Write`, unless `cache` has it already; throws if the
+	// image cannot be decoded, returns false if the file could not be written
+	static bool Cook(const std::string& imagePath,
+		const std::string& path,
+		ThreadPool& threadPool,
+		AssetCache* cache = nullptr,
+		texture::MipFilter mipFilter = texture::MipFilter::KAISER);
+
+	// of the texture cooked from the image in the asset cache
+	static uint64_t GetCacheKey(const std::string& imagePath, texture::MipFilter mipFilter);
+
+	// of the texel blob before encoding
+	static uint64_t GetTexelSize(uint32_t width, uint32_t height, uint32_t levelCount);
+
+	// checks if the cooked texture was written with the current version and
+	// after its source image, without mapping the whole file
+	static bool IsUpToDate(const std::string& path, const std::string& sourcePath);
+	// only checks the version, eg: when the cooker tracks the source images
+	static bool IsCompatible(const std::string& path);
+
+	// path of the cooked texture for a source image (eg: `room.png` -> `room.tex`)
+	static std::string GetCookedPath(const std::string& imagePath);
+
+	// points directly into the mapped file
+	inline EncodedStream GetTexelData() const
+	{
+		const Span<const uint8_t> data{ m_File->GetData() + m_Header.texelOffset, m_Header.texelEncodedSize };
+		return EncodedStream{ data,
+			GetTexelSize(),
+			static_cast<StreamEncoding>(m_Header.texelEncoding),
+			TEXTURE_FILE_TEXEL_SIZE };
+	}
+
+	inline uint32_t GetWidth() const { return m_Header.width; }
+	inline uint32_t GetHeight() const { return m_Header.height; }
+	inline uint32_t GetLevelCount() const { return m_Header.levelCount; }
+	inline uint32_t GetLevelWidth(uint32_t level) const { return std::max(1u, m_Header.width >> level); }
+	inline uint32_t GetLevelHeight(uint32_t level) const { return std::max(1u, m_Header.height >> level); }
+	// byte offset of the level in the decoded texel blob
+	inline uint64_t GetLevelOffset(uint32_t level) const
+	{
+		return GetTexelSize(m_Header.width, m_Header.height, level);
+	}
+	inline uint64_t GetTexelSize() const
+	{
+		return GetTexelSize(m_Header.width, m_Header.height, m_Header.levelCount);
+	}
+
+	// reads the whole file in, see `MappedFile::Prefetch`
+	inline void Prefetch() const { m_File->Prefetch(); }
+
+private:
+	void Validate();
+
+private:
+	std::unique_ptr<MappedFile> m_File;
+	TextureFileHeader m_Header;
+};
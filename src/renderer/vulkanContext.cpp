@@ -35,7 +35,9 @@ void VulkanContext::CreateInstance(const char* title)
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+	// the highest version used, the bindless textures need 1.2 and are
+	// skipped on devices that do not support it
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	// specify which extensions and validation layers to use
 	VkInstanceCreateInfo instanceCreateInfo{};
@@ -2,20 +2,13 @@
 
 #include <stdexcept>
 
-#include "utils.h"
 #include "utils/commandBufferUtils.h"
 
 
 namespace utils {
 namespace buff {
 
-void CreateBuffer(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
-	VkDeviceSize size,
-	VkBufferUsageFlags usage,
-	VkMemoryPropertyFlags properties,
-	VkBuffer& buffer,
-	VkDeviceMemory& bufferMemory)
+static VkBuffer CreateUnboundBuffer(VkDevice deviceVk, VkDeviceSize size, VkBufferUsageFlags usage)
 {
 	VkBufferCreateInfo bufferCreateInfo{};
 	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -25,27 +18,54 @@ void CreateBuffer(VkDevice deviceVk,
 															  // queue family or be shared between
 															  // multiple at the same time
 
+	VkBuffer buffer;
 	if (vkCreateBuffer(deviceVk, &bufferCreateInfo, nullptr, &buffer) != VK_SUCCESS)
 		throw std::runtime_error("Failed to create vertex buffer!");
 
-	// assign memory to the buffer
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(deviceVk, buffer, &memRequirements);
-
-	// memory allocation
-	VkMemoryAllocateInfo memAllocInfo{};
-	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.allocationSize = memRequirements.size;
-	memAllocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+	return buffer;
+}
 
-	// we are not supposed to call vkAllocateMemory() for every individual
-	// buffer, because we have a limited maxMemoryAllocationCount instead we
-	// can allocate a large memory and use offset to split the memory
-	// TODO: create a custom allocator
-	if (vkAllocateMemory(deviceVk, &memAllocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate vertex buffer memory!");
+void CreateBuffer(VkDevice deviceVk,
+	DeviceAllocator& allocator,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	VkMemoryPropertyFlags properties,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory)
+{
+	buffer = CreateUnboundBuffer(deviceVk, size, usage);
+
+	// a range of a large block of device memory rather than an allocation of
+	// its own, since the number of allocations is limited
+	// (maxMemoryAllocationCount) and each is slow
+	try
+	{
+		bufferMemory = allocator.AllocateBuffer(buffer, properties);
+	} catch (...)
+	{
+		vkDestroyBuffer(deviceVk, buffer, nullptr);
+		throw;
+	}
+}
 
-	vkBindBufferMemory(deviceVk, buffer, bufferMemory, 0);
+void CreateBufferInType(VkDevice deviceVk,
+	DeviceAllocator& allocator,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	uint32_t memoryType,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory)
+{
+	buffer = CreateUnboundBuffer(deviceVk, size, usage);
+
+	try
+	{
+		bufferMemory = allocator.AllocateBufferInType(buffer, memoryType);
+	} catch (...)
+	{
+		vkDestroyBuffer(deviceVk, buffer, nullptr);
+		throw;
+	}
 }
 
 void CopyBuffer(VkDevice deviceVk,
@@ -53,13 +73,14 @@ void CopyBuffer(VkDevice deviceVk,
 	VkCommandPool commandPool,
 	VkBuffer srcBuffer,
 	VkBuffer dstBuffer,
-	VkDeviceSize size)
+	VkDeviceSize size,
+	VkDeviceSize dstOffset)
 {
 	VkCommandBuffer cmdBuff = cmd::BeginSingleTimeCommands(deviceVk, commandPool);
 
 	VkBufferCopy copyRegion{};
 	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
 	// transfer the contents of the buffers
 	vkCmdCopyBuffer(cmdBuff, srcBuffer, dstBuffer, 1, &copyRegion);
@@ -98,5 +119,20 @@ void CopyBufferToImage(VkDevice deviceVk,
 	cmd::EndSingleTimeCommands(deviceVk, graphicsQueue, commandPool, cmdBuff);
 }
 
+void CopyBufferToImage(VkDevice deviceVk,
+	VkQueue graphicsQueue,
+	VkCommandPool commandPool,
+	VkBuffer buffer,
+	VkImage image,
+	const VkBufferImageCopy* regions,
+	uint32_t regionCount)
+{
+	VkCommandBuffer cmdBuff = cmd::BeginSingleTimeCommands(deviceVk, commandPool);
+
+	vkCmdCopyBufferToImage(cmdBuff, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);
+
+	cmd::EndSingleTimeCommands(deviceVk, graphicsQueue, commandPool, cmdBuff);
+}
+
 } // namespace buff
 } // namespace utils
\ No newline at end of file
@@ -2,24 +2,38 @@
 
 #include <vulkan/vulkan.h>
 
+#include "renderer/memory/deviceAllocator.h"
+
 
 namespace utils {
 namespace buff {
 
+// the memory of the buffer is sub-allocated from `allocator`, and mapped if
+// it is host visible; it is freed with `DeviceAllocator::Free` once the
+// buffer is destroyed
 void CreateBuffer(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	DeviceAllocator& allocator,
 	VkDeviceSize size,
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkBuffer& buffer,
-	VkDeviceMemory& bufferMemory);
+	DeviceAllocation& bufferMemory);
+// from exactly `memoryType` instead, see `DeviceAllocator::AllocateBufferInType`
+void CreateBufferInType(VkDevice deviceVk,
+	DeviceAllocator& allocator,
+	VkDeviceSize size,
+	VkBufferUsageFlags usage,
+	uint32_t memoryType,
+	VkBuffer& buffer,
+	DeviceAllocation& bufferMemory);
 
 void CopyBuffer(VkDevice deviceVk,
 	VkQueue graphicsQueue,
 	VkCommandPool commandPool,
 	VkBuffer srcBuffer,
 	VkBuffer dstBuffer,
-	VkDeviceSize size);
+	VkDeviceSize size,
+	VkDeviceSize dstOffset = 0);
 
 void CopyBufferToImage(VkDevice deviceVk,
 	VkQueue graphicsQueue,
@@ -29,5 +43,14 @@ void CopyBufferToImage(VkDevice deviceVk,
 	uint32_t width,
 	uint32_t height);
 
+// copies every region (eg: every mip level) in a single command
+void CopyBufferToImage(VkDevice deviceVk,
+	VkQueue graphicsQueue,
+	VkCommandPool commandPool,
+	VkBuffer buffer,
+	VkImage image,
+	const VkBufferImageCopy* regions,
+	uint32_t regionCount);
+
 } // namespace buff
 } // namespace utils
\ No newline at end of file
@@ -2,12 +2,17 @@
 
 #include <vulkan/vulkan.h>
 
+#include "renderer/memory/deviceAllocator.h"
+
 
 namespace utils {
 namespace img {
 
+// the memory of the image is sub-allocated from `allocator`, or allocated on
+// its own when the driver prefers that; it is freed with
+// `DeviceAllocator::Free` once the image is destroyed
 void CreateImage(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	DeviceAllocator& allocator,
 	uint32_t width,
 	uint32_t height,
 	uint32_t mipLevels,
@@ -17,7 +22,7 @@ void CreateImage(VkDevice deviceVk,
 	VkImageUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory);
+	DeviceAllocation& imageMemory);
 
 VkImageView CreateImageView(VkDevice deviceVk,
 	VkImage image,
@@ -25,15 +30,5 @@ VkImageView CreateImageView(VkDevice deviceVk,
 	VkImageAspectFlags aspectFlags,
 	uint32_t mipLevels);
 
-void GenerateMipmaps(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
-	VkCommandPool commandPool,
-	VkQueue graphicsQueue,
-	VkImage image,
-	VkFormat format,
-	int32_t width,
-	int32_t height,
-	uint32_t mipLevels);
-
 } // namespace img
 } // namespace utils
\ No newline at end of file